@@ -0,0 +1,228 @@
+#ifndef _CMathArena_CPP
+#define _CMathArena_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include "CMathArena.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define MATHARENA_ALIGNMENT 16
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathArena::CMathArena(size_t iBlockSize)
+{
+	this->Initialize(iBlockSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathArena::CMathArena(void)
+{
+	this->Initialize(CMATHARENA_DEFAULT_BLOCK_SIZE);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathArena::~CMathArena(void)
+{
+	while (this->pFirst)
+	{
+		MATHARENABLOCK *pNext = this->pFirst->Next;
+		free(this->pFirst);
+		this->pFirst = pNext;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathArena::Initialize(size_t iBlockSize)
+{
+	this->pFirst = NULL;
+	this->pCurrent = NULL;
+	this->pLast = NULL;
+	this->iBlockSize = iBlockSize;
+	this->iHeapAllocations = 0;
+	this->iReserved = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t CMathArena::Align(size_t iSize)
+{
+	return (iSize + (MATHARENA_ALIGNMENT - 1)) & ~(size_t)(MATHARENA_ALIGNMENT - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+char *CMathArena::BlockData(MATHARENABLOCK *pBlock)
+{
+	return ((char *)pBlock) + Align(sizeof(MATHARENABLOCK));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of blocks which have been allocated from the heap, for checking that repeated evaluations
+///	no longer allocate memory once they are warmed up.
+/// </summary>
+/// <returns></returns>
+size_t CMathArena::HeapAllocations(void)
+{
+	return this->iHeapAllocations;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of bytes held by the blocks.
+/// </summary>
+/// <returns></returns>
+size_t CMathArena::Reserved(void)
+{
+	return this->iReserved;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Allocates zero filled memory which stays valid until Release() is called with a mark taken before it.
+/// </summary>
+/// <param name="iSize"></param>
+/// <returns>NULL if memory could not be allocated.</returns>
+void *CMathArena::Allocate(size_t iSize)
+{
+	size_t iAligned = Align(iSize > 0 ? iSize : 1);
+
+	if (!this->pCurrent || this->pCurrent->Used + iAligned > this->pCurrent->Size)
+	{
+		//The blocks after the current one are free, use the first one which is large enough.
+		MATHARENABLOCK *pBlock = this->pCurrent ? this->pCurrent->Next : this->pFirst;
+		while (pBlock && pBlock->Size < iAligned)
+		{
+			pBlock = pBlock->Next;
+		}
+
+		if (!pBlock)
+		{
+			size_t iBlockSize = (iAligned > this->iBlockSize) ? iAligned : this->iBlockSize;
+
+			pBlock = (MATHARENABLOCK *)malloc(Align(sizeof(MATHARENABLOCK)) + iBlockSize);
+			if (!pBlock)
+			{
+				return NULL;
+			}
+
+			pBlock->Size = iBlockSize;
+
+			if (this->pCurrent)
+			{
+				pBlock->Next = this->pCurrent->Next;
+				this->pCurrent->Next = pBlock;
+			}
+			else {
+				pBlock->Next = this->pFirst;
+				this->pFirst = pBlock;
+			}
+
+			this->iHeapAllocations++;
+			this->iReserved += iBlockSize;
+		}
+
+		pBlock->Used = 0;
+		this->pCurrent = pBlock;
+	}
+
+	char *pMemory = BlockData(this->pCurrent) + this->pCurrent->Used;
+	this->pCurrent->Used += iAligned;
+	this->pLast = pMemory;
+
+	memset(pMemory, 0, iSize);
+
+	return pMemory;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Resizes an allocation, keeping its contents. The most recent allocation grows in place when there is room,
+///	others are copied (the old memory is only reclaimed by Release()). Memory added to the allocation is not zero
+///	filled.
+/// </summary>
+/// <param name="pMemory">NULL to allocate.</param>
+/// <param name="iOldSize">Size the memory was allocated (or last reallocated) with.</param>
+/// <param name="iNewSize"></param>
+/// <returns>NULL if memory could not be allocated, in which case the old memory is unchanged.</returns>
+void *CMathArena::Reallocate(void *pMemory, size_t iOldSize, size_t iNewSize)
+{
+	if (!pMemory)
+	{
+		return this->Allocate(iNewSize);
+	}
+
+	if (iNewSize <= iOldSize)
+	{
+		return pMemory;
+	}
+
+	if (pMemory == this->pLast)
+	{
+		size_t iOffset = (char *)pMemory - BlockData(this->pCurrent);
+		size_t iAligned = Align(iNewSize);
+
+		if (iOffset + iAligned <= this->pCurrent->Size)
+		{
+			this->pCurrent->Used = iOffset + iAligned;
+			return pMemory;
+		}
+	}
+
+	//The copy is given room to grow in place, so that an allocation which keeps growing (ex: the expression text as
+	//	variables are replaced) is not copied every time.
+	size_t iReserve = (iNewSize > iOldSize * 2) ? iNewSize : iOldSize * 2;
+
+	void *pNewMemory = this->Allocate(iReserve);
+	if (pNewMemory)
+	{
+		memcpy(pNewMemory, pMemory, iOldSize);
+		this->pCurrent->Used -= Align(iReserve) - Align(iNewSize);
+	}
+
+	return pNewMemory;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Remembers the current position, see Release().
+/// </summary>
+/// <returns></returns>
+CMathArena::MATHARENAMARK CMathArena::Mark(void)
+{
+	MATHARENAMARK Mark;
+	Mark.Block = this->pCurrent;
+	Mark.Used = this->pCurrent ? this->pCurrent->Used : 0;
+	return Mark;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Releases everything allocated since the mark was taken. Marks have to be released in the opposite order of
+///	taking them.
+/// </summary>
+/// <param name="Mark"></param>
+void CMathArena::Release(MATHARENAMARK Mark)
+{
+	this->pCurrent = (MATHARENABLOCK *)Mark.Block;
+	if (this->pCurrent)
+	{
+		this->pCurrent->Used = Mark.Used;
+	}
+	this->pLast = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
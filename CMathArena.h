@@ -0,0 +1,55 @@
+#ifndef _CMathArena_H
+#define _CMathArena_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define CMATHARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Scratch memory for the parser, handed out from large blocks by moving a pointer. Memory is not freed one
+///	allocation at a time: Mark() remembers the current position and Release() returns everything allocated after
+///	it, so nested calls (ex: Calculate() for the parameters of a method) release their memory in the opposite order
+///	of allocating it. Blocks are kept for reuse, so once the largest expression has been seen no more heap memory is
+///	allocated. Not thread-safe, each parser has its own.
+/// </summary>
+class CMathArena {
+public:
+	typedef struct _tag_Math_Arena_Mark {
+		void *Block;
+		size_t Used;
+	} MATHARENAMARK, *LPMATHARENAMARK;
+
+	CMathArena(size_t iBlockSize);
+	CMathArena(void);
+	~CMathArena(void);
+
+	void *Allocate(size_t iSize);
+	void *Reallocate(void *pMemory, size_t iOldSize, size_t iNewSize);
+	MATHARENAMARK Mark(void);
+	void Release(MATHARENAMARK Mark);
+
+	size_t HeapAllocations(void);
+	size_t Reserved(void);
+
+private:
+	typedef struct _tag_Math_Arena_Block {
+		struct _tag_Math_Arena_Block *Next;
+		size_t Size;          //Bytes available after the header.
+		size_t Used;
+	} MATHARENABLOCK, *LPMATHARENABLOCK;
+
+	MATHARENABLOCK *pFirst;
+	MATHARENABLOCK *pCurrent; //Block allocations are made from, NULL before the first allocation.
+	void *pLast;              //Most recent allocation, which Reallocate() can grow in place.
+	size_t iBlockSize;
+	size_t iHeapAllocations;
+	size_t iReserved;
+
+	void Initialize(size_t iBlockSize);
+	static size_t Align(size_t iSize);
+	static char *BlockData(MATHARENABLOCK *pBlock);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
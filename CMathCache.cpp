@@ -0,0 +1,464 @@
+#ifndef _CMathCache_CPP
+#define _CMathCache_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include "CMathParser.h"
+#include "CMathExpression.h"
+#include "CMathCache.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define MATHCACHE_INITIAL_BUCKETS 64
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathCache::CMathCache(size_t iMemoryLimit)
+{
+	this->Initialize(iMemoryLimit);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathCache::CMathCache(void)
+{
+	this->Initialize(CMATHCACHE_DEFAULT_MEMORY_LIMIT);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Deletes all entries. No parser may be using the cache at this point.
+/// </summary>
+CMathCache::~CMathCache(void)
+{
+	this->Clear();
+	free(this->Buckets);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathCache::Initialize(size_t iMemoryLimit)
+{
+	this->Buckets = NULL;
+	this->iBucketCount = 0;
+	this->iEntryCount = 0;
+	this->pNewest = NULL;
+	this->pOldest = NULL;
+	this->iMemoryUsed = 0;
+	this->iMemoryLimit = iMemoryLimit;
+	this->iHits = 0;
+	this->iMisses = 0;
+	this->iEvictions = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Sets the approximate number of bytes the cached entries may use, the least recently used entries are evicted
+///	to stay below it.
+/// </summary>
+/// <param name="iMemoryLimit"></param>
+/// <returns>The previous setting.</returns>
+size_t CMathCache::MemoryLimit(size_t iMemoryLimit)
+{
+	std::lock_guard<std::mutex> Guard(this->Lock);
+
+	size_t iOldMemoryLimit = this->iMemoryLimit;
+	this->iMemoryLimit = iMemoryLimit;
+	this->EnforceLimit();
+
+	return iOldMemoryLimit;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t CMathCache::MemoryLimit(void)
+{
+	std::lock_guard<std::mutex> Guard(this->Lock);
+	return this->iMemoryLimit;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathCache::Statistics(MATHCACHESTATS *pStats)
+{
+	std::lock_guard<std::mutex> Guard(this->Lock);
+
+	pStats->Hits = this->iHits;
+	pStats->Misses = this->iMisses;
+	pStats->Evictions = this->iEvictions;
+	pStats->Entries = this->iEntryCount;
+	pStats->MemoryUsed = this->iMemoryUsed;
+	pStats->MemoryLimit = this->iMemoryLimit;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathCache::ResetStatistics(void)
+{
+	std::lock_guard<std::mutex> Guard(this->Lock);
+
+	this->iHits = 0;
+	this->iMisses = 0;
+	this->iEvictions = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Removes all entries (entries which are in use are deleted once they are released). Not counted as evictions.
+/// </summary>
+void CMathCache::Clear(void)
+{
+	std::lock_guard<std::mutex> Guard(this->Lock);
+
+	while (this->pOldest)
+	{
+		this->Evict(this->pOldest);
+		this->iEvictions--;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Builds the cache key of an expression: the flags (parser settings which change the compiled form) followed by
+///	the text with redundant white space removed. White space is only kept where removing it would join two
+///	tokens (ex: "10 20" or "< =").
+/// </summary>
+/// <param name="sExpression"></param>
+/// <param name="iExpressionSz"></param>
+/// <param name="iFlags">0 to 25.</param>
+/// <param name="sOut">Receives the key, which is never longer than iExpressionSz + 1.</param>
+/// <param name="iMaxOutSz"></param>
+/// <returns>The length of the key or -1 if sOut is too small.</returns>
+int CMathCache::NormalizeKey(const char *sExpression, int iExpressionSz, int iFlags, char *sOut, int iMaxOutSz)
+{
+	const char *sOperators = "+-*/%^&|!~<>=";
+	int iWPos = 0;
+
+	if (iMaxOutSz < iExpressionSz + 2)
+	{
+		return -1;
+	}
+
+	sOut[iWPos++] = (char)('A' + iFlags);
+
+	for (int iRPos = 0; iRPos < iExpressionSz; iRPos++)
+	{
+		char cChar = sExpression[iRPos];
+
+		if (cChar == ' ' || cChar == '\t' || cChar == '\r' || cChar == '\n')
+		{
+			while (iRPos + 1 < iExpressionSz && (sExpression[iRPos + 1] == ' ' || sExpression[iRPos + 1] == '\t'
+				|| sExpression[iRPos + 1] == '\r' || sExpression[iRPos + 1] == '\n'))
+			{
+				iRPos++;
+			}
+
+			if (iWPos == 1 || iRPos + 1 >= iExpressionSz)
+			{
+				continue; //Leading or trailing.
+			}
+
+			char cBefore = sOut[iWPos - 1];
+			char cAfter = sExpression[iRPos + 1];
+
+			if (cBefore == '(' || cBefore == ')' || cBefore == ',' || cAfter == '(' || cAfter == ')' || cAfter == ',')
+			{
+				continue;
+			}
+
+			bool bOperatorBefore = (strchr(sOperators, cBefore) != NULL);
+			bool bOperatorAfter = (strchr(sOperators, cAfter) != NULL);
+
+			if (bOperatorBefore != bOperatorAfter)
+			{
+				continue; //Between an operator and an operand.
+			}
+
+			sOut[iWPos++] = ' ';
+		}
+		else {
+			sOut[iWPos++] = cChar;
+		}
+	}
+
+	sOut[iWPos] = '\0';
+
+	return iWPos;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Looks up a key built by NormalizeKey(). On a hit the entry becomes the most recently used one and must be
+///	given back with Release() once the caller is done with the expression.
+/// </summary>
+/// <returns>The entry, or NULL on a miss.</returns>
+CMathCache::MATHCACHEENTRY *CMathCache::Acquire(const char *sKey, int iKeySz)
+{
+	unsigned int iHash = this->Hash(sKey, iKeySz);
+
+	std::lock_guard<std::mutex> Guard(this->Lock);
+
+	MATHCACHEENTRY *pEntry = this->Find(sKey, iKeySz, iHash);
+	if (!pEntry)
+	{
+		this->iMisses++;
+		return NULL;
+	}
+
+	this->iHits++;
+	pEntry->References++;
+
+	this->Unlink(pEntry);
+	this->LinkNewest(pEntry);
+
+	return pEntry;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Adds a compiled expression after a miss, the cache takes ownership of it. If another thread inserted the
+///	same key in the mean time, pExpression is deleted and the existing entry is returned instead.
+/// </summary>
+/// <returns>The entry (to be given back with Release()), or NULL if memory could not be allocated, in which case
+///	pExpression has been deleted.</returns>
+CMathCache::MATHCACHEENTRY *CMathCache::Insert(const char *sKey, int iKeySz, CMathExpression *pExpression)
+{
+	unsigned int iHash = this->Hash(sKey, iKeySz);
+
+	std::lock_guard<std::mutex> Guard(this->Lock);
+
+	MATHCACHEENTRY *pEntry = this->Find(sKey, iKeySz, iHash);
+	if (pEntry)
+	{
+		delete pExpression;
+
+		pEntry->References++;
+		this->Unlink(pEntry);
+		this->LinkNewest(pEntry);
+
+		return pEntry;
+	}
+
+	if (this->iEntryCount >= this->iBucketCount && !this->Grow())
+	{
+		delete pExpression;
+		return NULL;
+	}
+
+	pEntry = (MATHCACHEENTRY *)calloc(1, sizeof(MATHCACHEENTRY));
+	if (!pEntry || !(pEntry->Key = (char *)calloc(sizeof(char), iKeySz + 1)))
+	{
+		free(pEntry);
+		delete pExpression;
+		return NULL;
+	}
+
+	memcpy(pEntry->Key, sKey, iKeySz);
+	pEntry->KeyLength = iKeySz;
+	pEntry->Hash = iHash;
+	pEntry->Expression = pExpression;
+	pEntry->Size = sizeof(MATHCACHEENTRY) + iKeySz + 1 + pExpression->MemoryUsage();
+	pEntry->References = 1;
+
+	int iBucket = (int)(iHash & (this->iBucketCount - 1));
+	pEntry->HashNext = this->Buckets[iBucket];
+	this->Buckets[iBucket] = pEntry;
+
+	this->LinkNewest(pEntry);
+	this->iEntryCount++;
+	this->iMemoryUsed += pEntry->Size;
+
+	this->EnforceLimit();
+
+	return pEntry;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Gives back an entry returned by Acquire() or Insert().
+/// </summary>
+void CMathCache::Release(MATHCACHEENTRY *pEntry)
+{
+	std::lock_guard<std::mutex> Guard(this->Lock);
+
+	if (--pEntry->References == 0 && pEntry->Evicted)
+	{
+		this->FreeEntry(pEntry);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int CMathCache::Hash(const char *sKey, int iKeySz)
+{
+	unsigned int iHash = 2166136261U; //FNV-1a
+
+	for (int i = 0; i < iKeySz; i++)
+	{
+		iHash = (iHash ^ (unsigned char)sKey[i]) * 16777619U;
+	}
+
+	return iHash;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathCache::MATHCACHEENTRY *CMathCache::Find(const char *sKey, int iKeySz, unsigned int iHash)
+{
+	if (this->iBucketCount == 0)
+	{
+		return NULL;
+	}
+
+	for (MATHCACHEENTRY *pEntry = this->Buckets[iHash & (this->iBucketCount - 1)]; pEntry; pEntry = pEntry->HashNext)
+	{
+		if (pEntry->Hash == iHash && pEntry->KeyLength == iKeySz && memcmp(pEntry->Key, sKey, iKeySz) == 0)
+		{
+			return pEntry;
+		}
+	}
+
+	return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Doubles the number of hash buckets (the count is always a power of two).
+/// </summary>
+bool CMathCache::Grow(void)
+{
+	int iBucketCount = (this->iBucketCount == 0) ? MATHCACHE_INITIAL_BUCKETS : this->iBucketCount * 2;
+
+	MATHCACHEENTRY **Buckets = (MATHCACHEENTRY **)calloc(sizeof(MATHCACHEENTRY *), iBucketCount);
+	if (!Buckets)
+	{
+		return false;
+	}
+
+	for (int iBucket = 0; iBucket < this->iBucketCount; iBucket++)
+	{
+		MATHCACHEENTRY *pEntry = this->Buckets[iBucket];
+		while (pEntry)
+		{
+			MATHCACHEENTRY *pNext = pEntry->HashNext;
+			int iNewBucket = (int)(pEntry->Hash & (iBucketCount - 1));
+
+			pEntry->HashNext = Buckets[iNewBucket];
+			Buckets[iNewBucket] = pEntry;
+
+			pEntry = pNext;
+		}
+	}
+
+	free(this->Buckets);
+	this->Buckets = Buckets;
+	this->iBucketCount = iBucketCount;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Removes an entry from the recently used list.
+/// </summary>
+void CMathCache::Unlink(MATHCACHEENTRY *pEntry)
+{
+	if (pEntry->Newer)
+	{
+		pEntry->Newer->Older = pEntry->Older;
+	}
+	else {
+		this->pNewest = pEntry->Older;
+	}
+
+	if (pEntry->Older)
+	{
+		pEntry->Older->Newer = pEntry->Newer;
+	}
+	else {
+		this->pOldest = pEntry->Newer;
+	}
+
+	pEntry->Newer = NULL;
+	pEntry->Older = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Adds an entry to the front of the recently used list.
+/// </summary>
+void CMathCache::LinkNewest(MATHCACHEENTRY *pEntry)
+{
+	pEntry->Newer = NULL;
+	pEntry->Older = this->pNewest;
+
+	if (this->pNewest)
+	{
+		this->pNewest->Newer = pEntry;
+	}
+	else {
+		this->pOldest = pEntry;
+	}
+
+	this->pNewest = pEntry;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Removes an entry from the cache. It is deleted right away unless it is in use.
+/// </summary>
+void CMathCache::Evict(MATHCACHEENTRY *pEntry)
+{
+	MATHCACHEENTRY **ppLink = &this->Buckets[pEntry->Hash & (this->iBucketCount - 1)];
+	while (*ppLink != pEntry)
+	{
+		ppLink = &(*ppLink)->HashNext;
+	}
+	*ppLink = pEntry->HashNext;
+
+	this->Unlink(pEntry);
+
+	this->iEntryCount--;
+	this->iMemoryUsed -= pEntry->Size;
+	this->iEvictions++;
+
+	pEntry->Evicted = true;
+	if (pEntry->References == 0)
+	{
+		this->FreeEntry(pEntry);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathCache::EnforceLimit(void)
+{
+	while (this->pOldest && this->iMemoryUsed > this->iMemoryLimit)
+	{
+		this->Evict(this->pOldest);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathCache::FreeEntry(MATHCACHEENTRY *pEntry)
+{
+	delete pEntry->Expression;
+	free(pEntry->Key);
+	free(pEntry);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,93 @@
+#ifndef _CMathCache_H
+#define _CMathCache_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <mutex>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define CMATHCACHE_DEFAULT_MEMORY_LIMIT (16 * 1024 * 1024)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CMathExpression;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// A bounded, thread-safe cache of compiled expressions keyed by their normalized text, with least recently used
+///	eviction. When attached to one or more parsers (see CMathParser::SetCache) Calculate() looks the expression up
+///	here and only parses it on a miss. Entries are reference counted, so an entry which is evicted while another
+///	thread is evaluating it is deleted once that thread releases it.
+/// </summary>
+class CMathCache {
+public:
+	typedef struct _tag_Math_Cache_Statistics {
+		size_t Hits;
+		size_t Misses;
+		size_t Evictions;
+		size_t Entries;
+		size_t MemoryUsed;   //Approximate bytes held by the cached entries.
+		size_t MemoryLimit;
+	} MATHCACHESTATS, *LPMATHCACHESTATS;
+
+	typedef struct _tag_Math_Cache_Entry {
+		char *Key;
+		int KeyLength;
+		unsigned int Hash;
+		size_t Size;
+		CMathExpression *Expression;
+		int References;
+		bool Evicted;
+		struct _tag_Math_Cache_Entry *HashNext;
+		struct _tag_Math_Cache_Entry *Newer;
+		struct _tag_Math_Cache_Entry *Older;
+	} MATHCACHEENTRY, *LPMATHCACHEENTRY;
+
+	CMathCache(size_t iMemoryLimit);
+	CMathCache(void);
+	~CMathCache(void);
+
+	size_t MemoryLimit(size_t iMemoryLimit);
+	size_t MemoryLimit(void);
+
+	void Statistics(MATHCACHESTATS *pStats);
+	void ResetStatistics(void);
+	void Clear(void);
+
+	static int NormalizeKey(const char *sExpression, int iExpressionSz, int iFlags, char *sOut, int iMaxOutSz);
+
+	MATHCACHEENTRY *Acquire(const char *sKey, int iKeySz);
+	MATHCACHEENTRY *Insert(const char *sKey, int iKeySz, CMathExpression *pExpression);
+	void Release(MATHCACHEENTRY *pEntry);
+
+private:
+	std::mutex Lock;
+
+	MATHCACHEENTRY **Buckets;
+	int iBucketCount;
+	int iEntryCount;
+
+	MATHCACHEENTRY *pNewest;
+	MATHCACHEENTRY *pOldest;
+
+	size_t iMemoryUsed;
+	size_t iMemoryLimit;
+
+	size_t iHits;
+	size_t iMisses;
+	size_t iEvictions;
+
+	void Initialize(size_t iMemoryLimit);
+	static unsigned int Hash(const char *sKey, int iKeySz);
+	MATHCACHEENTRY *Find(const char *sKey, int iKeySz, unsigned int iHash);
+	bool Grow(void);
+	void Unlink(MATHCACHEENTRY *pEntry);
+	void LinkNewest(MATHCACHEENTRY *pEntry);
+	void Evict(MATHCACHEENTRY *pEntry);
+	void EnforceLimit(void);
+	void FreeEntry(MATHCACHEENTRY *pEntry);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,462 @@
+#ifndef _CMathColumns_CPP
+#define _CMathColumns_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "CMathColumns.h"
+#include "CMathExpression.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathColumns::CMathColumns(CMathParser *pParser)
+{
+	this->pParser = pParser;
+
+	this->Columns = NULL;
+	this->iColumnCount = 0;
+	this->iRowCount = 0;
+	this->ciWindowRows = CMATHCOLUMNS_WINDOW_ROWS;
+
+#ifdef _WIN32
+	SYSTEM_INFO SystemInfo;
+	GetSystemInfo(&SystemInfo);
+	this->iGranularity = SystemInfo.dwAllocationGranularity;
+#else
+	this->iGranularity = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathColumns::~CMathColumns(void)
+{
+	for (int i = 0; i < this->iColumnCount; i++)
+	{
+		this->CloseFile(&this->Columns[i].File);
+		free(this->Columns[i].Name);
+	}
+	free(this->Columns);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Opens a column file and gives its values to the variable of the same name (case insensitive), replacing the
+///	file given to that name before. Every column has to have the same number of rows.
+/// </summary>
+/// <param name="sName">Name of the variable.</param>
+/// <param name="sFileName">File holding one value of the given type for each row, with no header.</param>
+/// <param name="Type"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathColumns::MapColumn(const char *sName, const char *sFileName, ColumnType Type)
+{
+	MATHMAPPEDFILE File;
+	int iColumn = this->iColumnCount;
+
+	if (!this->pParser->IsValidName(sName))
+	{
+		return this->pParser->SetError(CMathParser::ResultInvalidToken, "Invalid variable name: %s.", sName);
+	}
+
+	if (!this->OpenFile(&File, sFileName, false, 0))
+	{
+		return this->pParser->SetError(CMathParser::ResultFileError, "Could not open %s.", sFileName);
+	}
+
+	long long iValueSz = (Type == ColumnInt32) ? sizeof(int) : sizeof(double);
+	if (File.Size % iValueSz != 0)
+	{
+		this->CloseFile(&File);
+		return this->pParser->SetError(CMathParser::ResultFileError, "The size of %s is not a whole number of values.", sFileName);
+	}
+
+	for (int i = 0; i < this->iColumnCount; i++)
+	{
+		if (_strcmpi(this->Columns[i].Name, sName) == 0)
+		{
+			iColumn = i;
+		}
+	}
+
+	for (int i = 0; i < this->iColumnCount; i++)
+	{
+		if (i != iColumn && this->iRowCount != File.Size / iValueSz)
+		{
+			this->CloseFile(&File);
+			return this->pParser->SetError(CMathParser::ResultFileError, "%s does not have the same number of rows as the other columns.", sFileName);
+		}
+	}
+
+	if (iColumn == this->iColumnCount)
+	{
+		size_t iNameSz = strlen(sName);
+		char *sCopy = (char *)calloc(sizeof(char), iNameSz + 1);
+		MATHCOLUMN *pColumns = (MATHCOLUMN *)realloc(this->Columns, sizeof(MATHCOLUMN) * (this->iColumnCount + 1));
+		if (pColumns)
+		{
+			this->Columns = pColumns;
+		}
+		if (!sCopy || !pColumns)
+		{
+			free(sCopy);
+			this->CloseFile(&File);
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+		memcpy(sCopy, sName, iNameSz);
+
+		this->Columns[iColumn].Name = sCopy;
+		this->iColumnCount++;
+	}
+	else {
+		this->CloseFile(&this->Columns[iColumn].File);
+	}
+
+	this->Columns[iColumn].Type = Type;
+	this->Columns[iColumn].File = File;
+	this->iRowCount = File.Size / iValueSz;
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates a compiled expression for every row of the columns and writes the results to a file of RowCount()
+///	doubles, which is replaced if it exists. Each variable of the expression has to have been given a column. The
+///	rows are evaluated by EvaluateBatch() (so ThreadCount() and the other batch settings of the parser apply) one
+///	window at a time, if a window fails the output holds the results of the windows before it.
+/// </summary>
+/// <param name="pExpression">Expression compiled by the parser.</param>
+/// <param name="sOutputFileName"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathColumns::Evaluate(CMathExpression *pExpression, const char *sOutputFileName)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	int iVariables = pExpression->VariableCount();
+	MATHMAPPEDFILE Output;
+
+	//Column of each variable, followed by the values of the variable in the current window.
+	int *pVariableColumns = (int *)calloc(sizeof(int), iVariables + 1);
+	double **pValues = (double **)calloc(sizeof(double *), iVariables + 1);
+	double **pConverted = (double **)calloc(sizeof(double *), iVariables + 1);
+	if (!pVariableColumns || !pValues || !pConverted)
+	{
+		free(pVariableColumns);
+		free(pValues);
+		free(pConverted);
+		return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	size_t iWindowRows = this->ciWindowRows;
+	if ((long long)iWindowRows > this->iRowCount)
+	{
+		iWindowRows = (size_t)this->iRowCount;
+	}
+
+	for (int i = 0; i < iVariables && ErrorCode == CMathParser::ResultOk; i++)
+	{
+		pVariableColumns[i] = -1;
+		for (int iColumn = 0; iColumn < this->iColumnCount; iColumn++)
+		{
+			if (_strcmpi(this->Columns[iColumn].Name, pExpression->VariableName(i)) == 0)
+			{
+				pVariableColumns[i] = iColumn;
+			}
+		}
+
+		if (pVariableColumns[i] < 0)
+		{
+			ErrorCode = this->pParser->SetError(CMathParser::ResultUndefiendVariable, "Variable was not defined: %s.", pExpression->VariableName(i));
+		}
+		else if (this->Columns[pVariableColumns[i]].Type == ColumnInt32 && iWindowRows > 0)
+		{
+			//Integers have to be converted, doubles are evaluated where they are mapped.
+			if (!(pConverted[i] = (double *)calloc(sizeof(double), iWindowRows)))
+			{
+				ErrorCode = this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+			}
+		}
+	}
+
+	if (ErrorCode == CMathParser::ResultOk && !this->OpenFile(&Output, sOutputFileName, true, this->iRowCount * (long long)sizeof(double)))
+	{
+		ErrorCode = this->pParser->SetError(CMathParser::ResultFileError, "Could not create %s.", sOutputFileName);
+	}
+	else if (ErrorCode == CMathParser::ResultOk)
+	{
+		for (long long iFirst = 0; iFirst < this->iRowCount && ErrorCode == CMathParser::ResultOk; iFirst += iWindowRows)
+		{
+			size_t iRows = ((long long)iWindowRows < this->iRowCount - iFirst) ? iWindowRows : (size_t)(this->iRowCount - iFirst);
+
+			for (int i = 0; i < iVariables && ErrorCode == CMathParser::ResultOk; i++)
+			{
+				MATHCOLUMN *pColumn = &this->Columns[pVariableColumns[i]];
+
+				if (pColumn->Type == ColumnInt32)
+				{
+					const int *pIntegers = (const int *)this->MapWindow(&pColumn->File, iFirst * (long long)sizeof(int), iRows * sizeof(int), false);
+					if (pIntegers)
+					{
+						for (size_t iRow = 0; iRow < iRows; iRow++)
+						{
+							pConverted[i][iRow] = (double)pIntegers[iRow];
+						}
+						pValues[i] = pConverted[i];
+					}
+					//The conversion is done with the window, so it can be released right away.
+					this->UnmapWindow(&pColumn->File);
+				}
+				else {
+					pValues[i] = (double *)this->MapWindow(&pColumn->File, iFirst * (long long)sizeof(double), iRows * sizeof(double), false);
+				}
+
+				if (!pValues[i])
+				{
+					ErrorCode = this->pParser->SetError(CMathParser::ResultFileError, "Could not map the column of %s.", pColumn->Name);
+				}
+			}
+
+			double *pResults = NULL;
+			if (ErrorCode == CMathParser::ResultOk
+				&& !(pResults = (double *)this->MapWindow(&Output, iFirst * (long long)sizeof(double), iRows * sizeof(double), true)))
+			{
+				ErrorCode = this->pParser->SetError(CMathParser::ResultFileError, "Could not map %s.", sOutputFileName);
+			}
+
+			if (ErrorCode == CMathParser::ResultOk)
+			{
+				ErrorCode = this->pParser->EvaluateBatch(pExpression, (const double *const *)pValues, iRows, pResults);
+			}
+
+			for (int i = 0; i < iVariables; i++)
+			{
+				this->UnmapWindow(&this->Columns[pVariableColumns[i]].File);
+				pValues[i] = NULL;
+			}
+			this->UnmapWindow(&Output);
+		}
+
+		this->CloseFile(&Output);
+	}
+
+	for (int i = 0; i < iVariables; i++)
+	{
+		free(pConverted[i]);
+	}
+	free(pConverted);
+	free(pValues);
+	free(pVariableColumns);
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CMathColumns::ColumnCount(void)
+{
+	return this->iColumnCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of rows of the columns, 0 if no column was mapped.
+/// </summary>
+/// <returns></returns>
+long long CMathColumns::RowCount(void)
+{
+	return this->iRowCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Sets the number of rows mapped at a time, which bounds the memory (and address space) Evaluate() uses to
+///	WindowRows() values of every column it reads plus the results.
+/// </summary>
+/// <returns>The previous setting.</returns>
+size_t CMathColumns::WindowRows(size_t iWindowRows)
+{
+	size_t iOldWindowRows = this->ciWindowRows;
+	this->ciWindowRows = (iWindowRows < 1) ? 1 : iWindowRows;
+	return iOldWindowRows;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t CMathColumns::WindowRows(void)
+{
+	return this->ciWindowRows;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Opens a file for mapping. A file opened for writing is created (or truncated) with the given size, a file opened
+///	for reading gets the size it has. Both are only ever accessed from start to end, which the system is told.
+/// </summary>
+bool CMathColumns::OpenFile(MATHMAPPEDFILE *pFile, const char *sFileName, bool bWrite, long long iSize)
+{
+	memset(pFile, 0, sizeof(MATHMAPPEDFILE));
+
+#ifdef _WIN32
+	pFile->File = CreateFileA(sFileName, bWrite ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ, bWrite ? 0 : FILE_SHARE_READ,
+		NULL, bWrite ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (pFile->File == INVALID_HANDLE_VALUE)
+	{
+		pFile->File = NULL;
+		return false;
+	}
+
+	if (!bWrite)
+	{
+		LARGE_INTEGER FileSize;
+		if (!GetFileSizeEx(pFile->File, &FileSize))
+		{
+			this->CloseFile(pFile);
+			return false;
+		}
+		iSize = FileSize.QuadPart;
+	}
+	pFile->Size = iSize;
+
+	//An empty file can not be mapped, and has nothing to map.
+	if (iSize > 0)
+	{
+		pFile->Mapping = CreateFileMappingA(pFile->File, NULL, bWrite ? PAGE_READWRITE : PAGE_READONLY,
+			(DWORD)((unsigned long long)iSize >> 32), (DWORD)((unsigned long long)iSize & 0xFFFFFFFF), NULL);
+		if (!pFile->Mapping)
+		{
+			this->CloseFile(pFile);
+			return false;
+		}
+	}
+#else
+	pFile->File = open(sFileName, bWrite ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDONLY, 0644);
+	if (pFile->File < 0)
+	{
+		return false;
+	}
+
+	if (bWrite)
+	{
+		if (ftruncate(pFile->File, (off_t)iSize) != 0)
+		{
+			this->CloseFile(pFile);
+			return false;
+		}
+	}
+	else {
+		struct stat FileStat;
+		if (fstat(pFile->File, &FileStat) != 0)
+		{
+			this->CloseFile(pFile);
+			return false;
+		}
+		iSize = (long long)FileStat.st_size;
+		posix_fadvise(pFile->File, 0, 0, POSIX_FADV_SEQUENTIAL);
+	}
+	pFile->Size = iSize;
+#endif
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Maps part of a file, from an offset which does not have to be aligned. Only one window of a file is mapped at a
+///	time, the window mapped before has to have been released by UnmapWindow().
+/// </summary>
+/// <returns>The address of the byte at iOffset, NULL on failure.</returns>
+void *CMathColumns::MapWindow(MATHMAPPEDFILE *pFile, long long iOffset, size_t iLength, bool bWrite)
+{
+	long long iAligned = iOffset - (iOffset % (long long)this->iGranularity);
+	size_t iViewSz = (size_t)(iOffset - iAligned) + iLength;
+
+#ifdef _WIN32
+	void *pView = MapViewOfFile(pFile->Mapping, bWrite ? FILE_MAP_WRITE : FILE_MAP_READ,
+		(DWORD)((unsigned long long)iAligned >> 32), (DWORD)((unsigned long long)iAligned & 0xFFFFFFFF), iViewSz);
+	if (!pView)
+	{
+		return NULL;
+	}
+#else
+	void *pView = mmap(NULL, iViewSz, bWrite ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, pFile->File, (off_t)iAligned);
+	if (pView == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	//Pages are used once, in order: read ahead of the evaluation and let the system reclaim them right after.
+	madvise(pView, iViewSz, MADV_SEQUENTIAL);
+	if (!bWrite)
+	{
+		madvise(pView, iViewSz, MADV_WILLNEED);
+	}
+#endif
+
+	pFile->View = pView;
+	pFile->ViewSz = iViewSz;
+
+	return (char *)pView + (iOffset - iAligned);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Releases the mapped window of a file, if any. Written pages are saved to the file by the system.
+/// </summary>
+void CMathColumns::UnmapWindow(MATHMAPPEDFILE *pFile)
+{
+	if (!pFile->View)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(pFile->View);
+#else
+	munmap(pFile->View, pFile->ViewSz);
+#endif
+
+	pFile->View = NULL;
+	pFile->ViewSz = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathColumns::CloseFile(MATHMAPPEDFILE *pFile)
+{
+	this->UnmapWindow(pFile);
+
+#ifdef _WIN32
+	if (pFile->Mapping)
+	{
+		CloseHandle(pFile->Mapping);
+		pFile->Mapping = NULL;
+	}
+	if (pFile->File)
+	{
+		CloseHandle(pFile->File);
+		pFile->File = NULL;
+	}
+#else
+	if (pFile->File >= 0)
+	{
+		close(pFile->File);
+		pFile->File = -1;
+	}
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
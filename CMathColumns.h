@@ -0,0 +1,79 @@
+#ifndef _CMathColumns_H
+#define _CMathColumns_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathParser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define CMATHCOLUMNS_WINDOW_ROWS 1048576 //Rows of every file mapped (and evaluated) at a time.
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CMathExpression;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates an expression over binary column files: one file per variable holding a value for each row, either
+///	doubles or 32 bit integers (in the byte order of the machine, little-endian on every platform the parser builds
+///	for), with the results written as doubles to an output file. The files are memory mapped a window of WindowRows()
+///	rows at a time and each window is evaluated by EvaluateBatch() straight from the mapped double columns into the
+///	mapped output (integer columns are converted into a buffer of one window), so files which are larger than the
+///	memory are streamed through it and the operating system is told that they are read and written sequentially.
+///
+/// Errors are reported by the parser's LastError().
+/// </summary>
+class CMathColumns {
+public:
+	enum ColumnType {
+		ColumnDouble,
+		ColumnInt32
+	};
+
+	CMathColumns(CMathParser *pParser);
+	~CMathColumns(void);
+
+	CMathParser::MathResult MapColumn(const char *sName, const char *sFileName, ColumnType Type);
+	CMathParser::MathResult Evaluate(CMathExpression *pExpression, const char *sOutputFileName);
+
+	int ColumnCount(void);
+	long long RowCount(void);
+	size_t WindowRows(size_t iWindowRows);
+	size_t WindowRows(void);
+
+private:
+	typedef struct _tag_Math_Mapped_File {
+#ifdef _WIN32
+		void *File;          //HANDLE of the file.
+		void *Mapping;       //HANDLE of the file mapping.
+#else
+		int File;            //Descriptor of the file, -1 if it is not open.
+#endif
+		long long Size;      //Bytes in the file.
+		void *View;          //Mapped window, NULL if none.
+		size_t ViewSz;
+	} MATHMAPPEDFILE, *LPMATHMAPPEDFILE;
+
+	typedef struct _tag_Math_Column {
+		char *Name;
+		ColumnType Type;
+		MATHMAPPEDFILE File;
+	} MATHCOLUMN, *LPMATHCOLUMN;
+
+	CMathParser *pParser;
+
+	MATHCOLUMN *Columns;
+	int iColumnCount;
+	long long iRowCount;
+	size_t ciWindowRows;
+	size_t iGranularity;     //Alignment of the offset of a mapped window into its file.
+
+	bool OpenFile(MATHMAPPEDFILE *pFile, const char *sFileName, bool bWrite, long long iSize);
+	void *MapWindow(MATHMAPPEDFILE *pFile, long long iOffset, size_t iLength, bool bWrite);
+	void UnmapWindow(MATHMAPPEDFILE *pFile);
+	void CloseFile(MATHMAPPEDFILE *pFile);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,234 @@
+#ifndef _CMathContext_CPP
+#define _CMathContext_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include "CMathContext.h"
+#include "CMathExpression.h"
+#include "CMathArena.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathContext::CMathContext(CMathParser *pParser)
+{
+	this->pParser = pParser;
+	this->pArena = new CMathArena();
+	memset(&this->LastErrorInfo, 0, sizeof(this->LastErrorInfo));
+	memset(&this->ErrorRecord, 0, sizeof(this->ErrorRecord));
+	this->LastErrorInfo.Position = -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathContext::~CMathContext(void)
+{
+	if (this->pArena)
+	{
+		delete this->pArena;
+		this->pArena = NULL;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the parser the context evaluates for.
+/// </summary>
+/// <returns></returns>
+CMathParser *CMathContext::Parser(void)
+{
+	return this->pParser;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates an expression compiled by the parser, see CMathParser::Evaluate().
+/// </summary>
+/// <param name="pExpression"></param>
+/// <param name="dResult"></param>
+/// <returns>Errors are reported by the context's LastError(), not by the parser's.</returns>
+CMathParser::MathResult CMathContext::Evaluate(const CMathExpression *pExpression, double *dResult)
+{
+	return this->pParser->Evaluate(this, pExpression, dResult);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates an expression compiled by the parser using variable values supplied by the caller, see
+///	CMathParser::Evaluate().
+/// </summary>
+/// <param name="pExpression"></param>
+/// <param name="pSlots">One value for each variable of the expression (CMathExpression::VariableCount()).</param>
+/// <param name="dResult"></param>
+/// <returns>Errors are reported by the context's LastError(), not by the parser's.</returns>
+CMathParser::MathResult CMathContext::Evaluate(const CMathExpression *pExpression, const double *pSlots, double *dResult)
+{
+	return this->pParser->Evaluate(this, pExpression, pSlots, dResult);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates an expression compiled by the parser for many rows at once on the calling thread, see
+///	CMathParser::EvaluateBatch().
+/// </summary>
+/// <param name="pExpression"></param>
+/// <param name="pColumns">One array of iRows values for each variable of the expression.</param>
+/// <param name="iRows"></param>
+/// <param name="pResults">Receives one result per row.</param>
+/// <returns>Errors are reported by the context's LastError(), not by the parser's.</returns>
+CMathParser::MathResult CMathContext::EvaluateBatch(const CMathExpression *pExpression, const double *const *pColumns, size_t iRows, double *pResults)
+{
+	return this->pParser->EvaluateBatch(this, pExpression, pColumns, iRows, pResults);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of times the context's scratch memory had to be taken from the heap, see
+///	CMathParser::HeapAllocations().
+/// </summary>
+/// <returns></returns>
+size_t CMathContext::HeapAllocations(void)
+{
+	return this->pArena->HeapAllocations();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the last error of an evaluation made through the context. Errors only record their parameters when
+///	they occur, the message is formatted here the first time it is requested.
+/// </summary>
+/// <returns></returns>
+CMathParser::MATHERRORINFO *CMathContext::LastError(void)
+{
+	this->FormatError();
+	return &this->LastErrorInfo;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Records an error. Only the code, the format (which must be a literal) and its parameters are kept, so failing
+///	is cheap even when most evaluations fail (ex: divide by zero on many rows of a batch).
+/// </summary>
+/// <param name="ErrorCode"></param>
+/// <param name="iPosition">Offset into the expression, -1 if not known.</param>
+/// <param name="sFormat">Literal format, supports %c, %d and %s.</param>
+/// <param name="ArgList"></param>
+void CMathContext::RecordError(CMathParser::MathResult ErrorCode, int iPosition, const char *sFormat, va_list ArgList)
+{
+	MATHERRORRECORD *pRecord = &this->ErrorRecord;
+
+	pRecord->Format = sFormat;
+	pRecord->ArgCount = 0;
+	pRecord->PayloadUsed = 0;
+
+	//Text parameters are copied since they may not outlive the call (ex: a variable name on the stack).
+	for (int iPos = 0; sFormat[iPos] && pRecord->ArgCount < CMATHPARSER_MAX_ERROR_ARGS; iPos++)
+	{
+		if (sFormat[iPos] != '%')
+		{
+			continue;
+		}
+
+		iPos++;
+		if (sFormat[iPos] == 'c' || sFormat[iPos] == 'd')
+		{
+			pRecord->Args[pRecord->ArgCount++] = va_arg(ArgList, int);
+		}
+		else if (sFormat[iPos] == 's')
+		{
+			const char *sArg = va_arg(ArgList, const char *);
+			int iAvailable = CMATHPARSER_MAX_ERROR_PAYLOAD - pRecord->PayloadUsed - 1;
+			int iLength = 0;
+
+			while (iLength < iAvailable && sArg[iLength])
+			{
+				iLength++;
+			}
+			memcpy(pRecord->Payload + pRecord->PayloadUsed, sArg, iLength);
+			pRecord->Payload[pRecord->PayloadUsed + iLength] = '\0';
+
+			pRecord->Args[pRecord->ArgCount++] = pRecord->PayloadUsed;
+			pRecord->PayloadUsed += iLength + 1;
+		}
+		else if (sFormat[iPos] == '\0')
+		{
+			break;
+		}
+	}
+
+	this->LastErrorInfo.Error = ErrorCode;
+	this->LastErrorInfo.Position = iPosition;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Formats the message of the last recorded error, if it has not been formatted yet.
+/// </summary>
+void CMathContext::FormatError(void)
+{
+	MATHERRORRECORD *pRecord = &this->ErrorRecord;
+
+	if (!pRecord->Format)
+	{
+		return;
+	}
+
+	const char *sFormat = pRecord->Format;
+	char *sText = pRecord->Text;
+	int iTextSz = (int)sizeof(pRecord->Text) - 1;
+	int iLength = 0;
+	int iArg = 0;
+
+	for (int iPos = 0; sFormat[iPos] && iLength < iTextSz; iPos++)
+	{
+		if (sFormat[iPos] != '%' || sFormat[iPos + 1] == '\0')
+		{
+			sText[iLength++] = sFormat[iPos];
+			continue;
+		}
+
+		char cType = sFormat[++iPos];
+
+		if (cType == '%' || iArg >= pRecord->ArgCount)
+		{
+			sText[iLength++] = cType;
+		}
+		else if (cType == 'c')
+		{
+			sText[iLength++] = (char)pRecord->Args[iArg++];
+		}
+		else if (cType == 'd')
+		{
+			char sValue[16];
+			sprintf_s(sValue, sizeof(sValue), "%d", pRecord->Args[iArg++]);
+			for (int i = 0; sValue[i] && iLength < iTextSz; i++)
+			{
+				sText[iLength++] = sValue[i];
+			}
+		}
+		else if (cType == 's')
+		{
+			const char *sValue = pRecord->Payload + pRecord->Args[iArg++];
+			for (int i = 0; sValue[i] && iLength < iTextSz; i++)
+			{
+				sText[iLength++] = sValue[i];
+			}
+		}
+	}
+
+	sText[iLength] = '\0';
+
+	pRecord->Format = NULL;
+	this->LastErrorInfo.Text = sText;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,57 @@
+#ifndef _CMathContext_H
+#define _CMathContext_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathParser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CMathArena;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates compiled expressions for a parser, with its own scratch memory and error state, so that any number of
+///	threads can evaluate the same compiled expressions at once: a compiled expression is never modified once
+///	Compile() has returned, and each thread evaluates it through its own context. The parser must be set up
+///	(functions registered, variables defined and bound, callbacks set) before the contexts are used and must not be
+///	changed while they evaluate, except for updating the value of existing variables when the caller synchronizes
+///	those updates itself. Method callbacks and functions which are not pure are called from the evaluating thread,
+///	so they have to be thread-safe. Contexts ignore DebugMode() and evaluate batches on the calling thread only.
+/// </summary>
+class CMathContext {
+	friend class CMathParser;
+
+public:
+	CMathContext(CMathParser *pParser);
+	~CMathContext(void);
+
+	CMathParser::MathResult Evaluate(const CMathExpression *pExpression, double *dResult);
+	CMathParser::MathResult Evaluate(const CMathExpression *pExpression, const double *pSlots, double *dResult);
+	CMathParser::MathResult EvaluateBatch(const CMathExpression *pExpression, const double *const *pColumns, size_t iRows, double *pResults);
+
+	CMathParser *Parser(void);
+	CMathParser::MATHERRORINFO *LastError(void);
+	size_t HeapAllocations(void);
+
+private:
+	typedef struct _tag_Math_Error_Record {
+		const char *Format;   //Format given to SetError(), NULL once LastError() has formatted the message.
+		int ArgCount;
+		int Args[CMATHPARSER_MAX_ERROR_ARGS]; //%c and %d values, offsets into Payload for %s.
+		int PayloadUsed;
+		char Payload[CMATHPARSER_MAX_ERROR_PAYLOAD];
+		char Text[CMATHPARSER_MAX_ERROR_LENGTH];
+	} MATHERRORRECORD, *LPMATHERRORRECORD;
+
+	CMathParser *pParser;
+	CMathArena *pArena;   //Scratch memory, released when each call returns.
+	CMathParser::MATHERRORINFO LastErrorInfo;
+	MATHERRORRECORD ErrorRecord; //Parameters of the last error, formatted into LastErrorInfo by LastError().
+
+	void RecordError(CMathParser::MathResult ErrorCode, int iPosition, const char *sFormat, va_list ArgList);
+	void FormatError(void);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,1699 @@
+#ifndef _CMathExpression_CPP
+#define _CMathExpression_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include "CMathExpression.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _CVTBUFSIZE
+#define _CVTBUFSIZE (309+40) /* Number of digits in maximum double precision value + slop */
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern const char *sPreOrder[];
+extern const char *sFirstOrder[];
+extern const char *sSecondOrder[];
+extern const char *sThirdOrder[];
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathExpression::CMathExpression(CMathParser *pParser)
+{
+	this->pParser = pParser;
+
+	this->Nodes = NULL;
+	this->iNodeCount = 0;
+	this->iNodesAllocated = 0;
+
+	this->Arguments = NULL;
+	this->iArgumentCount = 0;
+	this->iArgumentsAllocated = 0;
+
+	this->iRoot = -1;
+
+	this->Instructions = NULL;
+	this->iInstructionCount = 0;
+	this->iInstructionsAllocated = 0;
+
+	this->Constants = NULL;
+	this->iConstantCount = 0;
+	this->iConstantsAllocated = 0;
+
+	this->iMaxStackDepth = 0;
+	this->iTempCount = 0;
+	this->iMaxArgCount = 0;
+	this->iDeduplicatedCount = 0;
+	this->bTextForm = false;
+
+	this->pJIT = NULL;
+	this->pIncremental = NULL;
+
+	this->NodeHash = NULL;
+	this->iNodeHashSz = 0;
+	this->NodeUses = NULL;
+	this->NodeTemps = NULL;
+
+	memset(&this->Variables, 0, sizeof(this->Variables));
+	memset(&this->Methods, 0, sizeof(this->Methods));
+	this->Bindings = NULL;
+
+	this->sSource = NULL;
+	this->pTokens = NULL;
+	this->iToken = 0;
+	this->iDepth = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathExpression::~CMathExpression(void)
+{
+	for (int i = 0; i < this->Variables.Count; i++)
+	{
+		free(this->Variables.Items[i]);
+	}
+	for (int i = 0; i < this->Methods.Count; i++)
+	{
+		free(this->Methods.Items[i]);
+	}
+
+	free(this->Variables.Items);
+	free(this->Methods.Items);
+	free(this->Bindings);
+	free(this->Nodes);
+	free(this->Arguments);
+	free(this->Instructions);
+	free(this->Constants);
+
+	if (this->pJIT)
+	{
+		delete this->pJIT;
+	}
+
+	if (this->pIncremental)
+	{
+		free(this->pIncremental->Values);
+		free(this->pIncremental->Dirty);
+		free(this->pIncremental->ProgramStart);
+		free(this->pIncremental->ParentStart);
+		free(this->pIncremental->Parents);
+		free(this->pIncremental->VariableNodes);
+		free(this->pIncremental->VolatileNodes);
+		free(this->pIncremental);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of distinct variables referenced by the expression.
+/// </summary>
+/// <returns></returns>
+int CMathExpression::VariableCount(void) const
+{
+	return this->Variables.Count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the name of a variable referenced by the expression, in the order they were first encountered.
+/// </summary>
+/// <param name="iIndex"></param>
+/// <returns></returns>
+const char *CMathExpression::VariableName(int iIndex) const
+{
+	if (iIndex < 0 || iIndex >= this->Variables.Count)
+	{
+		return NULL;
+	}
+	return this->Variables.Items[iIndex];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the slot index of a variable (for use with the slot array overload of CMathParser::Evaluate). Exact
+///	matches are preferred, otherwise the name is compared without regard to case.
+/// </summary>
+/// <param name="sName"></param>
+/// <returns>The index of the variable or -1 if the expression does not reference it.</returns>
+int CMathExpression::VariableIndex(const char *sName) const
+{
+	for (int i = 0; i < this->Variables.Count; i++)
+	{
+		if (strcmp(this->Variables.Items[i], sName) == 0)
+		{
+			return i;
+		}
+	}
+	for (int i = 0; i < this->Variables.Count; i++)
+	{
+		if (_strcmpi(this->Variables.Items[i], sName) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CMathExpression::NodeCount(void) const
+{
+	return this->iNodeCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of bytecode instructions the expression was lowered to.
+/// </summary>
+/// <returns></returns>
+int CMathExpression::InstructionCount(void) const
+{
+	return this->iInstructionCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of operations which were merged with an identical operation elsewhere in the expression
+///	(ex: 2 for the second SIN(X*Y) in "SIN(X*Y) * SIN(X*Y)").
+/// </summary>
+/// <returns></returns>
+int CMathExpression::DeduplicatedCount(void) const
+{
+	return this->iDeduplicatedCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether the expression was translated to machine code (see CMathParser::JITMode).
+/// </summary>
+/// <returns></returns>
+bool CMathExpression::HasMachineCode(void) const
+{
+	return (this->pJIT != NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether the expression keeps its node values between evaluations (see CMathParser::IncrementalMode).
+/// </summary>
+/// <returns></returns>
+bool CMathExpression::IsIncremental(void) const
+{
+	return (this->pIncremental != NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of nodes which were computed by the last incremental evaluation, or zero.
+/// </summary>
+/// <returns></returns>
+int CMathExpression::RecomputedCount(void) const
+{
+	return this->pIncremental ? this->pIncremental->iRecomputed : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the approximate number of bytes of memory held by the expression.
+/// </summary>
+/// <returns></returns>
+size_t CMathExpression::MemoryUsage(void) const
+{
+	size_t iBytes = sizeof(CMathExpression);
+
+	iBytes += sizeof(MATHNODE) * this->iNodesAllocated;
+	iBytes += sizeof(int) * this->iArgumentsAllocated;
+	iBytes += sizeof(MATHINSTRUCTION) * this->iInstructionsAllocated;
+	iBytes += sizeof(double) * this->iConstantsAllocated;
+	iBytes += sizeof(char *) * (this->Variables.Allocated + this->Methods.Allocated);
+	iBytes += this->Bindings ? sizeof(CMathVariables::MATHVALUE *) * this->Variables.Count : 0;
+
+	for (int i = 0; i < this->Variables.Count; i++)
+	{
+		iBytes += strlen(this->Variables.Items[i]) + 1;
+	}
+	for (int i = 0; i < this->Methods.Count; i++)
+	{
+		iBytes += strlen(this->Methods.Items[i]) + 1;
+	}
+
+	if (this->pJIT)
+	{
+		iBytes += sizeof(CMathJIT) + this->pJIT->CodeSize();
+	}
+
+	if (this->pIncremental)
+	{
+		iBytes += sizeof(MATHINCREMENTAL);
+		iBytes += (sizeof(double) + sizeof(char) + (sizeof(int) * 3)) * this->iNodeCount;
+		iBytes += sizeof(int) * (this->iArgumentCount + this->Variables.Count + 2);
+	}
+
+	return iBytes;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Classifies an operator so that the virtual machine can dispatch on it without any string comparisons.
+/// </summary>
+/// <param name="sOperator"></param>
+/// <param name="bUnary"></param>
+/// <returns>The MathOpCode of the operator or -1 if it is not recognized.</returns>
+int CMathExpression::GetOperatorOpCode(const char *sOperator, bool bUnary)
+{
+	CMathParser::MathOperator Operator = this->pParser->GetOperator(sOperator);
+
+	if (bUnary)
+	{
+		switch (Operator)
+		{
+		case CMathParser::OperatorSubtract: return OpNegate;
+		case CMathParser::OperatorNot: return OpNot;
+		case CMathParser::OperatorBitwiseNot: return OpBitwiseNot;
+		default: return -1;
+		}
+	}
+
+	switch (Operator)
+	{
+	case CMathParser::OperatorMultiply: return OpMultiply;
+	case CMathParser::OperatorDivide: return OpDivide;
+	case CMathParser::OperatorModulus: return OpModulus;
+	case CMathParser::OperatorAdd: return OpAdd;
+	case CMathParser::OperatorSubtract: return OpSubtract;
+	case CMathParser::OperatorNotEqual: return OpNotEqual;
+	case CMathParser::OperatorBitwiseOrEqual: return OpBitwiseOrEqual;
+	case CMathParser::OperatorBitwiseAndEqual: return OpBitwiseAndEqual;
+	case CMathParser::OperatorBitwiseXorEqual: return OpBitwiseXorEqual;
+	case CMathParser::OperatorLessOrEqual: return OpLessOrEqual;
+	case CMathParser::OperatorGreaterOrEqual: return OpGreaterOrEqual;
+	case CMathParser::OperatorShiftLeft: return OpShiftLeft;
+	case CMathParser::OperatorShiftRight: return OpShiftRight;
+	case CMathParser::OperatorEqual: return OpEqual;
+	case CMathParser::OperatorGreater: return OpGreater;
+	case CMathParser::OperatorLess: return OpLess;
+	case CMathParser::OperatorLogicalAnd: return OpLogicalAnd;
+	case CMathParser::OperatorLogicalOr: return OpLogicalOr;
+	case CMathParser::OperatorBitwiseOr: return OpBitwiseOr;
+	case CMathParser::OperatorBitwiseAnd: return OpBitwiseAnd;
+	case CMathParser::OperatorBitwiseXor: return OpBitwiseXor;
+	default: return -1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathExpression::AddInstruction(int iOpCode, int iOperand, int iArgCount, const char *sOperator)
+{
+	if (this->iInstructionCount >= this->iInstructionsAllocated)
+	{
+		int iAllocate = (this->iInstructionsAllocated == 0) ? 16 : this->iInstructionsAllocated * 2;
+		MATHINSTRUCTION *pInstructions = (MATHINSTRUCTION *)realloc(this->Instructions, sizeof(MATHINSTRUCTION) * iAllocate);
+		if (!pInstructions)
+		{
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+		this->Instructions = pInstructions;
+		this->iInstructionsAllocated = iAllocate;
+	}
+
+	MATHINSTRUCTION *pInstruction = &this->Instructions[this->iInstructionCount++];
+	pInstruction->OpCode = iOpCode;
+	pInstruction->Operand = iOperand;
+	pInstruction->ArgCount = iArgCount;
+	pInstruction->Operator = sOperator;
+	pInstruction->Method = CMathParser::MethodUnknown;
+	pInstruction->Function = NULL;
+	pInstruction->FunctionData = NULL;
+	pInstruction->IsPure = false;
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathExpression::AddConstant(double dValue, int *piOutIndex)
+{
+	for (int i = 0; i < this->iConstantCount; i++)
+	{
+		//Compared bitwise so that negative zero is not merged with zero.
+		if (memcmp(&this->Constants[i], &dValue, sizeof(double)) == 0)
+		{
+			*piOutIndex = i;
+			return CMathParser::ResultOk;
+		}
+	}
+
+	if (this->iConstantCount >= this->iConstantsAllocated)
+	{
+		int iAllocate = (this->iConstantsAllocated == 0) ? 8 : this->iConstantsAllocated * 2;
+		double *pConstants = (double *)realloc(this->Constants, sizeof(double) * iAllocate);
+		if (!pConstants)
+		{
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+		this->Constants = pConstants;
+		this->iConstantsAllocated = iAllocate;
+	}
+
+	this->Constants[this->iConstantCount] = dValue;
+	*piOutIndex = this->iConstantCount++;
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Looks up the variables of the expression among the variables defined on the parser (see
+///	CMathParser::SetVariable()), so that CMathParser::Evaluate() reads them through a pointer instead of looking up
+///	their names. Variables which are not defined yet are looked up by Evaluate() as before.
+/// </summary>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::Bind(void)
+{
+	if (!this->pParser->pVariableStore || this->Variables.Count == 0)
+	{
+		return CMathParser::ResultOk;
+	}
+
+	this->Bindings = (CMathVariables::MATHVALUE **)calloc(sizeof(CMathVariables::MATHVALUE *), this->Variables.Count);
+	if (!this->Bindings)
+	{
+		return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	for (int i = 0; i < this->Variables.Count; i++)
+	{
+		this->Bindings[i] = this->pParser->pVariableStore->Find(this->Variables.Items[i]);
+	}
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lowers the parsed node list into a flat stack based instruction stream and constant pool. Operations which are
+///	shared by more than one parent (see Compact()) are computed once and kept in a temporary slot.
+/// </summary>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::Lower(void)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	int iDepth = 0;
+
+	this->iInstructionCount = 0;
+	this->iConstantCount = 0;
+	this->iMaxStackDepth = 0;
+	this->iTempCount = 0;
+	this->iMaxArgCount = 0;
+
+	this->NodeUses = (int *)calloc(sizeof(int), this->iNodeCount + 1);
+	this->NodeTemps = (int *)calloc(sizeof(int), this->iNodeCount + 1);
+
+	if (!this->NodeUses || !this->NodeTemps)
+	{
+		ErrorCode = this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+	else {
+		for (int i = 0; i < this->iArgumentCount; i++)
+		{
+			this->NodeUses[this->Arguments[i]]++;
+		}
+		for (int i = 0; i < this->iNodeCount; i++)
+		{
+			this->NodeTemps[i] = -1;
+		}
+
+		ErrorCode = this->LowerNode(this->iRoot, &iDepth);
+	}
+
+	free(this->NodeUses);
+	free(this->NodeTemps);
+	this->NodeUses = NULL;
+	this->NodeTemps = NULL;
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathExpression::LowerNode(int iNode, int *piDepth)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	MATHNODE *pNode = &this->Nodes[iNode];
+
+	if (this->NodeTemps[iNode] >= 0)
+	{
+		//Already computed by an earlier reference.
+		if ((ErrorCode = this->AddInstruction(OpLoadTemp, this->NodeTemps[iNode], 0, NULL)) != CMathParser::ResultOk)
+		{
+			return ErrorCode;
+		}
+
+		(*piDepth)++;
+		if (*piDepth > this->iMaxStackDepth)
+		{
+			this->iMaxStackDepth = *piDepth;
+		}
+
+		return CMathParser::ResultOk;
+	}
+
+	for (int i = 0; i < pNode->ArgCount; i++)
+	{
+		if ((ErrorCode = this->LowerNode(this->Arguments[pNode->FirstArg + i], piDepth)) != CMathParser::ResultOk)
+		{
+			return ErrorCode;
+		}
+	}
+
+	ErrorCode = this->AddOperation(iNode);
+
+	if (pNode->Type == MATHNODE_METHOD && pNode->ArgCount > this->iMaxArgCount)
+	{
+		this->iMaxArgCount = pNode->ArgCount;
+	}
+
+	//Every node pushes a single result after consuming its arguments.
+	*piDepth = (*piDepth - pNode->ArgCount) + 1;
+	if (*piDepth > this->iMaxStackDepth)
+	{
+		this->iMaxStackDepth = *piDepth;
+	}
+
+	//Keep a copy of shared operations for the other references (constants and variables are as cheap to push).
+	if (ErrorCode == CMathParser::ResultOk && pNode->ArgCount > 0 && this->NodeUses[iNode] > 1)
+	{
+		this->NodeTemps[iNode] = this->iTempCount++;
+		ErrorCode = this->AddInstruction(OpStoreTemp, this->NodeTemps[iNode], 0, NULL);
+	}
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Adds the instruction which computes a node from the values of its parameters (which are expected on the stack),
+///	or pushes the value of a constant or variable.
+/// </summary>
+/// <param name="iNode"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::AddOperation(int iNode)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	MATHNODE *pNode = &this->Nodes[iNode];
+	int iOperand = 0;
+
+	if (pNode->Type == MATHNODE_CONSTANT)
+	{
+		if ((ErrorCode = this->AddConstant(pNode->Value, &iOperand)) != CMathParser::ResultOk)
+		{
+			return ErrorCode;
+		}
+		ErrorCode = this->AddInstruction(OpPushConstant, iOperand, 0, NULL);
+	}
+	else if (pNode->Type == MATHNODE_VARIABLE)
+	{
+		ErrorCode = this->AddInstruction(OpPushVariable, pNode->Index, 0, NULL);
+	}
+	else if (pNode->Type == MATHNODE_UNARY || pNode->Type == MATHNODE_BINARY)
+	{
+		int iOpCode = this->GetOperatorOpCode(pNode->Operator, pNode->Type == MATHNODE_UNARY);
+		if (iOpCode < 0)
+		{
+			return this->pParser->SetError(CMathParser::ResultInvalidOperator, "Invalid operator: %s.", pNode->Operator);
+		}
+		ErrorCode = this->AddInstruction(iOpCode, 0, pNode->ArgCount, pNode->Operator);
+	}
+	else if (pNode->Type == MATHNODE_METHOD)
+	{
+		int iOpCode = pNode->IsNative ? OpCallNative : ((pNode->Function >= 0) ? OpCallFunction : OpCallMethod);
+
+		ErrorCode = this->AddInstruction(iOpCode, pNode->Index, pNode->ArgCount, NULL);
+		if (ErrorCode == CMathParser::ResultOk && pNode->IsNative)
+		{
+			this->Instructions[this->iInstructionCount - 1].Method = this->pParser->GetNativeMethod(this->Methods.Items[pNode->Index]);
+		}
+		else if (ErrorCode == CMathParser::ResultOk && pNode->Function >= 0)
+		{
+			MATHINSTRUCTION *pInstruction = &this->Instructions[this->iInstructionCount - 1];
+			CMathParser::MATHFUNCTION *pFunction = &this->pParser->Functions[pNode->Function];
+			pInstruction->Function = pFunction->Proc;
+			pInstruction->FunctionData = pFunction->UserData;
+			pInstruction->IsPure = (pFunction->Flags & CMathParser::FunctionPure) != 0;
+		}
+	}
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Prepares the expression for CMathParser::EvaluateIncremental(), which keeps the value of every node between
+///	evaluations: each operation gets a program of its own which pushes the kept values of its parameters (with
+///	OpPushVariable, reading the node values instead of the variables) and then performs the operation. The programs
+///	are stored after the instructions of the expression itself, which still end at iInstructionCount.
+/// </summary>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::Track(void)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+
+	MATHINCREMENTAL *pIncremental = (MATHINCREMENTAL *)calloc(1, sizeof(MATHINCREMENTAL));
+	if (!pIncremental)
+	{
+		return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	this->pIncremental = pIncremental;
+
+	pIncremental->Values = (double *)calloc(sizeof(double), this->iNodeCount);
+	pIncremental->Dirty = (char *)calloc(sizeof(char), this->iNodeCount);
+	pIncremental->ProgramStart = (int *)calloc(sizeof(int), this->iNodeCount);
+	pIncremental->ParentStart = (int *)calloc(sizeof(int), this->iNodeCount + 1);
+	pIncremental->Parents = (int *)calloc(sizeof(int), this->iArgumentCount + 1);
+	pIncremental->VariableNodes = (int *)calloc(sizeof(int), this->Variables.Count + 1);
+	pIncremental->VolatileNodes = (int *)calloc(sizeof(int), this->iNodeCount);
+
+	if (!pIncremental->Values || !pIncremental->Dirty || !pIncremental->ProgramStart || !pIncremental->ParentStart
+		|| !pIncremental->Parents || !pIncremental->VariableNodes || !pIncremental->VolatileNodes)
+	{
+		return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	for (int i = 0; i < this->Variables.Count; i++)
+	{
+		pIncremental->VariableNodes[i] = -1;
+	}
+
+	//The parents of each node, counted first and then filled in.
+	for (int iNode = 0; iNode < this->iNodeCount; iNode++)
+	{
+		const MATHNODE *pNode = &this->Nodes[iNode];
+		for (int i = 0; i < pNode->ArgCount; i++)
+		{
+			pIncremental->ParentStart[this->Arguments[pNode->FirstArg + i] + 1]++;
+		}
+	}
+	for (int iNode = 0; iNode < this->iNodeCount; iNode++)
+	{
+		pIncremental->ParentStart[iNode + 1] += pIncremental->ParentStart[iNode];
+	}
+	for (int iNode = 0; iNode < this->iNodeCount; iNode++)
+	{
+		const MATHNODE *pNode = &this->Nodes[iNode];
+		for (int i = 0; i < pNode->ArgCount; i++)
+		{
+			pIncremental->Parents[pIncremental->ParentStart[this->Arguments[pNode->FirstArg + i]]++] = iNode;
+		}
+	}
+	for (int iNode = this->iNodeCount; iNode > 0; iNode--)
+	{
+		pIncremental->ParentStart[iNode] = pIncremental->ParentStart[iNode - 1];
+	}
+	pIncremental->ParentStart[0] = 0;
+
+	int iInstructionCount = this->iInstructionCount;
+
+	for (int iNode = 0; iNode < this->iNodeCount && ErrorCode == CMathParser::ResultOk; iNode++)
+	{
+		const MATHNODE *pNode = &this->Nodes[iNode];
+
+		pIncremental->ProgramStart[iNode] = -1;
+
+		if (pNode->Type == MATHNODE_CONSTANT)
+		{
+			pIncremental->Values[iNode] = pNode->Value;
+		}
+		else if (pNode->Type == MATHNODE_VARIABLE)
+		{
+			pIncremental->VariableNodes[pNode->Index] = iNode;
+		}
+		else {
+			pIncremental->ProgramStart[iNode] = this->iInstructionCount;
+
+			for (int i = 0; i < pNode->ArgCount && ErrorCode == CMathParser::ResultOk; i++)
+			{
+				ErrorCode = this->AddInstruction(OpPushVariable, this->Arguments[pNode->FirstArg + i], 0, NULL);
+			}
+			if (ErrorCode == CMathParser::ResultOk)
+			{
+				ErrorCode = this->AddOperation(iNode);
+			}
+
+			//Methods implemented by the method callback (or by functions which are not pure) may return a
+			//	different value each time they are called.
+			if (pNode->Type == MATHNODE_METHOD && !pNode->IsNative && !this->IsPureFunction(pNode))
+			{
+				pIncremental->VolatileNodes[pIncremental->iVolatileCount++] = iNode;
+			}
+		}
+	}
+
+	this->iInstructionCount = iInstructionCount;
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Simplifies the parsed node list so that repeated evaluations only pay for the parts of the expression which
+///	depend on variables or custom methods: constant sub-expressions (including native method calls with constant
+///	parameters) are replaced by their value and the identities x*1, 1*x, x/1, x+0, 0+x, x-0, -(-x) and !!x (where x
+///	is already 0 or 1) are removed. Sub-expressions which fail to evaluate (ex: 1/0) are left as they are so that
+///	the error is still reported by Evaluate().
+/// </summary>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::Optimize(void)
+{
+	//Folding is done by the parser itself so that the results are exactly what Evaluate() would produce,
+	//	but the folded operations should not show up in the debug output.
+	bool bDebugMode = this->pParser->DebugMode(false);
+
+	//Children are always added before their parents, so a single pass in node order sees each node after
+	//	its parameters have been simplified.
+	for (int iNode = 0; iNode < this->iNodeCount; iNode++)
+	{
+		this->OptimizeNode(iNode);
+	}
+
+	this->pParser->DebugMode(bDebugMode);
+
+	return this->Compact();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathExpression::OptimizeNode(int iNode)
+{
+	MATHNODE *pNode = &this->Nodes[iNode];
+	const int *piArgs = this->Arguments + pNode->FirstArg;
+	bool bConstantArgs = true;
+
+	if (pNode->Type == MATHNODE_CONSTANT || pNode->Type == MATHNODE_VARIABLE)
+	{
+		return;
+	}
+	else if (pNode->Type == MATHNODE_METHOD && !pNode->IsNative && !this->IsPureFunction(pNode))
+	{
+		return; //Methods implemented by the method callback (or by functions which are not pure) may have side effects.
+	}
+
+	for (int i = 0; i < pNode->ArgCount; i++)
+	{
+		if (this->Nodes[piArgs[i]].Type != MATHNODE_CONSTANT)
+		{
+			bConstantArgs = false;
+			break;
+		}
+	}
+
+	if (bConstantArgs && pNode->ArgCount > 0)
+	{
+		double dValue = 0;
+
+		if (this->pParser->EvaluateNode(this, iNode, NULL, &dValue) == CMathParser::ResultOk)
+		{
+			memset(pNode, 0, sizeof(MATHNODE));
+			pNode->Type = MATHNODE_CONSTANT;
+			pNode->Value = dValue;
+		}
+		return;
+	}
+
+	int iReplacement = -1;
+
+	//x*1, x/1, x+0, x-0 and -(-x) are only reduced to x when x is itself an operation: the result of an operation
+	//	is checked for NaN, a variable or a method result is not, so the check of the operation which is removed
+	//	still has to be made.
+	if (pNode->Type == MATHNODE_BINARY)
+	{
+		char cOp = pNode->Operator[1] == '\0' ? pNode->Operator[0] : '\0';
+
+		if ((cOp == '*' || cOp == '/') && this->IsConstantValue(piArgs[1], 1) && this->IsCheckedValue(piArgs[0]))
+		{
+			iReplacement = piArgs[0];
+		}
+		else if (cOp == '*' && this->IsConstantValue(piArgs[0], 1) && this->IsCheckedValue(piArgs[1]))
+		{
+			iReplacement = piArgs[1];
+		}
+		else if ((cOp == '+' || cOp == '-') && this->IsConstantValue(piArgs[1], 0) && this->IsCheckedValue(piArgs[0]))
+		{
+			iReplacement = piArgs[0];
+		}
+		else if (cOp == '+' && this->IsConstantValue(piArgs[0], 0) && this->IsCheckedValue(piArgs[1]))
+		{
+			iReplacement = piArgs[1];
+		}
+	}
+	else if (pNode->Type == MATHNODE_UNARY && pNode->Operator[0] == '-')
+	{
+		const MATHNODE *pOperand = &this->Nodes[piArgs[0]];
+
+		if (pOperand->Type == MATHNODE_UNARY && pOperand->Operator[0] == '-'
+			&& this->IsCheckedValue(this->Arguments[pOperand->FirstArg]))
+		{
+			iReplacement = this->Arguments[pOperand->FirstArg];
+		}
+	}
+
+	int iOperand = 0;
+	int iInner = 0;
+
+	//!!x (or NOT(NOT(x))) is only the same as x when x is already 0 or 1.
+	if (iReplacement < 0 && this->IsLogicalNot(iNode, &iOperand)
+		&& this->IsLogicalNot(iOperand, &iInner) && this->IsBooleanValue(iInner))
+	{
+		iReplacement = iInner;
+	}
+
+	if (iReplacement >= 0)
+	{
+		//The node becomes a copy of the operand it reduces to, the operand itself is dropped by Compact().
+		memcpy(pNode, &this->Nodes[iReplacement], sizeof(MATHNODE));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathExpression::IsConstantValue(int iNode, double dValue)
+{
+	return (this->Nodes[iNode].Type == MATHNODE_CONSTANT && this->Nodes[iNode].Value == dValue);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether the value of a node is checked for NaN when it is computed (operators are, like
+///	PerformDoubleOperation, variables and method results are not), or is a constant which is not NaN.
+/// </summary>
+/// <param name="iNode"></param>
+/// <returns></returns>
+bool CMathExpression::IsCheckedValue(int iNode)
+{
+	const MATHNODE *pNode = &this->Nodes[iNode];
+
+	return (pNode->Type == MATHNODE_UNARY || pNode->Type == MATHNODE_BINARY
+		|| (pNode->Type == MATHNODE_CONSTANT && pNode->Value == pNode->Value));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether a node is a logical not (either the ! operator or the NOT method).
+/// </summary>
+/// <param name="iNode"></param>
+/// <param name="piOutOperand">Receives the node being negated.</param>
+/// <returns></returns>
+bool CMathExpression::IsLogicalNot(int iNode, int *piOutOperand)
+{
+	const MATHNODE *pNode = &this->Nodes[iNode];
+
+	if ((pNode->Type == MATHNODE_UNARY && pNode->Operator[0] == '!')
+		|| (pNode->Type == MATHNODE_METHOD && pNode->IsNative && pNode->ArgCount == 1
+			&& this->pParser->GetNativeMethod(this->Methods.Items[pNode->Index]) == CMathParser::MethodNot))
+	{
+		*piOutOperand = this->Arguments[pNode->FirstArg];
+		return true;
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether a node can only ever produce 0 or 1 (comparisons, logical operators and NOT).
+/// </summary>
+/// <param name="iNode"></param>
+/// <returns></returns>
+bool CMathExpression::IsBooleanValue(int iNode)
+{
+	const MATHNODE *pNode = &this->Nodes[iNode];
+
+	if (pNode->Type == MATHNODE_CONSTANT)
+	{
+		return (pNode->Value == 0 || pNode->Value == 1);
+	}
+	else if (pNode->Type == MATHNODE_UNARY)
+	{
+		return (pNode->Operator[0] == '!');
+	}
+	else if (pNode->Type == MATHNODE_BINARY)
+	{
+		switch (this->GetOperatorOpCode(pNode->Operator, false))
+		{
+		case OpNotEqual:
+		case OpLessOrEqual:
+		case OpGreaterOrEqual:
+		case OpEqual:
+		case OpGreater:
+		case OpLess:
+		case OpLogicalAnd:
+		case OpLogicalOr:
+			return true;
+		}
+	}
+	else if (pNode->Type == MATHNODE_METHOD)
+	{
+		return (pNode->IsNative && this->pParser->GetNativeMethod(this->Methods.Items[pNode->Index]) == CMathParser::MethodNot);
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether a node calls a registered function which was declared pure, so that it can be folded and
+///	shared like a built-in method.
+/// </summary>
+/// <param name="pNode"></param>
+/// <returns></returns>
+bool CMathExpression::IsPureFunction(const MATHNODE *pNode)
+{
+	return pNode->Type == MATHNODE_METHOD && pNode->Function >= 0
+		&& (this->pParser->Functions[pNode->Function].Flags & CMathParser::FunctionPure) != 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Rebuilds the node list so that it only contains the nodes which are still reachable from the root. Structurally
+///	identical sub-expressions are merged into a single node while rebuilding, so that they are only evaluated once.
+/// </summary>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::Compact(void)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+
+	MATHNODE *pOldNodes = this->Nodes;
+	int *pOldArguments = this->Arguments;
+	int iOldNodeCount = this->iNodeCount;
+
+	this->Nodes = NULL;
+	this->iNodeCount = 0;
+	this->iNodesAllocated = 0;
+
+	this->Arguments = NULL;
+	this->iArgumentCount = 0;
+	this->iArgumentsAllocated = 0;
+
+	this->iDeduplicatedCount = 0;
+
+	//Open addressing table of node indexes, at most half full.
+	this->iNodeHashSz = 16;
+	while (this->iNodeHashSz < iOldNodeCount * 2)
+	{
+		this->iNodeHashSz *= 2;
+	}
+
+	this->NodeHash = (int *)calloc(sizeof(int), this->iNodeHashSz);
+	if (!this->NodeHash)
+	{
+		ErrorCode = this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+	else {
+		for (int i = 0; i < this->iNodeHashSz; i++)
+		{
+			this->NodeHash[i] = -1;
+		}
+
+		ErrorCode = this->CopyNode(pOldNodes, pOldArguments, this->iRoot, &this->iRoot);
+	}
+
+	free(this->NodeHash);
+	this->NodeHash = NULL;
+	this->iNodeHashSz = 0;
+
+	free(pOldNodes);
+	free(pOldArguments);
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathExpression::CopyNode(const MATHNODE *pNodes, const int *pArguments, int iNode, int *piOutNode)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	const MATHNODE *pNode = &pNodes[iNode];
+	int iStackArgs[16];
+	int *piArgs = iStackArgs;
+
+	if (pNode->ArgCount > (int)(sizeof(iStackArgs) / sizeof(int)))
+	{
+		piArgs = (int *)calloc(sizeof(int), pNode->ArgCount);
+		if (!piArgs)
+		{
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+	}
+
+	for (int i = 0; i < pNode->ArgCount && ErrorCode == CMathParser::ResultOk; i++)
+	{
+		ErrorCode = this->CopyNode(pNodes, pArguments, pArguments[pNode->FirstArg + i], &piArgs[i]);
+	}
+
+	if (ErrorCode == CMathParser::ResultOk)
+	{
+		//Methods implemented by the method callback may return a different value each time they are called.
+		bool bShareable = (pNode->Type != MATHNODE_METHOD || pNode->IsNative || this->IsPureFunction(pNode));
+		int iSlot = -1;
+
+		if (bShareable)
+		{
+			iSlot = this->FindNode(pNode, piArgs);
+		}
+
+		if (iSlot >= 0 && this->NodeHash[iSlot] >= 0)
+		{
+			*piOutNode = this->NodeHash[iSlot];
+			if (pNode->ArgCount > 0)
+			{
+				this->iDeduplicatedCount++;
+			}
+		}
+		else if ((ErrorCode = this->AddNode(pNode->Type, pNode->Operator, pNode->Value, pNode->Index, piArgs, pNode->ArgCount, piOutNode)) == CMathParser::ResultOk)
+		{
+			this->Nodes[*piOutNode].IsNative = pNode->IsNative;
+			this->Nodes[*piOutNode].Function = pNode->Function;
+			if (iSlot >= 0)
+			{
+				this->NodeHash[iSlot] = *piOutNode;
+			}
+		}
+	}
+
+	if (piArgs != iStackArgs)
+	{
+		free(piArgs);
+	}
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Looks up a node in the node hash table (which is only valid during Compact()).
+/// </summary>
+/// <param name="pNode">The node to look for, its parameters are given by piArgs rather than by FirstArg.</param>
+/// <param name="piArgs">Indexes of the (already merged) parameter nodes.</param>
+/// <returns>The slot of the matching node, or the free slot where it should be stored.</returns>
+int CMathExpression::FindNode(const MATHNODE *pNode, const int *piArgs)
+{
+	unsigned long long iValueBits = 0;
+	unsigned int iHash = 2166136261U;
+
+	memcpy(&iValueBits, &pNode->Value, sizeof(iValueBits));
+
+	iHash = (iHash ^ (unsigned int)pNode->Type) * 16777619U;
+	iHash = (iHash ^ (unsigned int)(pNode->Operator ? pNode->Operator[0] : 0)) * 16777619U;
+	iHash = (iHash ^ (unsigned int)(iValueBits ^ (iValueBits >> 32))) * 16777619U;
+	iHash = (iHash ^ (unsigned int)pNode->Index) * 16777619U;
+	for (int i = 0; i < pNode->ArgCount; i++)
+	{
+		iHash = (iHash ^ (unsigned int)piArgs[i]) * 16777619U;
+	}
+
+	int iMask = this->iNodeHashSz - 1;
+	int iSlot = (int)(iHash & (unsigned int)iMask);
+
+	while (this->NodeHash[iSlot] >= 0)
+	{
+		const MATHNODE *pExisting = &this->Nodes[this->NodeHash[iSlot]];
+
+		if (pExisting->Type == pNode->Type
+			&& pExisting->Index == pNode->Index
+			&& pExisting->IsNative == pNode->IsNative
+			&& pExisting->ArgCount == pNode->ArgCount
+			&& memcmp(&pExisting->Value, &pNode->Value, sizeof(double)) == 0
+			&& (pExisting->Operator == pNode->Operator
+				|| (pExisting->Operator && pNode->Operator && strcmp(pExisting->Operator, pNode->Operator) == 0))
+			&& (pNode->ArgCount == 0
+				|| memcmp(this->Arguments + pExisting->FirstArg, piArgs, sizeof(int) * pNode->ArgCount) == 0))
+		{
+			return iSlot;
+		}
+
+		iSlot = (iSlot + 1) & iMask;
+	}
+
+	return iSlot;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathExpression::AddNode(int iType, const char *sOperator, double dValue, int iIndex, const int *piArgs, int iArgCount, int *piOutNode)
+{
+	if (this->iNodeCount >= this->iNodesAllocated)
+	{
+		int iAllocate = (this->iNodesAllocated == 0) ? 16 : this->iNodesAllocated * 2;
+		MATHNODE *pNodes = (MATHNODE *)realloc(this->Nodes, sizeof(MATHNODE) * iAllocate);
+		if (!pNodes)
+		{
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+		this->Nodes = pNodes;
+		this->iNodesAllocated = iAllocate;
+	}
+
+	if (this->iArgumentCount + iArgCount > this->iArgumentsAllocated)
+	{
+		int iAllocate = (this->iArgumentsAllocated == 0) ? 16 : this->iArgumentsAllocated * 2;
+		while (iAllocate < this->iArgumentCount + iArgCount)
+		{
+			iAllocate *= 2;
+		}
+		int *pArguments = (int *)realloc(this->Arguments, sizeof(int) * iAllocate);
+		if (!pArguments)
+		{
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+		this->Arguments = pArguments;
+		this->iArgumentsAllocated = iAllocate;
+	}
+
+	MATHNODE *pNode = &this->Nodes[this->iNodeCount];
+	memset(pNode, 0, sizeof(MATHNODE));
+
+	pNode->Type = iType;
+	pNode->Operator = sOperator;
+	pNode->Value = dValue;
+	pNode->Index = iIndex;
+	pNode->Function = -1;
+	pNode->FirstArg = this->iArgumentCount;
+	pNode->ArgCount = iArgCount;
+
+	for (int i = 0; i < iArgCount; i++)
+	{
+		this->Arguments[this->iArgumentCount++] = piArgs[i];
+
+		if (this->Nodes[piArgs[i]].Depth >= pNode->Depth)
+		{
+			pNode->Depth = this->Nodes[piArgs[i]].Depth + 1;
+		}
+	}
+
+	//Optimizing, lowering and evaluating the tree all recurse into the child nodes.
+	if (pNode->Depth > CMATHPARSER_MAX_NODE_DEPTH)
+	{
+		this->iArgumentCount -= iArgCount;
+		return this->pParser->SetError(CMathParser::ResultNestingTooDeep, "Expression is nested too deeply.");
+	}
+
+	*piOutNode = this->iNodeCount++;
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Adds a name to a name list (if it is not already present) and returns its index.
+/// </summary>
+/// <param name="pList"></param>
+/// <param name="sName"></param>
+/// <param name="piOutIndex"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::AddName(MATHNAMELIST *pList, const char *sName, int *piOutIndex)
+{
+	for (int i = 0; i < pList->Count; i++)
+	{
+		if (strcmp(pList->Items[i], sName) == 0)
+		{
+			*piOutIndex = i;
+			return CMathParser::ResultOk;
+		}
+	}
+
+	if (pList->Count >= pList->Allocated)
+	{
+		int iAllocate = (pList->Allocated == 0) ? 8 : pList->Allocated * 2;
+		char **pItems = (char **)realloc(pList->Items, sizeof(char *) * iAllocate);
+		if (!pItems)
+		{
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+		pList->Items = pItems;
+		pList->Allocated = iAllocate;
+	}
+
+	int iNameSz = (int)strlen(sName) + 1;
+	char *sCopy = (char *)calloc(sizeof(char), iNameSz);
+	if (!sCopy)
+	{
+		return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+	strcpy_s(sCopy, iNameSz, sName);
+
+	pList->Items[pList->Count] = sCopy;
+	*piOutIndex = pList->Count++;
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Parses the entire expression into the node list.
+/// </summary>
+/// <param name="sExpression"></param>
+/// <param name="iExpressionSz"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::Parse(const char *sExpression, int iExpressionSz)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+
+	if (this->pParser->MatchParentheses(sExpression, iExpressionSz) != 0)
+	{
+		return this->pParser->SetError(CMathParser::ResultParenthesesMismatch, "Parentheses mismatch.");
+	}
+
+	CMathLexer Lexer(this->pParser);
+
+	if (!Lexer.Tokenize(sExpression, iExpressionSz))
+	{
+		return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	this->sSource = sExpression;
+	this->pTokens = Lexer.Tokens();
+	this->iToken = 0;
+	this->iDepth = 0;
+
+	if ((ErrorCode = this->ParseGroup(&this->iRoot)) == CMathParser::ResultOk)
+	{
+		CMathLexer::MATHTOKEN *pToken = &this->pTokens[this->iToken];
+
+		if (pToken->Type == CMathLexer::TokenOpenParenthesis || pToken->Type == CMathLexer::TokenCloseParenthesis)
+		{
+			ErrorCode = this->pParser->SetErrorAt(CMathParser::ResultMissingOperator, pToken->Position, "Missing mathematical operator near: %c.", this->sSource[pToken->Position]);
+		}
+		else if (pToken->Type != CMathLexer::TokenEnd)
+		{
+			ErrorCode = this->pParser->SetErrorAt(CMathParser::ResultInvalidToken, pToken->Position, "Token is invalid: %c", this->sSource[pToken->Position]);
+		}
+		else {
+			this->bTextForm = this->ScanTextForm(&Lexer);
+		}
+	}
+
+	this->sSource = NULL;
+	this->pTokens = NULL;
+	this->iToken = 0;
+	this->iDepth = 0;
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Parses the whole expression, the contents of a pair of parentheses or a parameter of a method. A bitwise not at
+///	the start of a group applies to the result of everything which follows it, as it does for Calculate() (see
+///	CMathParser::EvaluateTokenGroup), so "~1+1" is "~(1+1)".
+/// </summary>
+/// <param name="piOutNode"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::ParseGroup(int *piOutNode)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	CMathLexer::MATHTOKEN *pToken = &this->pTokens[this->iToken];
+
+	if (pToken->Type != CMathLexer::TokenOperator || pToken->Operator != sFirstOrder[0])
+	{
+		return this->ParseBinary(1, piOutNode);
+	}
+
+	this->iToken++;
+
+	int iOperand = 0;
+	if ((ErrorCode = this->ParseBinary(1, &iOperand)) != CMathParser::ResultOk)
+	{
+		return ErrorCode;
+	}
+
+	return this->AddNode(MATHNODE_UNARY, pToken->Operator, 0, 0, &iOperand, 1, piOutNode);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Parses binary operations by precedence climbing. Operators which bind at least as tightly as iMinPrecedence
+///	are consumed here and the right operand of each one only takes operators which bind tighter, so operators of
+///	the same precedence are left associative. See CMathLexer::FirstOrderPrecedence for the precedence levels.
+/// </summary>
+/// <param name="iMinPrecedence"></param>
+/// <param name="piOutNode"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::ParseBinary(int iMinPrecedence, int *piOutNode)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	int iArgs[2];
+
+	if ((ErrorCode = this->ParseUnary(&iArgs[0])) != CMathParser::ResultOk)
+	{
+		return ErrorCode;
+	}
+
+	while (true)
+	{
+		CMathLexer::MATHTOKEN *pToken = &this->pTokens[this->iToken];
+
+		if (pToken->Type != CMathLexer::TokenOperator || pToken->Precedence == 0 || pToken->Precedence < iMinPrecedence)
+		{
+			break;
+		}
+
+		this->iToken++;
+
+		if ((ErrorCode = this->ParseBinary(pToken->Precedence + 1, &iArgs[1])) != CMathParser::ResultOk)
+		{
+			return ErrorCode;
+		}
+		if ((ErrorCode = this->AddNode(MATHNODE_BINARY, pToken->Operator, 0, 0, iArgs, 2, &iArgs[0])) != CMathParser::ResultOk)
+		{
+			return ErrorCode;
+		}
+	}
+
+	*piOutNode = iArgs[0];
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Parses the prefix operators: logical not (!), bitwise not (~) and the numeric sign (+/-).
+/// </summary>
+/// <param name="piOutNode"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::ParseUnary(int *piOutNode)
+{
+	//Every level of parentheses and every prefix operator is parsed by recursion.
+	if (this->iDepth >= CMATHPARSER_MAX_NESTING)
+	{
+		return this->pParser->SetError(CMathParser::ResultNestingTooDeep, "Expression is nested too deeply.");
+	}
+
+	this->iDepth++;
+	CMathParser::MathResult ErrorCode = this->ParseUnaryOperand(piOutNode);
+	this->iDepth--;
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Parses the prefix operators for ParseUnary().
+/// </summary>
+/// <param name="piOutNode"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::ParseUnaryOperand(int *piOutNode)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	CMathLexer::MATHTOKEN *pToken = &this->pTokens[this->iToken];
+	const char *sOp = NULL;
+
+	//The lexer returns the entries of the operator tables, so the operators can be compared by address.
+	if (pToken->Type == CMathLexer::TokenOperator)
+	{
+		if (pToken->Operator == sPreOrder[0] || pToken->Operator == sFirstOrder[0] || pToken->Operator == sSecondOrder[1])
+		{
+			sOp = pToken->Operator;
+		}
+		else if (pToken->Operator == sSecondOrder[0])
+		{
+			this->iToken++;
+			return this->ParseUnary(piOutNode);
+		}
+	}
+
+	if (!sOp)
+	{
+		return this->ParsePrimary(piOutNode);
+	}
+
+	this->iToken++;
+
+	int iOperand = 0;
+	if ((ErrorCode = this->ParseUnary(&iOperand)) != CMathParser::ResultOk)
+	{
+		return ErrorCode;
+	}
+
+	//A negative number is just a constant, there is no need to negate it at evaluation time. The sign of a group is
+	//	kept for CMathParser::EvaluateTextForm() (Optimize() folds it).
+	if (sOp[0] == '-' && this->Nodes[iOperand].Type == MATHNODE_CONSTANT && !this->Nodes[iOperand].IsGroup)
+	{
+		this->Nodes[iOperand].Value = -this->Nodes[iOperand].Value;
+		*piOutNode = iOperand;
+		return CMathParser::ResultOk;
+	}
+
+	return this->AddNode(MATHNODE_UNARY, sOp, 0, 0, &iOperand, 1, piOutNode);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathExpression::ParsePrimary(int *piOutNode)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	CMathLexer::MATHTOKEN *pToken = &this->pTokens[this->iToken];
+
+	if (pToken->Type == CMathLexer::TokenEnd)
+	{
+		return this->pParser->SetError(CMathParser::ResultRightValueFailed, "Value to the right of operator is missing or invalid.");
+	}
+	else if (pToken->Type == CMathLexer::TokenOpenParenthesis)
+	{
+		this->iToken++;
+
+		if ((ErrorCode = this->ParseGroup(piOutNode)) != CMathParser::ResultOk)
+		{
+			return ErrorCode;
+		}
+
+		if (this->pTokens[this->iToken].Type != CMathLexer::TokenCloseParenthesis)
+		{
+			return this->pParser->SetError(CMathParser::ResultParenthesesMismatch, "Parentheses mismatch.");
+		}
+
+		this->iToken++;
+		this->Nodes[*piOutNode].IsGroup = true;
+
+		return CMathParser::ResultOk;
+	}
+	else if (pToken->Type == CMathLexer::TokenNumber)
+	{
+		return this->ParseNumber(piOutNode);
+	}
+	else if (pToken->Type == CMathLexer::TokenIdentifier)
+	{
+		return this->ParseIdentifier(piOutNode);
+	}
+
+	return this->pParser->SetErrorAt(CMathParser::ResultInvalidToken, pToken->Position, "Token is invalid: %c", this->sSource[pToken->Position]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Checks whether CMathParser::CalculateCached() can evaluate the parsed form in place of the text of the expression
+///	(see CMathParser::EvaluateTextForm). It can not for the forms which the token stream leaves to the text based
+///	evaluator (ex: "--1" or "5*~3"), for calls without parameters, which are passed a zero, and for commas which
+///	CMathParser::ParseMethodParameters() takes as separating the parameters of an outer method (ex: "sum(2*max(1,3))").
+/// </summary>
+/// <param name="pLexer">The tokens of the expression, only valid during Parse().</param>
+/// <returns></returns>
+bool CMathExpression::ScanTextForm(CMathLexer *pLexer)
+{
+	CMathLexer::MATHTOKEN *pTokens = this->pTokens;
+	int iTokenCount = pLexer->Count();
+
+	//The open parentheses around the current token and whether each one is a call whose commas are its own.
+	int *piOpen = (int *)calloc(iTokenCount + 1, sizeof(int));
+	bool *pbOwnCommas = (bool *)calloc(iTokenCount + 1, sizeof(bool));
+	int iOpen = 0;
+	int iCalls = 0;
+
+	bool bTextForm = (piOpen && pbOwnCommas);
+	bool bOperand = true; //The token starts an operand, along with its prefix operators.
+	bool bGroup = true;   //The operand starts the text, a group or a parameter.
+
+	for (int iToken = 0; bTextForm && pTokens[iToken].Type != CMathLexer::TokenEnd; iToken++)
+	{
+		if (bOperand)
+		{
+			//The prefix operators read by CMathParser::EvaluateTokenGroup and EvaluateTokenOperand, in that order.
+			if (bGroup && pTokens[iToken].Type == CMathLexer::TokenOperator && pTokens[iToken].Operator == sFirstOrder[0])
+			{
+				iToken++;
+			}
+			if (pTokens[iToken].Type == CMathLexer::TokenOperator && pTokens[iToken].Operator == sFirstOrder[0])
+			{
+				if (iToken > 0 && pTokens[iToken - 1].Type == CMathLexer::TokenOperator
+					&& pTokens[iToken - 1].Precedence == pLexer->FirstOrderPrecedence())
+				{
+					bTextForm = false;
+					break;
+				}
+				iToken++;
+			}
+			if (pTokens[iToken].Type == CMathLexer::TokenOperator && pTokens[iToken].Operator == sPreOrder[0])
+			{
+				iToken++;
+			}
+			if (pTokens[iToken].Type == CMathLexer::TokenOperator && pTokens[iToken].Operator == sSecondOrder[1])
+			{
+				iToken++;
+			}
+
+			//Any other prefix operator (ex: "--1" or "+1") is left to the text based evaluator.
+			if (pTokens[iToken].Type != CMathLexer::TokenNumber && pTokens[iToken].Type != CMathLexer::TokenIdentifier
+				&& pTokens[iToken].Type != CMathLexer::TokenOpenParenthesis)
+			{
+				bTextForm = false;
+				break;
+			}
+
+			bOperand = false;
+			bGroup = false;
+		}
+
+		CMathLexer::MATHTOKEN *pToken = &pTokens[iToken];
+
+		if (pToken->Type == CMathLexer::TokenNumber)
+		{
+			//atof() and atol() of longer numbers may not agree on the integer part.
+			bTextForm = (pToken->Length <= 15);
+		}
+		else if (pToken->Type == CMathLexer::TokenIdentifier)
+		{
+		}
+		else if (pToken->Type == CMathLexer::TokenOpenParenthesis)
+		{
+			bool bCall = (iToken > 0 && pTokens[iToken - 1].Type == CMathLexer::TokenIdentifier);
+			bool bOwnCommas = false;
+
+			if (bCall)
+			{
+				//The parameters of every call outside of other calls are split by ParseMethodParameters(), which only
+				//	splits the parameters of a call inside of them for built-in methods which start a parameter.
+				if (iCalls == 0)
+				{
+					bOwnCommas = true;
+				}
+				else if (iOpen > 0 && pbOwnCommas[iOpen - 1] && iToken > 1
+					&& (pTokens[iToken - 2].Type == CMathLexer::TokenOpenParenthesis || pTokens[iToken - 2].Type == CMathLexer::TokenComma))
+				{
+					char sName[CMATHPARSER_MAX_VAR_LENGTH + 1];
+					memcpy(sName, this->sSource + pTokens[iToken - 1].Position, pTokens[iToken - 1].Length);
+					sName[pTokens[iToken - 1].Length] = '\0';
+
+					bOwnCommas = (this->pParser->GetNativeMethod(sName) != CMathParser::MethodUnknown);
+				}
+
+				bTextForm = (pTokens[iToken + 1].Type != CMathLexer::TokenCloseParenthesis);
+				iCalls++;
+			}
+
+			piOpen[iOpen] = iToken;
+			pbOwnCommas[iOpen] = bOwnCommas;
+			iOpen++;
+
+			bOperand = true;
+			bGroup = true;
+		}
+		else if (pToken->Type == CMathLexer::TokenCloseParenthesis && iOpen > 0)
+		{
+			iOpen--;
+
+			int iName = piOpen[iOpen] - 1;
+			if (iName >= 0 && pTokens[iName].Type == CMathLexer::TokenIdentifier)
+			{
+				iCalls--;
+
+				//ParseMethodParameters() collects each parameter, after replacing a leading built-in method by its
+				//	value, in 1024 characters.
+				if (pbOwnCommas[iOpen] && pToken->Position - pTokens[iName].Position >= 1024 - 64)
+				{
+					bTextForm = false;
+				}
+			}
+		}
+		else if (pToken->Type == CMathLexer::TokenComma && iOpen > 0 && pbOwnCommas[iOpen - 1])
+		{
+			bOperand = true;
+			bGroup = true;
+		}
+		else if (pToken->Type == CMathLexer::TokenOperator && pToken->Precedence > 0)
+		{
+			bOperand = true;
+		}
+		else {
+			//Commas of an outer method, prefix operators after an operand (ex: "1~2"), etc.
+			bTextForm = false;
+		}
+	}
+
+	free(piOpen);
+	free(pbOwnCommas);
+
+	return bTextForm;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathExpression::ParseNumber(int *piOutNode)
+{
+	CMathLexer::MATHTOKEN *pToken = &this->pTokens[this->iToken++];
+	char sVal[_CVTBUFSIZE];
+
+	if (pToken->Length > (int)sizeof(sVal) - 1)
+	{
+		return this->pParser->SetErrorAt(CMathParser::ResultInvalidToken, pToken->Position, "Numeric value is too long.");
+	}
+
+	memcpy(sVal, this->sSource + pToken->Position, pToken->Length);
+	sVal[pToken->Length] = '\0';
+
+	if (!this->pParser->IsNumeric(sVal, pToken->Length))
+	{
+		return this->pParser->SetErrorAt(CMathParser::ResultInvalidToken, pToken->Position, "Token is invalid: %s", sVal);
+	}
+
+	return this->AddNode(MATHNODE_CONSTANT, NULL, atof(sVal), 0, NULL, 0, piOutNode);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Parses a variable or a method call (along with its parameters).
+/// </summary>
+/// <param name="piOutNode"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathExpression::ParseIdentifier(int *piOutNode)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	CMathLexer::MATHTOKEN *pToken = &this->pTokens[this->iToken++];
+	char sName[CMATHPARSER_MAX_VAR_LENGTH + 1];
+	int iIndex = 0;
+
+	if (pToken->Length >= CMATHPARSER_MAX_VAR_LENGTH)
+	{
+		return this->pParser->SetErrorAt(CMathParser::ResultInvalidToken, pToken->Position, "Variable length limit exceeded.");
+	}
+
+	memcpy(sName, this->sSource + pToken->Position, pToken->Length);
+	sName[pToken->Length] = '\0';
+
+	if (this->pTokens[this->iToken].Type != CMathLexer::TokenOpenParenthesis)
+	{
+		if ((ErrorCode = this->AddName(&this->Variables, sName, &iIndex)) != CMathParser::ResultOk)
+		{
+			return ErrorCode;
+		}
+		return this->AddNode(MATHNODE_VARIABLE, NULL, 0, iIndex, NULL, 0, piOutNode);
+	}
+
+	this->iToken++; //Skip the opening parenthesis.
+
+	int *piArgs = NULL;
+	int iArgCount = 0;
+	int iArgsAllocated = 0;
+
+	if (this->pTokens[this->iToken].Type == CMathLexer::TokenCloseParenthesis)
+	{
+		this->iToken++;
+	}
+	else {
+		while (true)
+		{
+			if (iArgCount >= iArgsAllocated)
+			{
+				iArgsAllocated = (iArgsAllocated == 0) ? 8 : iArgsAllocated * 2;
+				int *piNewArgs = (int *)realloc(piArgs, sizeof(int) * iArgsAllocated);
+				if (!piNewArgs)
+				{
+					free(piArgs);
+					return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+				}
+				piArgs = piNewArgs;
+			}
+
+			if ((ErrorCode = this->ParseGroup(&piArgs[iArgCount])) != CMathParser::ResultOk)
+			{
+				free(piArgs);
+				return ErrorCode;
+			}
+
+			iArgCount++;
+
+			if (this->pTokens[this->iToken].Type == CMathLexer::TokenComma)
+			{
+				this->iToken++;
+			}
+			else if (this->pTokens[this->iToken].Type == CMathLexer::TokenCloseParenthesis)
+			{
+				this->iToken++;
+				break;
+			}
+			else {
+				free(piArgs);
+				return this->pParser->SetError(CMathParser::ResultParenthesesMismatch, "Parentheses mismatch.");
+			}
+		}
+	}
+
+	CMathParser::MathMethod Method = this->pParser->GetNativeMethod(sName);
+	int iFunction = (Method == CMathParser::MethodUnknown) ? this->pParser->GetFunction(sName) : -1;
+
+	//The number of parameters of built-in and registered functions is checked once, here, instead of on each call.
+	if (Method != CMathParser::MethodUnknown && !this->pParser->IsValidParamCount(Method, iArgCount))
+	{
+		ErrorCode = this->pParser->SetErrorAt(CMathParser::ResultInvalidToken, pToken->Position, "Invalid number of parameters passed to method: %s", sName);
+	}
+	else if (iFunction >= 0 && (iArgCount < this->pParser->Functions[iFunction].MinArgs
+		|| (this->pParser->Functions[iFunction].MaxArgs >= 0 && iArgCount > this->pParser->Functions[iFunction].MaxArgs)))
+	{
+		ErrorCode = this->pParser->SetErrorAt(CMathParser::ResultInvalidToken, pToken->Position, "Invalid number of parameters passed to method: %s", sName);
+	}
+	else if ((ErrorCode = this->AddName(&this->Methods, sName, &iIndex)) == CMathParser::ResultOk)
+	{
+		if ((ErrorCode = this->AddNode(MATHNODE_METHOD, NULL, 0, iIndex, piArgs, iArgCount, piOutNode)) == CMathParser::ResultOk)
+		{
+			this->Nodes[*piOutNode].IsNative = (Method != CMathParser::MethodUnknown);
+			this->Nodes[*piOutNode].Function = iFunction;
+		}
+	}
+
+	free(piArgs);
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,206 @@
+#ifndef _CMathExpression_H
+#define _CMathExpression_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathParser.h"
+#include "CMathJIT.h"
+#include "CMathLexer.h"
+#include "CMathVariables.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define MATHNODE_CONSTANT   0
+#define MATHNODE_VARIABLE   1
+#define MATHNODE_UNARY      2
+#define MATHNODE_BINARY     3
+#define MATHNODE_METHOD     4
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// A parsed expression which can be evaluated repeatedly by CMathParser::Evaluate without rescanning the text.
+/// Instances are created by CMathParser::Compile and are owned (and deleted) by the caller.
+/// </summary>
+class CMathExpression {
+	friend class CMathParser;
+	friend class CMathJIT;
+
+private:
+	typedef struct _tag_Math_Node {
+		int Type;             //One of the MATHNODE_ types.
+		const char *Operator; //Operator text for unary and binary nodes (points into the static operator tables).
+		double Value;         //Value for constant nodes.
+		int Index;            //Variable index for variable nodes, name index for method nodes.
+		bool IsNative;        //Method nodes: true for built-in methods, false for methods handled by the method callback.
+		int Function;         //Method nodes: index of the function added by CMathParser::RegisterFunction(), -1 for others.
+		int FirstArg;         //Index into Arguments of the first child node.
+		int ArgCount;         //Number of child nodes.
+		int Depth;            //Longest path to a leaf, limited to CMATHPARSER_MAX_NODE_DEPTH by AddNode().
+		bool IsGroup;         //The node is the contents of a pair of parentheses, as parsed by ParsePrimary().
+	} MATHNODE, *LPMATHNODE;
+
+	enum MathOpCode {
+		OpPushConstant,      //Operand: index into the constant pool.
+		OpPushVariable,      //Operand: variable index.
+		OpNegate,
+		OpNot,
+		OpBitwiseNot,
+		OpMultiply,          //Binary operators: OpMultiply through OpBitwiseXor.
+		OpDivide,
+		OpModulus,
+		OpAdd,
+		OpSubtract,
+		OpNotEqual,
+		OpBitwiseOrEqual,
+		OpBitwiseAndEqual,
+		OpBitwiseXorEqual,
+		OpLessOrEqual,
+		OpGreaterOrEqual,
+		OpShiftLeft,
+		OpShiftRight,
+		OpEqual,
+		OpGreater,
+		OpLess,
+		OpLogicalAnd,
+		OpLogicalOr,
+		OpBitwiseOr,
+		OpBitwiseAnd,
+		OpBitwiseXor,
+		OpCallNative,        //Operand: method name index, ArgCount: number of parameters on the stack.
+		OpCallMethod,        //Operand: method name index, ArgCount: number of parameters on the stack.
+		OpCallFunction,      //Operand: method name index, ArgCount: number of parameters on the stack.
+		OpStoreTemp,         //Operand: temporary slot, copies the top of the stack (which is left in place).
+		OpLoadTemp           //Operand: temporary slot.
+	};
+
+	typedef struct _tag_Math_Instruction {
+		int OpCode;           //One of the MathOpCode values.
+		int Operand;
+		int ArgCount;
+		const char *Operator; //Operator text, used for error reporting.
+		int Method;           //OpCallNative: the CMathParser::MathMethod, resolved when the expression is compiled.
+		CMathParser::TFunctionProc Function; //OpCallFunction: bound when the expression is compiled.
+		void *FunctionData;   //OpCallFunction: user data of the function.
+		bool IsPure;          //OpCallFunction: the function was registered with FunctionPure.
+	} MATHINSTRUCTION, *LPMATHINSTRUCTION;
+
+	typedef struct _tag_Math_Incremental {
+		double *Values;       //Value of each node after the last evaluation.
+		char *Dirty;          //Nodes which have to be computed again, only set during CMathParser::EvaluateIncremental().
+		int *ProgramStart;    //Index into Instructions of the program which computes each node, -1 for constants and variables.
+		int *ParentStart;     //Index into Parents of the first parent of each node (the list ends at the next node's start).
+		int *Parents;
+		int *VariableNodes;   //Node of each variable, -1 for variables which were optimized away.
+		int *VolatileNodes;   //Method nodes which are computed on every evaluation (callback methods and functions which are not pure).
+		int iVolatileCount;
+		bool IsValid;         //Values holds the result of a successful evaluation.
+		int iRecomputed;      //Nodes computed by the last evaluation.
+	} MATHINCREMENTAL, *LPMATHINCREMENTAL;
+
+	typedef struct _tag_Math_Name_List {
+		char **Items;
+		int Count;
+		int Allocated;
+	} MATHNAMELIST, *LPMATHNAMELIST;
+
+public:
+	~CMathExpression(void);
+
+	int VariableCount(void) const;
+	const char *VariableName(int iIndex) const;
+	int VariableIndex(const char *sName) const;
+	int NodeCount(void) const;
+	int InstructionCount(void) const;
+	int DeduplicatedCount(void) const;
+	bool HasMachineCode(void) const;
+	bool IsIncremental(void) const;
+	int RecomputedCount(void) const;
+	size_t MemoryUsage(void) const;
+
+private:
+	CMathExpression(CMathParser *pParser);
+
+	CMathParser *pParser;
+
+	MATHNODE *Nodes;
+	int iNodeCount;
+	int iNodesAllocated;
+
+	int *Arguments;
+	int iArgumentCount;
+	int iArgumentsAllocated;
+
+	int iRoot;
+
+	MATHINSTRUCTION *Instructions; //Followed (after iInstructionCount) by the node programs of pIncremental.
+	int iInstructionCount;
+	int iInstructionsAllocated;
+
+	double *Constants;
+	int iConstantCount;
+	int iConstantsAllocated;
+
+	int iMaxStackDepth;
+	int iTempCount;
+	int iMaxArgCount;     //Largest number of parameters of a method call.
+	int iDeduplicatedCount;
+	bool bTextForm;       //Set by Parse(), see ScanTextForm().
+
+	CMathJIT *pJIT; //Machine code for the expression, NULL when it is run by the interpreter.
+	MATHINCREMENTAL *pIncremental; //Node values kept between evaluations, NULL unless compiled in CMathParser::IncrementalMode().
+
+	MATHNAMELIST Variables;
+	MATHNAMELIST Methods;
+
+	CMathVariables::MATHVALUE **Bindings; //Value of each variable defined on the parser by Compile() time, NULL for others.
+
+	//Parser state, only valid during Parse().
+	const char *sSource;
+	CMathLexer::MATHTOKEN *pTokens;
+	int iToken;
+	int iDepth;           //Calls of ParseUnary() in progress, limited to CMATHPARSER_MAX_NESTING.
+
+	//Only valid during Compact().
+	int *NodeHash;
+	int iNodeHashSz;
+
+	//Only valid during Lower().
+	int *NodeUses;
+	int *NodeTemps;
+
+	CMathParser::MathResult Parse(const char *sExpression, int iExpressionSz);
+	CMathParser::MathResult ParseGroup(int *piOutNode);
+	CMathParser::MathResult ParseBinary(int iMinPrecedence, int *piOutNode);
+	CMathParser::MathResult ParseUnary(int *piOutNode);
+	CMathParser::MathResult ParseUnaryOperand(int *piOutNode);
+	CMathParser::MathResult ParsePrimary(int *piOutNode);
+	CMathParser::MathResult ParseNumber(int *piOutNode);
+	CMathParser::MathResult ParseIdentifier(int *piOutNode);
+	bool ScanTextForm(CMathLexer *pLexer);
+
+	CMathParser::MathResult Optimize(void);
+	void OptimizeNode(int iNode);
+	bool IsConstantValue(int iNode, double dValue);
+	bool IsCheckedValue(int iNode);
+	bool IsLogicalNot(int iNode, int *piOutOperand);
+	bool IsBooleanValue(int iNode);
+	bool IsPureFunction(const MATHNODE *pNode);
+	CMathParser::MathResult Compact(void);
+	CMathParser::MathResult CopyNode(const MATHNODE *pNodes, const int *pArguments, int iNode, int *piOutNode);
+	int FindNode(const MATHNODE *pNode, const int *piArgs);
+
+	CMathParser::MathResult Lower(void);
+	CMathParser::MathResult Bind(void);
+	CMathParser::MathResult Track(void);
+	CMathParser::MathResult LowerNode(int iNode, int *piDepth);
+	CMathParser::MathResult AddOperation(int iNode);
+	CMathParser::MathResult AddInstruction(int iOpCode, int iOperand, int iArgCount, const char *sOperator);
+	CMathParser::MathResult AddConstant(double dValue, int *piOutIndex);
+	int GetOperatorOpCode(const char *sOperator, bool bUnary);
+
+	CMathParser::MathResult AddNode(int iType, const char *sOperator, double dValue, int iIndex, const int *piArgs, int iArgCount, int *piOutNode);
+	CMathParser::MathResult AddName(MATHNAMELIST *pList, const char *sName, int *piOutIndex);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
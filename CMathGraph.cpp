@@ -0,0 +1,762 @@
+#ifndef _CMathGraph_CPP
+#define _CMathGraph_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include "CMathGraph.h"
+#include "CMathExpression.h"
+#include "CMathContext.h"
+#include "CMathThreadPool.h"
+#include "CMathVariables.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathGraph::CMathGraph(CMathParser *pParser)
+{
+	this->pParser = pParser;
+	this->pNames = new CMathVariables();
+
+	this->Cells = NULL;
+	this->iCellCount = 0;
+	this->iCellsAllocated = 0;
+	this->iFormulaCount = 0;
+
+	this->bSorted = false;
+	this->Order = NULL;
+	this->LevelStart = NULL;
+	this->iLevelCount = 0;
+	this->DependentStart = NULL;
+	this->Dependents = NULL;
+	this->iMaxVariables = 0;
+
+	this->Work = NULL;
+	this->iRecomputed = 0;
+
+	this->ciThreadCount = 1;
+	this->pThreadPool = NULL;
+	this->Contexts = NULL;
+	this->Slots = NULL;
+	this->iWorkerCount = 0;
+	this->iSlotsAllocated = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathGraph::~CMathGraph(void)
+{
+	this->Clear();
+
+	for (int i = 0; i < this->iCellCount; i++)
+	{
+		free(this->Cells[i].Name);
+		free(this->Cells[i].Sources);
+		if (this->Cells[i].Expression)
+		{
+			delete this->Cells[i].Expression;
+		}
+	}
+	free(this->Cells);
+
+	for (int i = 0; i < this->iWorkerCount; i++)
+	{
+		delete this->Contexts[i];
+	}
+	free(this->Contexts);
+	free(this->Slots);
+
+	if (this->pThreadPool)
+	{
+		delete this->pThreadPool;
+		this->pThreadPool = NULL;
+	}
+
+	if (this->pNames)
+	{
+		delete this->pNames;
+		this->pNames = NULL;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Frees the levels and dependents built by Sort().
+/// </summary>
+void CMathGraph::Clear(void)
+{
+	free(this->Order);
+	free(this->LevelStart);
+	free(this->DependentStart);
+	free(this->Dependents);
+	free(this->Work);
+
+	this->Order = NULL;
+	this->LevelStart = NULL;
+	this->DependentStart = NULL;
+	this->Dependents = NULL;
+	this->Work = NULL;
+	this->iLevelCount = 0;
+	this->bSorted = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Compiles a formula and stores it under a name, replacing the formula or input of that name. Other formulas
+///	use its result through a variable of the same name (case insensitive).
+/// </summary>
+/// <param name="sName"></param>
+/// <param name="sExpression"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathGraph::SetFormula(const char *sName, const char *sExpression)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	CMathExpression *pExpression = NULL;
+	int iCell = -1;
+
+	if (!this->pParser->IsValidName(sName))
+	{
+		return this->pParser->SetError(CMathParser::ResultInvalidToken, "Invalid variable name: %s.", sName);
+	}
+
+	//Formulas are evaluated by contexts, which always evaluate in full.
+	bool bIncrementalMode = this->pParser->IncrementalMode(false);
+	ErrorCode = this->pParser->Compile(sExpression, &pExpression);
+	this->pParser->IncrementalMode(bIncrementalMode);
+
+	if (ErrorCode != CMathParser::ResultOk)
+	{
+		return ErrorCode;
+	}
+
+	int *pSources = (int *)calloc(sizeof(int), pExpression->VariableCount() + 1);
+	if (!pSources)
+	{
+		delete pExpression;
+		return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	if ((ErrorCode = this->FindCell(sName, true, &iCell)) == CMathParser::ResultOk)
+	{
+		for (int i = 0; i < pExpression->VariableCount() && ErrorCode == CMathParser::ResultOk; i++)
+		{
+			ErrorCode = this->FindCell(pExpression->VariableName(i), true, &pSources[i]);
+		}
+	}
+
+	if (ErrorCode != CMathParser::ResultOk)
+	{
+		free(pSources);
+		delete pExpression;
+		return ErrorCode;
+	}
+
+	MATHGRAPHCELL *pCell = &this->Cells[iCell];
+
+	if (pCell->Expression)
+	{
+		delete pCell->Expression;
+		free(pCell->Sources);
+	}
+	else {
+		this->iFormulaCount++;
+	}
+
+	pCell->Expression = pExpression;
+	pCell->Sources = pSources;
+	pCell->IsSet = false;
+	pCell->ErrorCode = CMathParser::ResultOk;
+
+	this->bSorted = false;
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Sets the value of an input, replacing the formula of that name if there is one. The formulas which use it are
+///	computed by the next Update() if the value changed.
+/// </summary>
+/// <param name="sName"></param>
+/// <param name="dValue"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathGraph::SetInput(const char *sName, double dValue)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	int iCell = -1;
+
+	if (!this->pParser->IsValidName(sName))
+	{
+		return this->pParser->SetError(CMathParser::ResultInvalidToken, "Invalid variable name: %s.", sName);
+	}
+
+	if ((ErrorCode = this->FindCell(sName, true, &iCell)) != CMathParser::ResultOk)
+	{
+		return ErrorCode;
+	}
+
+	MATHGRAPHCELL *pCell = &this->Cells[iCell];
+
+	if (pCell->Expression)
+	{
+		delete pCell->Expression;
+		free(pCell->Sources);
+		pCell->Expression = NULL;
+		pCell->Sources = NULL;
+		this->iFormulaCount--;
+		this->bSorted = false;
+	}
+
+	//Compared bitwise, like the node values of CMathParser::IncrementalMode().
+	bool bChanged = !pCell->IsSet || pCell->ErrorCode != CMathParser::ResultOk
+		|| memcmp(&pCell->Value, &dValue, sizeof(double)) != 0;
+
+	pCell->Value = dValue;
+	pCell->IsSet = true;
+	pCell->ErrorCode = CMathParser::ResultOk;
+
+	if (bChanged)
+	{
+		this->MarkDependents(iCell);
+	}
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Computes the formulas which are out of date, one level at a time.
+/// </summary>
+/// <returns>The error of the first formula (in level order) which could not be computed, ResultOk if there are
+///	none. Value() gives the result of each formula.</returns>
+CMathParser::MathResult CMathGraph::Update(void)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+
+	this->iRecomputed = 0;
+
+	if (!this->bSorted && (ErrorCode = this->Sort()) != CMathParser::ResultOk)
+	{
+		return ErrorCode;
+	}
+
+	//Inputs which were not given with SetInput() are read from the parser each time, like Evaluate() does.
+	for (int iCell = 0; iCell < this->iCellCount; iCell++)
+	{
+		MATHGRAPHCELL *pCell = &this->Cells[iCell];
+
+		if (pCell->Expression || pCell->IsSet || this->DependentStart[iCell] == this->DependentStart[iCell + 1])
+		{
+			continue;
+		}
+
+		double dValue = 0;
+		CMathParser::MathResult InputError = CMathParser::ResultOk;
+
+		if (!this->pParser->GetVariableValue(pCell->Name, &dValue))
+		{
+			InputError = CMathParser::ResultUndefiendVariable;
+			if (ErrorCode == CMathParser::ResultOk)
+			{
+				ErrorCode = this->pParser->SetError(InputError, "Variable was not defined: %s.", pCell->Name);
+			}
+		}
+
+		if (InputError != pCell->ErrorCode || (InputError == CMathParser::ResultOk && memcmp(&pCell->Value, &dValue, sizeof(double)) != 0))
+		{
+			pCell->Value = dValue;
+			pCell->ErrorCode = InputError;
+			this->MarkDependents(iCell);
+		}
+	}
+
+	int iWorkers = (this->ciThreadCount > 0) ? this->ciThreadCount : CMathThreadPool::HardwareThreads();
+
+	CMathParser::MathResult WorkerError = this->PrepareWorkers(iWorkers);
+	if (WorkerError != CMathParser::ResultOk)
+	{
+		return WorkerError;
+	}
+
+	for (int iLevel = 0; iLevel < this->iLevelCount; iLevel++)
+	{
+		int iWork = 0;
+
+		for (int i = this->LevelStart[iLevel]; i < this->LevelStart[iLevel + 1]; i++)
+		{
+			MATHGRAPHCELL *pCell = &this->Cells[this->Order[i]];
+			if (pCell->IsDirty)
+			{
+				pCell->IsDirty = false;
+				this->Work[iWork++] = this->Order[i];
+			}
+		}
+
+		if (iWork == 0)
+		{
+			continue;
+		}
+
+		//The formulas of a level only use results of lower levels, so they can be computed in any order.
+		if (iWorkers > 1 && iWork >= CMATHGRAPH_PARALLEL_CELLS)
+		{
+			this->pThreadPool->Run(iWork, CMATHGRAPH_CHUNK_SIZE, &CMathGraph::ComputeChunk, this);
+		}
+		else {
+			for (int i = 0; i < iWork; i++)
+			{
+				this->ComputeCell(0, this->Work[i]);
+			}
+		}
+
+		this->iRecomputed += iWork;
+
+		for (int i = 0; i < iWork; i++)
+		{
+			if (this->Cells[this->Work[i]].IsChanged)
+			{
+				this->MarkDependents(this->Work[i]);
+			}
+		}
+	}
+
+	if (ErrorCode == CMathParser::ResultOk)
+	{
+		for (int i = 0; i < this->iFormulaCount; i++)
+		{
+			MATHGRAPHCELL *pCell = &this->Cells[this->Order[i]];
+			if (pCell->ErrorCode != CMathParser::ResultOk)
+			{
+				//The formulas were computed by the workers' contexts, compute the first one which failed again on
+				//	the parser so that LastError() describes it. Its parameters are of lower levels, so they are valid.
+				double dValue = 0;
+				for (int iVariable = 0; iVariable < pCell->Expression->VariableCount(); iVariable++)
+				{
+					this->Slots[iVariable] = this->Cells[pCell->Sources[iVariable]].Value;
+				}
+
+				ErrorCode = this->pParser->Evaluate(pCell->Expression, this->Slots, &dValue);
+				if (ErrorCode == CMathParser::ResultOk)
+				{
+					ErrorCode = pCell->ErrorCode;
+				}
+				break;
+			}
+		}
+	}
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the result of a formula as of the last Update(), or the value of an input.
+/// </summary>
+/// <param name="sName"></param>
+/// <param name="pOutValue"></param>
+/// <returns>The error which kept the formula from being computed, if any.</returns>
+CMathParser::MathResult CMathGraph::Value(const char *sName, double *pOutValue)
+{
+	int iCell = -1;
+	CMathParser::MathResult ErrorCode = this->FindCell(sName, false, &iCell);
+
+	if (ErrorCode == CMathParser::ResultOk)
+	{
+		*pOutValue = this->Cells[iCell].Value;
+		ErrorCode = this->Cells[iCell].ErrorCode;
+	}
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of formulas.
+/// </summary>
+/// <returns></returns>
+int CMathGraph::FormulaCount(void)
+{
+	return this->iFormulaCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of levels the formulas were sorted into by the last Update(): the length of the longest
+///	chain of formulas which use each other.
+/// </summary>
+/// <returns></returns>
+int CMathGraph::LevelCount(void)
+{
+	return this->iLevelCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of formulas computed by the last Update().
+/// </summary>
+/// <returns></returns>
+int CMathGraph::RecomputedCount(void)
+{
+	return this->iRecomputed;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Sets the number of threads Update() computes the formulas of a level on, for levels with at least
+///	CMATHGRAPH_PARALLEL_CELLS formulas to compute. The thread pool is created by the first Update() which needs it.
+/// </summary>
+/// <param name="iThreadCount">0 for one thread per logical processor, 1 (the default) for the calling thread only.</param>
+/// <returns>The previous setting.</returns>
+int CMathGraph::ThreadCount(int iThreadCount)
+{
+	int iOldThreadCount = this->ciThreadCount;
+	this->ciThreadCount = (iThreadCount < 0) ? 0 : iThreadCount;
+	return iOldThreadCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CMathGraph::ThreadCount(void)
+{
+	return this->ciThreadCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Finds the cell of a name, optionally adding it as an input which has not been set.
+/// </summary>
+CMathParser::MathResult CMathGraph::FindCell(const char *sName, bool bCreate, int *piOutCell)
+{
+	CMathVariables::MATHVALUE *pName = this->pNames->Find(sName);
+	if (pName)
+	{
+		*piOutCell = (int)pName->Value;
+		return CMathParser::ResultOk;
+	}
+
+	if (!bCreate)
+	{
+		return this->pParser->SetError(CMathParser::ResultUndefiendVariable, "Variable was not defined: %s.", sName);
+	}
+
+	if (this->iCellCount >= this->iCellsAllocated)
+	{
+		int iAllocate = (this->iCellsAllocated == 0) ? 64 : this->iCellsAllocated * 2;
+		MATHGRAPHCELL *pCells = (MATHGRAPHCELL *)realloc(this->Cells, sizeof(MATHGRAPHCELL) * iAllocate);
+		if (!pCells)
+		{
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+		this->Cells = pCells;
+		this->iCellsAllocated = iAllocate;
+	}
+
+	size_t iNameSz = strlen(sName);
+	char *sCopy = (char *)calloc(sizeof(char), iNameSz + 1);
+	if (!sCopy || !(pName = this->pNames->Define(sName)))
+	{
+		free(sCopy);
+		return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+	memcpy(sCopy, sName, iNameSz);
+
+	MATHGRAPHCELL *pCell = &this->Cells[this->iCellCount];
+	memset(pCell, 0, sizeof(MATHGRAPHCELL));
+	pCell->Name = sCopy;
+	pCell->ErrorCode = CMathParser::ResultOk;
+
+	pName->Value = this->iCellCount;
+	*piOutCell = this->iCellCount++;
+
+	this->bSorted = false;
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Sorts the formulas into levels (Kahn's algorithm): level 0 holds the formulas which only use inputs, each
+///	following level the formulas whose formulas are all on lower levels. Formulas which are never placed are part
+///	of (or depend on) a circular reference. Every formula is computed by the next Update().
+/// </summary>
+/// <returns></returns>
+CMathParser::MathResult CMathGraph::Sort(void)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+
+	this->Clear();
+
+	int iLinkCount = 0;
+	this->iMaxVariables = 0;
+
+	for (int iCell = 0; iCell < this->iCellCount; iCell++)
+	{
+		if (this->Cells[iCell].Expression)
+		{
+			int iVariables = this->Cells[iCell].Expression->VariableCount();
+			iLinkCount += iVariables;
+			if (iVariables > this->iMaxVariables)
+			{
+				this->iMaxVariables = iVariables;
+			}
+		}
+	}
+
+	this->Order = (int *)calloc(sizeof(int), this->iFormulaCount + 1);
+	this->LevelStart = (int *)calloc(sizeof(int), this->iFormulaCount + 2);
+	this->DependentStart = (int *)calloc(sizeof(int), this->iCellCount + 1);
+	this->Dependents = (int *)calloc(sizeof(int), iLinkCount + 1);
+	this->Work = (int *)calloc(sizeof(int), this->iFormulaCount + 1);
+	int *pPending = (int *)calloc(sizeof(int), this->iCellCount + 1); //Formulas used by each formula which are not placed yet.
+
+	if (!this->Order || !this->LevelStart || !this->DependentStart || !this->Dependents || !this->Work || !pPending)
+	{
+		free(pPending);
+		this->Clear();
+		return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	//The formulas using each cell, counted first and then filled in.
+	for (int iCell = 0; iCell < this->iCellCount; iCell++)
+	{
+		MATHGRAPHCELL *pCell = &this->Cells[iCell];
+		for (int i = 0; pCell->Expression && i < pCell->Expression->VariableCount(); i++)
+		{
+			this->DependentStart[pCell->Sources[i] + 1]++;
+			if (this->Cells[pCell->Sources[i]].Expression)
+			{
+				pPending[iCell]++;
+			}
+		}
+	}
+	for (int iCell = 0; iCell < this->iCellCount; iCell++)
+	{
+		this->DependentStart[iCell + 1] += this->DependentStart[iCell];
+	}
+	for (int iCell = 0; iCell < this->iCellCount; iCell++)
+	{
+		MATHGRAPHCELL *pCell = &this->Cells[iCell];
+		for (int i = 0; pCell->Expression && i < pCell->Expression->VariableCount(); i++)
+		{
+			this->Dependents[this->DependentStart[pCell->Sources[i]]++] = iCell;
+		}
+	}
+	for (int iCell = this->iCellCount; iCell > 0; iCell--)
+	{
+		this->DependentStart[iCell] = this->DependentStart[iCell - 1];
+	}
+	this->DependentStart[0] = 0;
+
+	int iPlaced = 0;
+
+	for (int iCell = 0; iCell < this->iCellCount; iCell++)
+	{
+		if (this->Cells[iCell].Expression && pPending[iCell] == 0)
+		{
+			this->Order[iPlaced++] = iCell;
+		}
+	}
+
+	for (int iLevelBegin = 0; iLevelBegin < iPlaced; )
+	{
+		int iLevelEnd = iPlaced;
+
+		this->LevelStart[this->iLevelCount++] = iLevelBegin;
+
+		for (int i = iLevelBegin; i < iLevelEnd; i++)
+		{
+			int iCell = this->Order[i];
+			for (int iLink = this->DependentStart[iCell]; iLink < this->DependentStart[iCell + 1]; iLink++)
+			{
+				if (--pPending[this->Dependents[iLink]] == 0)
+				{
+					this->Order[iPlaced++] = this->Dependents[iLink];
+				}
+			}
+		}
+
+		iLevelBegin = iLevelEnd;
+	}
+	this->LevelStart[this->iLevelCount] = iPlaced;
+
+	if (iPlaced < this->iFormulaCount)
+	{
+		//Follow formulas which are not placed from one that is not placed until the walk is certainly on a cycle.
+		int iCell = 0;
+		while (!this->Cells[iCell].Expression || pPending[iCell] == 0)
+		{
+			iCell++;
+		}
+
+		for (int iStep = 0; iStep < this->iCellCount; iStep++)
+		{
+			MATHGRAPHCELL *pCell = &this->Cells[iCell];
+			for (int i = 0; i < pCell->Expression->VariableCount(); i++)
+			{
+				int iSource = pCell->Sources[i];
+				if (this->Cells[iSource].Expression && pPending[iSource] > 0)
+				{
+					iCell = iSource;
+					break;
+				}
+			}
+		}
+
+		ErrorCode = this->pParser->SetError(CMathParser::ResultCircularReference, "Circular reference: %s.", this->Cells[iCell].Name);
+
+		free(pPending);
+		this->Clear();
+		return ErrorCode;
+	}
+
+	free(pPending);
+
+	for (int iCell = 0; iCell < this->iCellCount; iCell++)
+	{
+		this->Cells[iCell].IsDirty = (this->Cells[iCell].Expression != NULL);
+		this->Cells[iCell].IsChanged = false;
+	}
+
+	this->bSorted = true;
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Makes sure there is a context and room for the variables of a formula for each worker, and a thread pool with
+///	the right number of threads when there is more than one.
+/// </summary>
+CMathParser::MathResult CMathGraph::PrepareWorkers(int iWorkers)
+{
+	if (iWorkers > 1)
+	{
+		if (this->pThreadPool && this->pThreadPool->ThreadCount() != iWorkers)
+		{
+			delete this->pThreadPool;
+			this->pThreadPool = NULL;
+		}
+
+		if (!this->pThreadPool)
+		{
+			this->pThreadPool = new CMathThreadPool(iWorkers);
+		}
+	}
+
+	if (iWorkers > this->iWorkerCount)
+	{
+		CMathContext **pContexts = (CMathContext **)realloc(this->Contexts, sizeof(CMathContext *) * iWorkers);
+		if (!pContexts)
+		{
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+
+		this->Contexts = pContexts;
+		for (; this->iWorkerCount < iWorkers; this->iWorkerCount++)
+		{
+			this->Contexts[this->iWorkerCount] = new CMathContext(this->pParser);
+		}
+	}
+
+	int iSlots = iWorkers * (this->iMaxVariables + 1);
+	if (iSlots > this->iSlotsAllocated)
+	{
+		double *pSlots = (double *)realloc(this->Slots, sizeof(double) * iSlots);
+		if (!pSlots)
+		{
+			return this->pParser->SetError(CMathParser::ResultMemoryAllocationError, "Memory allocation error.");
+		}
+
+		this->Slots = pSlots;
+		this->iSlotsAllocated = iSlots;
+	}
+
+	return CMathParser::ResultOk;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Marks the formulas which use a cell to be computed by Update().
+/// </summary>
+void CMathGraph::MarkDependents(int iCell)
+{
+	if (!this->bSorted)
+	{
+		return; //Every formula is computed after sorting.
+	}
+
+	for (int iLink = this->DependentStart[iCell]; iLink < this->DependentStart[iCell + 1]; iLink++)
+	{
+		this->Cells[this->Dependents[iLink]].IsDirty = true;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Computes one formula on a worker's context. A formula which uses a failed formula (or input) fails with the
+///	same error without being evaluated.
+/// </summary>
+void CMathGraph::ComputeCell(int iWorker, int iCell)
+{
+	CMathParser::MathResult ErrorCode = CMathParser::ResultOk;
+	MATHGRAPHCELL *pCell = &this->Cells[iCell];
+	double *pSlots = this->Slots + (size_t)iWorker * (this->iMaxVariables + 1);
+	double dValue = 0;
+
+	for (int i = 0; i < pCell->Expression->VariableCount(); i++)
+	{
+		const MATHGRAPHCELL *pSource = &this->Cells[pCell->Sources[i]];
+		if (pSource->ErrorCode != CMathParser::ResultOk)
+		{
+			ErrorCode = pSource->ErrorCode;
+			break;
+		}
+		pSlots[i] = pSource->Value;
+	}
+
+	if (ErrorCode == CMathParser::ResultOk)
+	{
+		ErrorCode = this->Contexts[iWorker]->Evaluate(pCell->Expression, pSlots, &dValue);
+	}
+
+	pCell->IsChanged = (ErrorCode != pCell->ErrorCode)
+		|| (ErrorCode == CMathParser::ResultOk && memcmp(&dValue, &pCell->Value, sizeof(double)) != 0);
+	pCell->ErrorCode = ErrorCode;
+	if (ErrorCode == CMathParser::ResultOk)
+	{
+		pCell->Value = dValue;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Thread pool task for Update(), the items are indexes into Work.
+/// </summary>
+bool CMathGraph::ComputeChunk(void *pContext, int iWorker, size_t iFirst, size_t iCount)
+{
+	CMathGraph *pGraph = (CMathGraph *)pContext;
+
+	for (size_t i = iFirst; i < iFirst + iCount; i++)
+	{
+		pGraph->ComputeCell(iWorker, pGraph->Work[i]);
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,99 @@
+#ifndef _CMathGraph_H
+#define _CMathGraph_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathParser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define CMATHGRAPH_PARALLEL_CELLS 64 //Formulas of a level which have to be computed before the level is run on the thread pool.
+#define CMATHGRAPH_CHUNK_SIZE     16 //Formulas handed to a worker thread at a time.
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CMathExpression;
+class CMathContext;
+class CMathThreadPool;
+class CMathVariables;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// A set of named formulas which use each other's results by name, like the cells of a spreadsheet. Each formula
+///	is compiled once by SetFormula(). The names used by a formula which are not formulas themselves are inputs,
+///	given with SetInput() or, if they were not, read from the parser (its variables and variable callback) on each
+///	Update(). Update() sorts the formulas into levels, where every formula only uses formulas of lower levels, and
+///	computes the formulas of a level on ThreadCount() threads. After the first Update() only the formulas which use
+///	(directly or through other formulas) an input whose value changed are computed again, and a formula whose
+///	result did not change does not cause the formulas which use it to be computed. Circular references are
+///	reported by Update() with ResultCircularReference.
+///
+/// Errors are reported by the parser's LastError(). The parser must not be used by other threads while Update() is
+///	running, and method callbacks have to be thread-safe when more than one thread is used.
+/// </summary>
+class CMathGraph {
+public:
+	CMathGraph(CMathParser *pParser);
+	~CMathGraph(void);
+
+	CMathParser::MathResult SetFormula(const char *sName, const char *sExpression);
+	CMathParser::MathResult SetInput(const char *sName, double dValue);
+	CMathParser::MathResult Update(void);
+	CMathParser::MathResult Value(const char *sName, double *pOutValue);
+
+	int FormulaCount(void);
+	int LevelCount(void);
+	int RecomputedCount(void);
+	int ThreadCount(int iThreadCount);
+	int ThreadCount(void);
+
+private:
+	typedef struct _tag_Math_Graph_Cell {
+		char *Name;
+		CMathExpression *Expression;  //NULL for inputs.
+		int *Sources;                 //Cell of each variable of the expression.
+		double Value;
+		CMathParser::MathResult ErrorCode; //Result of the last evaluation, or of reading an input from the parser.
+		bool IsSet;                   //Inputs: the value was given with SetInput().
+		bool IsDirty;                 //Has to be computed by the next Update().
+		bool IsChanged;               //The value (or error) changed when the cell was last computed.
+	} MATHGRAPHCELL, *LPMATHGRAPHCELL;
+
+	CMathParser *pParser;
+	CMathVariables *pNames; //Index of the cell of each name, stored as its value.
+
+	MATHGRAPHCELL *Cells;
+	int iCellCount;
+	int iCellsAllocated;
+	int iFormulaCount;
+
+	//Built by Sort(), whenever a formula was added or changed.
+	bool bSorted;
+	int *Order;             //Formula cells sorted by level.
+	int *LevelStart;        //Index into Order of the first formula of each level, followed by iFormulaCount.
+	int iLevelCount;
+	int *DependentStart;    //Index into Dependents of the first formula using each cell, followed by the total.
+	int *Dependents;
+	int iMaxVariables;      //Most variables used by a formula, the size of each worker's slots.
+
+	int *Work;              //Formulas of the level being computed.
+	int iRecomputed;
+
+	int ciThreadCount;
+	CMathThreadPool *pThreadPool;
+	CMathContext **Contexts; //One per worker thread.
+	double *Slots;          //iMaxVariables values per worker thread.
+	int iWorkerCount;       //Workers Contexts and Slots were allocated for.
+	int iSlotsAllocated;
+
+	CMathParser::MathResult FindCell(const char *sName, bool bCreate, int *piOutCell);
+	CMathParser::MathResult Sort(void);
+	CMathParser::MathResult PrepareWorkers(int iWorkers);
+	void MarkDependents(int iCell);
+	void ComputeCell(int iWorker, int iCell);
+	static bool ComputeChunk(void *pContext, int iWorker, size_t iFirst, size_t iCount);
+	void Clear(void);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,897 @@
+#ifndef _CMathJIT_CPP
+#define _CMathJIT_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "CMathExpression.h"
+#include "CMathJIT.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//SSE2 compare predicates (cmpsd).
+#define JIT_CMP_EQ     0
+#define JIT_CMP_LT     1
+#define JIT_CMP_LE     2
+#define JIT_CMP_NEQ    4
+
+//Conditions for the two byte jcc encoding (0x0F 0x8?).
+#define JIT_JCC_E      0x84
+#define JIT_JCC_P      0x8A
+
+//General purpose registers used for the integer operations.
+#define JIT_REG_EAX    0
+#define JIT_REG_ECX    1
+
+//Size of the register parameter (shadow) area that the Windows x64 calling convention requires below each call.
+#define JIT_SHADOW_SZ  32
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double JitLdexp(double dValue, double dExponent)
+{
+	return ldexp(dValue, (int)dExponent);
+}
+
+static double JitModPow(double dBase, double dExponent, double dModulus)
+{
+	//A modulus of 0 leaves through the error exit, so that the interpreter reports it.
+	if ((int)dModulus == 0)
+	{
+		return nan("");
+	}
+	return (double)CMathParser::ModPow((long long)dBase, (long long)dExponent, (int)dModulus);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct _tag_Math_JIT_Method {
+	const char *Name;
+	int ArgCount;
+	double (*Unary)(double);
+	double (*Binary)(double, double);
+} MATHJITMETHOD, *LPMATHJITMETHOD;
+
+//Native methods which are implemented by calling out to the C runtime. The remaining native methods
+//	(ABS, SQRT, NOT, SUM, AVG and MODPOW) are emitted inline or through dedicated helpers.
+static const MATHJITMETHOD JitMethods[] =
+{
+	{ "ACOS", 1, acos, NULL },
+	{ "ASIN", 1, asin, NULL },
+	{ "ATAN", 1, atan, NULL },
+	{ "ATAN2", 2, NULL, atan2 },
+	{ "LDEXP", 2, NULL, JitLdexp },
+	{ "SINH", 1, sinh, NULL },
+	{ "COSH", 1, cosh, NULL },
+	{ "TANH", 1, tanh, NULL },
+	{ "LOG", 1, log, NULL },
+	{ "LOG10", 1, log10, NULL },
+	{ "EXP", 1, exp, NULL },
+	{ "POW", 2, NULL, pow },
+	{ "FLOOR", 1, floor, NULL },
+	{ "CEIL", 1, ceil, NULL },
+	{ "TAN", 1, tan, NULL },
+	{ "SIN", 1, sin, NULL },
+	{ "COS", 1, cos, NULL },
+	{ NULL, 0, NULL, NULL }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathJIT::CMathJIT(void)
+{
+	this->Code = NULL;
+	this->iCodeSz = 0;
+	this->iCodeAllocated = 0;
+
+	this->Fixups = NULL;
+	this->iFixupCount = 0;
+	this->iFixupsAllocated = 0;
+
+	this->Constants = NULL;
+	this->iConstantCount = 0;
+	this->iConstantsAllocated = 0;
+
+	this->ErrorJumps = NULL;
+	this->iErrorJumpCount = 0;
+	this->iErrorJumpsAllocated = 0;
+
+	this->pExecutable = NULL;
+	this->iExecutableSz = 0;
+
+	this->iFrameSz = 0;
+	this->iErrorOffset = 0;
+
+	this->bOutOfMemory = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathJIT::~CMathJIT(void)
+{
+	this->Reset();
+
+	if (this->pExecutable)
+	{
+#ifdef _WIN32
+		VirtualFree(this->pExecutable, 0, MEM_RELEASE);
+#else
+		munmap(this->pExecutable, this->iExecutableSz);
+#endif
+		this->pExecutable = NULL;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Frees the buffers which are only needed while generating code.
+/// </summary>
+void CMathJIT::Reset(void)
+{
+	free(this->Code);
+	free(this->Fixups);
+	free(this->Constants);
+	free(this->ErrorJumps);
+
+	this->Code = NULL;
+	this->iCodeSz = 0;
+	this->iCodeAllocated = 0;
+
+	this->Fixups = NULL;
+	this->iFixupCount = 0;
+	this->iFixupsAllocated = 0;
+
+	this->Constants = NULL;
+	this->iConstantCount = 0;
+	this->iConstantsAllocated = 0;
+
+	this->ErrorJumps = NULL;
+	this->iErrorJumpCount = 0;
+	this->iErrorJumpsAllocated = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether machine code can be generated for the current architecture.
+/// </summary>
+/// <returns></returns>
+bool CMathJIT::IsSupported(void)
+{
+#ifdef CMATHPARSER_JIT_SUPPORTED
+	return true;
+#else
+	return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathJIT::TJITProc CMathJIT::Proc(void)
+{
+	return (TJITProc)this->pExecutable;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CMathJIT::CodeSize(void)
+{
+	return this->iExecutableSz;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathJIT::Emit(const unsigned char *pBytes, int iCount)
+{
+	if (this->iCodeSz + iCount > this->iCodeAllocated)
+	{
+		int iAllocate = (this->iCodeAllocated == 0) ? 256 : this->iCodeAllocated * 2;
+		while (iAllocate < this->iCodeSz + iCount)
+		{
+			iAllocate *= 2;
+		}
+		unsigned char *pCode = (unsigned char *)realloc(this->Code, iAllocate);
+		if (!pCode)
+		{
+			this->bOutOfMemory = true;
+			return;
+		}
+		this->Code = pCode;
+		this->iCodeAllocated = iAllocate;
+	}
+
+	memcpy(this->Code + this->iCodeSz, pBytes, iCount);
+	this->iCodeSz += iCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathJIT::EmitByte(unsigned char cByte)
+{
+	this->Emit(&cByte, 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathJIT::EmitInt32(int iValue)
+{
+	unsigned char cBytes[4];
+	for (int i = 0; i < 4; i++)
+	{
+		cBytes[i] = (unsigned char)((unsigned int)iValue >> (i * 8));
+	}
+	this->Emit(cBytes, 4);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathJIT::EmitInt64(long long iValue)
+{
+	unsigned char cBytes[8];
+	for (int i = 0; i < 8; i++)
+	{
+		cBytes[i] = (unsigned char)((unsigned long long)iValue >> (i * 8));
+	}
+	this->Emit(cBytes, 8);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Adds a value to the constant table which is placed after the code, constants are compared bitwise so
+///	that masks (which are not numbers) and negative zero are kept distinct.
+/// </summary>
+/// <param name="dValue"></param>
+/// <returns></returns>
+int CMathJIT::AddConstant(double dValue)
+{
+	for (int i = 0; i < this->iConstantCount; i++)
+	{
+		if (memcmp(&this->Constants[i], &dValue, sizeof(double)) == 0)
+		{
+			return i;
+		}
+	}
+
+	if (this->iConstantCount >= this->iConstantsAllocated)
+	{
+		int iAllocate = (this->iConstantsAllocated == 0) ? 16 : this->iConstantsAllocated * 2;
+		double *pConstants = (double *)realloc(this->Constants, sizeof(double) * iAllocate);
+		if (!pConstants)
+		{
+			this->bOutOfMemory = true;
+			return 0;
+		}
+		this->Constants = pConstants;
+		this->iConstantsAllocated = iAllocate;
+	}
+
+	this->Constants[this->iConstantCount] = dValue;
+	return this->iConstantCount++;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// movsd xmm, [rip + constant]
+/// </summary>
+void CMathJIT::EmitLoadConstant(int iXmm, double dValue)
+{
+	int iConstant = this->AddConstant(dValue);
+
+	if (this->iFixupCount >= this->iFixupsAllocated)
+	{
+		int iAllocate = (this->iFixupsAllocated == 0) ? 16 : this->iFixupsAllocated * 2;
+		MATHJITFIXUP *pFixups = (MATHJITFIXUP *)realloc(this->Fixups, sizeof(MATHJITFIXUP) * iAllocate);
+		if (!pFixups)
+		{
+			this->bOutOfMemory = true;
+			return;
+		}
+		this->Fixups = pFixups;
+		this->iFixupsAllocated = iAllocate;
+	}
+
+	unsigned char cBytes[] = { 0xF2, 0x0F, 0x10, (unsigned char)(0x05 | (iXmm << 3)) };
+	this->Emit(cBytes, sizeof(cBytes));
+
+	this->Fixups[this->iFixupCount].Position = this->iCodeSz;
+	this->Fixups[this->iFixupCount].Constant = iConstant;
+	this->iFixupCount++;
+
+	this->EmitInt32(0); //Patched once the location of the constant table is known.
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// movsd xmm, [rsp + slot]
+/// </summary>
+void CMathJIT::EmitLoadSlot(int iXmm, int iSlot)
+{
+	unsigned char cBytes[] = { 0xF2, 0x0F, 0x10, (unsigned char)(0x84 | (iXmm << 3)), 0x24 };
+	this->Emit(cBytes, sizeof(cBytes));
+	this->EmitInt32(JIT_SHADOW_SZ + (iSlot * (int)sizeof(double)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// movsd [rsp + slot], xmm
+/// </summary>
+void CMathJIT::EmitStoreSlot(int iXmm, int iSlot)
+{
+	unsigned char cBytes[] = { 0xF2, 0x0F, 0x11, (unsigned char)(0x84 | (iXmm << 3)), 0x24 };
+	this->Emit(cBytes, sizeof(cBytes));
+	this->EmitInt32(JIT_SHADOW_SZ + (iSlot * (int)sizeof(double)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Emits a register to register SSE2 instruction (ex: addsd xmm0, xmm1).
+/// </summary>
+void CMathJIT::EmitXmmOp(unsigned char cPrefix, unsigned char cOpCode, int iDstXmm, int iSrcXmm)
+{
+	unsigned char cBytes[] = { cPrefix, 0x0F, cOpCode, (unsigned char)(0xC0 | (iDstXmm << 3) | iSrcXmm) };
+	this->Emit(cBytes, sizeof(cBytes));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// cmpsd xmm, xmm, predicate
+/// </summary>
+void CMathJIT::EmitCompare(int iDstXmm, int iSrcXmm, unsigned char cPredicate)
+{
+	this->EmitXmmOp(0xF2, 0xC2, iDstXmm, iSrcXmm);
+	this->EmitByte(cPredicate);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// mov rax, function; call rax
+/// </summary>
+void CMathJIT::EmitCall(const void *pFunction)
+{
+	unsigned char cMovRax[] = { 0x48, 0xB8 };
+	unsigned char cCallRax[] = { 0xFF, 0xD0 };
+
+	this->Emit(cMovRax, sizeof(cMovRax));
+	this->EmitInt64((long long)pFunction);
+	this->Emit(cCallRax, sizeof(cCallRax));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Emits a conditional jump to the error exit, the target is patched after the body has been generated.
+/// </summary>
+void CMathJIT::EmitErrorJump(unsigned char cCondition)
+{
+	if (this->iErrorJumpCount >= this->iErrorJumpsAllocated)
+	{
+		int iAllocate = (this->iErrorJumpsAllocated == 0) ? 16 : this->iErrorJumpsAllocated * 2;
+		int *pErrorJumps = (int *)realloc(this->ErrorJumps, sizeof(int) * iAllocate);
+		if (!pErrorJumps)
+		{
+			this->bOutOfMemory = true;
+			return;
+		}
+		this->ErrorJumps = pErrorJumps;
+		this->iErrorJumpsAllocated = iAllocate;
+	}
+
+	this->EmitByte(0x0F);
+	this->EmitByte(cCondition);
+	this->ErrorJumps[this->iErrorJumpCount++] = this->iCodeSz;
+	this->EmitInt32(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Leaves through the error exit if xmm0 is not a number (mirrors PerformDoubleOperation).
+/// </summary>
+void CMathJIT::EmitNaNCheck(void)
+{
+	this->EmitXmmOp(0x66, 0x2E, 0, 0); //ucomisd xmm0, xmm0
+	this->EmitErrorJump(JIT_JCC_P);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Leaves through the error exit if the given register is zero (used for the divisor of / and %).
+/// </summary>
+void CMathJIT::EmitZeroCheck(int iXmm)
+{
+	unsigned char cSkipIfUnordered[] = { 0x7A, 0x06 }; //jp over the je below, NaN is not zero.
+
+	this->EmitXmmOp(0x66, 0x57, 2, 2);    //xorpd xmm2, xmm2
+	this->EmitXmmOp(0x66, 0x2E, iXmm, 2); //ucomisd xmm, xmm2
+	this->Emit(cSkipIfUnordered, sizeof(cSkipIfUnordered));
+	this->EmitErrorJump(JIT_JCC_E);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// cvttsd2si r32, xmm
+/// </summary>
+void CMathJIT::EmitToInt(int iXmm, int iReg)
+{
+	this->EmitXmmOp(0xF2, 0x2C, iReg, iXmm);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// xorpd xmm, xmm; cvtsi2sd xmm, r32
+/// </summary>
+void CMathJIT::EmitFromInt(int iXmm, int iReg)
+{
+	this->EmitXmmOp(0x66, 0x57, iXmm, iXmm);
+	this->EmitXmmOp(0xF2, 0x2A, iXmm, iReg);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Converts a compare mask in the given register to 1.0 or 0.0.
+/// </summary>
+void CMathJIT::EmitBoolean(int iXmm)
+{
+	this->EmitLoadConstant(3, 1.0);
+	this->EmitXmmOp(0x66, 0x54, iXmm, 3); //andpd xmm, xmm3
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Emits a call to a native method. The parameters are the top iArgCount values of the stack, the last of which
+///	is in xmm0 and the rest in their stack slots.
+/// </summary>
+/// <param name="sMethodName"></param>
+/// <param name="iArgCount"></param>
+/// <param name="iDepth">The stack depth before the method consumes its parameters.</param>
+/// <returns>False if the method is not known or the parameter count is invalid.</returns>
+bool CMathJIT::EmitNativeMethod(const char *sMethodName, int iArgCount, int iDepth)
+{
+	if (_strcmpi(sMethodName, "SUM") == 0 || _strcmpi(sMethodName, "AVG") == 0)
+	{
+		if (iArgCount < 1)
+		{
+			return false;
+		}
+
+		this->EmitStoreSlot(0, iDepth - 1);
+		this->EmitXmmOp(0x66, 0x57, 0, 0); //xorpd xmm0, xmm0
+		for (int i = iDepth - iArgCount; i < iDepth; i++)
+		{
+			this->EmitLoadSlot(1, i);
+			this->EmitXmmOp(0xF2, 0x58, 0, 1); //addsd xmm0, xmm1
+		}
+
+		if (_strcmpi(sMethodName, "AVG") == 0)
+		{
+			this->EmitLoadConstant(1, (double)iArgCount);
+			this->EmitXmmOp(0xF2, 0x5E, 0, 1); //divsd xmm0, xmm1
+		}
+		return true;
+	}
+	else if (_strcmpi(sMethodName, "NOT") == 0)
+	{
+		//!((long long)x)
+		unsigned char cBytes[] = {
+			0xF2, 0x48, 0x0F, 0x2C, 0xC0, //cvttsd2si rax, xmm0
+			0x48, 0x85, 0xC0,             //test rax, rax
+			0x0F, 0x94, 0xC0,             //sete al
+			0x0F, 0xB6, 0xC0              //movzx eax, al
+		};
+		if (iArgCount != 1)
+		{
+			return false;
+		}
+		this->Emit(cBytes, sizeof(cBytes));
+		this->EmitFromInt(0, JIT_REG_EAX);
+		return true;
+	}
+	else if (_strcmpi(sMethodName, "ABS") == 0)
+	{
+		unsigned long long iMask = 0x7FFFFFFFFFFFFFFFULL;
+		double dMask = 0;
+		if (iArgCount != 1)
+		{
+			return false;
+		}
+		memcpy(&dMask, &iMask, sizeof(dMask));
+		this->EmitLoadConstant(1, dMask);
+		this->EmitXmmOp(0x66, 0x54, 0, 1); //andpd xmm0, xmm1
+		return true;
+	}
+	else if (_strcmpi(sMethodName, "SQRT") == 0)
+	{
+		if (iArgCount != 1)
+		{
+			return false;
+		}
+		this->EmitXmmOp(0xF2, 0x51, 0, 0); //sqrtsd xmm0, xmm0
+		return true;
+	}
+	else if (_strcmpi(sMethodName, "MODPOW") == 0)
+	{
+		if (iArgCount != 3)
+		{
+			return false;
+		}
+		this->EmitXmmOp(0x66, 0x28, 2, 0); //movapd xmm2, xmm0
+		this->EmitLoadSlot(1, iDepth - 2);
+		this->EmitLoadSlot(0, iDepth - 3);
+		this->EmitCall((const void *)JitModPow);
+		this->EmitNaNCheck();
+		return true;
+	}
+
+	for (int i = 0; JitMethods[i].Name; i++)
+	{
+		if (_strcmpi(sMethodName, JitMethods[i].Name) == 0)
+		{
+			if (iArgCount != JitMethods[i].ArgCount)
+			{
+				return false;
+			}
+
+			if (JitMethods[i].Unary)
+			{
+				this->EmitCall((const void *)JitMethods[i].Unary);
+			}
+			else {
+				this->EmitXmmOp(0x66, 0x28, 1, 0); //movapd xmm1, xmm0
+				this->EmitLoadSlot(0, iDepth - 2);
+				this->EmitCall((const void *)JitMethods[i].Binary);
+			}
+			return true;
+		}
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Generates machine code for the bytecode of the expression. The top of the value stack is kept in xmm0
+///	and the values below it are spilled to slots in the stack frame.
+/// </summary>
+/// <param name="pExpression"></param>
+/// <returns>False if the architecture is not supported or the expression uses something the code generator
+///	does not handle (such as methods which are implemented by the method callback).</returns>
+bool CMathJIT::Compile(CMathExpression *pExpression)
+{
+#ifndef CMATHPARSER_JIT_SUPPORTED
+	return false;
+#else
+	int iDepth = 0;
+
+	this->Reset();
+	this->bOutOfMemory = false;
+
+	//Shadow space, the value stack slots, the temporary slots and the saved error pointer. Together with the return
+	//	address and the saved rbx this must keep the stack 16 byte aligned for the calls out to the runtime.
+	int iTempBase = pExpression->iMaxStackDepth;
+	this->iErrorOffset = JIT_SHADOW_SZ + ((iTempBase + pExpression->iTempCount) * (int)sizeof(double));
+	this->iFrameSz = ((this->iErrorOffset + (int)sizeof(void *)) + 15) & ~15;
+
+	//Prologue.
+	this->EmitByte(0x53);                           //push rbx
+	this->EmitByte(0x48); this->EmitByte(0x81); this->EmitByte(0xEC);
+	this->EmitInt32(this->iFrameSz);                //sub rsp, frame
+#ifdef _WIN64
+	this->EmitByte(0x48); this->EmitByte(0x89); this->EmitByte(0xCB); //mov rbx, rcx
+	this->EmitByte(0x48); this->EmitByte(0x89); this->EmitByte(0x94); this->EmitByte(0x24);
+	this->EmitInt32(this->iErrorOffset);            //mov [rsp + error], rdx
+#else
+	this->EmitByte(0x48); this->EmitByte(0x89); this->EmitByte(0xFB); //mov rbx, rdi
+	this->EmitByte(0x48); this->EmitByte(0x89); this->EmitByte(0xB4); this->EmitByte(0x24);
+	this->EmitInt32(this->iErrorOffset);            //mov [rsp + error], rsi
+#endif
+
+	for (int iInstruction = 0; iInstruction < pExpression->iInstructionCount; iInstruction++)
+	{
+		const CMathExpression::MATHINSTRUCTION *pInstruction = &pExpression->Instructions[iInstruction];
+
+		switch (pInstruction->OpCode)
+		{
+		case CMathExpression::OpPushConstant:
+		case CMathExpression::OpPushVariable:
+		case CMathExpression::OpLoadTemp:
+			if (iDepth > 0)
+			{
+				this->EmitStoreSlot(0, iDepth - 1);
+			}
+			if (pInstruction->OpCode == CMathExpression::OpPushConstant)
+			{
+				this->EmitLoadConstant(0, pExpression->Constants[pInstruction->Operand]);
+			}
+			else if (pInstruction->OpCode == CMathExpression::OpLoadTemp)
+			{
+				this->EmitLoadSlot(0, iTempBase + pInstruction->Operand);
+			}
+			else {
+				unsigned char cBytes[] = { 0xF2, 0x0F, 0x10, 0x83 }; //movsd xmm0, [rbx + variable]
+				this->Emit(cBytes, sizeof(cBytes));
+				this->EmitInt32(pInstruction->Operand * (int)sizeof(double));
+			}
+			iDepth++;
+			break;
+
+		case CMathExpression::OpStoreTemp:
+			this->EmitStoreSlot(0, iTempBase + pInstruction->Operand);
+			break;
+
+		case CMathExpression::OpNegate:
+			this->EmitLoadConstant(1, -0.0);
+			this->EmitXmmOp(0x66, 0x57, 0, 1); //xorpd xmm0, xmm1
+			this->EmitNaNCheck();
+			break;
+		case CMathExpression::OpNot:
+		{
+			unsigned char cBytes[] = {
+				0x85, 0xC0,       //test eax, eax
+				0x0F, 0x94, 0xC0, //sete al
+				0x0F, 0xB6, 0xC0  //movzx eax, al
+			};
+			this->EmitToInt(0, JIT_REG_EAX);
+			this->Emit(cBytes, sizeof(cBytes));
+			this->EmitFromInt(0, JIT_REG_EAX);
+			break;
+		}
+		case CMathExpression::OpBitwiseNot:
+		{
+			unsigned char cBytes[] = { 0xF7, 0xD0 }; //not eax
+			this->EmitToInt(0, JIT_REG_EAX);
+			this->Emit(cBytes, sizeof(cBytes));
+			this->EmitFromInt(0, JIT_REG_EAX);
+			break;
+		}
+
+		case CMathExpression::OpCallNative:
+			if (pInstruction->ArgCount < 1 || !this->EmitNativeMethod(pExpression->Methods.Items[pInstruction->Operand], pInstruction->ArgCount, iDepth))
+			{
+				this->Reset();
+				return false;
+			}
+			iDepth -= (pInstruction->ArgCount - 1);
+			break;
+
+		case CMathExpression::OpCallMethod:
+		case CMathExpression::OpCallFunction:
+			//Methods implemented by the method callback and registered functions are left to the interpreter.
+			this->Reset();
+			return false;
+
+		default:
+		{
+			//Binary operators: left operand into xmm0, right operand into xmm1.
+			this->EmitXmmOp(0x66, 0x28, 1, 0); //movapd xmm1, xmm0
+			this->EmitLoadSlot(0, iDepth - 2);
+			iDepth--;
+
+			switch (pInstruction->OpCode)
+			{
+			case CMathExpression::OpMultiply:
+				this->EmitXmmOp(0xF2, 0x59, 0, 1); //mulsd xmm0, xmm1
+				this->EmitNaNCheck();
+				break;
+			case CMathExpression::OpDivide:
+				this->EmitZeroCheck(1);
+				this->EmitXmmOp(0xF2, 0x5E, 0, 1); //divsd xmm0, xmm1
+				this->EmitNaNCheck();
+				break;
+			case CMathExpression::OpModulus:
+				this->EmitZeroCheck(1);
+				this->EmitCall((const void *)(double (*)(double, double))fmod);
+				this->EmitNaNCheck();
+				break;
+			case CMathExpression::OpAdd:
+				this->EmitXmmOp(0xF2, 0x58, 0, 1); //addsd xmm0, xmm1
+				this->EmitNaNCheck();
+				break;
+			case CMathExpression::OpSubtract:
+				this->EmitXmmOp(0xF2, 0x5C, 0, 1); //subsd xmm0, xmm1
+				this->EmitNaNCheck();
+				break;
+
+			case CMathExpression::OpNotEqual:
+				this->EmitCompare(0, 1, JIT_CMP_NEQ);
+				this->EmitBoolean(0);
+				break;
+			case CMathExpression::OpEqual:
+				this->EmitCompare(0, 1, JIT_CMP_EQ);
+				this->EmitBoolean(0);
+				break;
+			case CMathExpression::OpLess:
+				this->EmitCompare(0, 1, JIT_CMP_LT);
+				this->EmitBoolean(0);
+				break;
+			case CMathExpression::OpLessOrEqual:
+				this->EmitCompare(0, 1, JIT_CMP_LE);
+				this->EmitBoolean(0);
+				break;
+			case CMathExpression::OpGreater:
+				this->EmitCompare(1, 0, JIT_CMP_LT); //right < left
+				this->EmitBoolean(1);
+				this->EmitXmmOp(0x66, 0x28, 0, 1);  //movapd xmm0, xmm1
+				break;
+			case CMathExpression::OpGreaterOrEqual:
+				this->EmitCompare(1, 0, JIT_CMP_LE); //right <= left
+				this->EmitBoolean(1);
+				this->EmitXmmOp(0x66, 0x28, 0, 1);  //movapd xmm0, xmm1
+				break;
+
+			case CMathExpression::OpLogicalAnd:
+			case CMathExpression::OpLogicalOr:
+				this->EmitXmmOp(0x66, 0x57, 2, 2);  //xorpd xmm2, xmm2
+				this->EmitCompare(0, 2, JIT_CMP_NEQ);
+				this->EmitCompare(1, 2, JIT_CMP_NEQ);
+				if (pInstruction->OpCode == CMathExpression::OpLogicalAnd)
+				{
+					this->EmitXmmOp(0x66, 0x54, 0, 1); //andpd xmm0, xmm1
+				}
+				else {
+					this->EmitXmmOp(0x66, 0x56, 0, 1); //orpd xmm0, xmm1
+				}
+				this->EmitBoolean(0);
+				break;
+
+			case CMathExpression::OpBitwiseOr:
+			case CMathExpression::OpBitwiseOrEqual:
+			case CMathExpression::OpBitwiseAnd:
+			case CMathExpression::OpBitwiseAndEqual:
+			case CMathExpression::OpBitwiseXor:
+			case CMathExpression::OpBitwiseXorEqual:
+			case CMathExpression::OpShiftLeft:
+			case CMathExpression::OpShiftRight:
+			{
+				unsigned char cBytes[2] = { 0, 0 };
+
+				switch (pInstruction->OpCode)
+				{
+				case CMathExpression::OpBitwiseOr:
+				case CMathExpression::OpBitwiseOrEqual:
+					cBytes[0] = 0x09; cBytes[1] = 0xC8; //or eax, ecx
+					break;
+				case CMathExpression::OpBitwiseAnd:
+				case CMathExpression::OpBitwiseAndEqual:
+					cBytes[0] = 0x21; cBytes[1] = 0xC8; //and eax, ecx
+					break;
+				case CMathExpression::OpBitwiseXor:
+				case CMathExpression::OpBitwiseXorEqual:
+					cBytes[0] = 0x31; cBytes[1] = 0xC8; //xor eax, ecx
+					break;
+				case CMathExpression::OpShiftLeft:
+					cBytes[0] = 0xD3; cBytes[1] = 0xE0; //shl eax, cl
+					break;
+				case CMathExpression::OpShiftRight:
+					cBytes[0] = 0xD3; cBytes[1] = 0xF8; //sar eax, cl
+					break;
+				}
+
+				this->EmitToInt(0, JIT_REG_EAX);
+				this->EmitToInt(1, JIT_REG_ECX);
+				this->Emit(cBytes, sizeof(cBytes));
+				this->EmitFromInt(0, JIT_REG_EAX);
+				break;
+			}
+
+			default:
+				this->Reset();
+				return false;
+			}
+			break;
+		}
+		}
+	}
+
+	//Epilogue, the result is already in xmm0.
+	this->EmitByte(0x48); this->EmitByte(0x81); this->EmitByte(0xC4);
+	this->EmitInt32(this->iFrameSz);                //add rsp, frame
+	this->EmitByte(0x5B);                           //pop rbx
+	this->EmitByte(0xC3);                           //ret
+
+	//Error exit: *piError = 1.
+	int iErrorLabel = this->iCodeSz;
+	this->EmitByte(0x48); this->EmitByte(0x8B); this->EmitByte(0x84); this->EmitByte(0x24);
+	this->EmitInt32(this->iErrorOffset);            //mov rax, [rsp + error]
+	unsigned char cSetError[] = { 0xC7, 0x00, 0x01, 0x00, 0x00, 0x00 };
+	this->Emit(cSetError, sizeof(cSetError));       //mov dword [rax], 1
+	this->EmitByte(0x48); this->EmitByte(0x81); this->EmitByte(0xC4);
+	this->EmitInt32(this->iFrameSz);                //add rsp, frame
+	this->EmitByte(0x5B);                           //pop rbx
+	this->EmitByte(0xC3);                           //ret
+
+	if (this->bOutOfMemory)
+	{
+		this->Reset();
+		return false;
+	}
+
+	for (int i = 0; i < this->iErrorJumpCount; i++)
+	{
+		int iPosition = this->ErrorJumps[i];
+		int iDisplacement = iErrorLabel - (iPosition + 4);
+		memcpy(this->Code + iPosition, &iDisplacement, sizeof(int));
+	}
+
+	//The constant table follows the code, aligned to 16 bytes.
+	int iConstantsOffset = (this->iCodeSz + 15) & ~15;
+
+	for (int i = 0; i < this->iFixupCount; i++)
+	{
+		int iPosition = this->Fixups[i].Position;
+		int iDisplacement = (iConstantsOffset + (this->Fixups[i].Constant * (int)sizeof(double))) - (iPosition + 4);
+		memcpy(this->Code + iPosition, &iDisplacement, sizeof(int));
+	}
+
+	this->iExecutableSz = iConstantsOffset + (this->iConstantCount * (int)sizeof(double));
+
+#ifdef _WIN32
+	this->pExecutable = VirtualAlloc(NULL, this->iExecutableSz, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if (!this->pExecutable)
+	{
+		this->Reset();
+		return false;
+	}
+#else
+	this->pExecutable = mmap(NULL, this->iExecutableSz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (this->pExecutable == MAP_FAILED)
+	{
+		this->pExecutable = NULL;
+		this->Reset();
+		return false;
+	}
+#endif
+
+	memset(this->pExecutable, 0xCC, iConstantsOffset); //int3 padding between the code and the constants.
+	memcpy(this->pExecutable, this->Code, this->iCodeSz);
+	if (this->iConstantCount > 0)
+	{
+		memcpy((unsigned char *)this->pExecutable + iConstantsOffset, this->Constants, this->iConstantCount * sizeof(double));
+	}
+
+	//The code is never written again, so drop write access before it is executed.
+#ifdef _WIN32
+	DWORD dwOldProtect = 0;
+	if (!VirtualProtect(this->pExecutable, this->iExecutableSz, PAGE_EXECUTE_READ, &dwOldProtect))
+	{
+		VirtualFree(this->pExecutable, 0, MEM_RELEASE);
+		this->pExecutable = NULL;
+		this->Reset();
+		return false;
+	}
+	FlushInstructionCache(GetCurrentProcess(), this->pExecutable, this->iExecutableSz);
+#else
+	if (mprotect(this->pExecutable, this->iExecutableSz, PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(this->pExecutable, this->iExecutableSz);
+		this->pExecutable = NULL;
+		this->Reset();
+		return false;
+	}
+#endif
+
+	this->Reset();
+
+	return true;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
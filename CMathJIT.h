@@ -0,0 +1,93 @@
+#ifndef _CMathJIT_H
+#define _CMathJIT_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CMATHPARSER_JIT_SUPPORTED
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CMathExpression;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Translates the bytecode of a compiled expression into x86-64 SSE2 machine code. On other architectures
+///	Compile() always fails and the caller keeps using the bytecode interpreter.
+/// </summary>
+class CMathJIT {
+public:
+	/// <summary>
+	/// Signature of the generated code.
+	/// </summary>
+	/// <param name="pVariables">Values of the variables of the expression, in expression order.</param>
+	/// <param name="piError">Set to a non-zero value if the code hit a condition which requires an error to be
+	///	reported (such as a divide by zero), in which case the expression should be run by the interpreter.</param>
+	/// <returns>The result of the expression.</returns>
+	typedef double (*TJITProc)(const double *pVariables, int *piError);
+
+	CMathJIT(void);
+	~CMathJIT(void);
+
+	static bool IsSupported(void);
+
+	bool Compile(CMathExpression *pExpression);
+	TJITProc Proc(void);
+	int CodeSize(void);
+
+private:
+	typedef struct _tag_Math_JIT_Fixup {
+		int Position;   //Position of the rel32 displacement within the code.
+		int Constant;   //Index of the constant being referenced.
+	} MATHJITFIXUP, *LPMATHJITFIXUP;
+
+	unsigned char *Code;
+	int iCodeSz;
+	int iCodeAllocated;
+
+	MATHJITFIXUP *Fixups;
+	int iFixupCount;
+	int iFixupsAllocated;
+
+	double *Constants;
+	int iConstantCount;
+	int iConstantsAllocated;
+
+	int *ErrorJumps;
+	int iErrorJumpCount;
+	int iErrorJumpsAllocated;
+
+	void *pExecutable;
+	int iExecutableSz;
+
+	int iFrameSz;
+	int iErrorOffset;
+
+	bool bOutOfMemory;
+
+	void Reset(void);
+	void Emit(const unsigned char *pBytes, int iCount);
+	void EmitByte(unsigned char cByte);
+	void EmitInt32(int iValue);
+	void EmitInt64(long long iValue);
+
+	int AddConstant(double dValue);
+	void EmitLoadConstant(int iXmm, double dValue);
+	void EmitLoadSlot(int iXmm, int iSlot);
+	void EmitStoreSlot(int iXmm, int iSlot);
+	void EmitXmmOp(unsigned char cPrefix, unsigned char cOpCode, int iDstXmm, int iSrcXmm);
+	void EmitCompare(int iDstXmm, int iSrcXmm, unsigned char cPredicate);
+	void EmitCall(const void *pFunction);
+	void EmitErrorJump(unsigned char cCondition);
+	void EmitNaNCheck(void);
+	void EmitZeroCheck(int iXmm);
+	void EmitToInt(int iXmm, int iReg);
+	void EmitFromInt(int iXmm, int iReg);
+	void EmitBoolean(int iXmm);
+
+	bool EmitNativeMethod(const char *sMethodName, int iArgCount, int iDepth);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
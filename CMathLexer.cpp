@@ -0,0 +1,265 @@
+#ifndef _CMathLexer_CPP
+#define _CMathLexer_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include "CMathParser.h"
+#include "CMathLexer.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern const char *sPreOrder[];
+extern const char *sFirstOrder[];
+extern const char *sSecondOrder[];
+extern const char *sThirdOrder[];
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathLexer::CMathLexer(CMathParser *pParser)
+{
+	this->pParser = pParser;
+
+	this->Items = NULL;
+	this->iCount = 0;
+	this->iAllocated = 0;
+
+	this->iThirdOrderCount = 0;
+	while (sThirdOrder[this->iThirdOrderCount])
+	{
+		this->iThirdOrderCount++;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathLexer::~CMathLexer(void)
+{
+	free(this->Items);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of tokens produced by the last call to Tokenize(), including the closing TokenEnd.
+/// </summary>
+int CMathLexer::Count(void)
+{
+	return this->iCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the tokens produced by the last call to Tokenize(). The array is reused by the next call.
+/// </summary>
+CMathLexer::MATHTOKEN *CMathLexer::Tokens(void)
+{
+	return this->Items;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Precedence of the multiplication, division and modulus operators. The third order operators are numbered
+///	1 (the last entry of sThirdOrder) through the number of third order operators (the first entry), followed by
+///	the second order and then the first order operators, which mirrors the order in which CalculateSimpleExpression
+///	processes them.
+/// </summary>
+int CMathLexer::FirstOrderPrecedence(void)
+{
+	return this->iThirdOrderCount + 2;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Precedence of the addition and subtraction operators.
+/// </summary>
+int CMathLexer::SecondOrderPrecedence(void)
+{
+	return this->iThirdOrderCount + 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathLexer::AddToken(int iType, int iPosition, int iLength, const char *sOperator, int iPrecedence)
+{
+	if (this->iCount >= this->iAllocated)
+	{
+		int iAllocated = (this->iAllocated == 0) ? 64 : this->iAllocated * 2;
+		MATHTOKEN *pItems = (MATHTOKEN *)realloc(this->Items, sizeof(MATHTOKEN) * iAllocated);
+		if (!pItems)
+		{
+			return false;
+		}
+		this->Items = pItems;
+		this->iAllocated = iAllocated;
+	}
+
+	MATHTOKEN *pToken = &this->Items[this->iCount++];
+	pToken->Type = iType;
+	pToken->Position = iPosition;
+	pToken->Length = iLength;
+	pToken->Operator = sOperator;
+	pToken->Precedence = iPrecedence;
+	pToken->OperatorCode = sOperator ? this->pParser->GetOperator(sOperator) : CMathParser::OperatorUnknown;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Matches the operator at the start of the text, preferring two character operators over one character operators.
+/// </summary>
+/// <returns>The length of the operator, 0 if the text does not start with an operator.</returns>
+int CMathLexer::MatchOperator(const char *sText, int iTextSz, const char **psOutOperator, int *piOutPrecedence)
+{
+	char cChar = sText[0];
+	char cNext = (iTextSz > 1) ? sText[1] : '\0';
+
+	//All of the two character operators are third order operators.
+	for (int i = 0; sThirdOrder[i]; i++)
+	{
+		if (sThirdOrder[i][1] != '\0' && sThirdOrder[i][0] == cChar && sThirdOrder[i][1] == cNext)
+		{
+			*psOutOperator = sThirdOrder[i];
+			*piOutPrecedence = this->iThirdOrderCount - i;
+			return 2;
+		}
+	}
+
+	//Do not split an unknown two character operator (ex: "==") into two operators.
+	if (strchr("<>=&|^", cChar) && (cNext == '=' || cNext == cChar || (cChar == '<' && cNext == '>')))
+	{
+		return 0;
+	}
+
+	if (cChar == sPreOrder[0][0])
+	{
+		*psOutOperator = sPreOrder[0];
+		*piOutPrecedence = 0;
+		return 1;
+	}
+
+	for (int i = 0; sFirstOrder[i]; i++)
+	{
+		if (sFirstOrder[i][0] == cChar)
+		{
+			*psOutOperator = sFirstOrder[i];
+			*piOutPrecedence = (cChar == '~') ? 0 : this->FirstOrderPrecedence();
+			return 1;
+		}
+	}
+
+	for (int i = 0; sSecondOrder[i]; i++)
+	{
+		if (sSecondOrder[i][0] == cChar)
+		{
+			*psOutOperator = sSecondOrder[i];
+			*piOutPrecedence = this->SecondOrderPrecedence();
+			return 1;
+		}
+	}
+
+	for (int i = 0; sThirdOrder[i]; i++)
+	{
+		if (sThirdOrder[i][1] == '\0' && sThirdOrder[i][0] == cChar)
+		{
+			*psOutOperator = sThirdOrder[i];
+			*piOutPrecedence = this->iThirdOrderCount - i;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Splits the text into tokens, skipping white space. The last token is always a TokenEnd positioned at the end
+///	of the text. Characters which are not part of any token are returned as TokenInvalid so that the parser can
+///	report them in context.
+/// </summary>
+/// <returns>False if memory could not be allocated.</returns>
+bool CMathLexer::Tokenize(const char *sText, int iTextSz)
+{
+	int iRPos = 0;
+
+	this->iCount = 0;
+
+	while (iRPos < iTextSz)
+	{
+		char cChar = sText[iRPos];
+		int iBegin = iRPos;
+
+		if (this->pParser->IsWhiteSpace(cChar))
+		{
+			iRPos++;
+			continue;
+		}
+
+		if (this->pParser->IsNumeric(cChar) || cChar == '.')
+		{
+			while (iRPos < iTextSz && (this->pParser->IsNumeric(sText[iRPos]) || sText[iRPos] == '.'))
+			{
+				iRPos++;
+			}
+			if (!this->AddToken(TokenNumber, iBegin, iRPos - iBegin, NULL, 0))
+			{
+				return false;
+			}
+		}
+		else if (this->pParser->IsValidVariableChar(cChar))
+		{
+			while (iRPos < iTextSz && this->pParser->IsValidVariableChar(sText[iRPos]))
+			{
+				iRPos++;
+			}
+			if (!this->AddToken(TokenIdentifier, iBegin, iRPos - iBegin, NULL, 0))
+			{
+				return false;
+			}
+		}
+		else {
+			int iType = TokenInvalid;
+			int iLength = 1;
+			const char *sOperator = NULL;
+			int iPrecedence = 0;
+
+			if (cChar == '(')
+			{
+				iType = TokenOpenParenthesis;
+			}
+			else if (cChar == ')')
+			{
+				iType = TokenCloseParenthesis;
+			}
+			else if (cChar == ',')
+			{
+				iType = TokenComma;
+			}
+			else if ((iLength = this->MatchOperator(sText + iRPos, iTextSz - iRPos, &sOperator, &iPrecedence)) > 0)
+			{
+				iType = TokenOperator;
+			}
+			else {
+				iLength = 1;
+			}
+
+			if (!this->AddToken(iType, iBegin, iLength, sOperator, iPrecedence))
+			{
+				return false;
+			}
+
+			iRPos += iLength;
+		}
+	}
+
+	return this->AddToken(TokenEnd, iTextSz, 0, NULL, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
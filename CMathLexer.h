@@ -0,0 +1,61 @@
+#ifndef _CMathLexer_H
+#define _CMathLexer_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CMathParser;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Splits an expression into tokens (numbers, identifiers, operators, parentheses and commas) in a single pass over
+///	the text. Operators are matched against the operator tables of the parser, longest first, and each one carries
+///	its precedence as a binary operator so that the token stream can be parsed by precedence climbing instead of
+///	rescanning the text once per operator.
+/// </summary>
+class CMathLexer {
+public:
+	enum TokenType {
+		TokenEnd,               //Always the last token.
+		TokenNumber,            //Digits and decimal points, the sign is a separate operator token.
+		TokenIdentifier,        //Variable or method name.
+		TokenOperator,
+		TokenOpenParenthesis,
+		TokenCloseParenthesis,
+		TokenComma,
+		TokenInvalid            //A character which does not start any other token (one character long).
+	};
+
+	typedef struct _tag_Math_Token {
+		int Type;               //One of the TokenType values.
+		int Position;           //Offset of the first character in the source text.
+		int Length;
+		const char *Operator;   //Operator tokens: the entry of the operator tables (sFirstOrder, sThirdOrder, etc.).
+		int Precedence;         //Operator tokens: binding strength as a binary operator (higher binds tighter), 0 for prefix only operators.
+		int OperatorCode;       //Operator tokens: the CMathParser::MathOperator of the operator.
+	} MATHTOKEN, *LPMATHTOKEN;
+
+	CMathLexer(CMathParser *pParser);
+	~CMathLexer(void);
+
+	bool Tokenize(const char *sText, int iTextSz);
+	int Count(void);
+	MATHTOKEN *Tokens(void);
+
+	int FirstOrderPrecedence(void);
+	int SecondOrderPrecedence(void);
+
+private:
+	CMathParser *pParser;
+
+	MATHTOKEN *Items;
+	int iCount;
+	int iAllocated;
+
+	int iThirdOrderCount;
+
+	bool AddToken(int iType, int iPosition, int iLength, const char *sOperator, int iPrecedence);
+	int MatchOperator(const char *sText, int iTextSz, const char **psOutOperator, int *piOutPrecedence);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
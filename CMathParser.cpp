@@ -1,2302 +1,5471 @@
-#ifndef _CMathParser_CPP
-#define _CMathParser_CPP
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-#include <Windows.H>
-#include <StdIO.H>
-#include <StdLib.H>
-#include <Math.H>
-#include <Float.H>
-#include <Limits.H>
-
-#include "CMathParser.h"
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-//using namespace NSWFL::String;
-
-#ifndef _CVTBUFSIZE
-#define _CVTBUFSIZE (309+40) /* Number of digits in maximum double precision value + slop */
-#endif
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-const char* sNativeMethods[] =
-{
-	"ACOS",
-	"ASIN",
-	"ATAN",
-	"ATAN2",
-	"LDEXP",
-	"SINH",
-	"COSH",
-	"TANH",
-	"LOG",
-	"LOG10",
-	"EXP",
-	"MODPOW",
-	"SQRT",
-	"POW",
-	"FLOOR",
-	"CEIL",
-	"NOT",
-	"AVG",
-	"SUM",
-	"TAN",
-	"ATAN",
-	"SIN",
-	"COS",
-	"ABS",
-	NULL
-};
-
-const char *sPreOrder[] =
-{
-	"!",  //Logical NOT
-	NULL
-};
-
-const char *sFirstOrder[] =
-{
-	"~",  //Bitwise NOT
-	"*",  //Multiplication
-	"/",  //Division
-	"%",  //Modulation
-	NULL
-};
-
-const char *sSecondOrder[] =
-{
-	"+",  //Addition
-	"-",  //Subtraction
-	NULL
-};
-
-const char *sThirdOrder[] =
-{
-	"<>", //Logical Not Equal
-	"|=", //Bitwise Or Equal
-	"&=", //Bitwise And Equal
-	"^=", //Bitwise XOR Equal
-	"<=", //Logical Less or Equal
-	">=", //Logical Greater or Equal
-	"!=", //Logical Not Equal
-
-	"<<", //Bitwise Left Shift
-	">>", //Bitwise Right Shift
-
-	"=",  //Logical Equals
-	">",  //Logical Greater Than
-	"<",  //Logical Less Than
-
-	"&&", //Logical AND
-	"||", //Logical OR
-
-	"|",  //Bitwise OR
-	"&",  //Bitwise AND
-	"^",  //Exclusive OR
-
-	NULL
-};
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Lets us know whether the identifier is a built-in function.
-/// </summary>
-/// <param name="sName"></param>
-/// <returns></returns>
-bool CMathParser::IsNativeMethod(const char* sName)
-{
-	for (int i = 0; sNativeMethods[i] != NULL; i++)
-	{
-		if (_strcmpi(sNativeMethods[i], sName) == 0)
-		{
-			return true;
-		}
-	}
-
-	return false;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int CMathParser::TrailingChars(const char *sVal, int iStartPos, const char cChar)
-{
-	for (int i = iStartPos; i > 0; i--)
-	{
-		if (sVal[i] != cChar)
-		{
-			return iStartPos - i;
-		}
-	}
-
-	return iStartPos;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int CMathParser::SmartRound(double dValue, char *sOut, int iMaxOutSz)
-{
-	char sVal[_CVTBUFSIZE * 2];
-	char sFormat[32];
-	int iValLen = this->DoubleToChar(dValue, sVal, sizeof(sVal));
-	if (iValLen < 0)
-	{
-		return -1;
-	}
-	int iDecPos = InStr(".", sVal, iValLen, 0);
-
-	if (iDecPos < 0)
-	{
-		return sprintf_s(sOut, iMaxOutSz, "%.0f", dValue);
-	}
-
-	//Detect long trail before last number (ex: 3.14000000000000000001).
-	if (sVal[iValLen - 1] != sVal[iValLen - 2])
-	{
-		int iTrailPos = iValLen - 2;
-		int iTrailAfterLastNumber = 0;
-		while (sVal[iTrailPos] == sVal[iValLen - 2])
-		{
-			iTrailPos--;
-			iTrailAfterLastNumber++;
-		}
-		if (iTrailAfterLastNumber >= 3)
-		{
-			sVal[iValLen - 1] = '\0'; //Truncate last number;
-		}
-	}
-
-	//Detect trailing 9's (ex: 3.99999999999999999).
-	int iNines = this->TrailingChars(sVal, iValLen - 1, '9');
-	if (iNines > 8)
-	{
-		int iRoundTo = (iValLen - iNines) - (iDecPos + 1);
-		sprintf_s(sFormat, sizeof(sFormat), "%%.%df", iRoundTo);
-		sprintf_s(sOut, iMaxOutSz, sFormat, dValue);
-	}
-	else {
-		//Detect trailing 0's (ex: 3.0000000000000).
-		int iZeros = TrailingChars(sVal, iValLen - 2, '0');
-		if (iZeros > 4)
-		{
-			int iRoundTo = (iValLen - iZeros) - (iDecPos + 2);
-			sprintf_s(sFormat, sizeof(sFormat), "%%.%df", iRoundTo);
-			sprintf_s(sOut, iMaxOutSz, sFormat, dValue);
-		}
-		else {
-			strcpy_s(sOut, iMaxOutSz, sVal);
-		}
-	}
-
-	int iSz = (int)strlen(sOut);
-
-	//Remove any remaining 0's after conversion.
-	if (sOut[iSz - 1] == '0')
-	{
-		iSz--;
-		while (sOut[iSz] == '0')
-		{
-			iSz--;
-		}
-
-		if (sOut[iSz] == '.')
-		{
-			iSz--;
-		}
-
-		iSz++;
-	}
-
-	sOut[iSz] = '\0';
-
-	return iSz;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Converts a double floating point to a string.
-/// </summary>
-/// <param name="dVal"></param>
-/// <param name="sOut"></param>
-/// <param name="iMaxOutSz"></param>
-/// <returns></returns>
-int CMathParser::DoubleToChar(double dVal, char *sOut, int iMaxOutSz)
-{
-	int iSigned = 0;
-	int iDecPos = 0;
-	int iWPos = 0;
-	int iValLen = 0;
-
-	if (dVal == 0)
-	{
-		strcpy_s(sOut, iMaxOutSz, "0");
-		return 1;
-	}
-
-	char sVal[_CVTBUFSIZE * 2];
-	if (_fcvt_s(sVal, sizeof(sVal), dVal, this->ciPrecision, &iDecPos, &iSigned) != 0)
-	{
-		return -1;
-	}
-
-	iValLen = (int)strlen(sVal);
-
-	if (iSigned)
-	{
-		sOut[iWPos++] = '-';
-	}
-
-	if (iDecPos <= 0)
-	{
-		sOut[iWPos++] = '0';
-		sOut[iWPos++] = '.';
-		while (iDecPos < 0)
-		{
-			sOut[iWPos++] = '0';
-			iDecPos++;
-		}
-		iDecPos = -1;
-	}
-
-	for (int iRPos = 0; iRPos < iValLen; iRPos++)
-	{
-		if (iRPos == iDecPos)
-		{
-			sOut[iWPos++] = '.';
-		}
-		sOut[iWPos++] = sVal[iRPos];
-	}
-
-	if (sOut[iWPos - 1] == '0')
-	{
-		iWPos--;
-		while (iWPos > 2 && sOut[iWPos] == '0' && sOut[iWPos - 1] != '.')
-		{
-			iWPos--;
-		}
-
-		if (sOut[iWPos] == '.')
-		{
-			iWPos--;
-		}
-
-		iWPos++;
-	}
-
-	sOut[iWPos] = '\0';
-
-	return iWPos;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Gets the number to the left of an operator.
-/// </summary>
-/// <param name="pExp"></param>
-/// <param name="iStartPos"></param>
-/// <param name="sOutVal"></param>
-/// <param name="iMaxSz"></param>
-/// <param name="iOutSz"></param>
-/// <param name="iBegin"></param>
-/// <returns></returns>
-CMathParser::MathResult CMathParser::GetLeftNumber(MATHEXPRESSION *pExp, int iStartPos, char *sOutVal, int iMaxSz, int *iOutSz, int *iBegin)
-{
-	int iRPos = (iStartPos - 1);
-	int iWPos = 0;
-
-	iMaxSz--;
-
-	while (iRPos >= 0 && iWPos < iMaxSz)
-	{
-		if (this->IsMathChar(pExp->Text[iRPos]))
-		{
-			if ((pExp->Text[iRPos] == '-' || pExp->Text[iRPos] == '+'))
-			{
-				if (iRPos > 0)
-				{
-					if (!this->IsMathChar(pExp->Text[iRPos - 1]))
-					{
-						break;
-					}
-				}
-				else {
-					//Negative or Positive number is explicitly defined.
-				}
-			}
-			else {
-				break;
-			}
-		}
-		else if (!IsNumeric(pExp->Text[iRPos]) && pExp->Text[iRPos] != '.')
-		{
-			return this->SetError(ResultInvalidToken, "Token is invalid: %c", pExp->Text[iRPos]);
-		}
-
-		sOutVal[iWPos++] = pExp->Text[iRPos--];
-	}
-
-	sOutVal[iWPos] = '\0';
-
-	ReverseString(sOutVal, iWPos);
-
-	*iOutSz = iWPos;
-	*iBegin = (iRPos + 1);
-
-	return ResultOk;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Gets the number to the right of an operator.
-/// </summary>
-/// <param name="pExp"></param>
-/// <param name="iStartPos"></param>
-/// <param name="sOutVal"></param>
-/// <param name="iMaxSz"></param>
-/// <param name="iOutSz"></param>
-/// <param name="iEnd"></param>
-/// <returns></returns>
-CMathParser::MathResult CMathParser::GetRightNumber(MATHEXPRESSION *pExp, int iStartPos, char *sOutVal, int iMaxSz, int *iOutSz, int *iEnd)
-{
-	int iRPos = iStartPos;
-	int iWPos = 0;
-
-	iMaxSz--;
-
-	while (iRPos < pExp->Length && iWPos < iMaxSz)
-	{
-		if (this->IsMathChar(pExp->Text[iRPos]))
-		{
-			if ((pExp->Text[iRPos] == '-' || pExp->Text[iRPos] == '+') && iRPos < pExp->Length)
-			{
-				if (!this->IsMathChar(pExp->Text[iRPos - 1]))
-				{
-					break;
-				}
-			}
-			else {
-				break;
-			}
-		}
-		else if (!IsNumeric(pExp->Text[iRPos]) && pExp->Text[iRPos] != '.')
-		{
-			return this->SetError(ResultInvalidToken, "Token is invalid: %c", pExp->Text[iRPos]);
-		}
-
-		sOutVal[iWPos++] = pExp->Text[iRPos++];
-	}
-
-	sOutVal[iWPos] = '\0';
-
-	*iOutSz = iWPos;
-	*iEnd = iRPos;
-
-	return ResultOk;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Parses a single operation.
-/// </summary>
-/// <param name="pInst"></param>
-/// <param name="pExp"></param>
-/// <param name="sOp"></param>
-/// <param name="iOpPos"></param>
-/// <param name="iOpSz"></param>
-/// <returns></returns>
-CMathParser::MathResult CMathParser::ParseOperator(MATHINSTANCE *pInst, MATHEXPRESSION *pExp, const char *sOp, int iOpPos, int iOpSz)
-{
-	char sVal[_CVTBUFSIZE];
-	char sVal1[_CVTBUFSIZE];
-	char sVal2[_CVTBUFSIZE];
-	int iValSz = 0;
-
-	MathResult ErrorCode = ResultOk;
-
-	int iBegin = 0;
-	int iEnd = 0;
-
-	if ((ErrorCode = this->GetLeftNumber(pExp, iOpPos, sVal1, sizeof(sVal1), &iValSz, &iBegin)) != ResultOk)
-	{
-		return ErrorCode;
-	}
-	if (iValSz > 0)
-	{
-		if ((ErrorCode = this->GetRightNumber(pExp, iOpPos + iOpSz, sVal2, sizeof(sVal2), &iValSz, &iEnd)) != ResultOk)
-		{
-			return ErrorCode;
-		}
-		if (iValSz > 0)
-		{
-			if (pInst->ForceIntegerMath)
-			{
-				double dLeft = atof(sVal1);
-				double dRight = atof(sVal2);
-
-				if(pInst->ForceUnsignedMath)
-				{
-					if (dLeft < 0 || dRight < 0)
-					{
-						return this->SetError(ResultMissingOperator, "Unsigned integer underflow.");
-					}
-					else if (dLeft > UINT_MAX || dRight > UINT_MAX)
-					{
-						return this->SetError(ResultMissingOperator, "unsigned integer overflow.");
-					}
-				}
-				else
-				{
-					if (dLeft < INT_MIN || dRight < INT_MIN)
-					{
-						return this->SetError(ResultIntegerunderflow, "Integer underflow.");
-					}
-					else if (dLeft > INT_MAX || dRight > INT_MAX)
-					{
-						return this->SetError(ResultIntegerOverflow, "Integer overflow.");
-					}
-				}
-
-				if ((ErrorCode = this->PerformDoubleOperation(pInst, atol(sVal1), sOp, atol(sVal2))) != ResultOk)
-				{
-					return ErrorCode;
-				}
-
-				if (pInst->RunningTotal < INT_MIN)
-				{
-					return this->SetError(ResultIntegerunderflow, "Integer underflow.");
-				}
-				else if (pInst->RunningTotal > INT_MAX)
-				{
-					return this->SetError(ResultIntegerOverflow, "Integer overflow.");
-				}
-
-				if (_itoa_s((int)pInst->RunningTotal, sVal, sizeof(sVal), 10) != 0)
-				{
-					return this->SetError(ResultIntegerTextConversionFailed, "Integer->Text converion failed.");
-				}
-			}
-			else {
-				if ((ErrorCode = this->PerformDoubleOperation(pInst, atof(sVal1), sOp, atof(sVal2))) != ResultOk)
-				{
-					return ErrorCode;
-				}
-
-				if (this->DoubleToChar(pInst->RunningTotal, sVal, sizeof(sVal)) <= 0)
-				{
-					return this->SetError(ResultDoubleTextConversionFailed, "Text->Double converion failed.");
-				}
-			}
-
-			iValSz = (int)strlen(sVal);
-
-			if (sVal[iValSz - 1] == '.')
-			{
-				iValSz--;
-				sVal[iValSz] = '\0';
-			}
-
-			if (this->cbDebugMode)
-			{
-				char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-
-				if (pInst->ForceIntegerMath)
-				{
-					sprintf_s(sDebugMath, sizeof(sDebugMath), "\t(%s %s %s) = %s\n", sVal1, sOp, sVal2, sVal);
-
-					if (this->pDebugProc)
-					{
-						this->pDebugProc(this, sDebugMath);
-					}
-					else {
-						printf("%s", sDebugMath);
-					}
-				}
-				else {
-					sprintf_s(sDebugMath, sizeof(sDebugMath), "\t(%.4f %s %.4f) = %.4f\n", atof(sVal1), sOp, atof(sVal2), atof(sVal));
-
-					if (this->pDebugProc)
-					{
-						this->pDebugProc(this, sDebugMath);
-					}
-					else {
-						printf("%s", sDebugMath);
-					}
-				}
-			}
-
-			if ((ErrorCode = this->ReplaceValue(pExp, iBegin, iEnd, sVal, iValSz)) != ResultOk)
-			{
-				return ErrorCode;
-			}
-		}
-		else {
-			return this->SetError(ResultRightValueFailed, "Value to the right of operator is missing or invalid.");
-		}
-	}
-	else {
-		if (strcmp(sOp, "!") == 0 || strcmp(sOp, "~") == 0)
-		{
-			if ((ErrorCode = this->GetRightNumber(pExp, iOpPos + iOpSz, sVal2, sizeof(sVal2), &iValSz, &iEnd)) != ResultOk)
-			{
-				return ErrorCode;
-			}
-
-			if (iValSz > 0)
-			{
-				if (sOp[0] == '!')
-				{
-					if ((ErrorCode = this->PerformBooleanOperation(pInst, atol(sVal2), sOp)) != ResultOk)
-					{
-						return ErrorCode;
-					}
-				}
-				else if (sOp[0] == '~')
-				{
-					if ((ErrorCode = this->PerformIntOperation(pInst, atol(sVal2), sOp, NULL)) != ResultOk)
-					{
-						return ErrorCode;
-					}
-				}
-				else {
-					return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", sOp);
-				}
-
-				if (_itoa_s((int)pInst->RunningTotal, sVal, sizeof(sVal), 10) != 0)
-				{
-					return this->SetError(ResultIntegerTextConversionFailed, "Integer to text conversion failed.");
-				}
-
-				iValSz = (int)strlen(sVal);
-
-				if (this->cbDebugMode)
-				{
-					char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-					sprintf_s(sDebugMath, sizeof(sDebugMath), "\t%s%s%s = %s\n", sVal1, sOp, sVal2, sVal);
-
-					if (this->pDebugProc)
-					{
-						this->pDebugProc(this, sDebugMath);
-					}
-					else {
-						printf("%s", sDebugMath);
-					}
-				}
-
-				if ((ErrorCode = this->ReplaceValue(pExp, iBegin, iEnd, sVal, iValSz)) != ResultOk)
-				{
-					return ErrorCode;
-				}
-			}
-			else {
-				return this->SetError(ResultRightValueFailed, "Value to the right of operator is missing or invalid.");
-			}
-		}
-		else if (strcmp(sOp, "-") == 0)
-		{
-			return ResultFoundNegative;
-		}
-		else {
-			return this->SetError(ResultInvalidToken, "Invalid token: %s", sOp);
-		}
-	}
-
-	return ResultOk;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Returns the position of a free-standing not operator.
-/// </summary>
-/// <param name="pExp"></param>
-/// <returns></returns>
-int CMathParser::GetFreestandingNotOperation(MATHEXPRESSION *pExp) //Pre order.
-{
-	for (int iRPos = 0; iRPos < pExp->Length; iRPos++)
-	{
-		//Make sure we have a "!' and not a "!=", these two have to be handled in different places.
-		if (pExp->Text[iRPos] == '!' && (iRPos + 1 < pExp->Length) && pExp->Text[iRPos + 1] != '=')
-		{
-			/*
-			//This is used to enforce the order of NOT expressions.
-			for(int iTmpRPos = iRPos + 1; iRPos < pExp->Length; iTmpRPos++)
-			{
-				if(!IsNumeric(pExp->Text[iTmpRPos]))
-				{
-					if(pExp->Text[iTmpRPos] != '(')
-					{
-						iRPos = iTmpRPos;
-						break;
-					}
-				}
-			}
-
-			if(pExp->Text[iRPos] == '~' || pExp->Text[iRPos] == '!')
-			{
-				return iRPos;
-			}
-			*/
-			return iRPos;
-		}
-	}
-	return -1;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Returns the first position of a first-order operation.
-/// </summary>
-/// <param name="pExp"></param>
-/// <returns></returns>
-int CMathParser::GetFirstOrderOperation(MATHEXPRESSION *pExp) //First order.
-{
-	for (int iRPos = 1; iRPos < pExp->Length; iRPos++)
-	{
-		if (pExp->Text[iRPos] == '*' || pExp->Text[iRPos] == '/' || pExp->Text[iRPos] == '%' || pExp->Text[iRPos] == '~')
-		{
-
-			return iRPos;
-		}
-	}
-	return 0;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Returns the first position of a second-order operation.
-/// </summary>
-/// <param name="pExp"></param>
-/// <param name="iStartPos"></param>
-/// <returns></returns>
-int CMathParser::GetSecondOrderOperation(MATHEXPRESSION *pExp, int iStartPos) //Second order.
-{
-	for (int iRPos = iStartPos; iRPos < pExp->Length; iRPos++)
-	{
-		if (pExp->Text[iRPos] == '-' || pExp->Text[iRPos] == '+')
-		{
-			return iRPos;
-		}
-	}
-	return 0;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::CalculateSimpleExpression(MATHINSTANCE *pInst, MATHEXPRESSION *pSubExp)
-{
-	MathResult ErrorCode = ResultOk;
-
-	int iDivPos = 0;
-	int iOpPos = 0;
-	int iOpSz = 0;
-
-	char *sOp = NULL;
-
-	int iRPos = 0;
-	int iWPos = 0;
-
-	int iBegin = 0;
-	int iEnd = 0;
-
-	int iOperator = 0;
-
-	pInst->RunningTotal = 0;
-
-	//Pre Order.
-	while ((iOpPos = this->GetFreestandingNotOperation(pSubExp)) >= 0)
-	{
-		iOpSz = 1;
-
-		if (pSubExp->Text[iOpPos] == '!')
-		{
-			sOp = "!";
-		}
-		else {
-			return this->SetError(ResultInvalidOperator, "Invalid operator: %c.", pSubExp->Text[iOpPos]);
-		}
-
-		if ((ErrorCode = this->ParseOperator(pInst, pSubExp, sOp, iOpPos, iOpSz)) != ResultOk)
-		{
-			return ErrorCode;
-		}
-	}
-
-	//First Order.
-	while ((iOpPos = this->GetFirstOrderOperation(pSubExp)) > 0)
-	{
-		iOpSz = 1;
-
-		if (pSubExp->Text[iOpPos] == '*') {
-			sOp = "*";
-		}
-		else if (pSubExp->Text[iOpPos] == '/') {
-			sOp = "/";
-		}
-		else if (pSubExp->Text[iOpPos] == '%') {
-			sOp = "%";
-		}
-		else if (pSubExp->Text[iOpPos] == '~') {
-			sOp = "~";
-		}
-		/*
-		else if(pSubExp->Text[iOpPos] == '!'){
-			sOp = "!";
-		}
-		*/
-		else {
-			return this->SetError(ResultInvalidOperator, "Invalid operator: %c.", pSubExp->Text[iOpPos]);
-		}
-
-		if ((ErrorCode = this->ParseOperator(pInst, pSubExp, sOp, iOpPos, iOpSz)) != ResultOk)
-		{
-			return ErrorCode;
-		}
-	}
-
-	int iStartPos = 1;
-
-	//Second Order.
-	while ((iOpPos = this->GetSecondOrderOperation(pSubExp, iStartPos)) > 0)
-	{
-		iOpSz = 1;
-
-		if (pSubExp->Text[iOpPos] == '-') {
-			sOp = "-";
-		}
-		else if (pSubExp->Text[iOpPos] == '+') {
-			sOp = "+";
-		}
-		else {
-			return this->SetError(ResultInvalidOperator, "Invalid operator: %c.", pSubExp->Text[iOpPos]);
-		}
-
-		if ((ErrorCode = this->ParseOperator(pInst, pSubExp, sOp, iOpPos, iOpSz)) != ResultOk)
-		{
-			if (ErrorCode == ResultFoundNegative)
-			{
-				iStartPos = iOpPos + 1;
-			}
-			else {
-				return ErrorCode;
-			}
-		}
-	}
-
-	for (iOperator = 0; sThirdOrder[iOperator]; iOperator++)
-	{
-		iOpSz = (int)strlen(sThirdOrder[iOperator]);
-
-		while ((iOpPos = InStr(sThirdOrder[iOperator], pSubExp->Text, pSubExp->Length, 0)) > 0)
-		{
-			if ((ErrorCode = this->ParseOperator(pInst, pSubExp, sThirdOrder[iOperator], iOpPos, iOpSz)) != ResultOk)
-			{
-				return ErrorCode;
-			}
-		}
-	}
-
-	if (IsNumeric(pSubExp->Text))
-	{
-		pInst->RunningTotal = atof(pSubExp->Text);
-
-		if (pInst->ForceIntegerMath)
-		{
-			if(pInst->ForceUnsignedMath)
-			{
-				if (pInst->RunningTotal < 0)
-				{
-					return this->SetError(ResultMissingOperator, "Unsigned integer underflow.");
-				}
-				else if (pInst->RunningTotal > UINT_MAX)
-				{
-					return this->SetError(ResultMissingOperator, "unsigned integer overflow.");
-				}
-				pInst->RunningTotal = (unsigned int)pInst->RunningTotal;
-			}
-			else
-			{
-				if (pInst->RunningTotal < INT_MIN)
-				{
-					return this->SetError(ResultMissingOperator, "Signed integer underflow.");
-				}
-				else if (pInst->RunningTotal > INT_MAX)
-				{
-					return this->SetError(ResultMissingOperator, "Signed integer overflow.");
-				}
-				pInst->RunningTotal = (int)pInst->RunningTotal;
-			}
-		}
-	}
-	else if (pSubExp->Text[0] == '!' && IsNumeric(pSubExp->Text + 1))
-	{
-		if (this->cbDebugMode)
-		{
-			char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-			sprintf_s(sDebugMath, sizeof(sDebugMath), "\t%s = %.4f\n", pSubExp->Text, pInst->RunningTotal);
-
-			if (this->pDebugProc)
-			{
-				this->pDebugProc(this, sDebugMath);
-			}
-			else {
-				printf("%s", sDebugMath);
-			}
-		}
-
-		if ((ErrorCode = this->PerformBooleanOperation(pInst, atol(pSubExp->Text + 1), "!")) != ResultOk)
-		{
-			return ErrorCode;
-		}
-	}
-	else if (pSubExp->Text[0] == '~' && IsNumeric(pSubExp->Text + 1))
-	{
-		if (this->cbDebugMode)
-		{
-			char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-			sprintf_s(sDebugMath, sizeof(sDebugMath), "\t%s = %.4f\n", pSubExp->Text, pInst->RunningTotal);
-
-			if (this->pDebugProc)
-			{
-				this->pDebugProc(this, sDebugMath);
-			}
-			else {
-				printf("%s", sDebugMath);
-			}
-		}
-
-		if ((ErrorCode = this->PerformIntOperation(pInst, atol(pSubExp->Text + 1), "~", NULL)) != ResultOk)
-		{
-			return ErrorCode;
-		}
-	}
-	else {
-		return this->SetError(ResultInvalidToken, "Invalid token: %c", pSubExp->Text[0]);
-	}
-
-	return ErrorCode;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Verifies that all parentheses have matches.
-/// </summary>
-/// <param name="sExpression"></param>
-/// <param name="iExpressionSz"></param>
-/// <returns></returns>
-int CMathParser::MatchParentheses(const char *sExpression, const int iExpressionSz)
-{
-	int iRPos = 0;
-	int iScope = 0;
-
-	while (iRPos < iExpressionSz)
-	{
-		if (sExpression[iRPos] == '(') {
-			iScope++;
-		}
-		else if (sExpression[iRPos] == ')') {
-			iScope--;
-		}
-		iRPos++;
-	}
-
-	return iScope;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::AllocateExpression(MATHEXPRESSION* pExp, const char* sSource, int iSourceSz)
-{
-	pExp->Allocated = (int)iSourceSz + 1;
-
-	pExp->Text = (char*)calloc(sizeof(char), pExp->Allocated);
-	if (!pExp->Text)
-	{
-		return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
-	}
-
-	short LastChar = 0; // -1=Other 0=Not-Set 1=Numeric
-	bool bAfterWhiteSpace = false;
-
-	for (int iRPos = 0; iRPos < iSourceSz; iRPos++)
-	{
-		if (!IsWhiteSpace(sSource[iRPos]))
-		{
-			if (IsNumeric(sSource[iRPos]))
-			{
-				if (bAfterWhiteSpace)
-				{
-					if (LastChar != -1 && LastChar != 0)
-					{
-						return this->SetError(ResultInvalidToken, "Token is invalid: %c", sSource[iRPos]);
-					}
-				}
-				LastChar = 1;
-			}
-			else if (this->IsValidChar(sSource[iRPos]))
-			{
-				LastChar = -1;
-			}
-			else if (this->IsValidVariableChar(sSource[iRPos]))
-			{
-				//Parse variable name.
-				char sVarName[CMATHPARSER_MAX_VAR_LENGTH + 1];
-
-				int iVarWPos = 0;
-
-				while (this->IsValidVariableChar(sSource[iRPos]))
-				{
-					sVarName[iVarWPos++] = sSource[iRPos++];
-					if (iVarWPos >= CMATHPARSER_MAX_VAR_LENGTH)
-					{
-						return this->SetError(ResultInvalidToken, "Variable length limit exceeded.");
-					}
-				}
-
-				sVarName[iVarWPos] = '\0';
-
-				//Skip whitespaces.
-				while( iRPos < iSourceSz && IsWhiteSpace(sSource[iRPos]))
-				{
-					iRPos++;
-				}
-
-				if (sSource[iRPos] == '(')
-				{
-					double* pOutParameters = NULL;
-					int iParameterCount = 0;
-
-					double dProcValue = 0;
-					MathResult result = ResultOk;
-
-					if ((result = ParseMethodParameters(sSource, iSourceSz, &iRPos, &pOutParameters, &iParameterCount)) != ResultOk)
-					{
-						return result;
-					}
-
-					if (IsNativeMethod(sVarName))
-					{
-						if ((result = ExecuteNativeMethod(sVarName, pOutParameters, iParameterCount, &dProcValue)) != ResultOk)
-						{
-							return result;
-						}
-					}
-					else if (this->pMethodProc != NULL && this->pMethodProc(this, sVarName, pOutParameters, iParameterCount, &dProcValue))
-					{
-						//Non-native method executed successfully.
-					}
-					else
-					{
-						return this->SetError(ResultInvalidToken, "Undeclared identifier: %s.", sVarName);
-					}
-
-					char sVarValue[64];
-					//Convert double to string (must be a faster way, but this is just super safe and doesn't create infinite repeating patterns).
-					//TODO: Fixed percision of 8 on variables seems inflexible.
-					int iVarValLength = sprintf_s(sVarValue, sizeof(sVarValue), "%.8f", dProcValue);
-
-					if (pExp->Length + iVarValLength + iSourceSz >= pExp->Allocated)
-					{
-						//Adding [iSourceSz] so that the remainder of the expression can be stored without allocating again (unless we encounter more vars).
-						pExp->Allocated = (pExp->Length + iVarValLength) + iSourceSz + 1;
-						pExp->Text = (char*)realloc(pExp->Text, sizeof(char) * pExp->Allocated);
-						if (!pExp->Text)
-						{
-							return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
-						}
-					}
-
-					//Copy the resulting variable value to the expression for further processing.
-					strcpy_s(pExp->Text + pExp->Length, pExp->Allocated - pExp->Length, sVarValue);
-					pExp->Length += strlen(sVarValue);
-				}
-				else
-				{
-					double dVarValue = 0;
-					//Get variable value...
-					if (!this->pVariableSetProc(this, sVarName, &dVarValue))
-					{
-						return this->SetError(ResultInvalidToken, "Variable was not defined: %s.", sVarName);
-					}
-
-					char sVarValue[64];
-					//Convert double to string (must be a faster way, but this is just super safe and doesn't create infinite repeating patterns).
-					//TODO: Fixed percision of 8 on variables seems inflexible.
-					int iVarValLength = sprintf_s(sVarValue, sizeof(sVarValue), "%.8f", dVarValue);
-
-					if (pExp->Length + iVarValLength + iSourceSz >= pExp->Allocated)
-					{
-						//Adding [iSourceSz] so that the remainder of the expression can be stored without allocating again (unless we encounter more vars).
-						pExp->Allocated = (pExp->Length + iVarValLength) + iSourceSz + 1;
-						pExp->Text = (char*)realloc(pExp->Text, sizeof(char) * pExp->Allocated);
-						if (!pExp->Text)
-						{
-							return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
-						}
-					}
-
-					//Copy the resulting variable value to the expression for further processing.
-					strcpy_s(pExp->Text + pExp->Length, pExp->Allocated - pExp->Length, sVarValue);
-					pExp->Length += strlen(sVarValue);
-				}
-
-				iRPos--; //We need to let the outer loop determine if we are done yet.
-				continue;
-			}
-			else {
-				return this->SetError(ResultInvalidToken, "Token is invalid: %c", sSource[iRPos]);
-			}
-
-			pExp->Text[pExp->Length++] = sSource[iRPos];
-
-			bAfterWhiteSpace = false;
-		}
-		else {
-			bAfterWhiteSpace = true;
-		}
-	}
-
-	pExp->Text[pExp->Length] = '\0';
-
-	return ResultOk;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/// <summary>
-/// Takes a method name and its parameters, apples logic to the result of a single floating point value.
-/// </summary>
-/// <param name="sMethodName"></param>
-/// <param name="dParameters"></param>
-/// <param name="iParamCount"></param>
-/// <param name="pOutResult"></param>
-/// <returns></returns>
-CMathParser::MathResult CMathParser::ExecuteNativeMethod(
-	const char* sMethodName, double* dParameters, int iParamCount, double* pOutResult)
-{
-	if (_strcmpi(sMethodName, "NOT") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = !((long long)dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "ACOS") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = acos(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "ASIN") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = asin(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "ATAN") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = atan(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "ATAN2") == 0)
-	{
-		if (iParamCount != 2)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = atan2(dParameters[0], dParameters[1]);
-	}
-	else if (_strcmpi(sMethodName, "LDEXP") == 0)
-	{
-		if (iParamCount != 2)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = ldexp(dParameters[0], (int)dParameters[1]);
-	}
-	else if (_strcmpi(sMethodName, "TAN") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = tan(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "SIN") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = sin(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "COS") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = cos(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "ATAN") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = atan(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "ABS") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = fabs(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "SQRT") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = sqrt(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "POW") == 0)
-	{
-		if (iParamCount != 2)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = pow(dParameters[0], dParameters[1]);
-	}
-	else if (_strcmpi(sMethodName, "MODPOW") == 0)
-	{
-		if (iParamCount != 3)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = this->ModPow((long long)dParameters[0], (long long)dParameters[1], (int)dParameters[2]);
-	}
-	else if (_strcmpi(sMethodName, "SINH") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = sinh(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "COSH") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = cosh(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "TANH") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = tanh(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "LOG") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = log(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "LOG10") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = log10(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "EXP") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = exp(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "FLOOR") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = floor(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "CEIL") == 0)
-	{
-		if (iParamCount != 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		*pOutResult = ceil(dParameters[0]);
-	}
-	else if (_strcmpi(sMethodName, "SUM") == 0)
-	{
-		if (iParamCount < 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		double dSum = 0;
-
-		for (int i = 0; i < iParamCount; i++)
-		{
-			dSum += dParameters[i];
-		}
-
-		*pOutResult = dSum;
-	}
-	else if (_strcmpi(sMethodName, "AVG") == 0)
-	{
-		if (iParamCount < 1)
-		{
-			return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
-		}
-
-		double dSum = 0;
-
-		for (int i = 0; i < iParamCount; i++)
-		{
-			dSum += dParameters[i];
-		}
-
-		dSum /= iParamCount;
-
-		*pOutResult = dSum;
-	}
-
-	return ResultOk;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::ParseMethodParameters(
-	const char* sSource, int iSourceSz, int* piRPos, double** pOutParameters, int *piOutParamCount)
-{
-	int iRPos = *piRPos;
-	int iWPos = 0;
-
-	int iParenNestLevel = 0;
-	int iParameters = 0;
-
-	char sBuf[1024];
-
-	if (sSource[iRPos] == '(')
-	{
-		iRPos++; //We skip the first paren because it encloses the currently parsing method.
-		iParenNestLevel++;
-	}
-
-	for (; iRPos < iSourceSz; iRPos++)
-	{
-		if (IsWhiteSpace(sSource[iRPos]))
-		{
-			continue;
-		}
-
-		if (sSource[iRPos] == '(')
-		{
-			sBuf[iWPos] = '\0';
-
-			if (IsNativeMethod(sBuf))
-			{
-				double* pOutParameters = NULL;
-				int iParameterCount = 0;
-
-				double dProcValue = 0;
-				MathResult result = ResultOk;
-
-				if ((result = ParseMethodParameters(sSource, iSourceSz, &iRPos, &pOutParameters, &iParameterCount)) != ResultOk)
-				{
-					return result;
-				}
-
-				if ((result = ExecuteNativeMethod(sBuf, pOutParameters, iParameterCount, &dProcValue)) != ResultOk)
-				{
-					return result;
-				}
-
-				iRPos--; //Let this loop determine the next action.
-
-				memset(sBuf, 0, sizeof(sBuf));
-
-				iWPos = sprintf_s(sBuf, sizeof(sBuf), "%.8f", dProcValue);
-
-				continue;
-			}
-
-			iParenNestLevel++;
-		}
-		else if (sSource[iRPos] == ')')
-		{
-			iParenNestLevel--;
-		}
-
-		if (sSource[iRPos] == ',')
-		{
-
-		}
-		else if(iParenNestLevel > 0)
-		{
-			sBuf[iWPos++] = sSource[iRPos];
-		}
-
-		if (iParenNestLevel == 0 || sSource[iRPos] == ',')
-		{
-			*pOutParameters = (double*)realloc(*pOutParameters, sizeof(double) * (iParameters + 1));
-
-			sBuf[iWPos] = '\0';
-			double dResult = 0;
-			this->Calculate(sBuf, &dResult);
-
-			(*pOutParameters)[iParameters] = dResult;
-
-			iParameters++;
-
-			if (sSource[iRPos] == ',')
-			{
-				iWPos = 0; //Reset for the next parameter.
-				memset(sBuf, 0, sizeof(sBuf));
-			}
-			else if (iParenNestLevel == 0)
-			{
-				iRPos++;
-				break;
-			}
-		}
-	}
-
-	if (iParenNestLevel != 0)
-	{
-		return this->SetError(ResultParenthesesMismatch, "Parentheses mismatch.");
-	}
-
-	*piOutParamCount = iParameters;
-	*piRPos = iRPos;
-
-	return ResultOk;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::CalculateComplexExpression(MATHINSTANCE *pInst)
-{
-	char sVal[_CVTBUFSIZE];
-
-	int iBegin = 0;
-	int iEnd = 0;
-	int iValSz = 0;
-
-	MathResult ErrorCode = ResultOk;
-
-	MATHEXPRESSION SubExpr;
-	memset(&SubExpr, 0, sizeof(SubExpr));
-
-	//Check braces to see if they each have a match.
-	if (this->MatchParentheses(pInst->Expression.Text, pInst->Expression.Length) != 0)
-	{
-		return this->SetError(ResultParenthesesMismatch, "Parentheses mismatch.");
-	}
-
-	SubExpr.Allocated = pInst->Expression.Length;;
-	SubExpr.Text = (char *)calloc(sizeof(char), SubExpr.Allocated);
-	if (!SubExpr.Text)
-	{
-		free(pInst->Expression.Text);
-		return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
-	}
-
-	while ((ErrorCode = this->GetSubExpression(pInst, &iBegin, &iEnd)) == ResultOk)
-	{
-		if (iEnd > iBegin)
-		{
-			SubExpr.Length = ((iEnd - iBegin) - 2);
-
-			if (SubExpr.Length >= SubExpr.Allocated)
-			{
-				SubExpr.Allocated = ((iEnd - iBegin) - 2) + 1;
-				SubExpr.Text = (char *)realloc(SubExpr.Text, SubExpr.Allocated);
-			}
-
-			memcpy_s(SubExpr.Text, SubExpr.Allocated, pInst->Expression.Text + (iBegin + 1), SubExpr.Length);
-			SubExpr.Text[SubExpr.Length] = '\0';
-
-			if ((ErrorCode = this->CalculateSimpleExpression(pInst, &SubExpr)) != ResultOk)
-			{
-				break;
-			}
-
-			if (pInst->ForceIntegerMath)
-			{
-				if (pInst->RunningTotal < INT_MIN)
-				{
-					ErrorCode = this->SetError(ResultMissingOperator, "Integer underflow.");
-					break;
-				}
-				else if (pInst->RunningTotal > INT_MAX)
-				{
-					ErrorCode = this->SetError(ResultMissingOperator, "Integer overflow.");
-					break;
-				}
-
-				if (_itoa_s((int)pInst->RunningTotal, sVal, sizeof(sVal), 10) != 0)
-				{
-					ErrorCode = this->SetError(ResultMissingOperator, "Integer->Text converion failed.");
-					break;
-				}
-			}
-			else {
-				sprintf_s(sVal, sizeof(sVal), "%.*g", this->ciPrecision, pInst->RunningTotal);
-				/*
-				if(_gcvt_s(sVal, sizeof(sVal), pInst->RunningTotal, this->ciPrecision) != 0)
-				{
-					ErrorCode = this->SetError(ResultMissingOperator, "Double->Text converion failed.");
-					break;
-				}
-				*/
-			}
-
-			iValSz = (int)strlen(sVal);
-
-			if (sVal[iValSz - 1] == '.')
-			{
-				iValSz--;
-				sVal[iValSz] = '\0';
-			}
-
-			if ((ErrorCode = this->ReplaceValue(&pInst->Expression, iBegin, iEnd, sVal, iValSz)) != ResultOk)
-			{
-				break;
-			}
-		}
-		else {
-			ErrorCode = this->CalculateSimpleExpression(pInst, &pInst->Expression);
-			break;
-		}
-	}
-
-	free(SubExpr.Text);
-
-	return ErrorCode;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::GetSubExpression(MATHINSTANCE *pInst, int *iBegin, int *iEnd)
-{
-	int iIn = 0;
-	int iOut = 0;
-
-	for (int iRPos = 0; iRPos < pInst->Expression.Length; iRPos++)
-	{
-		if (pInst->Expression.Text[iRPos] == ')')
-		{
-			*iEnd = iRPos + 1;
-			iOut++;
-			for (iRPos--; iRPos >= 0; iRPos--)
-			{
-				if (pInst->Expression.Text[iRPos] == '(')
-				{
-					iIn++;
-				}
-				else if (pInst->Expression.Text[iRPos] == ')')
-				{
-					iOut++;
-				}
-
-				if (iIn == iOut)
-				{
-					*iBegin = iRPos;
-
-					if (((int)*iBegin) > 0)
-					{
-						if (!this->IsMathChar(pInst->Expression.Text[((int)*iBegin) - 1]) && pInst->Expression.Text[((int)*iBegin) - 1] != '(')
-						{
-							return this->SetError(ResultMissingOperator, "Missing mathematical operator near: (.");
-						}
-					}
-
-					if (((int)*iEnd) < pInst->Expression.Length)
-					{
-						if (!this->IsMathChar(pInst->Expression.Text[((int)*iEnd)]) && pInst->Expression.Text[((int)*iEnd)] != ')')
-						{
-							return this->SetError(ResultMissingOperator, "Missing mathematical operator near: ).");
-						}
-					}
-
-					return ResultOk;
-				}
-			}
-		}
-	}
-
-	*iBegin = pInst->Expression.Length;
-	*iEnd = -pInst->Expression.Length;
-
-	return ResultOk; //This is not an error.
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::ReplaceValue(MATHEXPRESSION *pExp, int iBegin, int iEnd, const char *sWith, int iWithSz)
-{
-	int iPos = 0;
-	int iNewSz = pExp->Length + (iWithSz - (iEnd - iBegin));
-	int iGapSize = (pExp->Length - iNewSz);
-
-	pExp->Length = iNewSz;
-
-	if (iNewSz >= pExp->Allocated)
-	{
-		pExp->Allocated = iNewSz + 1;
-		pExp->Text = (char *)realloc(pExp->Text, pExp->Allocated);
-	}
-
-	if (iGapSize < 0)
-	{
-		iGapSize = abs(iGapSize);
-
-		for (iPos = iNewSz; iPos > iEnd && (iPos - iGapSize) >= 0; iPos--)
-		{
-			pExp->Text[iPos] = pExp->Text[iPos - iGapSize];
-		}
-		memcpy_s(pExp->Text + iBegin, pExp->Allocated - iBegin, sWith, iWithSz);
-	}
-	else if (iGapSize > 0)
-	{
-		memcpy_s(pExp->Text + iBegin, pExp->Allocated - iBegin, sWith, iWithSz);
-
-		for (iPos = iBegin + iWithSz; iPos < iNewSz; iPos++)
-		{
-			pExp->Text[iPos] = pExp->Text[iPos + iGapSize];
-		}
-
-		pExp->Text[iPos] = '\0';
-	}
-	else {
-		memcpy(pExp->Text + iBegin, sWith, iWithSz);
-	}
-
-	return ResultOk;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::IsIntegerExclusive(const char *sOperator)
-{
-	if (strcmp(sOperator, "&") == 0) {
-		return true;
-	}
-	else if (strcmp(sOperator, "|") == 0) {
-		return true;
-	}
-	else if (strcmp(sOperator, "^") == 0) {
-		return true;
-	}
-	else if (strcmp(sOperator, "&=") == 0) {
-		return true;
-	}
-	else if (strcmp(sOperator, "|=") == 0) {
-		return true;
-	}
-	else if (strcmp(sOperator, "^=") == 0) {
-		return true;
-	}
-	else if (strcmp(sOperator, "<<") == 0) {
-		return true;
-	}
-	else if (strcmp(sOperator, ">>") == 0) {
-		return true;
-	}
-	else return false;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::IsMathChar(const char cChar)
-{
-	return(cChar == '*' || cChar == '/'
-		|| cChar == '+' || cChar == '-'
-		|| cChar == '>' || cChar == '<'
-		|| cChar == '!' || cChar == '='
-		|| cChar == '&' || cChar == '|'
-		|| cChar == '^' || cChar == '%'
-		|| cChar == '~');
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::IsValidChar(const char cChar)
-{
-	return IsNumeric(cChar) || this->IsMathChar(cChar) || cChar == '.' || cChar == '(' || cChar == ')';
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::IsValidVariableChar(const char cChar)
-{
-	return IsNumeric(cChar)
-		|| (cChar >= 'a' && cChar <= 'z')
-		|| (cChar >= 'A' && cChar <= 'Z')
-		|| cChar == '_';
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::PerformBooleanOperation(MATHINSTANCE *pInst, int iVal, const char *sOpr)
-{
-	if (strcmp(sOpr, "!") == 0)
-	{
-		pInst->RunningTotal = (!iVal);
-	}
-	else
-	{
-		return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", sOpr);
-	}
-	return ResultOk;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::PerformIntOperation(MATHINSTANCE *pInst, int iVal1, const char *sOpr, int iVal2)
-{
-	if (strcmp(sOpr, "&&") == 0)
-		pInst->RunningTotal = (iVal1 && iVal2);
-	else if (strcmp(sOpr, "||") == 0)
-		pInst->RunningTotal = (iVal1 || iVal2);
-	else if (strcmp(sOpr, "&") == 0)
-		pInst->RunningTotal = (iVal1 & iVal2);
-	else if (strcmp(sOpr, "|") == 0)
-		pInst->RunningTotal = (iVal1 | iVal2);
-	else if (strcmp(sOpr, "!") == 0)
-		pInst->RunningTotal = (iVal1 != iVal2);
-	else if (strcmp(sOpr, "~") == 0)
-		pInst->RunningTotal = ~iVal1;
-	else if (strcmp(sOpr, "^") == 0)
-		pInst->RunningTotal = (iVal1 ^ iVal2);
-	else if (strcmp(sOpr, "&=") == 0)
-		pInst->RunningTotal = (iVal1 &= iVal2);
-	else if (strcmp(sOpr, "|=") == 0)
-		pInst->RunningTotal = (iVal1 |= iVal2);
-	else if (strcmp(sOpr, "^=") == 0)
-		pInst->RunningTotal = (iVal1 ^= iVal2);
-	else if (strcmp(sOpr, "<<") == 0)
-		pInst->RunningTotal = (iVal1 << iVal2);
-	else if (strcmp(sOpr, ">>") == 0)
-		pInst->RunningTotal = (iVal1 >> iVal2);
-	else {
-		return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", sOpr);
-	}
-
-	return ResultOk;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::PerformDoubleOperation(MATHINSTANCE *pInst, double dVal1, const char *sOpr, double dVal2)
-{
-	double dResult = 0;
-
-	if (this->IsIntegerExclusive(sOpr))
-		return this->PerformIntOperation(pInst, (int)dVal1, sOpr, (int)dVal2);
-	else if (strcmp(sOpr, "*") == 0)
-		dResult = (dVal1 * dVal2);
-	else if (strcmp(sOpr, "/") == 0)
-	{
-		if (dVal2 == 0)
-		{
-			return this->SetError(ResultInvalidOperator, "Divide by zero.");
-		}
-		dResult = (dVal1 / dVal2);
-	}
-	else if (strcmp(sOpr, "+") == 0)
-		dResult = (dVal1 + dVal2);
-	else if (strcmp(sOpr, "&&") == 0)
-		dResult = (dVal1 && dVal2);
-	else if (strcmp(sOpr, "||") == 0)
-		dResult = (dVal1 || dVal2);
-	else if (strcmp(sOpr, "-") == 0)
-		dResult = (dVal1 - dVal2);
-	else if (strcmp(sOpr, "=") == 0)
-		dResult = (dVal1 == dVal2);
-	else if (strcmp(sOpr, ">") == 0)
-		dResult = (dVal1 > dVal2);
-	else if (strcmp(sOpr, "<") == 0)
-		dResult = (dVal1 < dVal2);
-	else if (strcmp(sOpr, ">=") == 0)
-		dResult = (dVal1 >= dVal2);
-	else if (strcmp(sOpr, "<=") == 0)
-		dResult = (dVal1 <= dVal2);
-	else if (strcmp(sOpr, "<>") == 0)
-		dResult = (dVal1 != dVal2);
-	else if (strcmp(sOpr, "!") == 0)
-		dResult = (dVal1 != dVal2);
-	else if (strcmp(sOpr, "!=") == 0)
-		dResult = (dVal1 != dVal2);
-	else if (strcmp(sOpr, "%") == 0)
-	{
-		if (dVal2 == 0)
-		{
-			return this->SetError(ResultInvalidOperator, "Mod by zero.");
-		}
-		dResult = fmod(dVal1, dVal2);
-	}
-	else {
-		return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", sOpr);
-	}
-
-	if (_finite(dResult) || !_isnan(dResult))
-	{
-		pInst->RunningTotal = dResult;
-		return ResultOk;
-	}
-	else {
-		return this->SetError(ResultInfiniteOrNotANumber, "Result of %s is infinite or not a number.", sOpr);
-	}
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int iExpressionSz, double *dResult)
-{
-	if (this->cbDebugMode)
-	{
-		if (this->pDebugProc)
-		{
-			char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-			sprintf_s(sDebugMath, sizeof(sDebugMath), "\"%s\" = {\n", sExpression);
-			this->pDebugProc(this, sDebugMath);
-		}
-		else {
-			printf("(%s) = {\n", sExpression);
-		}
-	}
-
-	MATHINSTANCE Inst;
-	memset(&Inst, 0, sizeof(Inst));
-	MathResult ErrorCode = ResultOk;
-
-	Inst.ForceIntegerMath = false;
-	if ((ErrorCode = this->AllocateExpression(&Inst.Expression, sExpression, iExpressionSz)) != ResultOk)
-	{
-		return ErrorCode;
-	}
-
-	if ((ErrorCode = this->CalculateComplexExpression(&Inst)) == ResultOk)
-	{
-		*dResult = Inst.RunningTotal;
-	}
-
-	free(Inst.Expression.Text);
-
-	if (this->cbDebugMode)
-	{
-		char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-		sprintf_s(sDebugMath, sizeof(sDebugMath), "} = %.4f\n", *dResult);
-
-		if (this->pDebugProc)
-		{
-			this->pDebugProc(this, sDebugMath);
-		}
-		else {
-			printf("%s", sDebugMath);
-		}
-	}
-
-	return ErrorCode;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::Calculate(const char *sExpression, double *dResult)
-{
-	return this->Calculate(sExpression, (int)strlen(sExpression), dResult);
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int iExpressionSz, unsigned int *iResult)
-{
-	if (this->cbDebugMode)
-	{
-		if (this->pDebugProc)
-		{
-			char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-			sprintf_s(sDebugMath, sizeof(sDebugMath), "\"%s\" = {\n", sExpression);
-			this->pDebugProc(this, sDebugMath);
-		}
-		else {
-			printf("(%s) = {\n", sExpression);
-		}
-	}
-
-	MATHINSTANCE Inst;
-	memset(&Inst, 0, sizeof(Inst));
-	MathResult ErrorCode = ResultOk;
-
-	Inst.ForceIntegerMath = true;
-	Inst.ForceUnsignedMath = true;
-	if ((ErrorCode = this->AllocateExpression(&Inst.Expression, sExpression, iExpressionSz)) != ResultOk)
-	{
-		return ErrorCode;
-	}
-
-	if ((ErrorCode = this->CalculateComplexExpression(&Inst)) == ResultOk)
-	{
-		*iResult = (unsigned int)Inst.RunningTotal;
-	}
-
-	free(Inst.Expression.Text);
-
-	if (this->cbDebugMode)
-	{
-		char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-		sprintf_s(sDebugMath, sizeof(sDebugMath), "} = %d\n", *iResult);
-
-		if (this->pDebugProc)
-		{
-			this->pDebugProc(this, sDebugMath);
-		}
-		else {
-			printf("%s", sDebugMath);
-		}
-	}
-
-	return ErrorCode;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::Calculate(const char *sExpression, unsigned int *iResult)
-{
-	return this->Calculate(sExpression, (int)strlen(sExpression), iResult);
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int iExpressionSz, int *iResult)
-{
-	if (this->cbDebugMode)
-	{
-		if (this->pDebugProc)
-		{
-			char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-			sprintf_s(sDebugMath, sizeof(sDebugMath), "\"%s\" = {\n", sExpression);
-			this->pDebugProc(this, sDebugMath);
-		}
-		else {
-			printf("(%s) = {\n", sExpression);
-		}
-	}
-
-	MATHINSTANCE Inst;
-	memset(&Inst, 0, sizeof(Inst));
-	MathResult ErrorCode = ResultOk;
-
-	Inst.ForceIntegerMath = true;
-	if ((ErrorCode = this->AllocateExpression(&Inst.Expression, sExpression, iExpressionSz)) != ResultOk)
-	{
-		return ErrorCode;
-	}
-
-	if ((ErrorCode = this->CalculateComplexExpression(&Inst)) == ResultOk)
-	{
-		*iResult = (int)Inst.RunningTotal;
-	}
-
-	free(Inst.Expression.Text);
-
-	if (this->cbDebugMode)
-	{
-		char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-		sprintf_s(sDebugMath, sizeof(sDebugMath), "} = %d\n", *iResult);
-
-		if (this->pDebugProc)
-		{
-			this->pDebugProc(this, sDebugMath);
-		}
-		else {
-			printf("%s", sDebugMath);
-		}
-	}
-
-	return ErrorCode;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int *iResult)
-{
-	return this->Calculate(sExpression, (int)strlen(sExpression), iResult);
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::CMathParser(short iPrecision)
-{
-	memset(&this->LastErrorInfo, 0, sizeof(this->LastErrorInfo));
-	this->Precision(iPrecision);
-	this->pDebugProc = NULL;
-	this->cbDebugMode = false;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::CMathParser(void)
-{
-	memset(&this->LastErrorInfo, 0, sizeof(this->LastErrorInfo));
-	this->Precision(CMATHPARSER_DEFAULT_PRECISION);
-	this->pDebugProc = NULL;
-	this->cbDebugMode = false;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::~CMathParser(void)
-{
-	if (this->LastErrorInfo.Text)
-	{
-		free(this->LastErrorInfo.Text);
-	}
-	memset(&this->LastErrorInfo, 0, sizeof(this->LastErrorInfo));
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-short CMathParser::Precision(short iPrecision)
-{
-	if (iPrecision > CMATHPARSER_MAX_PRECISION)
-	{
-		iPrecision = CMATHPARSER_MAX_PRECISION;
-	}
-	else if (iPrecision < CMATHPARSER_MIN_PRECISION)
-	{
-		iPrecision = CMATHPARSER_MIN_PRECISION;
-	}
-
-	short iOldPrecision = this->ciPrecision;
-	this->ciPrecision = iPrecision;
-	return iOldPrecision;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-short CMathParser::Precision(void)
-{
-	return this->ciPrecision;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::DebugMode(bool bDebugMode)
-{
-	bool bOldDebugMode = this->cbDebugMode;
-	this->cbDebugMode = bDebugMode;
-	return bOldDebugMode;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::TMethodCallback CMathParser::GetMethodCallback(void)
-{
-	return this->pMethodProc;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::TMethodCallback CMathParser::SetMethodCallback(TMethodCallback procPtr)
-{
-	TMethodCallback oldProcPtr = this->pMethodProc;
-	this->pMethodProc = procPtr;
-	return oldProcPtr;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::TVariableSetCallback CMathParser::GetVariableSetCallback(void)
-{
-	return this->pVariableSetProc;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::TVariableSetCallback CMathParser::SetVariableSetCallback(TVariableSetCallback procPtr)
-{
-	TVariableSetCallback oldProcPtr = this->pVariableSetProc;
-	this->pVariableSetProc = procPtr;
-	return oldProcPtr;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::TDebugTextCallback CMathParser::GetDebugCallback(void)
-{
-	return this->pDebugProc;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::TDebugTextCallback CMathParser::SetDebugCallback(TDebugTextCallback procPtr)
-{
-	TDebugTextCallback oldProcPtr = this->pDebugProc;
-	this->pDebugProc = procPtr;
-	return oldProcPtr;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::DebugMode(void)
-{
-	return this->cbDebugMode;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MATHERRORINFO *CMathParser::LastError(void)
-{
-	return &this->LastErrorInfo;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-CMathParser::MathResult CMathParser::SetError(MathResult ErrorCode, const char *sFormat, ...)
-{
-	va_list ArgList;
-	va_start(ArgList, sFormat);
-
-	this->LastErrorInfo.Error = ErrorCode;
-
-	int iMemoryRequired = _vscprintf(sFormat, ArgList) + 1;
-
-	if (this->LastErrorInfo.Text)
-	{
-		free(this->LastErrorInfo.Text);
-		this->LastErrorInfo.Text = NULL;
-		this->LastErrorInfo.Error = ResultOk;
-	}
-
-	this->LastErrorInfo.Text = (char *)calloc(sizeof(char), iMemoryRequired);
-
-	_vsprintf_s_l(this->LastErrorInfo.Text, iMemoryRequired, sFormat, NULL, ArgList);
-	va_end(ArgList);
-
-	if (this->cbDebugMode)
-	{
-		char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
-		sprintf_s(sDebugMath, sizeof(sDebugMath), "\t%s\n", this->LastErrorInfo.Text);
-
-		if (this->pDebugProc)
-		{
-			this->pDebugProc(this, sDebugMath);
-		}
-		else {
-			printf("%s", sDebugMath);
-		}
-	}
-	return ErrorCode;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::ReverseString(char *sBuf, int iBufSz)
-{
-	char *String1 = NULL;
-	char *String2 = NULL;
-
-	if (!sBuf || !*sBuf)
-	{
-		return false;
-	}
-
-	for (String1 = sBuf, String2 = sBuf + iBufSz - 1; String2 > String1; ++String1, --String2)
-	{
-		*String1 ^= *String2;
-		*String2 ^= *String1;
-		*String1 ^= *String2;
-	}
-
-	return true;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::IsWhiteSpace(const char cChar)
-{
-	if (cChar == ' ' || cChar == '\r' || cChar == '\n' || cChar == '\t' || cChar == '\0')
-	{
-		return true;
-	}
-	return false;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::IsNumeric(const char cIn)
-{
-	return (cIn >= 48 && cIn <= 57);
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::IsNumeric(const char *sText, int iLength)
-{
-	int iRPos = 0;
-	bool bHasDecimal = false;
-
-	if (iLength == 0)
-	{
-		return false;
-	}
-
-	if (sText[iRPos] == '-' || sText[iRPos] == '+')
-	{
-		iRPos++;
-	}
-
-	for (; iRPos < iLength; iRPos++)
-	{
-		if (!IsNumeric(sText[iRPos]))
-		{
-			if (sText[iRPos] == '.')
-			{
-				if (iRPos == iLength - 1) //Decimal cannot be the last character.
-				{
-					return false;
-				}
-				if (iRPos == 0 || (iRPos == 1 && sText[0] == '-')) //Decimal cannot be the first character.
-				{
-					return false;
-				}
-
-
-				if (bHasDecimal)
-				{
-					return false;
-				}
-				bHasDecimal = true;
-			}
-			else {
-				return false;
-			}
-		}
-	}
-
-	return true;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool CMathParser::IsNumeric(const char *sText)
-{
-	return IsNumeric(sText, (int)strlen(sText));
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int CMathParser::InStr(const char *sSearchFor, const char *sInBuf, const int iBufSz, const int iStartPos)
-{
-	int iLookingLoop = 0;
-
-	if (iStartPos > iBufSz)
-	{
-		return -2;
-	}
-	int sSearchForSz = (int)strlen(sSearchFor);
-	if (sSearchForSz > iBufSz)
-	{
-		return -2;
-	}
-
-	for (int iControlLoop = iStartPos; iControlLoop <= (iBufSz - sSearchForSz); iControlLoop++)
-	{
-		if (sInBuf[iControlLoop] == sSearchFor[iLookingLoop])
-		{
-			while (iLookingLoop <= sSearchForSz)
-			{
-				if (sSearchFor[iLookingLoop] == sInBuf[iLookingLoop + iControlLoop])
-				{
-					iLookingLoop++;
-				}
-				else iLookingLoop = sSearchForSz + 1;
-
-				if (iLookingLoop == sSearchForSz)
-				{
-					return iControlLoop;
-				}
-			}
-		}
-		iLookingLoop = 0;
-	}
-
-	return -1;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-int CMathParser::ModPow(long long base, long long exponent, int modulus)
-{
-	long long result = 1;
-	while (exponent > 0)
-	{
-		if (exponent % 2 == 1)
-		{
-			result = (result * base) % modulus;
-		}
-		exponent = exponent >> 1;
-		base = (base * base) % modulus;
-	}
-	return (int)result;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#endif
+#ifndef _CMathParser_CPP
+#define _CMathParser_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include "CMathParser.h"
+#include "CMathExpression.h"
+#include "CMathLexer.h"
+#include "CMathVector.h"
+#include "CMathThreadPool.h"
+#include "CMathCache.h"
+#include "CMathVariables.h"
+#include "CMathArena.h"
+#include "CMathContext.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//using namespace NSWFL::String;
+
+#ifndef _CVTBUFSIZE
+#define _CVTBUFSIZE (309+40) /* Number of digits in maximum double precision value + slop */
+#endif
+
+//Locks of the thread pool used by a multi-threaded EvaluateBatch().
+#define MATHPARSER_LOCK_CALLBACKS 0
+#define MATHPARSER_LOCK_ERRORS    1
+
+//Identity given to the next parser, see CalculateCached().
+static std::atomic<unsigned int> iNextCacheIdentity(0);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Built-in methods, in the order of CMathParser::MathMethod.
+const char* sNativeMethods[] =
+{
+	"NOT",
+	"ACOS",
+	"ASIN",
+	"ATAN",
+	"ATAN2",
+	"LDEXP",
+	"TAN",
+	"SIN",
+	"COS",
+	"ABS",
+	"SQRT",
+	"POW",
+	"MODPOW",
+	"SINH",
+	"COSH",
+	"TANH",
+	"LOG",
+	"LOG10",
+	"EXP",
+	"FLOOR",
+	"CEIL",
+	"SUM",
+	"AVG",
+	NULL
+};
+
+//Minimum and maximum number of parameters of each built-in method, in the order of CMathParser::MathMethod (-1 for
+//	no limit).
+const int iNativeMethodArity[][2] =
+{
+	{ 1, 1 },  //NOT
+	{ 1, 1 },  //ACOS
+	{ 1, 1 },  //ASIN
+	{ 1, 1 },  //ATAN
+	{ 2, 2 },  //ATAN2
+	{ 2, 2 },  //LDEXP
+	{ 1, 1 },  //TAN
+	{ 1, 1 },  //SIN
+	{ 1, 1 },  //COS
+	{ 1, 1 },  //ABS
+	{ 1, 1 },  //SQRT
+	{ 2, 2 },  //POW
+	{ 3, 3 },  //MODPOW
+	{ 1, 1 },  //SINH
+	{ 1, 1 },  //COSH
+	{ 1, 1 },  //TANH
+	{ 1, 1 },  //LOG
+	{ 1, 1 },  //LOG10
+	{ 1, 1 },  //EXP
+	{ 1, 1 },  //FLOOR
+	{ 1, 1 },  //CEIL
+	{ 1, -1 }, //SUM
+	{ 1, -1 }  //AVG
+};
+
+//Perfect hash of the built-in method names: the slot of a name is NATIVE_METHOD_SLOT() and each slot holds the
+//	index into sNativeMethods of the only name which hashes to it (-1 if none does). The multipliers were found by
+//	trying small values until every name landed in its own slot, they have to be searched for again (and the table
+//	regenerated) whenever a method is added.
+#define NATIVE_METHOD_MIN_LENGTH 3
+#define NATIVE_METHOD_MAX_LENGTH 6
+#define NATIVE_METHOD_SLOT(sName, iLength) \
+	((((sName)[0] & 0xDF) * 2 + ((sName)[1] & 0xDF) + ((sName)[(iLength) - 1] & 0xDF) * 11 + (iLength)) & 63)
+
+const int iNativeMethodSlots[64] =
+{
+	-1, -1, -1, -1, -1, 15,  6, -1, -1, -1,  0, 13,  7, 21, -1, -1,
+	-1,  5, -1, 20, -1, 18, -1, 10,  9, -1,  1, -1, 17, -1, -1, -1,
+	-1,  4, -1, 19, -1, -1, -1, -1, 22,  8, -1, -1, 12, -1, -1, 11,
+	-1, 14, -1,  2,  3, -1, -1, 16, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+const char *sPreOrder[] =
+{
+	"!",  //Logical NOT
+	NULL
+};
+
+const char *sFirstOrder[] =
+{
+	"~",  //Bitwise NOT
+	"*",  //Multiplication
+	"/",  //Division
+	"%",  //Modulation
+	NULL
+};
+
+const char *sSecondOrder[] =
+{
+	"+",  //Addition
+	"-",  //Subtraction
+	NULL
+};
+
+const char *sThirdOrder[] =
+{
+	"<>", //Logical Not Equal
+	"|=", //Bitwise Or Equal
+	"&=", //Bitwise And Equal
+	"^=", //Bitwise XOR Equal
+	"<=", //Logical Less or Equal
+	">=", //Logical Greater or Equal
+	"!=", //Logical Not Equal
+
+	"<<", //Bitwise Left Shift
+	">>", //Bitwise Right Shift
+
+	"=",  //Logical Equals
+	">",  //Logical Greater Than
+	"<",  //Logical Less Than
+
+	"&&", //Logical AND
+	"||", //Logical OR
+
+	"|",  //Bitwise OR
+	"&",  //Bitwise AND
+	"^",  //Exclusive OR
+
+	NULL
+};
+
+//Text of each CMathParser::MathOperator, for error messages.
+const char *sOperatorText[] =
+{
+	"",
+	"!",
+	"~",
+	"*",
+	"/",
+	"%",
+	"+",
+	"-",
+	"!=", //Also written "<>", the two spellings are aliases of OperatorNotEqual.
+	"|=",
+	"&=",
+	"^=",
+	"<=",
+	">=",
+	"<<",
+	">>",
+	"=",
+	">",
+	"<",
+	"&&",
+	"||",
+	"|",
+	"&",
+	"^"
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether the identifier is a built-in function.
+/// </summary>
+/// <param name="sName"></param>
+/// <returns></returns>
+bool CMathParser::IsNativeMethod(const char* sName)
+{
+	return this->GetNativeMethod(sName) != MethodUnknown;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Identifies a built-in function by name (case insensitive) with a single lookup in the perfect hash table, so that
+///	every built-in function takes the same time to find.
+/// </summary>
+/// <param name="sName"></param>
+/// <returns>MethodUnknown if the identifier is not a built-in function.</returns>
+CMathParser::MathMethod CMathParser::GetNativeMethod(const char* sName)
+{
+	int iLength = 0;
+	while (sName[iLength] != '\0' && iLength <= NATIVE_METHOD_MAX_LENGTH)
+	{
+		iLength++;
+	}
+
+	if (iLength < NATIVE_METHOD_MIN_LENGTH || iLength > NATIVE_METHOD_MAX_LENGTH)
+	{
+		return MethodUnknown;
+	}
+
+	int iMethod = iNativeMethodSlots[NATIVE_METHOD_SLOT(sName, iLength)];
+
+	if (iMethod >= 0 && _strcmpi(sNativeMethods[iMethod], sName) == 0)
+	{
+		return (MathMethod)iMethod;
+	}
+
+	return MethodUnknown;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether a built-in function accepts the given number of parameters.
+/// </summary>
+/// <param name="Method"></param>
+/// <param name="iParamCount"></param>
+/// <returns></returns>
+bool CMathParser::IsValidParamCount(MathMethod Method, int iParamCount)
+{
+	return iParamCount >= iNativeMethodArity[Method][0]
+		&& (iNativeMethodArity[Method][1] < 0 || iParamCount <= iNativeMethodArity[Method][1]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Finds a function added by RegisterFunction() by name (case insensitive).
+/// </summary>
+/// <param name="sName"></param>
+/// <returns>The index of the function, -1 if no function of that name was registered.</returns>
+int CMathParser::GetFunction(const char* sName)
+{
+	for (int i = 0; i < this->iFunctionCount; i++)
+	{
+		if (_strcmpi(this->Functions[i].Name, sName) == 0)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CMathParser::TrailingChars(const char *sVal, int iStartPos, const char cChar)
+{
+	for (int i = iStartPos; i > 0; i--)
+	{
+		if (sVal[i] != cChar)
+		{
+			return iStartPos - i;
+		}
+	}
+
+	return iStartPos;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CMathParser::SmartRound(double dValue, char *sOut, int iMaxOutSz)
+{
+	char sVal[_CVTBUFSIZE * 2];
+	char sFormat[32];
+	int iValLen = this->DoubleToChar(dValue, sVal, sizeof(sVal));
+	if (iValLen < 0)
+	{
+		return -1;
+	}
+	int iDecPos = InStr(".", sVal, iValLen, 0);
+
+	if (iDecPos < 0)
+	{
+		return sprintf_s(sOut, iMaxOutSz, "%.0f", dValue);
+	}
+
+	//Detect long trail before last number (ex: 3.14000000000000000001).
+	if (sVal[iValLen - 1] != sVal[iValLen - 2])
+	{
+		int iTrailPos = iValLen - 2;
+		int iTrailAfterLastNumber = 0;
+		while (sVal[iTrailPos] == sVal[iValLen - 2])
+		{
+			iTrailPos--;
+			iTrailAfterLastNumber++;
+		}
+		if (iTrailAfterLastNumber >= 3)
+		{
+			sVal[iValLen - 1] = '\0'; //Truncate last number;
+		}
+	}
+
+	//Detect trailing 9's (ex: 3.99999999999999999).
+	int iNines = this->TrailingChars(sVal, iValLen - 1, '9');
+	if (iNines > 8)
+	{
+		int iRoundTo = (iValLen - iNines) - (iDecPos + 1);
+		sprintf_s(sFormat, sizeof(sFormat), "%%.%df", iRoundTo);
+		sprintf_s(sOut, iMaxOutSz, sFormat, dValue);
+	}
+	else {
+		//Detect trailing 0's (ex: 3.0000000000000).
+		int iZeros = TrailingChars(sVal, iValLen - 2, '0');
+		if (iZeros > 4)
+		{
+			int iRoundTo = (iValLen - iZeros) - (iDecPos + 2);
+			sprintf_s(sFormat, sizeof(sFormat), "%%.%df", iRoundTo);
+			sprintf_s(sOut, iMaxOutSz, sFormat, dValue);
+		}
+		else {
+			strcpy_s(sOut, iMaxOutSz, sVal);
+		}
+	}
+
+	int iSz = (int)strlen(sOut);
+
+	//Remove any remaining 0's after conversion.
+	if (sOut[iSz - 1] == '0')
+	{
+		iSz--;
+		while (sOut[iSz] == '0')
+		{
+			iSz--;
+		}
+
+		if (sOut[iSz] == '.')
+		{
+			iSz--;
+		}
+
+		iSz++;
+	}
+
+	sOut[iSz] = '\0';
+
+	return iSz;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Converts a double floating point to a string.
+/// </summary>
+/// <param name="dVal"></param>
+/// <param name="sOut"></param>
+/// <param name="iMaxOutSz"></param>
+/// <returns></returns>
+int CMathParser::DoubleToChar(double dVal, char *sOut, int iMaxOutSz)
+{
+	int iSigned = 0;
+	int iDecPos = 0;
+	int iWPos = 0;
+	int iValLen = 0;
+
+	if (dVal == 0)
+	{
+		strcpy_s(sOut, iMaxOutSz, "0");
+		return 1;
+	}
+
+	char sVal[_CVTBUFSIZE * 2];
+	if (_fcvt_s(sVal, sizeof(sVal), dVal, this->ciPrecision, &iDecPos, &iSigned) != 0)
+	{
+		return -1;
+	}
+
+	iValLen = (int)strlen(sVal);
+
+	if (iSigned)
+	{
+		sOut[iWPos++] = '-';
+	}
+
+	if (iDecPos <= 0)
+	{
+		sOut[iWPos++] = '0';
+		sOut[iWPos++] = '.';
+		while (iDecPos < 0)
+		{
+			sOut[iWPos++] = '0';
+			iDecPos++;
+		}
+		iDecPos = -1;
+	}
+
+	for (int iRPos = 0; iRPos < iValLen; iRPos++)
+	{
+		if (iRPos == iDecPos)
+		{
+			sOut[iWPos++] = '.';
+		}
+		sOut[iWPos++] = sVal[iRPos];
+	}
+
+	if (sOut[iWPos - 1] == '0')
+	{
+		iWPos--;
+		while (iWPos > 2 && sOut[iWPos] == '0' && sOut[iWPos - 1] != '.')
+		{
+			iWPos--;
+		}
+
+		if (sOut[iWPos] == '.')
+		{
+			iWPos--;
+		}
+
+		iWPos++;
+	}
+
+	sOut[iWPos] = '\0';
+
+	return iWPos;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Gets the number to the left of an operator.
+/// </summary>
+/// <param name="pExp"></param>
+/// <param name="iStartPos"></param>
+/// <param name="sOutVal"></param>
+/// <param name="iMaxSz"></param>
+/// <param name="iOutSz"></param>
+/// <param name="iBegin"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::GetLeftNumber(MATHEXPRESSION *pExp, int iStartPos, char *sOutVal, int iMaxSz, int *iOutSz, int *iBegin)
+{
+	int iRPos = (iStartPos - 1);
+	int iWPos = 0;
+
+	iMaxSz--;
+
+	while (iRPos >= 0 && iWPos < iMaxSz)
+	{
+		if (this->IsMathChar(pExp->Text[iRPos]))
+		{
+			if ((pExp->Text[iRPos] == '-' || pExp->Text[iRPos] == '+'))
+			{
+				if (iRPos > 0)
+				{
+					if (!this->IsMathChar(pExp->Text[iRPos - 1]))
+					{
+						break;
+					}
+				}
+				else {
+					//Negative or Positive number is explicitly defined.
+				}
+			}
+			else {
+				break;
+			}
+		}
+		else if (!IsNumeric(pExp->Text[iRPos]) && pExp->Text[iRPos] != '.')
+		{
+			return this->SetError(ResultInvalidToken, "Token is invalid: %c", pExp->Text[iRPos]);
+		}
+
+		sOutVal[iWPos++] = pExp->Text[iRPos--];
+	}
+
+	sOutVal[iWPos] = '\0';
+
+	ReverseString(sOutVal, iWPos);
+
+	*iOutSz = iWPos;
+	*iBegin = (iRPos + 1);
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Gets the number to the right of an operator.
+/// </summary>
+/// <param name="pExp"></param>
+/// <param name="iStartPos"></param>
+/// <param name="sOutVal"></param>
+/// <param name="iMaxSz"></param>
+/// <param name="iOutSz"></param>
+/// <param name="iEnd"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::GetRightNumber(MATHEXPRESSION *pExp, int iStartPos, char *sOutVal, int iMaxSz, int *iOutSz, int *iEnd)
+{
+	int iRPos = iStartPos;
+	int iWPos = 0;
+
+	iMaxSz--;
+
+	while (iRPos < pExp->Length && iWPos < iMaxSz)
+	{
+		if (this->IsMathChar(pExp->Text[iRPos]))
+		{
+			if ((pExp->Text[iRPos] == '-' || pExp->Text[iRPos] == '+') && iRPos < pExp->Length)
+			{
+				if (!this->IsMathChar(pExp->Text[iRPos - 1]))
+				{
+					break;
+				}
+			}
+			else {
+				break;
+			}
+		}
+		else if (!IsNumeric(pExp->Text[iRPos]) && pExp->Text[iRPos] != '.')
+		{
+			return this->SetError(ResultInvalidToken, "Token is invalid: %c", pExp->Text[iRPos]);
+		}
+
+		sOutVal[iWPos++] = pExp->Text[iRPos++];
+	}
+
+	sOutVal[iWPos] = '\0';
+
+	*iOutSz = iWPos;
+	*iEnd = iRPos;
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Parses a single operation.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="pExp"></param>
+/// <param name="sOp"></param>
+/// <param name="iOpPos"></param>
+/// <param name="iOpSz"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::ParseOperator(MATHINSTANCE *pInst, MATHEXPRESSION *pExp, const char *sOp, int iOpPos, int iOpSz)
+{
+	char sVal[_CVTBUFSIZE];
+	char sVal1[_CVTBUFSIZE];
+	char sVal2[_CVTBUFSIZE];
+	int iValSz = 0;
+
+	MathResult ErrorCode = ResultOk;
+
+	int iBegin = 0;
+	int iEnd = 0;
+
+	MathOperator Operator = this->GetOperator(sOp);
+
+	if ((ErrorCode = this->GetLeftNumber(pExp, iOpPos, sVal1, sizeof(sVal1), &iValSz, &iBegin)) != ResultOk)
+	{
+		return ErrorCode;
+	}
+	if (iValSz > 0)
+	{
+		if ((ErrorCode = this->GetRightNumber(pExp, iOpPos + iOpSz, sVal2, sizeof(sVal2), &iValSz, &iEnd)) != ResultOk)
+		{
+			return ErrorCode;
+		}
+		if (iValSz > 0)
+		{
+			if (pInst->ForceIntegerMath)
+			{
+				double dLeft = atof(sVal1);
+				double dRight = atof(sVal2);
+
+				if(pInst->ForceUnsignedMath)
+				{
+					if (dLeft < 0 || dRight < 0)
+					{
+						return this->SetError(ResultMissingOperator, "Unsigned integer underflow.");
+					}
+					else if (dLeft > UINT_MAX || dRight > UINT_MAX)
+					{
+						return this->SetError(ResultMissingOperator, "unsigned integer overflow.");
+					}
+				}
+				else
+				{
+					if (dLeft < INT_MIN || dRight < INT_MIN)
+					{
+						return this->SetError(ResultIntegerunderflow, "Integer underflow.");
+					}
+					else if (dLeft > INT_MAX || dRight > INT_MAX)
+					{
+						return this->SetError(ResultIntegerOverflow, "Integer overflow.");
+					}
+				}
+
+				if ((ErrorCode = this->PerformDoubleOperation(pInst, atol(sVal1), Operator, atol(sVal2))) != ResultOk)
+				{
+					return ErrorCode;
+				}
+
+				if (pInst->RunningTotal < INT_MIN)
+				{
+					return this->SetError(ResultIntegerunderflow, "Integer underflow.");
+				}
+				else if (pInst->RunningTotal > INT_MAX)
+				{
+					return this->SetError(ResultIntegerOverflow, "Integer overflow.");
+				}
+
+				if (_itoa_s((int)pInst->RunningTotal, sVal, sizeof(sVal), 10) != 0)
+				{
+					return this->SetError(ResultIntegerTextConversionFailed, "Integer->Text converion failed.");
+				}
+			}
+			else {
+				if ((ErrorCode = this->PerformDoubleOperation(pInst, atof(sVal1), Operator, atof(sVal2))) != ResultOk)
+				{
+					return ErrorCode;
+				}
+
+				if (this->DoubleToChar(pInst->RunningTotal, sVal, sizeof(sVal)) <= 0)
+				{
+					return this->SetError(ResultDoubleTextConversionFailed, "Text->Double converion failed.");
+				}
+			}
+
+			iValSz = (int)strlen(sVal);
+
+			if (sVal[iValSz - 1] == '.')
+			{
+				iValSz--;
+				sVal[iValSz] = '\0';
+			}
+
+			if (this->cbDebugMode)
+			{
+				char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
+
+				if (pInst->ForceIntegerMath)
+				{
+					sprintf_s(sDebugMath, sizeof(sDebugMath), "\t(%s %s %s) = %s\n", sVal1, sOp, sVal2, sVal);
+
+					if (this->pDebugProc)
+					{
+						this->pDebugProc(this, sDebugMath);
+					}
+					else {
+						printf("%s", sDebugMath);
+					}
+				}
+				else {
+					sprintf_s(sDebugMath, sizeof(sDebugMath), "\t(%.4f %s %.4f) = %.4f\n", atof(sVal1), sOp, atof(sVal2), atof(sVal));
+
+					if (this->pDebugProc)
+					{
+						this->pDebugProc(this, sDebugMath);
+					}
+					else {
+						printf("%s", sDebugMath);
+					}
+				}
+			}
+
+			if ((ErrorCode = this->ReplaceValue(pExp, iBegin, iEnd, sVal, iValSz)) != ResultOk)
+			{
+				return ErrorCode;
+			}
+		}
+		else {
+			return this->SetError(ResultRightValueFailed, "Value to the right of operator is missing or invalid.");
+		}
+	}
+	else {
+		if (Operator == OperatorNot || Operator == OperatorBitwiseNot)
+		{
+			if ((ErrorCode = this->GetRightNumber(pExp, iOpPos + iOpSz, sVal2, sizeof(sVal2), &iValSz, &iEnd)) != ResultOk)
+			{
+				return ErrorCode;
+			}
+
+			if (iValSz > 0)
+			{
+				if (Operator == OperatorNot)
+				{
+					if ((ErrorCode = this->PerformBooleanOperation(pInst, atol(sVal2), Operator)) != ResultOk)
+					{
+						return ErrorCode;
+					}
+				}
+				else if (Operator == OperatorBitwiseNot)
+				{
+					if ((ErrorCode = this->PerformIntOperation(pInst, atol(sVal2), Operator, 0)) != ResultOk)
+					{
+						return ErrorCode;
+					}
+				}
+				else {
+					return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", sOp);
+				}
+
+				if (_itoa_s((int)pInst->RunningTotal, sVal, sizeof(sVal), 10) != 0)
+				{
+					return this->SetError(ResultIntegerTextConversionFailed, "Integer to text conversion failed.");
+				}
+
+				iValSz = (int)strlen(sVal);
+
+				if (this->cbDebugMode)
+				{
+					char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
+					sprintf_s(sDebugMath, sizeof(sDebugMath), "\t%s%s%s = %s\n", sVal1, sOp, sVal2, sVal);
+
+					if (this->pDebugProc)
+					{
+						this->pDebugProc(this, sDebugMath);
+					}
+					else {
+						printf("%s", sDebugMath);
+					}
+				}
+
+				if ((ErrorCode = this->ReplaceValue(pExp, iBegin, iEnd, sVal, iValSz)) != ResultOk)
+				{
+					return ErrorCode;
+				}
+			}
+			else {
+				return this->SetError(ResultRightValueFailed, "Value to the right of operator is missing or invalid.");
+			}
+		}
+		else if (Operator == OperatorSubtract)
+		{
+			return ResultFoundNegative;
+		}
+		else {
+			return this->SetError(ResultInvalidToken, "Invalid token: %s", sOp);
+		}
+	}
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the position of a free-standing not operator.
+/// </summary>
+/// <param name="pExp"></param>
+/// <returns></returns>
+int CMathParser::GetFreestandingNotOperation(MATHEXPRESSION *pExp) //Pre order.
+{
+	for (int iRPos = 0; iRPos < pExp->Length; iRPos++)
+	{
+		//Make sure we have a "!' and not a "!=", these two have to be handled in different places.
+		if (pExp->Text[iRPos] == '!' && (iRPos + 1 < pExp->Length) && pExp->Text[iRPos + 1] != '=')
+		{
+			/*
+			//This is used to enforce the order of NOT expressions.
+			for(int iTmpRPos = iRPos + 1; iRPos < pExp->Length; iTmpRPos++)
+			{
+				if(!IsNumeric(pExp->Text[iTmpRPos]))
+				{
+					if(pExp->Text[iTmpRPos] != '(')
+					{
+						iRPos = iTmpRPos;
+						break;
+					}
+				}
+			}
+
+			if(pExp->Text[iRPos] == '~' || pExp->Text[iRPos] == '!')
+			{
+				return iRPos;
+			}
+			*/
+			return iRPos;
+		}
+	}
+	return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the first position of a first-order operation.
+/// </summary>
+/// <param name="pExp"></param>
+/// <returns></returns>
+int CMathParser::GetFirstOrderOperation(MATHEXPRESSION *pExp) //First order.
+{
+	for (int iRPos = 1; iRPos < pExp->Length; iRPos++)
+	{
+		if (pExp->Text[iRPos] == '*' || pExp->Text[iRPos] == '/' || pExp->Text[iRPos] == '%' || pExp->Text[iRPos] == '~')
+		{
+
+			return iRPos;
+		}
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the first position of a second-order operation.
+/// </summary>
+/// <param name="pExp"></param>
+/// <param name="iStartPos"></param>
+/// <returns></returns>
+int CMathParser::GetSecondOrderOperation(MATHEXPRESSION *pExp, int iStartPos) //Second order.
+{
+	for (int iRPos = iStartPos; iRPos < pExp->Length; iRPos++)
+	{
+		if (pExp->Text[iRPos] == '-' || pExp->Text[iRPos] == '+')
+		{
+			return iRPos;
+		}
+	}
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::CalculateSimpleExpression(MATHINSTANCE *pInst, MATHEXPRESSION *pSubExp)
+{
+	MathResult ErrorCode = ResultOk;
+
+	int iDivPos = 0;
+	int iOpPos = 0;
+	int iOpSz = 0;
+
+	char *sOp = NULL;
+
+	int iRPos = 0;
+	int iWPos = 0;
+
+	int iBegin = 0;
+	int iEnd = 0;
+
+	int iOperator = 0;
+
+	pInst->RunningTotal = 0;
+
+	//Pre Order.
+	while ((iOpPos = this->GetFreestandingNotOperation(pSubExp)) >= 0)
+	{
+		iOpSz = 1;
+
+		if (pSubExp->Text[iOpPos] == '!')
+		{
+			sOp = "!";
+		}
+		else {
+			return this->SetError(ResultInvalidOperator, "Invalid operator: %c.", pSubExp->Text[iOpPos]);
+		}
+
+		if ((ErrorCode = this->ParseOperator(pInst, pSubExp, sOp, iOpPos, iOpSz)) != ResultOk)
+		{
+			return ErrorCode;
+		}
+	}
+
+	//First Order.
+	while ((iOpPos = this->GetFirstOrderOperation(pSubExp)) > 0)
+	{
+		iOpSz = 1;
+
+		if (pSubExp->Text[iOpPos] == '*') {
+			sOp = "*";
+		}
+		else if (pSubExp->Text[iOpPos] == '/') {
+			sOp = "/";
+		}
+		else if (pSubExp->Text[iOpPos] == '%') {
+			sOp = "%";
+		}
+		else if (pSubExp->Text[iOpPos] == '~') {
+			sOp = "~";
+		}
+		/*
+		else if(pSubExp->Text[iOpPos] == '!'){
+			sOp = "!";
+		}
+		*/
+		else {
+			return this->SetError(ResultInvalidOperator, "Invalid operator: %c.", pSubExp->Text[iOpPos]);
+		}
+
+		if ((ErrorCode = this->ParseOperator(pInst, pSubExp, sOp, iOpPos, iOpSz)) != ResultOk)
+		{
+			return ErrorCode;
+		}
+	}
+
+	int iStartPos = 1;
+
+	//Second Order.
+	while ((iOpPos = this->GetSecondOrderOperation(pSubExp, iStartPos)) > 0)
+	{
+		iOpSz = 1;
+
+		if (pSubExp->Text[iOpPos] == '-') {
+			sOp = "-";
+		}
+		else if (pSubExp->Text[iOpPos] == '+') {
+			sOp = "+";
+		}
+		else {
+			return this->SetError(ResultInvalidOperator, "Invalid operator: %c.", pSubExp->Text[iOpPos]);
+		}
+
+		if ((ErrorCode = this->ParseOperator(pInst, pSubExp, sOp, iOpPos, iOpSz)) != ResultOk)
+		{
+			if (ErrorCode == ResultFoundNegative)
+			{
+				iStartPos = iOpPos + 1;
+			}
+			else {
+				return ErrorCode;
+			}
+		}
+	}
+
+	for (iOperator = 0; sThirdOrder[iOperator]; iOperator++)
+	{
+		iOpSz = (int)strlen(sThirdOrder[iOperator]);
+
+		while ((iOpPos = InStr(sThirdOrder[iOperator], pSubExp->Text, pSubExp->Length, 0)) > 0)
+		{
+			if ((ErrorCode = this->ParseOperator(pInst, pSubExp, sThirdOrder[iOperator], iOpPos, iOpSz)) != ResultOk)
+			{
+				return ErrorCode;
+			}
+		}
+	}
+
+	if (IsNumeric(pSubExp->Text))
+	{
+		pInst->RunningTotal = atof(pSubExp->Text);
+
+		if (pInst->ForceIntegerMath)
+		{
+			if(pInst->ForceUnsignedMath)
+			{
+				if (pInst->RunningTotal < 0)
+				{
+					return this->SetError(ResultMissingOperator, "Unsigned integer underflow.");
+				}
+				else if (pInst->RunningTotal > UINT_MAX)
+				{
+					return this->SetError(ResultMissingOperator, "unsigned integer overflow.");
+				}
+				pInst->RunningTotal = (unsigned int)pInst->RunningTotal;
+			}
+			else
+			{
+				if (pInst->RunningTotal < INT_MIN)
+				{
+					return this->SetError(ResultMissingOperator, "Signed integer underflow.");
+				}
+				else if (pInst->RunningTotal > INT_MAX)
+				{
+					return this->SetError(ResultMissingOperator, "Signed integer overflow.");
+				}
+				pInst->RunningTotal = (int)pInst->RunningTotal;
+			}
+		}
+	}
+	else if (pSubExp->Text[0] == '!' && IsNumeric(pSubExp->Text + 1))
+	{
+		if (this->cbDebugMode)
+		{
+			char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
+			sprintf_s(sDebugMath, sizeof(sDebugMath), "\t%s = %.4f\n", pSubExp->Text, pInst->RunningTotal);
+
+			if (this->pDebugProc)
+			{
+				this->pDebugProc(this, sDebugMath);
+			}
+			else {
+				printf("%s", sDebugMath);
+			}
+		}
+
+		if ((ErrorCode = this->PerformBooleanOperation(pInst, atol(pSubExp->Text + 1), OperatorNot)) != ResultOk)
+		{
+			return ErrorCode;
+		}
+	}
+	else if (pSubExp->Text[0] == '~' && IsNumeric(pSubExp->Text + 1))
+	{
+		if (this->cbDebugMode)
+		{
+			char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
+			sprintf_s(sDebugMath, sizeof(sDebugMath), "\t%s = %.4f\n", pSubExp->Text, pInst->RunningTotal);
+
+			if (this->pDebugProc)
+			{
+				this->pDebugProc(this, sDebugMath);
+			}
+			else {
+				printf("%s", sDebugMath);
+			}
+		}
+
+		if ((ErrorCode = this->PerformIntOperation(pInst, atol(pSubExp->Text + 1), OperatorBitwiseNot, 0)) != ResultOk)
+		{
+			return ErrorCode;
+		}
+	}
+	else {
+		return this->SetError(ResultInvalidToken, "Invalid token: %c", pSubExp->Text[0]);
+	}
+
+	return ErrorCode;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Verifies that all parentheses have matches.
+/// </summary>
+/// <param name="sExpression"></param>
+/// <param name="iExpressionSz"></param>
+/// <returns></returns>
+int CMathParser::MatchParentheses(const char *sExpression, const int iExpressionSz)
+{
+	int iRPos = 0;
+	int iScope = 0;
+
+	while (iRPos < iExpressionSz)
+	{
+		if (sExpression[iRPos] == '(') {
+			iScope++;
+		}
+		else if (sExpression[iRPos] == ')') {
+			iScope--;
+		}
+		iRPos++;
+	}
+
+	return iScope;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Writes the value of a variable or of a method call into the expression text. The double overloads get it with a
+///	fixed precision of 8. The integer overloads get its integer part with every digit, so that values above 2^53 are
+///	read back exactly; negative values are put in parentheses so that the sign also applies after an operator.
+/// </summary>
+/// <param name="dValue"></param>
+/// <param name="bInteger"></param>
+/// <param name="sOut"></param>
+/// <param name="iMaxOutSz"></param>
+/// <param name="piOutSz">Receives the length of the text.</param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::FormatValue(double dValue, bool bInteger, char *sOut, int iMaxOutSz, int *piOutSz)
+{
+	if (!bInteger)
+	{
+		//Convert double to string (must be a faster way, but this is just super safe and doesn't create infinite repeating patterns).
+		//TODO: Fixed percision of 8 on variables seems inflexible.
+		*piOutSz = sprintf_s(sOut, iMaxOutSz, "%.8f", dValue);
+		return ResultOk;
+	}
+
+	if (!_finite(dValue))
+	{
+		return this->SetError(ResultInfiniteOrNotANumber, "Result is infinite or not a number.");
+	}
+
+	//2^64, the first magnitude which does not fit in an unsigned long long.
+	if (fabs(dValue) >= 18446744073709551616.0)
+	{
+		return (dValue < 0) ? this->SetError(ResultIntegerunderflow, "Integer underflow.")
+			: this->SetError(ResultIntegerOverflow, "Integer overflow.");
+	}
+
+	unsigned long long iMagnitude = (unsigned long long)fabs(dValue);
+
+	*piOutSz = (dValue <= -1) ? sprintf_s(sOut, iMaxOutSz, "(-%llu)", iMagnitude) : sprintf_s(sOut, iMaxOutSz, "%llu", iMagnitude);
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Copies the expression text without its whitespace, replacing each variable and method call with its value.
+/// </summary>
+/// <param name="pExp"></param>
+/// <param name="sSource"></param>
+/// <param name="iSourceSz"></param>
+/// <param name="bInteger">The values are written as integers for the integer overloads, see FormatValue().</param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::AllocateExpression(MATHEXPRESSION* pExp, const char* sSource, int iSourceSz, bool bInteger)
+{
+	pExp->Allocated = (int)iSourceSz + 1;
+
+	pExp->Text = (char*)this->pContext->pArena->Allocate(sizeof(char) * pExp->Allocated);
+	if (!pExp->Text)
+	{
+		return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	short LastChar = 0; // -1=Other 0=Not-Set 1=Numeric
+	bool bAfterWhiteSpace = false;
+
+	for (int iRPos = 0; iRPos < iSourceSz; iRPos++)
+	{
+		if (!IsWhiteSpace(sSource[iRPos]))
+		{
+			if (IsNumeric(sSource[iRPos]))
+			{
+				if (bAfterWhiteSpace)
+				{
+					if (LastChar != -1 && LastChar != 0)
+					{
+						return this->SetErrorAt(ResultInvalidToken, iRPos, "Token is invalid: %c", sSource[iRPos]);
+					}
+				}
+				LastChar = 1;
+			}
+			else if (this->IsValidChar(sSource[iRPos]))
+			{
+				LastChar = -1;
+			}
+			else if (this->IsValidVariableChar(sSource[iRPos]))
+			{
+				//Parse variable name.
+				char sVarName[CMATHPARSER_MAX_VAR_LENGTH + 1];
+
+				int iVarWPos = 0;
+
+				while (this->IsValidVariableChar(sSource[iRPos]))
+				{
+					sVarName[iVarWPos++] = sSource[iRPos++];
+					if (iVarWPos >= CMATHPARSER_MAX_VAR_LENGTH)
+					{
+						return this->SetError(ResultInvalidToken, "Variable length limit exceeded.");
+					}
+				}
+
+				sVarName[iVarWPos] = '\0';
+
+				//Skip whitespaces.
+				while( iRPos < iSourceSz && IsWhiteSpace(sSource[iRPos]))
+				{
+					iRPos++;
+				}
+
+				if (sSource[iRPos] == '(')
+				{
+					double* pOutParameters = NULL;
+					int iParameterCount = 0;
+
+					double dProcValue = 0;
+					MathResult result = ResultOk;
+
+					if ((result = ParseMethodParameters(sSource, iSourceSz, &iRPos, &pOutParameters, &iParameterCount)) != ResultOk)
+					{
+						return result;
+					}
+
+					MathMethod Method = this->GetNativeMethod(sVarName);
+					int iFunction = -1;
+
+					if (Method != MethodUnknown)
+					{
+						if ((result = ExecuteNativeMethod(Method, sVarName, pOutParameters, iParameterCount, &dProcValue)) != ResultOk)
+						{
+							return result;
+						}
+					}
+					else if ((iFunction = this->GetFunction(sVarName)) >= 0)
+					{
+						if ((result = ExecuteFunction(iFunction, pOutParameters, iParameterCount, &dProcValue)) != ResultOk)
+						{
+							return result;
+						}
+					}
+					else if (this->pMethodProc != NULL && this->pMethodProc(this, sVarName, pOutParameters, iParameterCount, &dProcValue))
+					{
+						//Non-native method executed successfully.
+					}
+					else
+					{
+						return this->SetError(ResultInvalidToken, "Undeclared identifier: %s.", sVarName);
+					}
+
+					char sVarValue[64];
+					int iVarValLength = 0;
+					if ((result = this->FormatValue(dProcValue, bInteger, sVarValue, sizeof(sVarValue), &iVarValLength)) != ResultOk)
+					{
+						return result;
+					}
+
+					if (pExp->Length + iVarValLength + iSourceSz >= pExp->Allocated)
+					{
+						//Adding [iSourceSz] so that the remainder of the expression can be stored without allocating again (unless we encounter more vars).
+						int iAllocated = (pExp->Length + iVarValLength) + iSourceSz + 1;
+						char *sText = (char*)this->pContext->pArena->Reallocate(pExp->Text, sizeof(char) * pExp->Allocated, sizeof(char) * iAllocated);
+						if (!sText)
+						{
+							return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+						}
+						pExp->Text = sText;
+						pExp->Allocated = iAllocated;
+					}
+
+					//Copy the resulting variable value to the expression for further processing.
+					strcpy_s(pExp->Text + pExp->Length, pExp->Allocated - pExp->Length, sVarValue);
+					pExp->Length += strlen(sVarValue);
+				}
+				else
+				{
+					double dVarValue = 0;
+					//Get variable value...
+					if (!this->GetVariableValue(sVarName, &dVarValue))
+					{
+						return this->SetError(ResultInvalidToken, "Variable was not defined: %s.", sVarName);
+					}
+
+					char sVarValue[64];
+					int iVarValLength = 0;
+					MathResult result = ResultOk;
+					if ((result = this->FormatValue(dVarValue, bInteger, sVarValue, sizeof(sVarValue), &iVarValLength)) != ResultOk)
+					{
+						return result;
+					}
+
+					if (pExp->Length + iVarValLength + iSourceSz >= pExp->Allocated)
+					{
+						//Adding [iSourceSz] so that the remainder of the expression can be stored without allocating again (unless we encounter more vars).
+						int iAllocated = (pExp->Length + iVarValLength) + iSourceSz + 1;
+						char *sText = (char*)this->pContext->pArena->Reallocate(pExp->Text, sizeof(char) * pExp->Allocated, sizeof(char) * iAllocated);
+						if (!sText)
+						{
+							return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+						}
+						pExp->Text = sText;
+						pExp->Allocated = iAllocated;
+					}
+
+					//Copy the resulting variable value to the expression for further processing.
+					strcpy_s(pExp->Text + pExp->Length, pExp->Allocated - pExp->Length, sVarValue);
+					pExp->Length += strlen(sVarValue);
+				}
+
+				iRPos--; //We need to let the outer loop determine if we are done yet.
+				continue;
+			}
+			else {
+				return this->SetErrorAt(ResultInvalidToken, iRPos, "Token is invalid: %c", sSource[iRPos]);
+			}
+
+			pExp->Text[pExp->Length++] = sSource[iRPos];
+
+			bAfterWhiteSpace = false;
+		}
+		else {
+			bAfterWhiteSpace = true;
+		}
+	}
+
+	pExp->Text[pExp->Length] = '\0';
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Takes a method name and its parameters, apples logic to the result of a single floating point value.
+/// </summary>
+/// <param name="Method">The method, as identified by GetNativeMethod().</param>
+/// <param name="sMethodName">The name as written in the expression, for error messages.</param>
+/// <param name="dParameters"></param>
+/// <param name="iParamCount"></param>
+/// <param name="pOutResult"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::ExecuteNativeMethod(
+	MathMethod Method, const char* sMethodName, double* dParameters, int iParamCount, double* pOutResult)
+{
+	if (Method == MethodUnknown)
+	{
+		return this->SetError(ResultInvalidToken, "Undeclared identifier: %s.", sMethodName);
+	}
+
+	if (!this->IsValidParamCount(Method, iParamCount))
+	{
+		return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", sMethodName);
+	}
+
+	MathResult ErrorCode = this->CheckNativeParameters(this->pContext, Method, dParameters);
+	if (ErrorCode == ResultOk)
+	{
+		*pOutResult = this->CallNativeMethod(Method, dParameters, iParamCount);
+	}
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Rejects the parameters a built-in method can not be applied to: MODPOW with a modulus of 0, which is reported
+///	like the % operator.
+/// </summary>
+CMathParser::MathResult CMathParser::CheckNativeParameters(CMathContext *pContext, MathMethod Method, const double* dParameters)
+{
+	if (Method == MethodModPow && (int)dParameters[2] == 0)
+	{
+		return this->SetError(pContext, ResultInvalidOperator, "Mod by zero.");
+	}
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Applies a built-in method to parameters which are already known to be valid for it (see IsValidParamCount()),
+///	compiled expressions check the number of parameters once when they are compiled.
+/// </summary>
+/// <param name="Method"></param>
+/// <param name="dParameters"></param>
+/// <param name="iParamCount"></param>
+/// <returns></returns>
+double CMathParser::CallNativeMethod(MathMethod Method, const double* dParameters, int iParamCount)
+{
+	switch (Method)
+	{
+	case MethodNot:
+		return !((long long)dParameters[0]);
+	case MethodAcos:
+		return acos(dParameters[0]);
+	case MethodAsin:
+		return asin(dParameters[0]);
+	case MethodAtan:
+		return atan(dParameters[0]);
+	case MethodAtan2:
+		return atan2(dParameters[0], dParameters[1]);
+	case MethodLdexp:
+		return ldexp(dParameters[0], (int)dParameters[1]);
+	case MethodTan:
+		return tan(dParameters[0]);
+	case MethodSin:
+		return sin(dParameters[0]);
+	case MethodCos:
+		return cos(dParameters[0]);
+	case MethodAbs:
+		return fabs(dParameters[0]);
+	case MethodSqrt:
+		return sqrt(dParameters[0]);
+	case MethodPow:
+		return pow(dParameters[0], dParameters[1]);
+	case MethodModPow:
+		return this->ModPow((long long)dParameters[0], (long long)dParameters[1], (int)dParameters[2]);
+	case MethodSinh:
+		return sinh(dParameters[0]);
+	case MethodCosh:
+		return cosh(dParameters[0]);
+	case MethodTanh:
+		return tanh(dParameters[0]);
+	case MethodLog:
+		return log(dParameters[0]);
+	case MethodLog10:
+		return log10(dParameters[0]);
+	case MethodExp:
+		return exp(dParameters[0]);
+	case MethodFloor:
+		return floor(dParameters[0]);
+	case MethodCeil:
+		return ceil(dParameters[0]);
+	case MethodSum:
+	case MethodAvg:
+	{
+		double dSum = 0;
+
+		for (int i = 0; i < iParamCount; i++)
+		{
+			dSum += dParameters[i];
+		}
+
+		if (Method == MethodAvg)
+		{
+			dSum /= iParamCount;
+		}
+
+		return dSum;
+	}
+	default:
+		return 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Calls a function added by RegisterFunction(), checking the number of parameters for the text based evaluator
+///	(compiled expressions check it once when they are compiled).
+/// </summary>
+/// <param name="iFunction">Index returned by GetFunction().</param>
+/// <param name="dParameters"></param>
+/// <param name="iParamCount"></param>
+/// <param name="pOutResult"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::ExecuteFunction(int iFunction, double* dParameters, int iParamCount, double* pOutResult)
+{
+	MATHFUNCTION *pFunction = &this->Functions[iFunction];
+
+	if (iParamCount < pFunction->MinArgs || (pFunction->MaxArgs >= 0 && iParamCount > pFunction->MaxArgs))
+	{
+		return this->SetError(ResultInvalidToken, "Invalid number of parameters passed to method: %s", pFunction->Name);
+	}
+
+	if (!pFunction->Proc(this, dParameters, iParamCount, pOutResult, pFunction->UserData))
+	{
+		return this->SetError(ResultFunctionFailed, "Function failed: %s.", pFunction->Name);
+	}
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::ParseMethodParameters(
+	const char* sSource, int iSourceSz, int* piRPos, double** pOutParameters, int *piOutParamCount)
+{
+	int iRPos = *piRPos;
+	int iWPos = 0;
+
+	int iParenNestLevel = 0;
+	int iParameters = 0;
+
+	char sBuf[1024];
+
+	if (sSource[iRPos] == '(')
+	{
+		iRPos++; //We skip the first paren because it encloses the currently parsing method.
+		iParenNestLevel++;
+	}
+
+	for (; iRPos < iSourceSz; iRPos++)
+	{
+		if (IsWhiteSpace(sSource[iRPos]))
+		{
+			continue;
+		}
+
+		if (sSource[iRPos] == '(')
+		{
+			sBuf[iWPos] = '\0';
+
+			MathMethod Method = this->GetNativeMethod(sBuf);
+
+			if (Method != MethodUnknown)
+			{
+				double* pOutParameters = NULL;
+				int iParameterCount = 0;
+
+				double dProcValue = 0;
+				MathResult result = ResultOk;
+
+				if ((result = ParseMethodParameters(sSource, iSourceSz, &iRPos, &pOutParameters, &iParameterCount)) != ResultOk)
+				{
+					return result;
+				}
+
+				if ((result = ExecuteNativeMethod(Method, sBuf, pOutParameters, iParameterCount, &dProcValue)) != ResultOk)
+				{
+					return result;
+				}
+
+				iRPos--; //Let this loop determine the next action.
+
+				memset(sBuf, 0, sizeof(sBuf));
+
+				iWPos = sprintf_s(sBuf, sizeof(sBuf), "%.8f", dProcValue);
+
+				continue;
+			}
+
+			iParenNestLevel++;
+		}
+		else if (sSource[iRPos] == ')')
+		{
+			iParenNestLevel--;
+		}
+
+		if (sSource[iRPos] == ',')
+		{
+
+		}
+		else if(iParenNestLevel > 0)
+		{
+			sBuf[iWPos++] = sSource[iRPos];
+		}
+
+		if (iParenNestLevel == 0 || sSource[iRPos] == ',')
+		{
+			double *pParameters = (double*)this->pContext->pArena->Reallocate(*pOutParameters, sizeof(double) * iParameters, sizeof(double) * (iParameters + 1));
+			if (!pParameters)
+			{
+				return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+			}
+			*pOutParameters = pParameters;
+
+			sBuf[iWPos] = '\0';
+			double dResult = 0;
+			this->Calculate(sBuf, &dResult);
+
+			(*pOutParameters)[iParameters] = dResult;
+
+			iParameters++;
+
+			if (sSource[iRPos] == ',')
+			{
+				iWPos = 0; //Reset for the next parameter.
+				memset(sBuf, 0, sizeof(sBuf));
+			}
+			else if (iParenNestLevel == 0)
+			{
+				iRPos++;
+				break;
+			}
+		}
+	}
+
+	if (iParenNestLevel != 0)
+	{
+		return this->SetError(ResultParenthesesMismatch, "Parentheses mismatch.");
+	}
+
+	*piOutParamCount = iParameters;
+	*piRPos = iRPos;
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::CalculateComplexExpression(MATHINSTANCE *pInst)
+{
+	char sVal[_CVTBUFSIZE];
+
+	int iBegin = 0;
+	int iEnd = 0;
+	int iValSz = 0;
+
+	MathResult ErrorCode = ResultOk;
+
+	MATHEXPRESSION SubExpr;
+	memset(&SubExpr, 0, sizeof(SubExpr));
+
+	//The integer overloads always go through the integer token stream, the text based evaluator works on doubles.
+	if (pInst->ForceIntegerMath)
+	{
+		return this->CalculateIntegerTokenStream(pInst);
+	}
+	else if (this->cbTokenizerMode && !this->cbDebugMode && this->CalculateTokenStream(pInst))
+	{
+		return ResultOk;
+	}
+
+	//Check braces to see if they each have a match.
+	if (this->MatchParentheses(pInst->Expression.Text, pInst->Expression.Length) != 0)
+	{
+		return this->SetError(ResultParenthesesMismatch, "Parentheses mismatch.");
+	}
+
+	SubExpr.Allocated = pInst->Expression.Length;;
+	SubExpr.Text = (char *)this->pContext->pArena->Allocate(sizeof(char) * SubExpr.Allocated);
+	if (!SubExpr.Text)
+	{
+		return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	while ((ErrorCode = this->GetSubExpression(pInst, &iBegin, &iEnd)) == ResultOk)
+	{
+		if (iEnd > iBegin)
+		{
+			SubExpr.Length = ((iEnd - iBegin) - 2);
+
+			if (SubExpr.Length >= SubExpr.Allocated)
+			{
+				int iAllocated = ((iEnd - iBegin) - 2) + 1;
+				char *sText = (char *)this->pContext->pArena->Reallocate(SubExpr.Text, SubExpr.Allocated, iAllocated);
+				if (!sText)
+				{
+					ErrorCode = this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+					break;
+				}
+				SubExpr.Text = sText;
+				SubExpr.Allocated = iAllocated;
+			}
+
+			memcpy_s(SubExpr.Text, SubExpr.Allocated, pInst->Expression.Text + (iBegin + 1), SubExpr.Length);
+			SubExpr.Text[SubExpr.Length] = '\0';
+
+			if ((ErrorCode = this->CalculateSimpleExpression(pInst, &SubExpr)) != ResultOk)
+			{
+				break;
+			}
+
+			if (pInst->ForceIntegerMath)
+			{
+				if (pInst->RunningTotal < INT_MIN)
+				{
+					ErrorCode = this->SetError(ResultMissingOperator, "Integer underflow.");
+					break;
+				}
+				else if (pInst->RunningTotal > INT_MAX)
+				{
+					ErrorCode = this->SetError(ResultMissingOperator, "Integer overflow.");
+					break;
+				}
+
+				if (_itoa_s((int)pInst->RunningTotal, sVal, sizeof(sVal), 10) != 0)
+				{
+					ErrorCode = this->SetError(ResultMissingOperator, "Integer->Text converion failed.");
+					break;
+				}
+			}
+			else {
+				sprintf_s(sVal, sizeof(sVal), "%.*g", this->ciPrecision, pInst->RunningTotal);
+				/*
+				if(_gcvt_s(sVal, sizeof(sVal), pInst->RunningTotal, this->ciPrecision) != 0)
+				{
+					ErrorCode = this->SetError(ResultMissingOperator, "Double->Text converion failed.");
+					break;
+				}
+				*/
+			}
+
+			iValSz = (int)strlen(sVal);
+
+			if (sVal[iValSz - 1] == '.')
+			{
+				iValSz--;
+				sVal[iValSz] = '\0';
+			}
+
+			if ((ErrorCode = this->ReplaceValue(&pInst->Expression, iBegin, iEnd, sVal, iValSz)) != ResultOk)
+			{
+				break;
+			}
+		}
+		else {
+			ErrorCode = this->CalculateSimpleExpression(pInst, &pInst->Expression);
+			break;
+		}
+	}
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates the expression text (as prepared by AllocateExpression) from a token stream in a single pass by
+///	precedence climbing, instead of rescanning and rewriting the text for every operator. The result is the same as
+///	that of the text based evaluator: intermediate values are rounded exactly as they would be when written back into
+///	the text. Forms whose meaning depends on how the text is rewritten (ex: "--1", "5*~3" or "(2)3") and all errors
+///	are left to the text based evaluator so that they are reported exactly as before.
+/// </summary>
+/// <param name="pInst"></param>
+/// <returns>False if the expression has to be evaluated by CalculateComplexExpression's text based evaluator.</returns>
+bool CMathParser::CalculateTokenStream(MATHINSTANCE *pInst)
+{
+	if (!this->pLexer)
+	{
+		this->pLexer = new CMathLexer(this);
+	}
+
+	if (!this->pLexer->Tokenize(pInst->Expression.Text, pInst->Expression.Length))
+	{
+		return false;
+	}
+
+	int iToken = 0;
+	double dResult = 0;
+
+	pInst->NestingDepth = 0;
+
+	if (!this->EvaluateTokenGroup(pInst, &iToken, &dResult) || this->pLexer->Tokens()[iToken].Type != CMathLexer::TokenEnd)
+	{
+		return false;
+	}
+
+	pInst->RunningTotal = dResult;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates the whole expression or the contents of a pair of parentheses, like CalculateSimpleExpression.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="piToken">Index of the first token, receives the index of the token which ended the group.</param>
+/// <param name="pdResult"></param>
+/// <returns></returns>
+bool CMathParser::EvaluateTokenGroup(MATHINSTANCE *pInst, int *piToken, double *pdResult)
+{
+	CMathLexer::MATHTOKEN *pToken = &this->pLexer->Tokens()[*piToken];
+	MATHOPERAND Value;
+	bool bBitwiseNot = false;
+
+	//A bitwise not at the start of the text applies to the result of everything which follows it.
+	if (pToken->Type == CMathLexer::TokenOperator && pToken->Operator == sFirstOrder[0])
+	{
+		bBitwiseNot = true;
+		(*piToken)++;
+	}
+
+	if (!this->EvaluateTokenOperation(pInst, piToken, 1, &Value))
+	{
+		return false;
+	}
+
+	if (bBitwiseNot)
+	{
+		*pdResult = ~(int)Value.Integer;
+	}
+	else if (pInst->ForceIntegerMath)
+	{
+		if (pInst->ForceUnsignedMath)
+		{
+			if (Value.Value < 0 || Value.Value > UINT_MAX)
+			{
+				return false;
+			}
+			*pdResult = (unsigned int)Value.Value;
+		}
+		else {
+			if (Value.Value < INT_MIN || Value.Value > INT_MAX)
+			{
+				return false;
+			}
+			*pdResult = (int)Value.Value;
+		}
+	}
+	else {
+		*pdResult = Value.Value;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates binary operations by precedence climbing. Operators which bind at least as tightly as iMinPrecedence
+///	are applied here and the right operand of each one only takes operators which bind tighter, so operators of the
+///	same precedence are applied from left to right (see CMathLexer::FirstOrderPrecedence).
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="piToken"></param>
+/// <param name="iMinPrecedence"></param>
+/// <param name="pResult"></param>
+/// <returns></returns>
+bool CMathParser::EvaluateTokenOperation(MATHINSTANCE *pInst, int *piToken, int iMinPrecedence, MATHOPERAND *pResult)
+{
+	CMathLexer::MATHTOKEN *pTokens = this->pLexer->Tokens();
+
+	if (!this->EvaluateTokenOperand(pInst, piToken, pResult))
+	{
+		return false;
+	}
+
+	while (true)
+	{
+		CMathLexer::MATHTOKEN *pToken = &pTokens[*piToken];
+
+		if (pToken->Type != CMathLexer::TokenOperator || pToken->Precedence == 0 || pToken->Precedence < iMinPrecedence)
+		{
+			break;
+		}
+
+		(*piToken)++;
+
+		//The text based evaluator does not accept a bitwise not directly after a first order operator.
+		if (pToken->Precedence == this->pLexer->FirstOrderPrecedence()
+			&& pTokens[*piToken].Type == CMathLexer::TokenOperator && pTokens[*piToken].Operator == sFirstOrder[0])
+		{
+			return false;
+		}
+
+		MATHOPERAND Right;
+
+		if (!this->EvaluateTokenOperation(pInst, piToken, pToken->Precedence + 1, &Right)
+			|| !this->ApplyTokenOperator(pInst, (MathOperator)pToken->OperatorCode, pResult, &Right))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates a number or a parenthesized group along with its prefix operators: an optional bitwise not, an
+///	optional logical not and an optional sign, in that order.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="piToken"></param>
+/// <param name="pResult"></param>
+/// <returns></returns>
+bool CMathParser::EvaluateTokenOperand(MATHINSTANCE *pInst, int *piToken, MATHOPERAND *pResult)
+{
+	CMathLexer::MATHTOKEN *pTokens = this->pLexer->Tokens();
+	CMathLexer::MATHTOKEN *pSign = NULL;
+	bool bBitwiseNot = false;
+	bool bLogicalNot = false;
+
+	if (pTokens[*piToken].Type == CMathLexer::TokenOperator && pTokens[*piToken].Operator == sFirstOrder[0])
+	{
+		bBitwiseNot = true;
+		(*piToken)++;
+	}
+	if (pTokens[*piToken].Type == CMathLexer::TokenOperator && pTokens[*piToken].Operator == sPreOrder[0])
+	{
+		bLogicalNot = true;
+		(*piToken)++;
+	}
+	if (pTokens[*piToken].Type == CMathLexer::TokenOperator
+		&& (pTokens[*piToken].Operator == sSecondOrder[0] || pTokens[*piToken].Operator == sSecondOrder[1]))
+	{
+		pSign = &pTokens[(*piToken)++];
+
+		//The text based evaluator reads a plus sign which directly follows a third order operator (or the bitwise not
+		//	at the start of the text) as an addition without a left value.
+		if (pSign->Operator[0] == '+' && !bBitwiseNot && !bLogicalNot && *piToken > 1
+			&& pSign[-1].Type == CMathLexer::TokenOperator && pSign[-1].Precedence < this->pLexer->SecondOrderPrecedence())
+		{
+			return false;
+		}
+	}
+
+	CMathLexer::MATHTOKEN *pToken = &pTokens[*piToken];
+
+	if (pToken->Type == CMathLexer::TokenNumber)
+	{
+		if (!this->IsNumeric(pInst->Expression.Text + pToken->Position, pToken->Length))
+		{
+			return false;
+		}
+
+		//The sign directly precedes the digits and the number is followed by an operator or the end of the text.
+		const char *sNumber = pInst->Expression.Text + (pSign ? pSign->Position : pToken->Position);
+		pResult->Value = atof(sNumber);
+		pResult->Integer = atol(sNumber);
+
+		(*piToken)++;
+	}
+	else if (pToken->Type == CMathLexer::TokenOpenParenthesis)
+	{
+		double dGroup = 0;
+		bool bNegative = false;
+
+		(*piToken)++;
+
+		//Each level of parentheses is a level of recursion, deeper expressions are left to the text based evaluator
+		//	which does not recurse.
+		if (pInst->NestingDepth >= CMATHPARSER_MAX_NESTING)
+		{
+			return false;
+		}
+
+		pInst->NestingDepth++;
+		if (!this->EvaluateTokenGroup(pInst, piToken, &dGroup) || pTokens[*piToken].Type != CMathLexer::TokenCloseParenthesis)
+		{
+			return false;
+		}
+		pInst->NestingDepth--;
+
+		(*piToken)++;
+
+		if (!this->ReadTokenGroup(pInst, dGroup, pResult, &bNegative))
+		{
+			return false;
+		}
+
+		if (pSign && !this->ApplyTokenSign(pSign->Operator, bNegative, pResult))
+		{
+			return false;
+		}
+	}
+	else {
+		return false;
+	}
+
+	//The logical not is a pre order operator, it is applied before the bitwise not.
+	if (bLogicalNot)
+	{
+		pResult->Integer = !(int)pResult->Integer;
+		pResult->Value = (double)pResult->Integer;
+	}
+	if (bBitwiseNot)
+	{
+		pResult->Integer = ~(int)pResult->Integer;
+		pResult->Value = (double)pResult->Integer;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Rounds the value of a parenthesized group the way CalculateComplexExpression does when it writes it back into
+///	the text.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="dGroup"></param>
+/// <param name="pResult"></param>
+/// <param name="pbNegative">Receives whether the text of the value starts with a minus sign.</param>
+/// <returns>False if the text based evaluator would not read the value back as a number.</returns>
+bool CMathParser::ReadTokenGroup(MATHINSTANCE *pInst, double dGroup, MATHOPERAND *pResult, bool *pbNegative)
+{
+	if (pInst->ForceIntegerMath)
+	{
+		if (dGroup < INT_MIN || dGroup > INT_MAX)
+		{
+			return false;
+		}
+		pResult->Integer = (int)dGroup;
+		pResult->Value = (double)pResult->Integer;
+		*pbNegative = (pResult->Integer < 0);
+	}
+	else {
+		char sVal[_CVTBUFSIZE];
+		sprintf_s(sVal, sizeof(sVal), "%.*g", this->ciPrecision, dGroup);
+
+		//Exponents, infinities, etc. are not numbers to the text based evaluator.
+		for (int iRPos = 0; sVal[iRPos]; iRPos++)
+		{
+			if (!IsNumeric(sVal[iRPos]) && sVal[iRPos] != '.' && sVal[iRPos] != '-')
+			{
+				return false;
+			}
+		}
+
+		pResult->Value = atof(sVal);
+		pResult->Integer = atol(sVal);
+		*pbNegative = (sVal[0] == '-');
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Applies a sign to a value which was written into the text (a group or, see EvaluateTextNode, a variable).
+/// </summary>
+/// <param name="sSign">The operator text of the sign: "+" or "-".</param>
+/// <param name="bNegative">The text of the value starts with a minus sign.</param>
+/// <param name="pResult"></param>
+/// <returns></returns>
+bool CMathParser::ApplyTokenSign(const char *sSign, bool bNegative, MATHOPERAND *pResult)
+{
+	//A sign followed by a negative value (ex: "--5") is not read as a number by the text based evaluator.
+	if (bNegative || pResult->Integer == LONG_MAX)
+	{
+		return false;
+	}
+
+	if (sSign[0] == '-')
+	{
+		pResult->Value = -pResult->Value;
+		pResult->Integer = -pResult->Integer;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Applies a binary operator like ParseOperator, leaving the (rounded) result in pLeft.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="Operator"></param>
+/// <param name="pLeft"></param>
+/// <param name="pRight"></param>
+/// <returns></returns>
+bool CMathParser::ApplyTokenOperator(MATHINSTANCE *pInst, MathOperator Operator, MATHOPERAND *pLeft, const MATHOPERAND *pRight)
+{
+	if (pInst->ForceIntegerMath)
+	{
+		if (pInst->ForceUnsignedMath)
+		{
+			if (pLeft->Value < 0 || pRight->Value < 0 || pLeft->Value > UINT_MAX || pRight->Value > UINT_MAX)
+			{
+				return false;
+			}
+		}
+		else if (pLeft->Value < INT_MIN || pRight->Value < INT_MIN || pLeft->Value > INT_MAX || pRight->Value > INT_MAX)
+		{
+			return false;
+		}
+
+		if (this->PerformDoubleOperation(pInst, pLeft->Integer, Operator, pRight->Integer) != ResultOk
+			|| pInst->RunningTotal < INT_MIN || pInst->RunningTotal > INT_MAX)
+		{
+			return false;
+		}
+
+		pLeft->Integer = (int)pInst->RunningTotal;
+		pLeft->Value = (double)pLeft->Integer;
+	}
+	else {
+		char sVal[_CVTBUFSIZE];
+
+		if (this->PerformDoubleOperation(pInst, pLeft->Value, Operator, pRight->Value) != ResultOk
+			|| !_finite(pInst->RunningTotal) || this->DoubleToChar(pInst->RunningTotal, sVal, sizeof(sVal)) <= 0)
+		{
+			return false;
+		}
+
+		pLeft->Value = atof(sVal);
+		pLeft->Integer = atol(sVal);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates the expression text for the integer overloads of Calculate() from a token stream like
+///	CalculateTokenStream(), but entirely in 64 bit integers: numbers (including the values of variables and methods,
+///	see AllocateExpression) are read from the text straight into a long long and every operation is checked for
+///	overflow, so results are exact over the whole range of the type. It is the only evaluator of the integer
+///	overloads: values outside the range of the type, forms it does not read (ex: "--1") and all other errors are
+///	reported here rather than left to the text based evaluator.
+/// </summary>
+/// <param name="pInst"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::CalculateIntegerTokenStream(MATHINSTANCE *pInst)
+{
+	if (this->MatchParentheses(pInst->Expression.Text, pInst->Expression.Length) != 0)
+	{
+		return this->SetError(ResultParenthesesMismatch, "Parentheses mismatch.");
+	}
+
+	if (!this->pLexer)
+	{
+		this->pLexer = new CMathLexer(this);
+	}
+
+	if (!this->pLexer->Tokenize(pInst->Expression.Text, pInst->Expression.Length))
+	{
+		return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	int iToken = 0;
+	long long iResult = 0;
+
+	pInst->NestingDepth = 0;
+
+	if (!this->EvaluateIntegerGroup(pInst, &iToken, &iResult)
+		|| !this->CheckIntegerToken(iToken, CMathLexer::TokenEnd))
+	{
+		return this->pContext->LastErrorInfo.Error;
+	}
+
+	pInst->IntegerTotal = iResult;
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates the whole expression or the contents of a pair of parentheses, like EvaluateTokenGroup.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="piToken">Index of the first token, receives the index of the token which ended the group.</param>
+/// <param name="piResult"></param>
+/// <returns></returns>
+bool CMathParser::EvaluateIntegerGroup(MATHINSTANCE *pInst, int *piToken, long long *piResult)
+{
+	CMathLexer::MATHTOKEN *pToken = &this->pLexer->Tokens()[*piToken];
+	MATHINTEGEROPERAND Value;
+	bool bBitwiseNot = false;
+
+	//A bitwise not at the start of the text applies to the result of everything which follows it.
+	if (pToken->Type == CMathLexer::TokenOperator && pToken->Operator == sFirstOrder[0])
+	{
+		bBitwiseNot = true;
+		(*piToken)++;
+	}
+
+	if (!this->EvaluateIntegerOperation(pInst, piToken, 1, &Value) || !this->CheckIntegerRange(pInst, &Value))
+	{
+		return false;
+	}
+
+	*piResult = bBitwiseNot ? this->IntegerBitwiseNot(pInst, Value.Value) : Value.Value;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates binary operations by precedence climbing, like EvaluateTokenOperation.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="piToken"></param>
+/// <param name="iMinPrecedence"></param>
+/// <param name="pResult"></param>
+/// <returns></returns>
+bool CMathParser::EvaluateIntegerOperation(MATHINSTANCE *pInst, int *piToken, int iMinPrecedence, MATHINTEGEROPERAND *pResult)
+{
+	CMathLexer::MATHTOKEN *pTokens = this->pLexer->Tokens();
+
+	if (!this->EvaluateIntegerOperand(pInst, piToken, pResult))
+	{
+		return false;
+	}
+
+	while (true)
+	{
+		CMathLexer::MATHTOKEN *pToken = &pTokens[*piToken];
+
+		if (pToken->Type != CMathLexer::TokenOperator || pToken->Precedence == 0 || pToken->Precedence < iMinPrecedence)
+		{
+			break;
+		}
+
+		(*piToken)++;
+
+		//Like the text based evaluator of the double overloads, a bitwise not is not accepted directly after a first
+		//	order operator.
+		if (pToken->Precedence == this->pLexer->FirstOrderPrecedence()
+			&& pTokens[*piToken].Type == CMathLexer::TokenOperator && pTokens[*piToken].Operator == sFirstOrder[0])
+		{
+			this->SetError(ResultRightValueFailed, "Value to the right of operator is missing or invalid.");
+			return false;
+		}
+
+		MATHINTEGEROPERAND Right;
+
+		if (!this->EvaluateIntegerOperation(pInst, piToken, pToken->Precedence + 1, &Right)
+			|| !this->ApplyIntegerOperator(pInst, (MathOperator)pToken->OperatorCode, pResult, &Right))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates a number or a parenthesized group along with its prefix operators, like EvaluateTokenOperand.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="piToken"></param>
+/// <param name="pResult"></param>
+/// <returns></returns>
+bool CMathParser::EvaluateIntegerOperand(MATHINSTANCE *pInst, int *piToken, MATHINTEGEROPERAND *pResult)
+{
+	CMathLexer::MATHTOKEN *pTokens = this->pLexer->Tokens();
+	CMathLexer::MATHTOKEN *pSign = NULL;
+	bool bBitwiseNot = false;
+	bool bLogicalNot = false;
+
+	if (pTokens[*piToken].Type == CMathLexer::TokenOperator && pTokens[*piToken].Operator == sFirstOrder[0])
+	{
+		bBitwiseNot = true;
+		(*piToken)++;
+	}
+	if (pTokens[*piToken].Type == CMathLexer::TokenOperator && pTokens[*piToken].Operator == sPreOrder[0])
+	{
+		bLogicalNot = true;
+		(*piToken)++;
+	}
+	if (pTokens[*piToken].Type == CMathLexer::TokenOperator
+		&& (pTokens[*piToken].Operator == sSecondOrder[0] || pTokens[*piToken].Operator == sSecondOrder[1]))
+	{
+		pSign = &pTokens[(*piToken)++];
+
+		//A plus sign which directly follows a third order operator is an addition without a left value, which the
+		//	double overloads do not accept either (see EvaluateTokenOperand).
+		if (pSign->Operator[0] == '+' && !bBitwiseNot && !bLogicalNot && *piToken > 1
+			&& pSign[-1].Type == CMathLexer::TokenOperator && pSign[-1].Precedence < this->pLexer->SecondOrderPrecedence())
+		{
+			this->SetError(ResultInvalidToken, "Token is invalid: %s", pSign->Operator);
+			return false;
+		}
+	}
+
+	CMathLexer::MATHTOKEN *pToken = &pTokens[*piToken];
+
+	if (pToken->Type == CMathLexer::TokenNumber)
+	{
+		if (!this->IsNumeric(pInst->Expression.Text + pToken->Position, pToken->Length))
+		{
+			//The error message is formatted later (see CMathContext::FormatError), it takes the token as a whole string.
+			char sVal[_CVTBUFSIZE];
+
+			if (pToken->Length > (int)sizeof(sVal) - 1)
+			{
+				this->SetError(ResultInvalidToken, "Numeric value is too long.");
+				return false;
+			}
+
+			memcpy(sVal, pInst->Expression.Text + pToken->Position, pToken->Length);
+			sVal[pToken->Length] = '\0';
+
+			this->SetError(ResultInvalidToken, "Token is invalid: %s", sVal);
+			return false;
+		}
+
+		//The sign directly precedes the digits.
+		if (!this->ReadInteger(pInst, pInst->Expression.Text + (pSign ? pSign->Position : pToken->Position), pResult))
+		{
+			return false;
+		}
+
+		(*piToken)++;
+	}
+	else if (pToken->Type == CMathLexer::TokenOpenParenthesis)
+	{
+		long long iGroup = 0;
+
+		(*piToken)++;
+
+		//Each level of parentheses is a level of recursion.
+		if (pInst->NestingDepth >= CMATHPARSER_MAX_NESTING)
+		{
+			this->SetError(ResultNestingTooDeep, "Expression is nested too deeply.");
+			return false;
+		}
+
+		pInst->NestingDepth++;
+		if (!this->EvaluateIntegerGroup(pInst, piToken, &iGroup)
+			|| !this->CheckIntegerToken(*piToken, CMathLexer::TokenCloseParenthesis))
+		{
+			return false;
+		}
+		pInst->NestingDepth--;
+
+		(*piToken)++;
+
+		pResult->Value = iGroup;
+		pResult->Fraction = 0;
+
+		if (pSign && pSign->Operator[0] == '-' && pResult->Value != 0)
+		{
+			if (pInst->ForceUnsignedMath)
+			{
+				this->SetError(ResultIntegerunderflow, "Unsigned integer underflow.");
+				return false;
+			}
+
+			//The one value which can not be negated is LLONG_MIN.
+			if (CheckedSubtract(0LL, iGroup, &pResult->Value))
+			{
+				this->SetError(ResultIntegerOverflow, "Integer overflow.");
+				return false;
+			}
+		}
+	}
+	else {
+		//Ex: "--1", "1*" or "()".
+		this->SetError(ResultRightValueFailed, "Value to the right of operator is missing or invalid.");
+		return false;
+	}
+
+	if ((bLogicalNot || bBitwiseNot) && !this->CheckIntegerRange(pInst, pResult))
+	{
+		return false;
+	}
+
+	//The logical not is a pre order operator, it is applied before the bitwise not.
+	if (bLogicalNot)
+	{
+		pResult->Value = !pResult->Value;
+		pResult->Fraction = 0;
+	}
+	if (bBitwiseNot)
+	{
+		pResult->Value = this->IntegerBitwiseNot(pInst, pResult->Value);
+		pResult->Fraction = 0;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Applies a binary operator like ApplyTokenOperator, leaving the result in pLeft.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="Operator"></param>
+/// <param name="pLeft"></param>
+/// <param name="pRight"></param>
+/// <returns></returns>
+bool CMathParser::ApplyIntegerOperator(MATHINSTANCE *pInst, MathOperator Operator, MATHINTEGEROPERAND *pLeft, const MATHINTEGEROPERAND *pRight)
+{
+	long long iResult = 0;
+
+	if (!this->CheckIntegerRange(pInst, pLeft) || !this->CheckIntegerRange(pInst, pRight)
+		|| this->PerformInt64Operation(pInst, pLeft->Value, Operator, pRight->Value, &iResult) != ResultOk)
+	{
+		return false;
+	}
+
+	pLeft->Value = iResult;
+	pLeft->Fraction = 0;
+
+	return this->CheckIntegerRange(pInst, pLeft);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Reads a number of the expression text, with its sign, into an integer without converting it to a double. The
+///	fractional part is dropped like atol() does, but its sign is kept so that the range checks of the int overloads
+///	see the value atof() would have given them.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="sText">The number, which ends at the first character which is not a digit or its decimal point.</param>
+/// <param name="pResult"></param>
+/// <returns>False if the number does not fit in a long long (unsigned long long), which is reported as an error.</returns>
+bool CMathParser::ReadInteger(MATHINSTANCE *pInst, const char *sText, MATHINTEGEROPERAND *pResult)
+{
+	unsigned long long iMagnitude = 0;
+	bool bNegative = (*sText == '-');
+	bool bOverflow = false;
+
+	if (*sText == '-' || *sText == '+')
+	{
+		sText++;
+	}
+
+	for (; IsNumeric(*sText); sText++)
+	{
+		bOverflow = bOverflow || CheckedMultiply(iMagnitude, 10ULL, &iMagnitude)
+			|| CheckedAdd(iMagnitude, (unsigned long long)(*sText - '0'), &iMagnitude);
+	}
+
+	pResult->Fraction = 0;
+	if (*sText == '.')
+	{
+		for (sText++; IsNumeric(*sText); sText++)
+		{
+			if (*sText != '0')
+			{
+				pResult->Fraction = bNegative ? -1 : 1;
+			}
+		}
+	}
+
+	if (pInst->ForceUnsignedMath)
+	{
+		if (bNegative && iMagnitude != 0)
+		{
+			this->SetError(ResultIntegerunderflow, "Unsigned integer underflow.");
+			return false;
+		}
+		else if (bOverflow)
+		{
+			this->SetError(ResultIntegerOverflow, "Integer overflow.");
+			return false;
+		}
+
+		pResult->Value = (long long)iMagnitude;
+	}
+	else {
+		//The magnitude of LLONG_MIN is one more than LLONG_MAX.
+		if (bOverflow || iMagnitude > (unsigned long long)LLONG_MAX + (bNegative ? 1 : 0))
+		{
+			this->SetError(bNegative ? ResultIntegerunderflow : ResultIntegerOverflow, bNegative ? "Integer underflow." : "Integer overflow.");
+			return false;
+		}
+
+		pResult->Value = (bNegative && iMagnitude != 0) ? -(long long)(iMagnitude - 1) - 1 : (long long)iMagnitude;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Checks that a value, including its fractional part, is within the range of the int (unsigned int) overloads.
+///	64 bit values are always in range since reading and computing them checks for overflow.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="pValue"></param>
+/// <returns>False if the value is out of range, which is reported as an overflow (underflow).</returns>
+bool CMathParser::CheckIntegerRange(MATHINSTANCE *pInst, const MATHINTEGEROPERAND *pValue)
+{
+	if (pInst->Force64BitMath)
+	{
+		return true;
+	}
+
+	long long iMin = pInst->ForceUnsignedMath ? 0 : INT_MIN;
+	long long iMax = pInst->ForceUnsignedMath ? UINT_MAX : INT_MAX;
+
+	if (pValue->Value < iMin || (pValue->Value == iMin && pValue->Fraction < 0))
+	{
+		this->SetError(ResultIntegerunderflow, pInst->ForceUnsignedMath ? "Unsigned integer underflow." : "Integer underflow.");
+		return false;
+	}
+	if (pValue->Value > iMax || (pValue->Value == iMax && pValue->Fraction > 0))
+	{
+		this->SetError(ResultIntegerOverflow, "Integer overflow.");
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Checks the token which ends a group: the end of the text or a closing parenthesis.
+/// </summary>
+/// <param name="iToken"></param>
+/// <param name="iExpectedType"></param>
+/// <returns>False if it is any other token, which is reported as an error.</returns>
+bool CMathParser::CheckIntegerToken(int iToken, int iExpectedType)
+{
+	CMathLexer::MATHTOKEN *pToken = &this->pLexer->Tokens()[iToken];
+
+	if (pToken->Type == iExpectedType)
+	{
+		return true;
+	}
+
+	if (pToken->Type == CMathLexer::TokenNumber || pToken->Type == CMathLexer::TokenOpenParenthesis
+		|| pToken->Type == CMathLexer::TokenCloseParenthesis)
+	{
+		this->SetError(ResultMissingOperator, "Missing mathematical operator.");
+	}
+	else if (pToken->Type == CMathLexer::TokenOperator)
+	{
+		//Prefix only operators after a value (ex: "1~2").
+		this->SetError(ResultInvalidOperator, "Invalid operator: %s.", pToken->Operator);
+	}
+	else {
+		this->SetError(ResultInvalidToken, "Token is invalid.");
+	}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Applies a bitwise not to a value of the integer overloads, within the width of their type.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="iValue">A value within the range of the type, see CheckIntegerRange().</param>
+/// <returns></returns>
+long long CMathParser::IntegerBitwiseNot(MATHINSTANCE *pInst, long long iValue)
+{
+	if (!pInst->Force64BitMath && pInst->ForceUnsignedMath)
+	{
+		return (long long)(unsigned int)~(unsigned int)iValue;
+	}
+
+	//The bits of a long long, which are those of an int for values in its range.
+	return ~iValue;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::GetSubExpression(MATHINSTANCE *pInst, int *iBegin, int *iEnd)
+{
+	int iIn = 0;
+	int iOut = 0;
+
+	for (int iRPos = 0; iRPos < pInst->Expression.Length; iRPos++)
+	{
+		if (pInst->Expression.Text[iRPos] == ')')
+		{
+			*iEnd = iRPos + 1;
+			iOut++;
+			for (iRPos--; iRPos >= 0; iRPos--)
+			{
+				if (pInst->Expression.Text[iRPos] == '(')
+				{
+					iIn++;
+				}
+				else if (pInst->Expression.Text[iRPos] == ')')
+				{
+					iOut++;
+				}
+
+				if (iIn == iOut)
+				{
+					*iBegin = iRPos;
+
+					if (((int)*iBegin) > 0)
+					{
+						if (!this->IsMathChar(pInst->Expression.Text[((int)*iBegin) - 1]) && pInst->Expression.Text[((int)*iBegin) - 1] != '(')
+						{
+							return this->SetError(ResultMissingOperator, "Missing mathematical operator near: (.");
+						}
+					}
+
+					if (((int)*iEnd) < pInst->Expression.Length)
+					{
+						if (!this->IsMathChar(pInst->Expression.Text[((int)*iEnd)]) && pInst->Expression.Text[((int)*iEnd)] != ')')
+						{
+							return this->SetError(ResultMissingOperator, "Missing mathematical operator near: ).");
+						}
+					}
+
+					return ResultOk;
+				}
+			}
+		}
+	}
+
+	*iBegin = pInst->Expression.Length;
+	*iEnd = -pInst->Expression.Length;
+
+	return ResultOk; //This is not an error.
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::ReplaceValue(MATHEXPRESSION *pExp, int iBegin, int iEnd, const char *sWith, int iWithSz)
+{
+	int iPos = 0;
+	int iNewSz = pExp->Length + (iWithSz - (iEnd - iBegin));
+	int iGapSize = (pExp->Length - iNewSz);
+
+	pExp->Length = iNewSz;
+
+	if (iNewSz >= pExp->Allocated)
+	{
+		char *sText = (char *)this->pContext->pArena->Reallocate(pExp->Text, pExp->Allocated, iNewSz + 1);
+		if (!sText)
+		{
+			return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+		}
+		pExp->Text = sText;
+		pExp->Allocated = iNewSz + 1;
+	}
+
+	if (iGapSize < 0)
+	{
+		iGapSize = abs(iGapSize);
+
+		for (iPos = iNewSz; iPos > iEnd && (iPos - iGapSize) >= 0; iPos--)
+		{
+			pExp->Text[iPos] = pExp->Text[iPos - iGapSize];
+		}
+		memcpy_s(pExp->Text + iBegin, pExp->Allocated - iBegin, sWith, iWithSz);
+	}
+	else if (iGapSize > 0)
+	{
+		memcpy_s(pExp->Text + iBegin, pExp->Allocated - iBegin, sWith, iWithSz);
+
+		for (iPos = iBegin + iWithSz; iPos < iNewSz; iPos++)
+		{
+			pExp->Text[iPos] = pExp->Text[iPos + iGapSize];
+		}
+
+		pExp->Text[iPos] = '\0';
+	}
+	else {
+		memcpy(pExp->Text + iBegin, sWith, iWithSz);
+	}
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IsIntegerExclusive(const char *sOperator)
+{
+	return this->IsIntegerExclusive(this->GetOperator(sOperator));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IsIntegerExclusive(MathOperator Operator)
+{
+	switch (Operator)
+	{
+	case OperatorBitwiseAnd:
+	case OperatorBitwiseOr:
+	case OperatorBitwiseXor:
+	case OperatorBitwiseAndEqual:
+	case OperatorBitwiseOrEqual:
+	case OperatorBitwiseXorEqual:
+	case OperatorShiftLeft:
+	case OperatorShiftRight:
+		return true;
+	default:
+		return false;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Classifies an operator of the operator tables so that it can be dispatched by a switch instead of string comparisons.
+/// </summary>
+/// <param name="sOperator"></param>
+/// <returns>OperatorUnknown if the text is not an operator.</returns>
+CMathParser::MathOperator CMathParser::GetOperator(const char *sOperator)
+{
+	char cNext = (sOperator[0] != '\0') ? sOperator[1] : '\0';
+
+	if (cNext != '\0' && sOperator[2] != '\0')
+	{
+		return OperatorUnknown;
+	}
+
+	switch (sOperator[0])
+	{
+	case '*': return (cNext == '\0') ? OperatorMultiply : OperatorUnknown;
+	case '/': return (cNext == '\0') ? OperatorDivide : OperatorUnknown;
+	case '%': return (cNext == '\0') ? OperatorModulus : OperatorUnknown;
+	case '+': return (cNext == '\0') ? OperatorAdd : OperatorUnknown;
+	case '-': return (cNext == '\0') ? OperatorSubtract : OperatorUnknown;
+	case '~': return (cNext == '\0') ? OperatorBitwiseNot : OperatorUnknown;
+	case '!':
+		if (cNext == '\0') return OperatorNot;
+		else if (cNext == '=') return OperatorNotEqual;
+		break;
+	case '=':
+		if (cNext == '\0') return OperatorEqual;
+		break;
+	case '<':
+		if (cNext == '\0') return OperatorLess;
+		else if (cNext == '=') return OperatorLessOrEqual;
+		else if (cNext == '>') return OperatorNotEqual;
+		else if (cNext == '<') return OperatorShiftLeft;
+		break;
+	case '>':
+		if (cNext == '\0') return OperatorGreater;
+		else if (cNext == '=') return OperatorGreaterOrEqual;
+		else if (cNext == '>') return OperatorShiftRight;
+		break;
+	case '&':
+		if (cNext == '\0') return OperatorBitwiseAnd;
+		else if (cNext == '=') return OperatorBitwiseAndEqual;
+		else if (cNext == '&') return OperatorLogicalAnd;
+		break;
+	case '|':
+		if (cNext == '\0') return OperatorBitwiseOr;
+		else if (cNext == '=') return OperatorBitwiseOrEqual;
+		else if (cNext == '|') return OperatorLogicalOr;
+		break;
+	case '^':
+		if (cNext == '\0') return OperatorBitwiseXor;
+		else if (cNext == '=') return OperatorBitwiseXorEqual;
+		break;
+	}
+
+	return OperatorUnknown;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IsMathChar(const char cChar)
+{
+	return(cChar == '*' || cChar == '/'
+		|| cChar == '+' || cChar == '-'
+		|| cChar == '>' || cChar == '<'
+		|| cChar == '!' || cChar == '='
+		|| cChar == '&' || cChar == '|'
+		|| cChar == '^' || cChar == '%'
+		|| cChar == '~');
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IsValidChar(const char cChar)
+{
+	return IsNumeric(cChar) || this->IsMathChar(cChar) || cChar == '.' || cChar == '(' || cChar == ')';
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IsValidVariableChar(const char cChar)
+{
+	return IsNumeric(cChar)
+		|| (cChar >= 'a' && cChar <= 'z')
+		|| (cChar >= 'A' && cChar <= 'Z')
+		|| cChar == '_';
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::PerformBooleanOperation(MATHINSTANCE *pInst, int iVal, MathOperator Operator)
+{
+	if (Operator == OperatorNot)
+	{
+		pInst->RunningTotal = (!iVal);
+	}
+	else
+	{
+		return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", sOperatorText[Operator]);
+	}
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::PerformIntOperation(MATHINSTANCE *pInst, int iVal1, MathOperator Operator, int iVal2)
+{
+	switch (Operator)
+	{
+	case OperatorLogicalAnd: pInst->RunningTotal = (iVal1 && iVal2); break;
+	case OperatorLogicalOr: pInst->RunningTotal = (iVal1 || iVal2); break;
+	case OperatorBitwiseAnd: pInst->RunningTotal = (iVal1 & iVal2); break;
+	case OperatorBitwiseOr: pInst->RunningTotal = (iVal1 | iVal2); break;
+	case OperatorNot: pInst->RunningTotal = (iVal1 != iVal2); break;
+	case OperatorBitwiseNot: pInst->RunningTotal = ~iVal1; break;
+	case OperatorBitwiseXor: pInst->RunningTotal = (iVal1 ^ iVal2); break;
+	case OperatorBitwiseAndEqual: pInst->RunningTotal = (iVal1 &= iVal2); break;
+	case OperatorBitwiseOrEqual: pInst->RunningTotal = (iVal1 |= iVal2); break;
+	case OperatorBitwiseXorEqual: pInst->RunningTotal = (iVal1 ^= iVal2); break;
+	case OperatorShiftLeft: pInst->RunningTotal = (iVal1 << iVal2); break;
+	case OperatorShiftRight: pInst->RunningTotal = (iVal1 >> iVal2); break;
+	default:
+		return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", sOperatorText[Operator]);
+	}
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Performs an operation of the integer overloads on two 64 bit integers, checking for overflow instead of losing
+///	precision the way PerformDoubleOperation would. For unsigned math the values are the bits of unsigned long longs.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="iVal1"></param>
+/// <param name="Operator"></param>
+/// <param name="iVal2"></param>
+/// <param name="piResult"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::PerformInt64Operation(MATHINSTANCE *pInst, long long iVal1, MathOperator Operator, long long iVal2, long long *piResult)
+{
+	bool bUnsigned = pInst->ForceUnsignedMath;
+	unsigned long long uVal1 = (unsigned long long)iVal1;
+	unsigned long long uVal2 = (unsigned long long)iVal2;
+	unsigned long long uResult = 0;
+	long long iResult = 0;
+	bool bOverflow = false;
+
+	switch (Operator)
+	{
+	case OperatorMultiply:
+	case OperatorAdd:
+	case OperatorSubtract:
+		if (bUnsigned)
+		{
+			bOverflow = (Operator == OperatorMultiply) ? CheckedMultiply(uVal1, uVal2, &uResult)
+				: (Operator == OperatorAdd) ? CheckedAdd(uVal1, uVal2, &uResult) : CheckedSubtract(uVal1, uVal2, &uResult);
+			iResult = (long long)uResult;
+		}
+		else {
+			bOverflow = (Operator == OperatorMultiply) ? CheckedMultiply(iVal1, iVal2, &iResult)
+				: (Operator == OperatorAdd) ? CheckedAdd(iVal1, iVal2, &iResult) : CheckedSubtract(iVal1, iVal2, &iResult);
+		}
+
+		if (bOverflow)
+		{
+			//Below the range: an unsigned difference, a product of different signs or a sum (difference) going down.
+			if (bUnsigned ? (Operator == OperatorSubtract)
+				: (Operator == OperatorMultiply) ? ((iVal1 < 0) != (iVal2 < 0))
+				: (Operator == OperatorAdd) ? (iVal1 < 0) : (iVal2 > 0))
+			{
+				return this->SetError(ResultIntegerunderflow, bUnsigned ? "Unsigned integer underflow." : "Integer underflow.");
+			}
+			return this->SetError(ResultIntegerOverflow, "Integer overflow.");
+		}
+		break;
+	case OperatorDivide:
+	case OperatorModulus:
+		if (iVal2 == 0)
+		{
+			return this->SetError(ResultInvalidOperator, (Operator == OperatorDivide) ? "Divide by zero." : "Mod by zero.");
+		}
+		if (bUnsigned)
+		{
+			iResult = (long long)((Operator == OperatorDivide) ? (uVal1 / uVal2) : (uVal1 % uVal2));
+		}
+		else if (iVal2 == -1)
+		{
+			//The one quotient which does not fit is that of LLONG_MIN / -1.
+			if (Operator == OperatorDivide && CheckedSubtract(0LL, iVal1, &iResult))
+			{
+				return this->SetError(ResultIntegerOverflow, "Integer overflow.");
+			}
+		}
+		else {
+			iResult = (Operator == OperatorDivide) ? (iVal1 / iVal2) : (iVal1 % iVal2);
+		}
+		break;
+	case OperatorShiftLeft:
+	case OperatorShiftRight:
+		//Shifting by the width of the type or more (or by a negative count) shifts out every bit of the value.
+		if (iVal2 < 0 || iVal2 > 63)
+		{
+			return this->SetError(ResultIntegerOverflow, "Shift count out of range.");
+		}
+		if (Operator == OperatorShiftLeft)
+		{
+			//The bits shifted out have to be restored by shifting back.
+			uResult = (uVal1 << iVal2);
+			iResult = (long long)uResult;
+			if (bUnsigned ? ((uResult >> iVal2) != uVal1) : ((iResult >> iVal2) != iVal1))
+			{
+				return this->SetError(ResultIntegerOverflow, "Integer overflow.");
+			}
+		}
+		else {
+			//Unsigned values are shifted logically, signed ones arithmetically.
+			iResult = bUnsigned ? (long long)(uVal1 >> iVal2) : (iVal1 >> iVal2);
+		}
+		break;
+	case OperatorBitwiseAnd:
+	case OperatorBitwiseAndEqual: iResult = (iVal1 & iVal2); break;
+	case OperatorBitwiseOr:
+	case OperatorBitwiseOrEqual: iResult = (iVal1 | iVal2); break;
+	case OperatorBitwiseXor:
+	case OperatorBitwiseXorEqual: iResult = (iVal1 ^ iVal2); break;
+	case OperatorLogicalAnd: iResult = (iVal1 && iVal2); break;
+	case OperatorLogicalOr: iResult = (iVal1 || iVal2); break;
+	case OperatorEqual: iResult = (iVal1 == iVal2); break;
+	case OperatorNot:
+	case OperatorNotEqual: iResult = (iVal1 != iVal2); break;
+	case OperatorGreater: iResult = bUnsigned ? (uVal1 > uVal2) : (iVal1 > iVal2); break;
+	case OperatorLess: iResult = bUnsigned ? (uVal1 < uVal2) : (iVal1 < iVal2); break;
+	case OperatorGreaterOrEqual: iResult = bUnsigned ? (uVal1 >= uVal2) : (iVal1 >= iVal2); break;
+	case OperatorLessOrEqual: iResult = bUnsigned ? (uVal1 <= uVal2) : (iVal1 <= iVal2); break;
+	default:
+		return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", sOperatorText[Operator]);
+	}
+
+	*piResult = iResult;
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::PerformDoubleOperation(MATHINSTANCE *pInst, double dVal1, MathOperator Operator, double dVal2)
+{
+	double dResult = 0;
+
+	switch (Operator)
+	{
+	case OperatorBitwiseAnd:
+	case OperatorBitwiseOr:
+	case OperatorBitwiseXor:
+	case OperatorBitwiseAndEqual:
+	case OperatorBitwiseOrEqual:
+	case OperatorBitwiseXorEqual:
+	case OperatorShiftLeft:
+	case OperatorShiftRight:
+		return this->PerformIntOperation(pInst, (int)dVal1, Operator, (int)dVal2);
+	case OperatorMultiply:
+		dResult = (dVal1 * dVal2);
+		break;
+	case OperatorDivide:
+		if (dVal2 == 0)
+		{
+			return this->SetError(ResultInvalidOperator, "Divide by zero.");
+		}
+		dResult = (dVal1 / dVal2);
+		break;
+	case OperatorAdd: dResult = (dVal1 + dVal2); break;
+	case OperatorLogicalAnd: dResult = (dVal1 && dVal2); break;
+	case OperatorLogicalOr: dResult = (dVal1 || dVal2); break;
+	case OperatorSubtract: dResult = (dVal1 - dVal2); break;
+	case OperatorEqual: dResult = (dVal1 == dVal2); break;
+	case OperatorGreater: dResult = (dVal1 > dVal2); break;
+	case OperatorLess: dResult = (dVal1 < dVal2); break;
+	case OperatorGreaterOrEqual: dResult = (dVal1 >= dVal2); break;
+	case OperatorLessOrEqual: dResult = (dVal1 <= dVal2); break;
+	case OperatorNotEqual: dResult = (dVal1 != dVal2); break;
+	case OperatorNot: dResult = (dVal1 != dVal2); break;
+	case OperatorModulus:
+		if (dVal2 == 0)
+		{
+			return this->SetError(ResultInvalidOperator, "Mod by zero.");
+		}
+		dResult = fmod(dVal1, dVal2);
+		break;
+	default:
+		return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", sOperatorText[Operator]);
+	}
+
+	if (_finite(dResult) || !_isnan(dResult))
+	{
+		pInst->RunningTotal = dResult;
+		return ResultOk;
+	}
+	else {
+		return this->SetError(ResultInfiniteOrNotANumber, "Result of %s is infinite or not a number.", sOperatorText[Operator]);
+	}
+}
+
+////
+
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int iExpressionSz, double *dResult)
+{
+	if ((this->pCache || this->cbBinaryMode) && !this->cbDebugMode)
+	{
+		MathResult ErrorCode = ResultOk;
+		if (this->pCache ? this->CalculateCached(sExpression, iExpressionSz, dResult, &ErrorCode)
+			: this->CalculateBinary(sExpression, iExpressionSz, dResult, &ErrorCode))
+		{
+			if (ErrorCode == ResultOk && this->cbBinaryMode)
+			{
+				ErrorCode = this->RoundToPrecision(dResult);
+			}
+			return ErrorCode;
+		}
+	}
+
+	if (this->cbDebugMode)
+	{
+		if (this->pDebugProc)
+		{
+			char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
+			sprintf_s(sDebugMath, sizeof(sDebugMath), "\"%s\" = {\n", sExpression);
+			this->pDebugProc(this, sDebugMath);
+		}
+		else {
+			printf("(%s) = {\n", sExpression);
+		}
+	}
+
+	MATHINSTANCE Inst;
+	memset(&Inst, 0, sizeof(Inst));
+	MathResult ErrorCode = ResultOk;
+
+	Inst.ForceIntegerMath = false;
+	//Everything allocated while calculating (including by nested calls for method parameters) is released at once.
+	CMathArena::MATHARENAMARK Mark = this->pContext->pArena->Mark();
+
+	if ((ErrorCode = this->AllocateExpression(&Inst.Expression, sExpression, iExpressionSz, false)) != ResultOk)
+	{
+		this->pContext->pArena->Release(Mark);
+		return ErrorCode;
+	}
+
+	if ((ErrorCode = this->CalculateComplexExpression(&Inst)) == ResultOk)
+	{
+		*dResult = Inst.RunningTotal;
+	}
+
+	this->pContext->pArena->Release(Mark);
+
+	if (this->cbDebugMode)
+	{
+		char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
+		sprintf_s(sDebugMath, sizeof(sDebugMath), "} = %.4f\n", *dResult);
+
+		if (this->pDebugProc)
+		{
+			this->pDebugProc(this, sDebugMath);
+		}
+		else {
+			printf("%s", sDebugMath);
+		}
+	}
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates an expression through the cache set by SetCache(), parsing and adding it on a miss. The result is the
+///	one Calculate() would return without the cache: in BinaryMode() the cached form is the one compiled by
+///	CalculateBinary(), otherwise it is only parsed and evaluated by EvaluateTextForm(), the way the token stream
+///	evaluates the text. Expressions which it can not evaluate that way are evaluated by Calculate() itself (which
+///	calls variable and method callbacks again). Only the parsing is saved, which in the default mode is a small
+///	part of the time since every operation is still rounded through its text (see BenchmarkCache in the test
+///	application).
+/// </summary>
+/// <returns>False if Calculate() has to evaluate the text itself, including for all errors.</returns>
+bool CMathParser::CalculateCached(const char *sExpression, int iExpressionSz, double *dResult, MathResult *pErrorCode)
+{
+	char sStackKey[256];
+	char *sKey = sStackKey;
+	int iKeyAllocated = iExpressionSz + 2 + 9;
+
+	//The token stream is the only evaluator of the text which EvaluateTextForm() reproduces.
+	if (!this->cbBinaryMode && !this->cbTokenizerMode)
+	{
+		return false;
+	}
+
+	CMathArena::MATHARENAMARK Mark = this->pContext->pArena->Mark();
+
+	if (iKeyAllocated > (int)sizeof(sStackKey))
+	{
+		sKey = (char *)this->pContext->pArena->Allocate(sizeof(char) * iKeyAllocated);
+		if (!sKey)
+		{
+			this->pContext->pArena->Release(Mark);
+			return false;
+		}
+	}
+
+	//The compiled and the parsed form of an expression are evaluated differently, so BinaryMode is part of the key.
+	int iTextSz = CMathCache::NormalizeKey(sExpression, iExpressionSz, this->cbBinaryMode ? 1 : 0, sKey, iKeyAllocated);
+	int iKeySz = iTextSz;
+
+	//The compiled form calls the functions registered on the parser which compiled it and reads its variables, so
+	//	it is only shared by the calls of that parser. The parsed form looks them up on the calling parser.
+	if (this->cbBinaryMode)
+	{
+		iKeySz += sprintf_s(sKey + iTextSz, iKeyAllocated - iTextSz, "#%08x", this->ciCacheIdentity);
+	}
+
+	CMathCache::MATHCACHEENTRY *pEntry = this->pCache->Acquire(sKey, iKeySz);
+	if (!pEntry)
+	{
+		CMathExpression *pExpression = NULL;
+
+		if (this->cbBinaryMode)
+		{
+			//Cached expressions are shared by every Calculate() call, they do not keep node values.
+			bool bJITMode = this->cbJITMode;
+			bool bIncrementalMode = this->cbIncrementalMode;
+			this->cbJITMode = false;
+			this->cbIncrementalMode = false;
+			sKey[iTextSz] = '\0';
+			if (this->Compile(sKey + 1, iTextSz - 1, &pExpression) != ResultOk)
+			{
+				pExpression = NULL;
+			}
+			sKey[iTextSz] = '#';
+			this->cbJITMode = bJITMode;
+			this->cbIncrementalMode = bIncrementalMode;
+		}
+		else {
+			//Folding constants or removing identities would skip the rounding of the text, the parsed form is kept.
+			pExpression = new CMathExpression(this);
+			if (pExpression->Parse(sKey + 1, iTextSz - 1) != ResultOk)
+			{
+				delete pExpression;
+				pExpression = NULL;
+			}
+		}
+
+		if (pExpression)
+		{
+			pEntry = this->pCache->Insert(sKey, iKeySz, pExpression);
+		}
+	}
+
+	this->pContext->pArena->Release(Mark);
+
+	if (!pEntry)
+	{
+		return false;
+	}
+
+	bool bResult = true;
+
+	if (this->cbBinaryMode)
+	{
+		*pErrorCode = this->Evaluate(pEntry->Expression, dResult);
+	}
+	else if ((bResult = pEntry->Expression->bTextForm))
+	{
+		MATHINSTANCE Inst;
+		MATHOPERAND Value;
+		bool bNegative = false;
+
+		memset(&Inst, 0, sizeof(Inst));
+
+		if ((bResult = this->EvaluateTextForm(&Inst, pEntry->Expression, pEntry->Expression->iRoot, &Value, &bNegative)))
+		{
+			*dResult = Value.Value;
+			*pErrorCode = ResultOk;
+		}
+	}
+
+	this->pCache->Release(pEntry);
+
+	return bResult;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates a node of an expression parsed by CalculateCached() the way the token stream evaluates the text, see
+///	CMathExpression::ScanTextForm(): variables and method results are rounded as they are when AllocateExpression
+///	writes them into the text, and parenthesized groups as they are by EvaluateTokenOperand.
+/// </summary>
+/// <param name="pInst"></param>
+/// <param name="pExpression"></param>
+/// <param name="iNode"></param>
+/// <param name="pResult"></param>
+/// <param name="pbNegative">Receives whether the text of the value starts with a minus sign.</param>
+/// <returns>False for anything the token stream would leave to the text based evaluator, including all errors.</returns>
+bool CMathParser::EvaluateTextForm(MATHINSTANCE *pInst, const CMathExpression *pExpression, int iNode, MATHOPERAND *pResult, bool *pbNegative)
+{
+	const CMathExpression::MATHNODE *pNode = &pExpression->Nodes[iNode];
+	const int *piArgs = pExpression->Arguments + pNode->FirstArg;
+
+	*pbNegative = false;
+
+	if (pNode->Type == MATHNODE_CONSTANT)
+	{
+		//Numbers are at most 15 digits long (see ScanTextForm), so the integer part is that of the double.
+		pResult->Value = pNode->Value;
+		pResult->Integer = (pNode->Value > (double)INT_MIN - 1 && pNode->Value < (double)INT_MAX + 1) ? (long)pNode->Value : 0;
+	}
+	else if (pNode->Type == MATHNODE_VARIABLE)
+	{
+		double dValue = 0;
+
+		if (!this->GetVariableValue(pExpression->Variables.Items[pNode->Index], &dValue)
+			|| !this->ReadTextValue(dValue, pResult, pbNegative))
+		{
+			return false;
+		}
+	}
+	else if (pNode->Type == MATHNODE_METHOD)
+	{
+		const char *sName = pExpression->Methods.Items[pNode->Index];
+		CMathArena::MATHARENAMARK Mark = this->pContext->pArena->Mark();
+		double *pParameters = (double *)this->pContext->pArena->Allocate(sizeof(double) * pNode->ArgCount);
+		double dProcValue = 0;
+		bool bResult = (pParameters != NULL);
+
+		for (int i = 0; bResult && i < pNode->ArgCount; i++)
+		{
+			MATHOPERAND Parameter;
+			bool bNegative = false;
+
+			if ((bResult = this->EvaluateTextForm(pInst, pExpression, piArgs[i], &Parameter, &bNegative)))
+			{
+				pParameters[i] = Parameter.Value;
+			}
+		}
+
+		if (bResult)
+		{
+			//Methods are looked up on every call, like AllocateExpression does.
+			MathMethod Method = this->GetNativeMethod(sName);
+			int iFunction = -1;
+
+			if (Method != MethodUnknown)
+			{
+				bResult = (this->ExecuteNativeMethod(Method, sName, pParameters, pNode->ArgCount, &dProcValue) == ResultOk);
+			}
+			else if ((iFunction = this->GetFunction(sName)) >= 0)
+			{
+				bResult = (this->ExecuteFunction(iFunction, pParameters, pNode->ArgCount, &dProcValue) == ResultOk);
+			}
+			else {
+				bResult = (this->pMethodProc != NULL && this->pMethodProc(this, sName, pParameters, pNode->ArgCount, &dProcValue));
+			}
+		}
+
+		this->pContext->pArena->Release(Mark);
+
+		if (!bResult || !this->ReadTextValue(dProcValue, pResult, pbNegative))
+		{
+			return false;
+		}
+	}
+	else if (pNode->Type == MATHNODE_UNARY)
+	{
+		bool bNegative = false;
+
+		if (!this->EvaluateTextForm(pInst, pExpression, piArgs[0], pResult, &bNegative))
+		{
+			return false;
+		}
+
+		if (pNode->Operator == sSecondOrder[1])
+		{
+			if (!this->ApplyTokenSign(pNode->Operator, bNegative, pResult))
+			{
+				return false;
+			}
+		}
+		else {
+			//The logical and the bitwise not are applied to the integer part as an int.
+			if (pResult->Value <= (double)INT_MIN - 1 || pResult->Value >= (double)INT_MAX + 1)
+			{
+				return false;
+			}
+
+			pResult->Integer = (pNode->Operator == sPreOrder[0]) ? !(int)pResult->Integer : ~(int)pResult->Integer;
+			pResult->Value = (double)pResult->Integer;
+		}
+	}
+	else if (pNode->Type == MATHNODE_BINARY)
+	{
+		MATHOPERAND Right;
+		bool bNegative = false;
+
+		if (!this->EvaluateTextForm(pInst, pExpression, piArgs[0], pResult, &bNegative)
+			|| !this->EvaluateTextForm(pInst, pExpression, piArgs[1], &Right, &bNegative)
+			|| !this->ApplyTokenOperator(pInst, this->GetOperator(pNode->Operator), pResult, &Right))
+		{
+			return false;
+		}
+	}
+	else {
+		return false;
+	}
+
+	if (pNode->IsGroup)
+	{
+		return this->ReadTokenGroup(pInst, pResult->Value, pResult, pbNegative);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Reads the value of a variable or of a method call back from the text AllocateExpression writes it into.
+/// </summary>
+/// <param name="dValue"></param>
+/// <param name="pResult"></param>
+/// <param name="pbNegative">Receives whether the text of the value starts with a minus sign.</param>
+/// <returns>False if the text would not be a number.</returns>
+bool CMathParser::ReadTextValue(double dValue, MATHOPERAND *pResult, bool *pbNegative)
+{
+	char sVal[64];
+
+	if (!_finite(dValue) || dValue <= -1e50 || dValue >= 1e50)
+	{
+		return false;
+	}
+
+	sprintf_s(sVal, sizeof(sVal), "%.8f", dValue);
+
+	pResult->Value = atof(sVal);
+	pResult->Integer = atol(sVal);
+	*pbNegative = (sVal[0] == '-');
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates an expression for BinaryMode() by compiling it and evaluating the compiled form once, so variables,
+///	method results and every intermediate value stay doubles instead of being written into the expression text.
+/// </summary>
+/// <returns>False if the expression could not be compiled, in which case Calculate() evaluates the text itself so
+///	that the error is reported as usual.</returns>
+bool CMathParser::CalculateBinary(const char *sExpression, int iExpressionSz, double *dResult, MathResult *pErrorCode)
+{
+	CMathExpression *pExpression = NULL;
+
+	//Machine code and node values would only be used once, they are not worth generating.
+	bool bJITMode = this->cbJITMode;
+	bool bIncrementalMode = this->cbIncrementalMode;
+	this->cbJITMode = false;
+	this->cbIncrementalMode = false;
+	MathResult ErrorCode = this->Compile(sExpression, iExpressionSz, &pExpression);
+	this->cbJITMode = bJITMode;
+	this->cbIncrementalMode = bIncrementalMode;
+
+	if (ErrorCode != ResultOk)
+	{
+		return false;
+	}
+
+	*pErrorCode = this->Evaluate(pExpression, dResult);
+
+	delete pExpression;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Rounds a value to Precision() decimal places, the same way the text based evaluator rounds each result.
+/// </summary>
+/// <param name="pdValue"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::RoundToPrecision(double *pdValue)
+{
+	char sVal[_CVTBUFSIZE * 2];
+
+	if (this->DoubleToChar(*pdValue, sVal, sizeof(sVal)) <= 0)
+	{
+		return this->SetError(ResultDoubleTextConversionFailed, "Text->Double converion failed.");
+	}
+
+	*pdValue = atof(sVal);
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, double *dResult)
+{
+	return this->Calculate(sExpression, (int)strlen(sExpression), dResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Shared by the integer overloads of Calculate(): evaluates the expression in integers on the integer token stream,
+///	see CalculateIntegerTokenStream().
+/// </summary>
+/// <param name="sExpression"></param>
+/// <param name="iExpressionSz"></param>
+/// <param name="bUnsigned"></param>
+/// <param name="b64Bit">Whether the result is a long long (unsigned long long) rather than an int (unsigned int).</param>
+/// <param name="piResult">Receives the result, the bits of an unsigned long long for unsigned 64 bit math.</param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::CalculateInteger(const char *sExpression, int iExpressionSz, bool bUnsigned, bool b64Bit, long long *piResult)
+{
+	if (this->cbDebugMode)
+	{
+		if (this->pDebugProc)
+		{
+			char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
+			sprintf_s(sDebugMath, sizeof(sDebugMath), "\"%s\" = {\n", sExpression);
+			this->pDebugProc(this, sDebugMath);
+		}
+		else {
+			printf("(%s) = {\n", sExpression);
+		}
+	}
+
+	MATHINSTANCE Inst;
+	memset(&Inst, 0, sizeof(Inst));
+	MathResult ErrorCode = ResultOk;
+
+	Inst.ForceIntegerMath = true;
+	Inst.ForceUnsignedMath = bUnsigned;
+	Inst.Force64BitMath = b64Bit;
+	//Everything allocated while calculating (including by nested calls for method parameters) is released at once.
+	CMathArena::MATHARENAMARK Mark = this->pContext->pArena->Mark();
+
+	if ((ErrorCode = this->AllocateExpression(&Inst.Expression, sExpression, iExpressionSz, true)) != ResultOk)
+	{
+		this->pContext->pArena->Release(Mark);
+		return ErrorCode;
+	}
+
+	if ((ErrorCode = this->CalculateComplexExpression(&Inst)) == ResultOk)
+	{
+		*piResult = Inst.IntegerTotal;
+	}
+
+	this->pContext->pArena->Release(Mark);
+
+	if (this->cbDebugMode)
+	{
+		char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
+		sprintf_s(sDebugMath, sizeof(sDebugMath), (bUnsigned && b64Bit) ? "} = %llu\n" : "} = %lld\n", *piResult);
+
+		if (this->pDebugProc)
+		{
+			this->pDebugProc(this, sDebugMath);
+		}
+		else {
+			printf("%s", sDebugMath);
+		}
+	}
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int iExpressionSz, unsigned int *iResult)
+{
+	long long iValue = *iResult;
+	MathResult ErrorCode = this->CalculateInteger(sExpression, iExpressionSz, true, false, &iValue);
+	*iResult = (unsigned int)iValue;
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, unsigned int *iResult)
+{
+	return this->Calculate(sExpression, (int)strlen(sExpression), iResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int iExpressionSz, int *iResult)
+{
+	long long iValue = *iResult;
+	MathResult ErrorCode = this->CalculateInteger(sExpression, iExpressionSz, false, false, &iValue);
+	*iResult = (int)iValue;
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int *iResult)
+{
+	return this->Calculate(sExpression, (int)strlen(sExpression), iResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates the expression in 64 bit integers. Numbers are read straight from the text and every operation is
+///	checked, so the result is exact and an overflow is reported (ResultIntegerOverflow) instead of losing precision.
+/// </summary>
+/// <param name="sExpression"></param>
+/// <param name="iExpressionSz"></param>
+/// <param name="iResult"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int iExpressionSz, long long *iResult)
+{
+	return this->CalculateInteger(sExpression, iExpressionSz, false, true, iResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, long long *iResult)
+{
+	return this->Calculate(sExpression, (int)strlen(sExpression), iResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, int iExpressionSz, unsigned long long *iResult)
+{
+	long long iValue = (long long)*iResult;
+	MathResult ErrorCode = this->CalculateInteger(sExpression, iExpressionSz, true, true, &iValue);
+	*iResult = (unsigned long long)iValue;
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Calculate(const char *sExpression, unsigned long long *iResult)
+{
+	return this->Calculate(sExpression, (int)strlen(sExpression), iResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Parses an expression once so that it can be evaluated many times by Evaluate() without any text processing.
+/// The resulting expression is owned by the caller and must be deleted when no longer needed.
+/// </summary>
+/// <param name="sExpression"></param>
+/// <param name="iExpressionSz"></param>
+/// <param name="pOutExpression"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::Compile(const char *sExpression, int iExpressionSz, CMathExpression **pOutExpression)
+{
+	MathResult ErrorCode = ResultOk;
+
+	*pOutExpression = NULL;
+
+	//A sub-expression which fails to fold (ex: 1/0) is left for Evaluate() to report, so the error recorded while
+	//	folding it must not be left behind once the expression has compiled.
+	CMathContext::MATHERRORRECORD ErrorRecord = this->pContext->ErrorRecord;
+	MATHERRORINFO ErrorInfo = this->pContext->LastErrorInfo;
+
+	CMathExpression *pExpression = new CMathExpression(this);
+
+	if ((ErrorCode = pExpression->Parse(sExpression, iExpressionSz)) != ResultOk
+		|| (ErrorCode = pExpression->Optimize()) != ResultOk
+		|| (ErrorCode = pExpression->Lower()) != ResultOk
+		|| (ErrorCode = pExpression->Bind()) != ResultOk
+		|| (this->cbIncrementalMode && (ErrorCode = pExpression->Track()) != ResultOk))
+	{
+		delete pExpression;
+		return ErrorCode;
+	}
+
+	this->pContext->ErrorRecord = ErrorRecord;
+	this->pContext->LastErrorInfo = ErrorInfo;
+
+	if (this->cbJITMode && CMathJIT::IsSupported())
+	{
+		//Machine code is optional, if it can not be generated the bytecode is interpreted.
+		pExpression->pJIT = new CMathJIT();
+		if (!pExpression->pJIT->Compile(pExpression))
+		{
+			delete pExpression->pJIT;
+			pExpression->pJIT = NULL;
+		}
+	}
+
+	*pOutExpression = pExpression;
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Compile(const char *sExpression, CMathExpression **pOutExpression)
+{
+	return this->Compile(sExpression, (int)strlen(sExpression), pOutExpression);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates an expression which was previously compiled by Compile(). Each distinct variable is requested
+///	from the variable callback once per evaluation.
+/// </summary>
+/// <param name="pExpression"></param>
+/// <param name="dResult"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::Evaluate(CMathExpression *pExpression, double *dResult)
+{
+	return this->Evaluate(this->pContext, pExpression, dResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Evaluate(CMathContext *pContext, const CMathExpression *pExpression, double *dResult)
+{
+	MathResult ErrorCode = ResultOk;
+
+	double dStackVariables[64];
+	double *pVariables = dStackVariables;
+	int iVariableCount = pExpression->Variables.Count;
+	CMathArena::MATHARENAMARK Mark = pContext->pArena->Mark();
+
+	if (iVariableCount > (int)(sizeof(dStackVariables) / sizeof(double)))
+	{
+		pVariables = (double *)pContext->pArena->Allocate(sizeof(double) * iVariableCount);
+		if (!pVariables)
+		{
+			return this->SetError(pContext, ResultMemoryAllocationError, "Memory allocation error.");
+		}
+	}
+
+	//Variables which were defined on this parser when the expression was compiled are read through the pointer
+	//	bound by Compile(), without looking up their name.
+	CMathVariables::MATHVALUE **pBindings = (pExpression->pParser == this) ? pExpression->Bindings : NULL;
+
+	for (int i = 0; i < iVariableCount; i++)
+	{
+		pVariables[i] = 0;
+
+		if (pBindings && pBindings[i])
+		{
+			pVariables[i] = *pBindings[i]->Pointer;
+		}
+		else if (!this->GetVariableValue(pExpression->Variables.Items[i], &pVariables[i]))
+		{
+			ErrorCode = this->SetError(pContext, ResultUndefiendVariable, "Variable was not defined: %s.", pExpression->Variables.Items[i]);
+			break;
+		}
+	}
+
+	if (ErrorCode == ResultOk)
+	{
+		ErrorCode = this->Evaluate(pContext, pExpression, (const double *)pVariables, dResult);
+	}
+
+	pContext->pArena->Release(Mark);
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates a compiled expression using variable values supplied by the caller instead of the variable callback.
+///	The slot of each variable is given by CMathExpression::VariableIndex() and does not change once compiled.
+/// </summary>
+/// <param name="pExpression"></param>
+/// <param name="pSlots">One value for each variable of the expression (CMathExpression::VariableCount()).</param>
+/// <param name="dResult"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::Evaluate(CMathExpression *pExpression, const double *pSlots, double *dResult)
+{
+	return this->Evaluate(this->pContext, pExpression, pSlots, dResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::Evaluate(CMathContext *pContext, const CMathExpression *pExpression, const double *pSlots, double *dResult)
+{
+	MathResult ErrorCode = ResultOk;
+
+	if (this->cbDebugMode && pContext == this->pContext)
+	{
+		//Walk the node list so that each operation can be shown.
+		ErrorCode = this->EvaluateNode(pExpression, pExpression->iRoot, pSlots, dResult);
+	}
+	else if (pExpression->pIncremental && pContext == this->pContext && pExpression->pParser == this)
+	{
+		//The node values belong to the parser which compiled the expression, other contexts evaluate it in full.
+		ErrorCode = this->EvaluateIncremental(pContext, pExpression, pSlots, dResult);
+	}
+	else if (pExpression->pJIT)
+	{
+		int iError = 0;
+		double dValue = pExpression->pJIT->Proc()(pSlots, &iError);
+		if (iError == 0)
+		{
+			*dResult = dValue;
+		}
+		else {
+			//The machine code only signals that something went wrong, let the interpreter report the error.
+			ErrorCode = this->Execute(pContext, pExpression, pSlots, dResult);
+		}
+	}
+	else {
+		ErrorCode = this->Execute(pContext, pExpression, pSlots, dResult);
+	}
+
+	if (ErrorCode == ResultOk && !_finite(*dResult))
+	{
+		//Calculate() cannot write such a value back into the text, the value of a method is not checked on its own.
+		ErrorCode = this->SetError(pContext, ResultInfiniteOrNotANumber, "Result is infinite or not a number.");
+	}
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates an expression compiled in IncrementalMode(). The value of every node is kept from the previous
+///	evaluation, only the nodes which depend on a variable whose value changed (and methods which may return a
+///	different value each time) are computed again. A node whose new value equals its previous value does not cause
+///	the nodes which use it to be computed again.
+/// </summary>
+/// <param name="pExpression"></param>
+/// <param name="pSlots"></param>
+/// <param name="dResult"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::EvaluateIncremental(CMathContext *pContext, const CMathExpression *pExpression, const double *pSlots, double *dResult)
+{
+	MathResult ErrorCode = ResultOk;
+
+	CMathExpression::MATHINCREMENTAL *pIncremental = pExpression->pIncremental;
+	double *pValues = pIncremental->Values;
+	char *pDirty = pIncremental->Dirty;
+	int iNodeCount = pExpression->iNodeCount;
+	int iFirstDirty = iNodeCount;
+
+	pIncremental->iRecomputed = 0;
+
+	if (!pIncremental->IsValid)
+	{
+		memset(pDirty, 1, iNodeCount);
+		iFirstDirty = 0;
+	}
+
+	for (int i = 0; i < pExpression->Variables.Count; i++)
+	{
+		int iNode = pIncremental->VariableNodes[i];
+
+		//Compared bitwise so that a change of the sign of zero is not missed (and NaN is not always a change).
+		if (iNode >= 0 && (!pIncremental->IsValid || memcmp(&pValues[iNode], &pSlots[i], sizeof(double)) != 0))
+		{
+			pValues[iNode] = pSlots[i];
+			pDirty[iNode] = 1;
+			if (iNode < iFirstDirty)
+			{
+				iFirstDirty = iNode;
+			}
+		}
+	}
+
+	for (int i = 0; i < pIncremental->iVolatileCount; i++)
+	{
+		int iNode = pIncremental->VolatileNodes[i];
+		pDirty[iNode] = 1;
+		if (iNode < iFirstDirty)
+		{
+			iFirstDirty = iNode;
+		}
+	}
+
+	//The parameters of a node always come before it, so one pass in node order sees every change before the nodes
+	//	which depend on it.
+	for (int iNode = iFirstDirty; iNode < iNodeCount; iNode++)
+	{
+		if (!pDirty[iNode])
+		{
+			continue;
+		}
+
+		pDirty[iNode] = 0;
+
+		int iProgramStart = pIncremental->ProgramStart[iNode];
+		if (iProgramStart >= 0)
+		{
+			int iArgCount = pExpression->Nodes[iNode].ArgCount;
+			double dValue = 0;
+
+			ErrorCode = this->ExecuteInstructions(pContext, pExpression, iProgramStart, iArgCount + 1,
+				iArgCount + 1, 0, pValues, &dValue);
+			pIncremental->iRecomputed++;
+
+			if (ErrorCode != ResultOk)
+			{
+				break;
+			}
+
+			if (pIncremental->IsValid && memcmp(&dValue, &pValues[iNode], sizeof(double)) == 0)
+			{
+				continue;
+			}
+
+			pValues[iNode] = dValue;
+		}
+
+		for (int i = pIncremental->ParentStart[iNode]; i < pIncremental->ParentStart[iNode + 1]; i++)
+		{
+			pDirty[pIncremental->Parents[i]] = 1;
+		}
+	}
+
+	if (ErrorCode != ResultOk)
+	{
+		//Some of the values are out of date, the next evaluation computes every node.
+		memset(pDirty, 0, iNodeCount);
+		pIncremental->IsValid = false;
+	}
+	else {
+		pIncremental->IsValid = true;
+		*dResult = pValues[pExpression->iRoot];
+	}
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Runs the bytecode of a compiled expression on a value stack.
+/// </summary>
+/// <param name="pExpression"></param>
+/// <param name="pVariables"></param>
+/// <param name="pResult"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::Execute(CMathContext *pContext, const CMathExpression *pExpression, const double *pVariables, double *pResult)
+{
+	return this->ExecuteInstructions(pContext, pExpression, 0, pExpression->iInstructionCount,
+		pExpression->iMaxStackDepth, pExpression->iTempCount, pVariables, pResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Runs a sequence of instructions of a compiled expression: the whole expression for Execute(), or the program of
+///	a single node for EvaluateIncremental().
+/// </summary>
+/// <param name="iFirstInstruction">Index into the instructions of the expression.</param>
+/// <param name="iInstructionCount"></param>
+/// <param name="iMaxStackDepth">Largest number of values the instructions keep on the stack.</param>
+/// <param name="iTempCount">Number of temporary slots used by OpStoreTemp and OpLoadTemp.</param>
+/// <param name="pVariables">Values read by OpPushVariable.</param>
+/// <param name="pResult">Receives the value left on top of the stack.</param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::ExecuteInstructions(CMathContext *pContext, const CMathExpression *pExpression,
+	int iFirstInstruction, int iInstructionCount, int iMaxStackDepth, int iTempCount, const double *pVariables, double *pResult)
+{
+	MathResult ErrorCode = ResultOk;
+
+	double dStackValues[64];
+	double *pStack = dStackValues;
+	CMathArena::MATHARENAMARK Mark = pContext->pArena->Mark();
+
+	//The temporary slots for shared operations follow the value stack.
+	if (iMaxStackDepth + iTempCount > (int)(sizeof(dStackValues) / sizeof(double)))
+	{
+		pStack = (double *)pContext->pArena->Allocate(sizeof(double) * (iMaxStackDepth + iTempCount));
+		if (!pStack)
+		{
+			return this->SetError(pContext, ResultMemoryAllocationError, "Memory allocation error.");
+		}
+	}
+
+	double *pTemps = pStack + iMaxStackDepth;
+
+	const CMathExpression::MATHINSTRUCTION *pInstruction = pExpression->Instructions + iFirstInstruction;
+	const CMathExpression::MATHINSTRUCTION *pEnd = pInstruction + iInstructionCount;
+	const double *pConstants = pExpression->Constants;
+	double *pTop = pStack - 1;
+
+	for (; pInstruction < pEnd && ErrorCode == ResultOk; pInstruction++)
+	{
+		switch (pInstruction->OpCode)
+		{
+		case CMathExpression::OpPushConstant:
+			*(++pTop) = pConstants[pInstruction->Operand];
+			break;
+		case CMathExpression::OpPushVariable:
+			*(++pTop) = pVariables[pInstruction->Operand];
+			break;
+
+		case CMathExpression::OpNegate:
+			pTop[0] = -pTop[0];
+			break;
+		case CMathExpression::OpNot:
+			pTop[0] = !((int)pTop[0]);
+			break;
+		case CMathExpression::OpBitwiseNot:
+			pTop[0] = ~((int)pTop[0]);
+			break;
+
+		case CMathExpression::OpMultiply:
+			pTop--;
+			pTop[0] = pTop[0] * pTop[1];
+			break;
+		case CMathExpression::OpDivide:
+			pTop--;
+			if (pTop[1] == 0)
+			{
+				ErrorCode = this->SetError(pContext, ResultInvalidOperator, "Divide by zero.");
+				break;
+			}
+			pTop[0] = pTop[0] / pTop[1];
+			break;
+		case CMathExpression::OpModulus:
+			pTop--;
+			if (pTop[1] == 0)
+			{
+				ErrorCode = this->SetError(pContext, ResultInvalidOperator, "Mod by zero.");
+				break;
+			}
+			pTop[0] = fmod(pTop[0], pTop[1]);
+			break;
+		case CMathExpression::OpAdd:
+			pTop--;
+			pTop[0] = pTop[0] + pTop[1];
+			break;
+		case CMathExpression::OpSubtract:
+			pTop--;
+			pTop[0] = pTop[0] - pTop[1];
+			break;
+
+		case CMathExpression::OpNotEqual:
+			pTop--;
+			pTop[0] = (pTop[0] != pTop[1]);
+			break;
+		case CMathExpression::OpLessOrEqual:
+			pTop--;
+			pTop[0] = (pTop[0] <= pTop[1]);
+			break;
+		case CMathExpression::OpGreaterOrEqual:
+			pTop--;
+			pTop[0] = (pTop[0] >= pTop[1]);
+			break;
+		case CMathExpression::OpEqual:
+			pTop--;
+			pTop[0] = (pTop[0] == pTop[1]);
+			break;
+		case CMathExpression::OpGreater:
+			pTop--;
+			pTop[0] = (pTop[0] > pTop[1]);
+			break;
+		case CMathExpression::OpLess:
+			pTop--;
+			pTop[0] = (pTop[0] < pTop[1]);
+			break;
+		case CMathExpression::OpLogicalAnd:
+			pTop--;
+			pTop[0] = (pTop[0] && pTop[1]);
+			break;
+		case CMathExpression::OpLogicalOr:
+			pTop--;
+			pTop[0] = (pTop[0] || pTop[1]);
+			break;
+
+		case CMathExpression::OpBitwiseOr:
+		case CMathExpression::OpBitwiseOrEqual:
+			pTop--;
+			pTop[0] = ((int)pTop[0] | (int)pTop[1]);
+			break;
+		case CMathExpression::OpBitwiseAnd:
+		case CMathExpression::OpBitwiseAndEqual:
+			pTop--;
+			pTop[0] = ((int)pTop[0] & (int)pTop[1]);
+			break;
+		case CMathExpression::OpBitwiseXor:
+		case CMathExpression::OpBitwiseXorEqual:
+			pTop--;
+			pTop[0] = ((int)pTop[0] ^ (int)pTop[1]);
+			break;
+		case CMathExpression::OpShiftLeft:
+			pTop--;
+			pTop[0] = ((int)pTop[0] << (int)pTop[1]);
+			break;
+		case CMathExpression::OpShiftRight:
+			pTop--;
+			pTop[0] = ((int)pTop[0] >> (int)pTop[1]);
+			break;
+
+		case CMathExpression::OpCallNative:
+			pTop -= pInstruction->ArgCount;
+			if ((ErrorCode = this->CheckNativeParameters(pContext, (MathMethod)pInstruction->Method, pTop + 1)) == ResultOk)
+			{
+				pTop[1] = this->CallNativeMethod((MathMethod)pInstruction->Method, pTop + 1, pInstruction->ArgCount);
+			}
+			pTop++;
+			break;
+		case CMathExpression::OpCallFunction:
+			pTop -= pInstruction->ArgCount;
+			if (!pInstruction->Function(this, pTop + 1, pInstruction->ArgCount, pTop + 1, pInstruction->FunctionData))
+			{
+				ErrorCode = this->SetError(pContext, ResultFunctionFailed, "Function failed: %s.", pExpression->Methods.Items[pInstruction->Operand]);
+			}
+			pTop++;
+			break;
+		case CMathExpression::OpCallMethod:
+			pTop -= pInstruction->ArgCount;
+			if (this->pMethodProc == NULL
+				|| !this->pMethodProc(this, pExpression->Methods.Items[pInstruction->Operand], pTop + 1, pInstruction->ArgCount, pTop + 1))
+			{
+				ErrorCode = this->SetError(pContext, ResultInvalidToken, "Undeclared identifier: %s.", pExpression->Methods.Items[pInstruction->Operand]);
+			}
+			pTop++;
+			break;
+
+		case CMathExpression::OpStoreTemp:
+			pTemps[pInstruction->Operand] = pTop[0];
+			break;
+		case CMathExpression::OpLoadTemp:
+			*(++pTop) = pTemps[pInstruction->Operand];
+			break;
+
+		default:
+			ErrorCode = this->SetError(pContext, ResultInvalidOperator, "Invalid instruction.");
+			break;
+		}
+
+		//Mirror PerformDoubleOperation(), which rejects results that are not a number.
+		if (pInstruction->Operator && pTop[0] != pTop[0] && ErrorCode == ResultOk)
+		{
+			ErrorCode = this->SetError(pContext, ResultInfiniteOrNotANumber, "Result of %s is infinite or not a number.", pInstruction->Operator);
+		}
+	}
+
+	if (ErrorCode == ResultOk)
+	{
+		*pResult = pTop[0];
+	}
+
+	pContext->pArena->Release(Mark);
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Evaluates a compiled expression for many rows at once. The values of each variable are passed as a column: the
+///	value of variable i (see CMathExpression::VariableIndex()) for row r is pColumns[i][r]. Rows are processed in
+///	blocks so that each instruction runs as a simple loop over the rows of the block, which the compiler can
+///	vectorize, rather than dispatching every instruction for every row.
+/// </summary>
+/// <param name="pExpression"></param>
+/// <param name="pColumns">One array of iRows values for each variable of the expression.</param>
+/// <param name="iRows"></param>
+/// <param name="pResults">Receives one result per row.</param>
+/// <returns>If any row fails the error is returned and the results of the remaining rows are undefined.</returns>
+CMathParser::MathResult CMathParser::EvaluateBatch(CMathExpression *pExpression, const double *const *pColumns, size_t iRows, double *pResults)
+{
+	MathResult ErrorCode = ResultOk;
+
+	if (this->cbDebugMode)
+	{
+		//Show the work for each row.
+		double dStackSlots[64];
+		double *pSlots = dStackSlots;
+
+		if (pExpression->Variables.Count > (int)(sizeof(dStackSlots) / sizeof(double)))
+		{
+			pSlots = (double *)calloc(sizeof(double), pExpression->Variables.Count);
+			if (!pSlots)
+			{
+				return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+			}
+		}
+
+		for (size_t iRow = 0; iRow < iRows && ErrorCode == ResultOk; iRow++)
+		{
+			for (int i = 0; i < pExpression->Variables.Count; i++)
+			{
+				pSlots[i] = pColumns[i][iRow];
+			}
+			ErrorCode = this->EvaluateNode(pExpression, pExpression->iRoot, pSlots, &pResults[iRow]);
+			if (ErrorCode == ResultOk && !_finite(pResults[iRow]))
+			{
+				ErrorCode = this->SetError(ResultInfiniteOrNotANumber, "Result is infinite or not a number.");
+			}
+		}
+
+		if (pSlots != dStackSlots)
+		{
+			free(pSlots);
+		}
+
+		return ErrorCode;
+	}
+
+	if (this->ciThreadCount != 1 && iRows > this->ciChunkSize)
+	{
+		return this->EvaluateParallel(pExpression, pColumns, iRows, pResults);
+	}
+
+	return this->EvaluateBatch(this->pContext, pExpression, pColumns, iRows, pResults);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Runs all the rows of EvaluateBatch() on the calling thread.
+/// </summary>
+CMathParser::MathResult CMathParser::EvaluateBatch(CMathContext *pContext, const CMathExpression *pExpression, const double *const *pColumns, size_t iRows, double *pResults)
+{
+	MathResult ErrorCode = ResultOk;
+	CMathArena::MATHARENAMARK Mark = pContext->pArena->Mark();
+
+	//One block of rows for each stack entry and each temporary slot, followed by the parameters of a method call.
+	double *pStack = (double *)pContext->pArena->Allocate(sizeof(double)
+		* (((size_t)(pExpression->iMaxStackDepth + pExpression->iTempCount) * CMATHPARSER_BATCH_BLOCK_SIZE) + pExpression->iMaxArgCount));
+	if (!pStack)
+	{
+		return this->SetError(pContext, ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	ErrorCode = this->ExecuteRows(pContext, pExpression, pColumns, 0, iRows, pStack, pResults);
+
+	pContext->pArena->Release(Mark);
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Splits the rows of EvaluateBatch() into chunks of ChunkSize() rows which are run by the thread pool. Errors
+///	are reported exactly as a single threaded run would report them: the rows from the first failed chunk on are
+///	run again on the calling thread.
+/// </summary>
+CMathParser::MathResult CMathParser::EvaluateParallel(CMathExpression *pExpression, const double *const *pColumns, size_t iRows, double *pResults)
+{
+	MathResult ErrorCode = ResultOk;
+	int iThreads = (this->ciThreadCount > 0) ? this->ciThreadCount : CMathThreadPool::HardwareThreads();
+
+	if (this->pThreadPool && this->pThreadPool->ThreadCount() != iThreads)
+	{
+		delete this->pThreadPool;
+		this->pThreadPool = NULL;
+	}
+
+	if (!this->pThreadPool)
+	{
+		this->pThreadPool = new CMathThreadPool(iThreads);
+	}
+
+	MATHBATCH Batch;
+	memset(&Batch, 0, sizeof(Batch));
+	Batch.Parser = this;
+	Batch.Expression = pExpression;
+	Batch.Columns = pColumns;
+	Batch.Results = pResults;
+
+	size_t iStackSz = ((size_t)(pExpression->iMaxStackDepth + pExpression->iTempCount) * CMATHPARSER_BATCH_BLOCK_SIZE) + pExpression->iMaxArgCount;
+
+	//The stacks are taken from the parser's scratch memory by this thread before the workers start, each followed
+	//	by a cache line of padding so that neighbouring workers never write to the same line.
+	CMathArena::MATHARENAMARK Mark = this->pContext->pArena->Mark();
+
+	Batch.Stacks = (double **)this->pContext->pArena->Allocate(sizeof(double *) * iThreads);
+	if (!Batch.Stacks)
+	{
+		return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	for (int iWorker = 0; iWorker < iThreads && ErrorCode == ResultOk; iWorker++)
+	{
+		Batch.Stacks[iWorker] = (double *)this->pContext->pArena->Allocate(sizeof(double) * iStackSz + 64);
+		if (!Batch.Stacks[iWorker])
+		{
+			ErrorCode = this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+		}
+	}
+
+	if (ErrorCode == ResultOk)
+	{
+		CMathVector::Level(); //Detect the instruction set before the workers need it.
+
+		this->cbParallel = true;
+		bool bSucceeded = this->pThreadPool->Run(iRows, this->ciChunkSize, &CMathParser::EvaluateChunk, &Batch);
+		this->cbParallel = false;
+
+		if (!bSucceeded)
+		{
+			size_t iFirstRow = this->pThreadPool->FailedItem();
+			ErrorCode = this->ExecuteRows(this->pContext, pExpression, pColumns, iFirstRow, iRows - iFirstRow, Batch.Stacks[0], pResults);
+		}
+	}
+
+	this->pContext->pArena->Release(Mark);
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Thread pool task for EvaluateParallel().
+/// </summary>
+bool CMathParser::EvaluateChunk(void *pContext, int iWorker, size_t iFirstRow, size_t iRows)
+{
+	MATHBATCH *pBatch = (MATHBATCH *)pContext;
+
+	return pBatch->Parser->ExecuteRows(pBatch->Parser->pContext, pBatch->Expression, pBatch->Columns,
+		iFirstRow, iRows, pBatch->Stacks[iWorker], pBatch->Results) == ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Runs a range of rows of EvaluateBatch() one block at a time, stopping at the first error.
+/// </summary>
+/// <param name="pResults">Results for all rows, the range is written at pResults + iFirstRow.</param>
+CMathParser::MathResult CMathParser::ExecuteRows(CMathContext *pContext, const CMathExpression *pExpression, const double *const *pColumns,
+	size_t iFirstRow, size_t iRows, double *pStack, double *pResults)
+{
+	MathResult ErrorCode = ResultOk;
+	size_t iEndRow = iFirstRow + iRows;
+
+	for (size_t iRow = iFirstRow; iRow < iEndRow && ErrorCode == ResultOk; iRow += CMATHPARSER_BATCH_BLOCK_SIZE)
+	{
+		int iBlockRows = (iEndRow - iRow < CMATHPARSER_BATCH_BLOCK_SIZE) ? (int)(iEndRow - iRow) : CMATHPARSER_BATCH_BLOCK_SIZE;
+		ErrorCode = this->ExecuteBlock(pContext, pExpression, pColumns, iRow, iBlockRows, pStack, pResults + iRow);
+	}
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Calls the method callback for EvaluateBatch(). While the batch is running on the thread pool the calls are
+///	serialized, unless ThreadSafeCallbacks() has been enabled. Calls made for other contexts are never serialized.
+/// </summary>
+bool CMathParser::InvokeMethodCallback(CMathContext *pContext, const char *sMethodName, double *dParameters, int iParamCount, double *pOutResult)
+{
+	if (pContext == this->pContext && this->cbParallel && !this->cbThreadSafeCallbacks)
+	{
+		this->pThreadPool->Lock(MATHPARSER_LOCK_CALLBACKS);
+		bool bResult = this->pMethodProc(this, sMethodName, dParameters, iParamCount, pOutResult);
+		this->pThreadPool->Unlock(MATHPARSER_LOCK_CALLBACKS);
+		return bResult;
+	}
+
+	return this->pMethodProc(this, sMethodName, dParameters, iParamCount, pOutResult);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Calls a registered function for ExecuteBlock(), serializing the calls of functions which are not pure the same
+///	way as the method callback (see ThreadSafeCallbacks()).
+/// </summary>
+bool CMathParser::InvokeFunction(CMathContext *pContext, TFunctionProc pProc, void *pUserData, bool bPure, double *dParameters, int iParamCount, double *pOutResult)
+{
+	if (pContext == this->pContext && this->cbParallel && !bPure && !this->cbThreadSafeCallbacks)
+	{
+		this->pThreadPool->Lock(MATHPARSER_LOCK_CALLBACKS);
+		bool bResult = pProc(this, dParameters, iParamCount, pOutResult, pUserData);
+		this->pThreadPool->Unlock(MATHPARSER_LOCK_CALLBACKS);
+		return bResult;
+	}
+
+	return pProc(this, dParameters, iParamCount, pOutResult, pUserData);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Runs the bytecode of a compiled expression over one block of rows (see EvaluateBatch()). Each entry of the
+///	value stack is an array of CMATHPARSER_BATCH_BLOCK_SIZE values, one per row.
+/// </summary>
+CMathParser::MathResult CMathParser::ExecuteBlock(CMathContext *pContext, const CMathExpression *pExpression, const double *const *pColumns,
+	size_t iFirstRow, int iRows, double *pStack, double *pResults)
+{
+	MathResult ErrorCode = ResultOk;
+
+	const CMathExpression::MATHINSTRUCTION *pInstruction = pExpression->Instructions;
+	const CMathExpression::MATHINSTRUCTION *pEnd = pInstruction + pExpression->iInstructionCount;
+	double *pTemps = pStack + (pExpression->iMaxStackDepth * CMATHPARSER_BATCH_BLOCK_SIZE);
+	double *pParameters = pTemps + (pExpression->iTempCount * CMATHPARSER_BATCH_BLOCK_SIZE); //Parameters of a method call for a single row.
+	int iTop = -1;
+
+	for (; pInstruction < pEnd && ErrorCode == ResultOk; pInstruction++)
+	{
+		double *pA = NULL; //Left operand and result.
+		double *pB = NULL; //Right operand.
+
+		if (pInstruction->OpCode >= CMathExpression::OpMultiply && pInstruction->OpCode <= CMathExpression::OpBitwiseXor)
+		{
+			iTop--;
+			pA = pStack + (iTop * CMATHPARSER_BATCH_BLOCK_SIZE);
+			pB = pA + CMATHPARSER_BATCH_BLOCK_SIZE;
+		}
+		else if (iTop >= 0)
+		{
+			pA = pStack + (iTop * CMATHPARSER_BATCH_BLOCK_SIZE);
+		}
+
+		switch (pInstruction->OpCode)
+		{
+		case CMathExpression::OpPushConstant:
+		{
+			double dValue = pExpression->Constants[pInstruction->Operand];
+			pA = pStack + (++iTop * CMATHPARSER_BATCH_BLOCK_SIZE);
+			for (int i = 0; i < iRows; i++) pA[i] = dValue;
+			break;
+		}
+		case CMathExpression::OpPushVariable:
+			pA = pStack + (++iTop * CMATHPARSER_BATCH_BLOCK_SIZE);
+			memcpy(pA, pColumns[pInstruction->Operand] + iFirstRow, sizeof(double) * iRows);
+			break;
+		case CMathExpression::OpStoreTemp:
+			memcpy(pTemps + (pInstruction->Operand * CMATHPARSER_BATCH_BLOCK_SIZE), pA, sizeof(double) * iRows);
+			break;
+		case CMathExpression::OpLoadTemp:
+			pA = pStack + (++iTop * CMATHPARSER_BATCH_BLOCK_SIZE);
+			memcpy(pA, pTemps + (pInstruction->Operand * CMATHPARSER_BATCH_BLOCK_SIZE), sizeof(double) * iRows);
+			break;
+
+		case CMathExpression::OpNegate:
+			for (int i = 0; i < iRows; i++) pA[i] = -pA[i];
+			break;
+		case CMathExpression::OpNot:
+			for (int i = 0; i < iRows; i++) pA[i] = !((int)pA[i]);
+			break;
+		case CMathExpression::OpBitwiseNot:
+			for (int i = 0; i < iRows; i++) pA[i] = ~((int)pA[i]);
+			break;
+
+		case CMathExpression::OpMultiply:
+			for (int i = 0; i < iRows; i++) pA[i] = pA[i] * pB[i];
+			break;
+		case CMathExpression::OpDivide:
+		case CMathExpression::OpModulus:
+		{
+			int iZero = 0;
+			for (int i = 0; i < iRows; i++) iZero |= (pB[i] == 0);
+			if (iZero)
+			{
+				ErrorCode = this->SetError(pContext, ResultInvalidOperator,
+					pInstruction->OpCode == CMathExpression::OpDivide ? "Divide by zero." : "Mod by zero.");
+				break;
+			}
+			if (pInstruction->OpCode == CMathExpression::OpDivide)
+			{
+				for (int i = 0; i < iRows; i++) pA[i] = pA[i] / pB[i];
+			}
+			else {
+				for (int i = 0; i < iRows; i++) pA[i] = fmod(pA[i], pB[i]);
+			}
+			break;
+		}
+		case CMathExpression::OpAdd:
+			for (int i = 0; i < iRows; i++) pA[i] = pA[i] + pB[i];
+			break;
+		case CMathExpression::OpSubtract:
+			for (int i = 0; i < iRows; i++) pA[i] = pA[i] - pB[i];
+			break;
+
+		case CMathExpression::OpNotEqual:
+			for (int i = 0; i < iRows; i++) pA[i] = (pA[i] != pB[i]);
+			break;
+		case CMathExpression::OpLessOrEqual:
+			for (int i = 0; i < iRows; i++) pA[i] = (pA[i] <= pB[i]);
+			break;
+		case CMathExpression::OpGreaterOrEqual:
+			for (int i = 0; i < iRows; i++) pA[i] = (pA[i] >= pB[i]);
+			break;
+		case CMathExpression::OpEqual:
+			for (int i = 0; i < iRows; i++) pA[i] = (pA[i] == pB[i]);
+			break;
+		case CMathExpression::OpGreater:
+			for (int i = 0; i < iRows; i++) pA[i] = (pA[i] > pB[i]);
+			break;
+		case CMathExpression::OpLess:
+			for (int i = 0; i < iRows; i++) pA[i] = (pA[i] < pB[i]);
+			break;
+		case CMathExpression::OpLogicalAnd:
+			for (int i = 0; i < iRows; i++) pA[i] = ((pA[i] != 0) & (pB[i] != 0));
+			break;
+		case CMathExpression::OpLogicalOr:
+			for (int i = 0; i < iRows; i++) pA[i] = ((pA[i] != 0) | (pB[i] != 0));
+			break;
+
+		case CMathExpression::OpBitwiseOr:
+		case CMathExpression::OpBitwiseOrEqual:
+			for (int i = 0; i < iRows; i++) pA[i] = ((int)pA[i] | (int)pB[i]);
+			break;
+		case CMathExpression::OpBitwiseAnd:
+		case CMathExpression::OpBitwiseAndEqual:
+			for (int i = 0; i < iRows; i++) pA[i] = ((int)pA[i] & (int)pB[i]);
+			break;
+		case CMathExpression::OpBitwiseXor:
+		case CMathExpression::OpBitwiseXorEqual:
+			for (int i = 0; i < iRows; i++) pA[i] = ((int)pA[i] ^ (int)pB[i]);
+			break;
+		case CMathExpression::OpShiftLeft:
+			for (int i = 0; i < iRows; i++) pA[i] = ((int)pA[i] << (int)pB[i]);
+			break;
+		case CMathExpression::OpShiftRight:
+			for (int i = 0; i < iRows; i++) pA[i] = ((int)pA[i] >> (int)pB[i]);
+			break;
+
+		case CMathExpression::OpCallNative:
+		case CMathExpression::OpCallFunction:
+		case CMathExpression::OpCallMethod:
+		{
+			const char *sMethodName = pExpression->Methods.Items[pInstruction->Operand];
+			const double *pArgs[16];
+
+			//The result replaces the first parameter (or is pushed if there are none).
+			iTop -= pInstruction->ArgCount;
+			double *pFirst = pStack + ((iTop + 1) * CMATHPARSER_BATCH_BLOCK_SIZE);
+
+			//Use the array implementation of the native method where there is one.
+			if (pInstruction->OpCode == CMathExpression::OpCallNative && pInstruction->ArgCount > 0
+				&& pInstruction->ArgCount <= (int)(sizeof(pArgs) / sizeof(pArgs[0])))
+			{
+				for (int iArg = 0; iArg < pInstruction->ArgCount; iArg++)
+				{
+					pArgs[iArg] = pFirst + (iArg * CMATHPARSER_BATCH_BLOCK_SIZE);
+				}
+
+				if (CMathVector::Execute((MathMethod)pInstruction->Method, pInstruction->ArgCount, pArgs, pFirst, iRows, this->cbVectorMathMode))
+				{
+					pA = pFirst;
+					iTop++;
+					break;
+				}
+			}
+
+			for (int i = 0; i < iRows && ErrorCode == ResultOk; i++)
+			{
+				for (int iArg = 0; iArg < pInstruction->ArgCount; iArg++)
+				{
+					pParameters[iArg] = pFirst[(iArg * CMATHPARSER_BATCH_BLOCK_SIZE) + i];
+				}
+
+				if (pInstruction->OpCode == CMathExpression::OpCallNative)
+				{
+					if ((ErrorCode = this->CheckNativeParameters(pContext, (MathMethod)pInstruction->Method, pParameters)) == ResultOk)
+					{
+						pFirst[i] = this->CallNativeMethod((MathMethod)pInstruction->Method, pParameters, pInstruction->ArgCount);
+					}
+				}
+				else if (pInstruction->OpCode == CMathExpression::OpCallFunction)
+				{
+					if (!this->InvokeFunction(pContext, pInstruction->Function, pInstruction->FunctionData, pInstruction->IsPure,
+						pParameters, pInstruction->ArgCount, &pFirst[i]))
+					{
+						ErrorCode = this->SetError(pContext, ResultFunctionFailed, "Function failed: %s.", sMethodName);
+					}
+				}
+				else if (this->pMethodProc == NULL
+					|| !this->InvokeMethodCallback(pContext, sMethodName, pParameters, pInstruction->ArgCount, &pFirst[i]))
+				{
+					ErrorCode = this->SetError(pContext, ResultInvalidToken, "Undeclared identifier: %s.", sMethodName);
+				}
+			}
+
+			pA = pFirst;
+			iTop++;
+			break;
+		}
+
+		default:
+			ErrorCode = this->SetError(pContext, ResultInvalidOperator, "Invalid instruction.");
+			break;
+		}
+
+		//Mirror PerformDoubleOperation(), which rejects results that are not a number.
+		if (pInstruction->Operator && ErrorCode == ResultOk)
+		{
+			int iNaN = 0;
+			for (int i = 0; i < iRows; i++) iNaN |= (pA[i] != pA[i]);
+			if (iNaN)
+			{
+				ErrorCode = this->SetError(pContext, ResultInfiniteOrNotANumber, "Result of %s is infinite or not a number.", pInstruction->Operator);
+			}
+		}
+	}
+
+	if (ErrorCode == ResultOk)
+	{
+		//The result of a method is only checked once it is the result of the whole expression (see Evaluate()).
+		int iNotFinite = 0;
+		for (int i = 0; i < iRows; i++) iNotFinite |= !_finite(pStack[i]);
+		if (iNotFinite)
+		{
+			ErrorCode = this->SetError(pContext, ResultInfiniteOrNotANumber, "Result is infinite or not a number.");
+		}
+		else {
+			memcpy(pResults, pStack, sizeof(double) * iRows);
+		}
+	}
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MathResult CMathParser::EvaluateNode(const CMathExpression *pExpression, int iNode, const double *pVariables, double *pResult)
+{
+	MathResult ErrorCode = ResultOk;
+	CMathExpression::MATHNODE *pNode = &pExpression->Nodes[iNode];
+	const int *piArgs = pExpression->Arguments + pNode->FirstArg;
+
+	MATHINSTANCE Inst;
+	memset(&Inst, 0, sizeof(Inst));
+
+	if (pNode->Type == MATHNODE_CONSTANT)
+	{
+		*pResult = pNode->Value;
+	}
+	else if (pNode->Type == MATHNODE_VARIABLE)
+	{
+		*pResult = pVariables[pNode->Index];
+	}
+	else if (pNode->Type == MATHNODE_UNARY)
+	{
+		double dVal = 0;
+
+		if ((ErrorCode = this->EvaluateNode(pExpression, piArgs[0], pVariables, &dVal)) != ResultOk)
+		{
+			return ErrorCode;
+		}
+
+		if (pNode->Operator[0] == '!')
+		{
+			ErrorCode = this->PerformBooleanOperation(&Inst, (int)dVal, OperatorNot);
+		}
+		else if (pNode->Operator[0] == '~')
+		{
+			ErrorCode = this->PerformIntOperation(&Inst, (int)dVal, OperatorBitwiseNot, 0);
+		}
+		else if (pNode->Operator[0] == '-')
+		{
+			Inst.RunningTotal = -dVal;
+		}
+		else {
+			return this->SetError(ResultInvalidOperator, "Invalid operator: %s.", pNode->Operator);
+		}
+
+		*pResult = Inst.RunningTotal;
+	}
+	else if (pNode->Type == MATHNODE_BINARY)
+	{
+		double dVal1 = 0;
+		double dVal2 = 0;
+
+		if ((ErrorCode = this->EvaluateNode(pExpression, piArgs[0], pVariables, &dVal1)) != ResultOk)
+		{
+			return ErrorCode;
+		}
+		if ((ErrorCode = this->EvaluateNode(pExpression, piArgs[1], pVariables, &dVal2)) != ResultOk)
+		{
+			return ErrorCode;
+		}
+		if ((ErrorCode = this->PerformDoubleOperation(&Inst, dVal1, this->GetOperator(pNode->Operator), dVal2)) != ResultOk)
+		{
+			return ErrorCode;
+		}
+
+		if (this->cbDebugMode)
+		{
+			//The text is kept off the stack, which has to hold a frame for every level of the tree.
+			CMathArena::MATHARENAMARK Mark = this->pContext->pArena->Mark();
+			int iDebugMathSz = 1024 + (_CVTBUFSIZE * 2);
+			char *sDebugMath = (char *)this->pContext->pArena->Allocate(sizeof(char) * iDebugMathSz);
+			if (!sDebugMath)
+			{
+				return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+			}
+
+			sprintf_s(sDebugMath, iDebugMathSz, "\t(%.4f %s %.4f) = %.4f\n", dVal1, pNode->Operator, dVal2, Inst.RunningTotal);
+
+			if (this->pDebugProc)
+			{
+				this->pDebugProc(this, sDebugMath);
+			}
+			else {
+				printf("%s", sDebugMath);
+			}
+
+			this->pContext->pArena->Release(Mark);
+		}
+
+		*pResult = Inst.RunningTotal;
+	}
+	else if (pNode->Type == MATHNODE_METHOD)
+	{
+		const char *sMethodName = pExpression->Methods.Items[pNode->Index];
+
+		//Nested calls are evaluated while the parameters are being filled, so each call takes its own.
+		CMathArena::MATHARENAMARK Mark = this->pContext->pArena->Mark();
+		double *pParameters = (double *)this->pContext->pArena->Allocate(sizeof(double) * pNode->ArgCount);
+		if (!pParameters)
+		{
+			return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+		}
+
+		for (int i = 0; i < pNode->ArgCount && ErrorCode == ResultOk; i++)
+		{
+			ErrorCode = this->EvaluateNode(pExpression, piArgs[i], pVariables, &pParameters[i]);
+		}
+
+		if (ErrorCode == ResultOk)
+		{
+			if (pNode->IsNative)
+			{
+				ErrorCode = this->ExecuteNativeMethod(this->GetNativeMethod(sMethodName), sMethodName, pParameters, pNode->ArgCount, pResult);
+			}
+			else if (pNode->Function >= 0)
+			{
+				ErrorCode = this->ExecuteFunction(pNode->Function, pParameters, pNode->ArgCount, pResult);
+			}
+			else if (this->pMethodProc != NULL && this->pMethodProc(this, sMethodName, pParameters, pNode->ArgCount, pResult))
+			{
+				//Non-native method executed successfully.
+			}
+			else
+			{
+				ErrorCode = this->SetError(ResultInvalidToken, "Undeclared identifier: %s.", sMethodName);
+			}
+		}
+
+		this->pContext->pArena->Release(Mark);
+	}
+	else {
+		return this->SetError(ResultInvalidToken, "Invalid expression node.");
+	}
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::CMathParser(short iPrecision)
+{
+	this->Precision(iPrecision);
+	this->pDebugProc = NULL;
+	this->pVariableSetProc = NULL;
+	this->pMethodProc = NULL;
+	this->cbDebugMode = false;
+	this->cbJITMode = false;
+	this->cbIncrementalMode = false;
+	this->cbTokenizerMode = true;
+	this->cbBinaryMode = false;
+	this->cbVectorMathMode = false;
+	this->cbThreadSafeCallbacks = false;
+	this->cbParallel = false;
+	this->ciThreadCount = 1;
+	this->ciChunkSize = CMATHPARSER_DEFAULT_CHUNK_SIZE;
+	this->pThreadPool = NULL;
+	this->pCache = NULL;
+	this->ciCacheIdentity = iNextCacheIdentity++;
+	this->pLexer = NULL;
+	this->Functions = NULL;
+	this->iFunctionCount = 0;
+	this->iFunctionsAllocated = 0;
+	this->pVariableStore = NULL;
+	this->pContext = new CMathContext(this);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::CMathParser(void)
+{
+	this->Precision(CMATHPARSER_DEFAULT_PRECISION);
+	this->pDebugProc = NULL;
+	this->pVariableSetProc = NULL;
+	this->pMethodProc = NULL;
+	this->cbDebugMode = false;
+	this->cbJITMode = false;
+	this->cbIncrementalMode = false;
+	this->cbTokenizerMode = true;
+	this->cbBinaryMode = false;
+	this->cbVectorMathMode = false;
+	this->cbThreadSafeCallbacks = false;
+	this->cbParallel = false;
+	this->ciThreadCount = 1;
+	this->ciChunkSize = CMATHPARSER_DEFAULT_CHUNK_SIZE;
+	this->pThreadPool = NULL;
+	this->pCache = NULL;
+	this->ciCacheIdentity = iNextCacheIdentity++;
+	this->pLexer = NULL;
+	this->Functions = NULL;
+	this->iFunctionCount = 0;
+	this->iFunctionsAllocated = 0;
+	this->pVariableStore = NULL;
+	this->pContext = new CMathContext(this);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::~CMathParser(void)
+{
+	if (this->pThreadPool)
+	{
+		delete this->pThreadPool;
+		this->pThreadPool = NULL;
+	}
+
+	if (this->pLexer)
+	{
+		delete this->pLexer;
+		this->pLexer = NULL;
+	}
+
+	if (this->pVariableStore)
+	{
+		delete this->pVariableStore;
+		this->pVariableStore = NULL;
+	}
+
+	if (this->pContext)
+	{
+		delete this->pContext;
+		this->pContext = NULL;
+	}
+
+	for (int i = 0; i < this->iFunctionCount; i++)
+	{
+		free(this->Functions[i].Name);
+	}
+	free(this->Functions);
+	this->Functions = NULL;
+	this->iFunctionCount = 0;
+	this->iFunctionsAllocated = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+short CMathParser::Precision(short iPrecision)
+{
+	if (iPrecision > CMATHPARSER_MAX_PRECISION)
+	{
+		iPrecision = CMATHPARSER_MAX_PRECISION;
+	}
+	else if (iPrecision < CMATHPARSER_MIN_PRECISION)
+	{
+		iPrecision = CMATHPARSER_MIN_PRECISION;
+	}
+
+	short iOldPrecision = this->ciPrecision;
+	this->ciPrecision = iPrecision;
+	return iOldPrecision;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+short CMathParser::Precision(void)
+{
+	return this->ciPrecision;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::DebugMode(bool bDebugMode)
+{
+	bool bOldDebugMode = this->cbDebugMode;
+	this->cbDebugMode = bDebugMode;
+	return bOldDebugMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::TMethodCallback CMathParser::GetMethodCallback(void)
+{
+	return this->pMethodProc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::TMethodCallback CMathParser::SetMethodCallback(TMethodCallback procPtr)
+{
+	TMethodCallback oldProcPtr = this->pMethodProc;
+	this->pMethodProc = procPtr;
+	return oldProcPtr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Adds a custom function which, unlike the method callback, is found by name when the expression is compiled:
+///	the number of parameters is checked once by Compile() and the compiled expression calls pProc directly. Pure
+///	functions (FunctionPure) with constant parameters are evaluated by Compile() and repeated calls with the same
+///	parameters are only made once per evaluation. Registering a name again replaces the function. Expressions
+///	which were compiled before a function was (re)registered keep calling what they were compiled with, so the
+///	cache set by SetCache() is cleared; parsers which share a cache should register the same functions.
+/// </summary>
+/// <param name="sName">Name of the function, made of variable characters. Built-in methods can not be replaced.</param>
+/// <param name="iMinArgs">Least number of parameters.</param>
+/// <param name="iMaxArgs">Greatest number of parameters, -1 for no limit.</param>
+/// <param name="iFlags">FunctionFlags.</param>
+/// <param name="pProc"></param>
+/// <param name="pUserData">Value passed to each call of pProc.</param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::RegisterFunction(const char *sName, int iMinArgs, int iMaxArgs, int iFlags, TFunctionProc pProc, void *pUserData)
+{
+	if (!this->IsValidName(sName))
+	{
+		return this->SetError(ResultInvalidToken, "Invalid function name: %s.", sName);
+	}
+
+	if (this->IsNativeMethod(sName))
+	{
+		return this->SetError(ResultInvalidToken, "Built-in methods can not be replaced: %s.", sName);
+	}
+
+	if (pProc == NULL || iMinArgs < 0 || (iMaxArgs >= 0 && iMaxArgs < iMinArgs))
+	{
+		return this->SetError(ResultInvalidToken, "Invalid function declaration: %s.", sName);
+	}
+
+	int iFunction = this->GetFunction(sName);
+
+	if (iFunction < 0)
+	{
+		if (this->iFunctionCount >= this->iFunctionsAllocated)
+		{
+			int iAllocate = (this->iFunctionsAllocated == 0) ? 8 : this->iFunctionsAllocated * 2;
+			MATHFUNCTION *pFunctions = (MATHFUNCTION *)realloc(this->Functions, sizeof(MATHFUNCTION) * iAllocate);
+			if (!pFunctions)
+			{
+				return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+			}
+			this->Functions = pFunctions;
+			this->iFunctionsAllocated = iAllocate;
+		}
+
+		int iNameSz = (int)strlen(sName);
+		char *sCopy = (char *)calloc(sizeof(char), iNameSz + 1);
+		if (!sCopy)
+		{
+			return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+		}
+		strcpy_s(sCopy, iNameSz + 1, sName);
+
+		iFunction = this->iFunctionCount++;
+		this->Functions[iFunction].Name = sCopy;
+	}
+
+	MATHFUNCTION *pFunction = &this->Functions[iFunction];
+	pFunction->MinArgs = iMinArgs;
+	pFunction->MaxArgs = iMaxArgs;
+	pFunction->Flags = iFlags;
+	pFunction->Proc = pProc;
+	pFunction->UserData = pUserData;
+
+	if (this->pCache)
+	{
+		this->pCache->Clear();
+	}
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Defines a variable (or changes its value) without a variable callback. Variables defined this way take
+///	precedence over the callback and are read by compiled expressions through a pointer bound by Compile(), so
+///	updating one between evaluations costs a single store. If the variable is bound to a double (see
+///	BindVariable()), that double is changed.
+/// </summary>
+/// <param name="sName">Name of the variable (case insensitive).</param>
+/// <param name="dValue"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::SetVariable(const char *sName, double dValue)
+{
+	double *pValue = this->VariablePointer(sName);
+	if (!pValue)
+	{
+		return this->pContext->LastErrorInfo.Error;
+	}
+
+	*pValue = dValue;
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Binds a variable to a double owned by the caller, which is read each time the variable is used (it must outlive
+///	the binding). Passing NULL gives the variable its own value back, which is the value it had before it was bound.
+/// </summary>
+/// <param name="sName">Name of the variable (case insensitive), it is defined if it is not already.</param>
+/// <param name="pValue"></param>
+/// <returns></returns>
+CMathParser::MathResult CMathParser::BindVariable(const char *sName, double *pValue)
+{
+	if (!this->IsValidName(sName))
+	{
+		return this->SetError(ResultInvalidToken, "Invalid variable name: %s.", sName);
+	}
+
+	if (!this->pVariableStore)
+	{
+		this->pVariableStore = new CMathVariables();
+	}
+
+	CMathVariables::MATHVALUE *pVariable = this->pVariableStore->Define(sName);
+	if (!pVariable)
+	{
+		return this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+	}
+
+	pVariable->Pointer = pValue ? pValue : &pVariable->Value;
+
+	return ResultOk;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns where the value of a variable is stored, defining the variable (with a value of zero) if it is not
+///	defined yet, so that it can be updated with a single store. The pointer stays valid for the life of the parser
+///	but is not updated by a later BindVariable().
+/// </summary>
+/// <param name="sName">Name of the variable (case insensitive).</param>
+/// <returns>NULL if the name is invalid or memory could not be allocated, see LastError().</returns>
+double *CMathParser::VariablePointer(const char *sName)
+{
+	if (!this->IsValidName(sName))
+	{
+		this->SetError(ResultInvalidToken, "Invalid variable name: %s.", sName);
+		return NULL;
+	}
+
+	if (!this->pVariableStore)
+	{
+		this->pVariableStore = new CMathVariables();
+	}
+
+	CMathVariables::MATHVALUE *pVariable = this->pVariableStore->Define(sName);
+	if (!pVariable)
+	{
+		this->SetError(ResultMemoryAllocationError, "Memory allocation error.");
+		return NULL;
+	}
+
+	return pVariable->Pointer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Gets the value of a variable from the variables set by SetVariable() and BindVariable() or, failing that,
+///	from the variable callback.
+/// </summary>
+/// <param name="sName"></param>
+/// <param name="pOutValue"></param>
+/// <returns>False if the variable is not defined.</returns>
+bool CMathParser::GetVariableValue(const char *sName, double *pOutValue)
+{
+	if (this->pVariableStore)
+	{
+		CMathVariables::MATHVALUE *pVariable = this->pVariableStore->Find(sName);
+		if (pVariable)
+		{
+			*pOutValue = *pVariable->Pointer;
+			return true;
+		}
+	}
+
+	return this->pVariableSetProc && this->pVariableSetProc(this, sName, pOutValue);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of times the parser's scratch memory had to be taken from the heap. Calculate(), Evaluate()
+///	and EvaluateBatch() reuse the same memory on every call, so this stops changing once the largest expression
+///	(and batch) has been seen.
+/// </summary>
+/// <returns></returns>
+size_t CMathParser::HeapAllocations(void)
+{
+	return this->pContext->pArena->HeapAllocations();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::TVariableSetCallback CMathParser::GetVariableSetCallback(void)
+{
+	return this->pVariableSetProc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::TVariableSetCallback CMathParser::SetVariableSetCallback(TVariableSetCallback procPtr)
+{
+	TVariableSetCallback oldProcPtr = this->pVariableSetProc;
+	this->pVariableSetProc = procPtr;
+	return oldProcPtr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::TDebugTextCallback CMathParser::GetDebugCallback(void)
+{
+	return this->pDebugProc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::TDebugTextCallback CMathParser::SetDebugCallback(TDebugTextCallback procPtr)
+{
+	TDebugTextCallback oldProcPtr = this->pDebugProc;
+	this->pDebugProc = procPtr;
+	return oldProcPtr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathCache *CMathParser::GetCache(void)
+{
+	return this->pCache;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Attaches a cache of compiled expressions (NULL, the default, detaches it). While a cache is attached,
+///	Calculate() with a double result compiles each distinct expression once and evaluates the compiled form
+///	(see Evaluate()), so method results and variables are used at full precision instead of being rounded to
+///	eight decimal places. One cache can be shared by the parsers of several threads; it must outlive them.
+/// </summary>
+/// <param name="pCache"></param>
+/// <returns>The previous cache.</returns>
+CMathCache *CMathParser::SetCache(CMathCache *pCache)
+{
+	CMathCache *pOldCache = this->pCache;
+	this->pCache = pCache;
+	return pOldCache;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::DebugMode(void)
+{
+	return this->cbDebugMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// When enabled, Compile() also translates expressions to native machine code (x86-64 only). Expressions which
+///	use methods implemented by the method callback are always interpreted.
+/// </summary>
+/// <param name="bJITMode"></param>
+/// <returns>The previous setting.</returns>
+bool CMathParser::JITMode(bool bJITMode)
+{
+	bool bOldJITMode = this->cbJITMode;
+	this->cbJITMode = bJITMode;
+	return bOldJITMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::JITMode(void)
+{
+	return this->cbJITMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// When enabled, Compile() prepares expressions to keep the value of each node between evaluations, so that
+///	Evaluate() only computes the parts of the expression which depend on variables whose values changed. This pays
+///	off for large expressions of which only a few variables change between evaluations. Incremental evaluation is
+///	only used on the parser's own context, expressions evaluated with other contexts are computed in full.
+/// </summary>
+/// <param name="bIncrementalMode"></param>
+/// <returns>The previous setting.</returns>
+bool CMathParser::IncrementalMode(bool bIncrementalMode)
+{
+	bool bOldIncrementalMode = this->cbIncrementalMode;
+	this->cbIncrementalMode = bIncrementalMode;
+	return bOldIncrementalMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IncrementalMode(void)
+{
+	return this->cbIncrementalMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// When enabled (the default), Calculate() evaluates the expression from a token stream in a single pass instead of
+///	repeatedly searching the text for the next operator and writing each result back into the text, which takes
+///	time proportional to the square of the length of the expression. Both give the same results and errors, this
+///	only exists to compare the two. Debug mode always uses the text based evaluator, which shows its work.
+/// </summary>
+/// <param name="bTokenizerMode"></param>
+/// <returns>The previous setting.</returns>
+bool CMathParser::TokenizerMode(bool bTokenizerMode)
+{
+	bool bOldTokenizerMode = this->cbTokenizerMode;
+	this->cbTokenizerMode = bTokenizerMode;
+	return bOldTokenizerMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::TokenizerMode(void)
+{
+	return this->cbTokenizerMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// When enabled, Calculate() with a double result keeps every intermediate value (including variables and method
+///	results) as a double from start to finish, and only rounds the final result to Precision() decimal places.
+///	Otherwise each result is written back into the expression text: parenthesized results are rounded to
+///	Precision() significant digits, operations to Precision() decimal places and variables and method results to
+///	eight decimal places. The expression is compiled (see Compile()) and evaluated once; expressions which can not
+///	be compiled are evaluated as text so that the error is reported as usual. Integer results are not affected.
+///
+/// Prefix operators are applied to values like Evaluate() applies them, which differs from the text for a sign in
+///	front of a negative value and for chains of prefix operators: the text keeps the sign of a negative value
+///	("-(2-3)" and "--9" are -1 and -9, 9 and 1 here), reads "-!2" as 1 (0 here) and rejects "!!4" (1 here).
+/// </summary>
+/// <param name="bBinaryMode"></param>
+/// <returns>The previous setting.</returns>
+bool CMathParser::BinaryMode(bool bBinaryMode)
+{
+	bool bOldBinaryMode = this->cbBinaryMode;
+	this->cbBinaryMode = bBinaryMode;
+	return bOldBinaryMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::BinaryMode(void)
+{
+	return this->cbBinaryMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// When enabled, EvaluateBatch() also uses the SIMD implementations of EXP, LOG, LOG10, SIN, COS and POW. These
+///	are not guaranteed to round exactly like the C runtime (see CMathVector.h for the error bounds). The exact
+///	SIMD implementations (SQRT, ABS, FLOOR and CEIL) are always used.
+/// </summary>
+/// <param name="bVectorMathMode"></param>
+/// <returns>The previous setting.</returns>
+bool CMathParser::VectorMathMode(bool bVectorMathMode)
+{
+	bool bOldVectorMathMode = this->cbVectorMathMode;
+	this->cbVectorMathMode = bVectorMathMode;
+	return bOldVectorMathMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::VectorMathMode(void)
+{
+	return this->cbVectorMathMode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Sets the number of threads used by EvaluateBatch() for batches of more than ChunkSize() rows. The thread
+///	calling EvaluateBatch() is one of them. 0 uses one thread per core, 1 (the default) disables threading.
+/// </summary>
+/// <param name="iThreadCount"></param>
+/// <returns>The previous setting.</returns>
+int CMathParser::ThreadCount(int iThreadCount)
+{
+	int iOldThreadCount = this->ciThreadCount;
+	this->ciThreadCount = (iThreadCount < 0) ? 0 : iThreadCount;
+	return iOldThreadCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CMathParser::ThreadCount(void)
+{
+	return this->ciThreadCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Sets the number of rows handed to a thread at a time by EvaluateBatch(), rounded up to a multiple of
+///	CMATHPARSER_BATCH_BLOCK_SIZE. Smaller chunks balance the work better, larger chunks have less overhead.
+/// </summary>
+/// <param name="iChunkSize"></param>
+/// <returns>The previous setting.</returns>
+size_t CMathParser::ChunkSize(size_t iChunkSize)
+{
+	size_t iOldChunkSize = this->ciChunkSize;
+	if (iChunkSize < CMATHPARSER_BATCH_BLOCK_SIZE)
+	{
+		iChunkSize = CMATHPARSER_BATCH_BLOCK_SIZE;
+	}
+	this->ciChunkSize = ((iChunkSize + CMATHPARSER_BATCH_BLOCK_SIZE - 1) / CMATHPARSER_BATCH_BLOCK_SIZE) * CMATHPARSER_BATCH_BLOCK_SIZE;
+	return iOldChunkSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t CMathParser::ChunkSize(void)
+{
+	return this->ciChunkSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// By default a multi-threaded EvaluateBatch() calls the method callback from one thread at a time. Enable this
+///	if the callback can safely be called from several threads at once (it must not use the parser passed to it).
+/// </summary>
+/// <param name="bThreadSafeCallbacks"></param>
+/// <returns>The previous setting.</returns>
+bool CMathParser::ThreadSafeCallbacks(bool bThreadSafeCallbacks)
+{
+	bool bOldThreadSafeCallbacks = this->cbThreadSafeCallbacks;
+	this->cbThreadSafeCallbacks = bThreadSafeCallbacks;
+	return bOldThreadSafeCallbacks;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::ThreadSafeCallbacks(void)
+{
+	return this->cbThreadSafeCallbacks;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathParser::MATHERRORINFO *CMathParser::LastError(void)
+{
+	return this->pContext->LastError();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Records an error of the parser's own calls. Only the code, the format (which must be a literal) and its
+///	parameters are kept, the message is formatted when LastError() is called.
+/// </summary>
+/// <param name="ErrorCode"></param>
+/// <param name="sFormat">Literal format, supports %c, %d and %s.</param>
+/// <returns>ErrorCode.</returns>
+CMathParser::MathResult CMathParser::SetError(MathResult ErrorCode, const char *sFormat, ...)
+{
+	va_list ArgList;
+	va_start(ArgList, sFormat);
+	this->ReportError(this->pContext, ErrorCode, -1, sFormat, ArgList);
+	va_end(ArgList);
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Records an error found at a known offset into the expression, see SetError().
+/// </summary>
+CMathParser::MathResult CMathParser::SetErrorAt(MathResult ErrorCode, int iPosition, const char *sFormat, ...)
+{
+	va_list ArgList;
+	va_start(ArgList, sFormat);
+	this->ReportError(this->pContext, ErrorCode, iPosition, sFormat, ArgList);
+	va_end(ArgList);
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Records an error of an evaluation made through a context (the parser's own or a CMathContext), see SetError().
+/// </summary>
+CMathParser::MathResult CMathParser::SetError(CMathContext *pContext, MathResult ErrorCode, const char *sFormat, ...)
+{
+	va_list ArgList;
+	va_start(ArgList, sFormat);
+	this->ReportError(pContext, ErrorCode, -1, sFormat, ArgList);
+	va_end(ArgList);
+
+	return ErrorCode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathParser::ReportError(CMathContext *pContext, MathResult ErrorCode, int iPosition, const char *sFormat, va_list ArgList)
+{
+	if (pContext != this->pContext)
+	{
+		//Other contexts belong to a single thread and do not show the work.
+		pContext->RecordError(ErrorCode, iPosition, sFormat, ArgList);
+		return;
+	}
+
+	//The workers of a multi-threaded EvaluateBatch() share the error information.
+	bool bLocked = this->cbParallel;
+	if (bLocked)
+	{
+		this->pThreadPool->Lock(MATHPARSER_LOCK_ERRORS);
+	}
+
+	pContext->RecordError(ErrorCode, iPosition, sFormat, ArgList);
+
+	if (this->cbDebugMode)
+	{
+		char sDebugMath[1024 + (_CVTBUFSIZE * 2)];
+		sprintf_s(sDebugMath, sizeof(sDebugMath), "\t%s\n", pContext->LastError()->Text);
+
+		if (this->pDebugProc)
+		{
+			this->pDebugProc(this, sDebugMath);
+		}
+		else {
+			printf("%s", sDebugMath);
+		}
+	}
+
+	if (bLocked)
+	{
+		this->pThreadPool->Unlock(MATHPARSER_LOCK_ERRORS);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::ReverseString(char *sBuf, int iBufSz)
+{
+	char *String1 = NULL;
+	char *String2 = NULL;
+
+	if (!sBuf || !*sBuf)
+	{
+		return false;
+	}
+
+	for (String1 = sBuf, String2 = sBuf + iBufSz - 1; String2 > String1; ++String1, --String2)
+	{
+		*String1 ^= *String2;
+		*String2 ^= *String1;
+		*String1 ^= *String2;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IsWhiteSpace(const char cChar)
+{
+	if (cChar == ' ' || cChar == '\r' || cChar == '\n' || cChar == '\t' || cChar == '\0')
+	{
+		return true;
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether a name can be used for a variable or function: variable characters only, not starting
+///	with a digit and shorter than CMATHPARSER_MAX_VAR_LENGTH.
+/// </summary>
+/// <param name="sName"></param>
+/// <returns></returns>
+bool CMathParser::IsValidName(const char *sName)
+{
+	int iNameSz = 0;
+
+	if (sName == NULL || sName[0] == '\0' || this->IsNumeric(sName[0]))
+	{
+		return false;
+	}
+
+	for (; sName[iNameSz]; iNameSz++)
+	{
+		if (iNameSz >= CMATHPARSER_MAX_VAR_LENGTH - 1 || !this->IsValidVariableChar(sName[iNameSz]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IsNumeric(const char cIn)
+{
+	return (cIn >= 48 && cIn <= 57);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IsNumeric(const char *sText, int iLength)
+{
+	int iRPos = 0;
+	bool bHasDecimal = false;
+
+	if (iLength == 0)
+	{
+		return false;
+	}
+
+	if (sText[iRPos] == '-' || sText[iRPos] == '+')
+	{
+		iRPos++;
+	}
+
+	for (; iRPos < iLength; iRPos++)
+	{
+		if (!IsNumeric(sText[iRPos]))
+		{
+			if (sText[iRPos] == '.')
+			{
+				if (iRPos == iLength - 1) //Decimal cannot be the last character.
+				{
+					return false;
+				}
+				if (iRPos == 0 || (iRPos == 1 && sText[0] == '-')) //Decimal cannot be the first character.
+				{
+					return false;
+				}
+
+
+				if (bHasDecimal)
+				{
+					return false;
+				}
+				bHasDecimal = true;
+			}
+			else {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathParser::IsNumeric(const char *sText)
+{
+	return IsNumeric(sText, (int)strlen(sText));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CMathParser::InStr(const char *sSearchFor, const char *sInBuf, const int iBufSz, const int iStartPos)
+{
+	int iLookingLoop = 0;
+
+	if (iStartPos > iBufSz)
+	{
+		return -2;
+	}
+	int sSearchForSz = (int)strlen(sSearchFor);
+	if (sSearchForSz > iBufSz)
+	{
+		return -2;
+	}
+
+	for (int iControlLoop = iStartPos; iControlLoop <= (iBufSz - sSearchForSz); iControlLoop++)
+	{
+		if (sInBuf[iControlLoop] == sSearchFor[iLookingLoop])
+		{
+			while (iLookingLoop <= sSearchForSz)
+			{
+				if (sSearchFor[iLookingLoop] == sInBuf[iLookingLoop + iControlLoop])
+				{
+					iLookingLoop++;
+				}
+				else iLookingLoop = sSearchForSz + 1;
+
+				if (iLookingLoop == sSearchForSz)
+				{
+					return iControlLoop;
+				}
+			}
+		}
+		iLookingLoop = 0;
+	}
+
+	return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Computes base^exponent % modulus. The modulus must not be 0 (see CheckNativeParameters()).
+/// </summary>
+int CMathParser::ModPow(long long base, long long exponent, int modulus)
+{
+	long long result = 1;
+	while (exponent > 0)
+	{
+		if (exponent % 2 == 1)
+		{
+			result = (result * base) % modulus;
+		}
+		exponent = exponent >> 1;
+		base = (base * base) % modulus;
+	}
+	return (int)result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -1,151 +1,381 @@
-#ifndef _CMathParser_H
-#define _CMathParser_H
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-#define CMATHPARSER_MIN_PRECISION     0
-#define CMATHPARSER_MAX_PRECISION     32
-#define CMATHPARSER_DEFAULT_PRECISION 16
-#define CMATHPARSER_MAX_VAR_LENGTH    128
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-class CMathParser {
-private:
-	typedef struct _tag_Math_Expression {
-		char *Text;
-		int Length;
-		int Allocated;
-	} MATHEXPRESSION, *LPMATHEXPRESSION;
-
-	typedef struct _tag_Math_Inst {
-		MATHEXPRESSION Expression;
-		bool ForceIntegerMath;
-		bool ForceUnsignedMath;
-		double RunningTotal;
-	} MATHINSTANCE, *LPMATHINSTANCE;
-
-public:
-	typedef void(*TDebugTextCallback)(CMathParser* pParser, const char* sText);
-
-	/// <summary>
-	/// Allows for the interception for setting variables.
-	/// </summary>
-	/// <param name="pParser">Instance calling the callback.</param>
-	/// <param name="sMethodName">Name of the variable that was encountered.</param>
-	/// <param name="pOutResult">Pointer for pushing resulting value back to the engine.</param>
-	/// <returns></returns>
-	typedef bool (*TVariableSetCallback)(CMathParser* pParser, const char* sVarName, double* dReturnValue);
-
-	/// <summary>
-	/// Allows for the interception of function calls to implement custom methods.
-	/// </summary>
-	/// <param name="pParser">Instance calling the callback.</param>
-	/// <param name="sMethodName">Name of the function being invoked.</param>
-	/// <param name="dParameters">Array of parameters passed to the method.</param>
-	/// <param name="iParamCount">Count of the parameters being passed to the method.</param>
-	/// <param name="pOutResult">Pointer for pushing resulting value back to the engine.</param>
-	/// <returns></returns>
-	typedef bool (*TMethodCallback)(CMathParser* pParser, const char* sMethodName, double* dParameters, int iParamCount, double* pOutResult);
-
-	enum MathResult {
-		ResultFoundNegative = -1,
-		ResultOk = 0,
-		ResultInfiniteOrNotANumber,
-		ResultMissingOperator,
-		ResultInvalidOperator,
-		ResultInvalidToken,
-		ResultIntegerunderflow,
-		ResultIntegerOverflow,
-		ResultIntegerTextConversionFailed,
-		ResultDoubleTextConversionFailed,
-		ResultRightValueFailed,
-		ResultParenthesesMismatch,
-		ResultMemoryAllocationError,
-		ResultUndefiendVariable
-	};
-
-	typedef struct _tag_Error_Information {
-		char* Text;
-		MathResult Error;
-	} MATHERRORINFO, *LPMATHERRORINFO;
-
-	MathResult Calculate(const char *sExpression, int iExpressionSz, double *dResult);
-	MathResult Calculate(const char *sExpression, double *dResult);
-	MathResult Calculate(const char *sExpression, int iExpressionSz, int *iResult);
-	MathResult Calculate(const char *sExpression, int *iResult);
-	MathResult Calculate(const char *sExpression, int iExpressionSz, unsigned int *iResult);
-	MathResult Calculate(const char *sExpression, unsigned int *iResult);
-
-	int SmartRound(double dValue, char *sOut, int iMaxOutSz);
-
-	bool IsMathChar(const char cChar);
-	bool IsValidChar(const char cChar);
-	bool IsValidVariableChar(const char cChar);
-	bool IsIntegerExclusive(const char *sOperator);
-	int MatchParentheses(const char *sExpression, const int iExpressionSz);
-	int DoubleToChar(double dVal, char *sOut, int iMaxOutSz);
-	int ModPow(long long base, long long exponent, int modulus);
-
-	CMathParser(short iPrecision);
-	CMathParser(void);
-	~CMathParser(void);
-
-	short Precision(short iPrecision);
-	short Precision(void);
-
-	TMethodCallback GetMethodCallback(void);
-	TMethodCallback SetMethodCallback(TMethodCallback procPtr);
-
-	TVariableSetCallback GetVariableSetCallback(void);
-	TVariableSetCallback SetVariableSetCallback(TVariableSetCallback procPtr);
-
-	TDebugTextCallback GetDebugCallback(void);
-	TDebugTextCallback SetDebugCallback(TDebugTextCallback procPtr);
-
-	bool DebugMode(bool bDebugMode);
-	bool DebugMode(void);
-	MATHERRORINFO *LastError(void);
-
-private:
-	bool cbDebugMode;
-	short ciPrecision;
-	MATHERRORINFO LastErrorInfo;
-	TVariableSetCallback pVariableSetProc;
-	TMethodCallback pMethodProc;
-	TDebugTextCallback pDebugProc;
-
-	MathResult PerformDoubleOperation(MATHINSTANCE *pInst, double dVal1, const char *sOpr, double dVal2);
-	MathResult PerformBooleanOperation(MATHINSTANCE *pInst, int iVal, const char *sOpr);
-	MathResult PerformIntOperation(MATHINSTANCE *pInst, int iVal1, const char *sOpr, int iVal2);
-
-	MathResult CalculateSimpleExpression(MATHINSTANCE *pInst, MATHEXPRESSION *pSubExp);
-	MathResult CalculateComplexExpression(MATHINSTANCE *pInst);
-
-	MathResult GetLeftNumber(MATHEXPRESSION *pExp, int iStartPos, char *sOutVal, int iMaxSz, int *iOutSz, int *iBegin);
-	MathResult GetRightNumber(MATHEXPRESSION *pExp, int iStartPos, char *sOutVal, int iMaxSz, int *iOutSz, int *iEnd);
-	MathResult GetSubExpression(MATHINSTANCE *pInst, int *iBegin, int *iEnd);
-	MathResult ParseOperator(MATHINSTANCE *pInst, MATHEXPRESSION *pExp, const char *sOp, int iOpPos, int iOpSz);
-	MathResult ExecuteNativeMethod(const char* sMethodName, double* dParameters, int iParamCount, double* pOutResult);
-	MathResult ParseMethodParameters(const char* sSource, int iSourceSz, int* piRPos, double** pOutParameters, int* piOutParamCount);
-
-	int GetFreestandingNotOperation(MATHEXPRESSION *pExp);
-	int GetFirstOrderOperation(MATHEXPRESSION *pExp);
-	int GetSecondOrderOperation(MATHEXPRESSION *pExp, int iStartPos);
-
-	MathResult ReplaceValue(MATHEXPRESSION *pExp, int iBegin, int iEnd, const char *sWith, int iWithSz);
-	MathResult AllocateExpression(MATHEXPRESSION *pExp, const char *sSource, int iSourceSz);
-
-	int InStr(const char *sSearchFor, const char *sInBuf, const int iBufSz, const int iStartPos);
-	bool ReverseString(char *sBuf, int iBufSz);
-	bool IsWhiteSpace(const char cChar);
-	bool IsNativeMethod(const char* sName);
-	bool IsNumeric(const char cIn);
-	bool IsNumeric(const char *sText, int iLength);
-	bool IsNumeric(const char *sText);
-	int TrailingChars(const char *sVal, int iStartPos, const char cChar);
-
-	MathResult SetError(MathResult ErrorCode, const char *sFormat, ...);
-};
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#endif
+#ifndef _CMathParser_H
+#define _CMathParser_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define CMATHPARSER_MIN_PRECISION     0
+#define CMATHPARSER_MAX_PRECISION     32
+#define CMATHPARSER_DEFAULT_PRECISION 16
+#define CMATHPARSER_MAX_VAR_LENGTH    128
+#define CMATHPARSER_BATCH_BLOCK_SIZE  256 //Rows processed by each instruction of EvaluateBatch() at a time.
+#define CMATHPARSER_DEFAULT_CHUNK_SIZE 65536 //Rows handed to a worker thread of EvaluateBatch() at a time.
+#define CMATHPARSER_MAX_ERROR_ARGS    4   //Parameters of an error message which are kept until LastError() formats it.
+#define CMATHPARSER_MAX_ERROR_PAYLOAD 256 //Bytes kept for the text parameters of an error message.
+#define CMATHPARSER_MAX_ERROR_LENGTH  512 //Length of a formatted error message.
+#define CMATHPARSER_MAX_NESTING       1024 //Levels of parentheses (and prefix operators) which are evaluated by recursion.
+#define CMATHPARSER_MAX_NODE_DEPTH    1024 //Depth of the node tree of a compiled expression (ex: the terms of a sum).
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CMathExpression;
+class CMathLexer;
+class CMathThreadPool;
+class CMathCache;
+class CMathVariables;
+class CMathArena;
+class CMathContext;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CMathParser {
+	friend class CMathExpression;
+	friend class CMathLexer;
+	friend class CMathContext;
+	friend class CMathGraph;
+	friend class CMathColumns;
+	friend class CMathVector;
+
+private:
+	typedef struct _tag_Math_Expression {
+		char *Text;
+		int Length;
+		int Allocated;
+	} MATHEXPRESSION, *LPMATHEXPRESSION;
+
+	typedef struct _tag_Math_Inst {
+		MATHEXPRESSION Expression;
+		bool ForceIntegerMath;
+		bool ForceUnsignedMath;
+		bool Force64BitMath;       //Integer math on long long (or unsigned long long) instead of int.
+		double RunningTotal;
+		long long IntegerTotal;    //Result of the integer overloads, the bits of an unsigned long long.
+		int NestingDepth;          //Parentheses entered by the token stream, limited to CMATHPARSER_MAX_NESTING.
+	} MATHINSTANCE, *LPMATHINSTANCE;
+
+	enum MathOperator {
+		OperatorUnknown,
+		OperatorNot,              //"!": logical not as a prefix, not equal between two values.
+		OperatorBitwiseNot,       //"~"
+		OperatorMultiply,
+		OperatorDivide,
+		OperatorModulus,
+		OperatorAdd,
+		OperatorSubtract,
+		OperatorNotEqual,         //"<>" and "!=".
+		OperatorBitwiseOrEqual,
+		OperatorBitwiseAndEqual,
+		OperatorBitwiseXorEqual,
+		OperatorLessOrEqual,
+		OperatorGreaterOrEqual,
+		OperatorShiftLeft,
+		OperatorShiftRight,
+		OperatorEqual,
+		OperatorGreater,
+		OperatorLess,
+		OperatorLogicalAnd,
+		OperatorLogicalOr,
+		OperatorBitwiseOr,
+		OperatorBitwiseAnd,
+		OperatorBitwiseXor
+	};
+
+	enum MathMethod {
+		MethodUnknown = -1,
+		MethodNot,
+		MethodAcos,
+		MethodAsin,
+		MethodAtan,
+		MethodAtan2,
+		MethodLdexp,
+		MethodTan,
+		MethodSin,
+		MethodCos,
+		MethodAbs,
+		MethodSqrt,
+		MethodPow,
+		MethodModPow,
+		MethodSinh,
+		MethodCosh,
+		MethodTanh,
+		MethodLog,
+		MethodLog10,
+		MethodExp,
+		MethodFloor,
+		MethodCeil,
+		MethodSum,
+		MethodAvg
+	};
+
+	typedef struct _tag_Math_Operand {
+		double Value;         //atof() of the text of the value.
+		long Integer;         //atol() of the text of the value.
+	} MATHOPERAND, *LPMATHOPERAND;
+
+	typedef struct _tag_Math_Integer_Operand {
+		long long Value;      //Integer part of the value, the bits of an unsigned long long for 64 bit unsigned math.
+		int Fraction;         //Sign of the fractional part of a number read from the text (1 for "2.5"), otherwise 0.
+	} MATHINTEGEROPERAND, *LPMATHINTEGEROPERAND;
+
+	typedef struct _tag_Math_Batch {
+		CMathParser *Parser;
+		const CMathExpression *Expression;
+		const double *const *Columns;
+		double *Results;
+		double **Stacks;      //Value stack of each worker thread.
+	} MATHBATCH, *LPMATHBATCH;
+
+public:
+	typedef void(*TDebugTextCallback)(CMathParser* pParser, const char* sText);
+
+	/// <summary>
+	/// Allows for the interception for setting variables.
+	/// </summary>
+	/// <param name="pParser">Instance calling the callback.</param>
+	/// <param name="sMethodName">Name of the variable that was encountered.</param>
+	/// <param name="pOutResult">Pointer for pushing resulting value back to the engine.</param>
+	/// <returns></returns>
+	typedef bool (*TVariableSetCallback)(CMathParser* pParser, const char* sVarName, double* dReturnValue);
+
+	/// <summary>
+	/// Allows for the interception of function calls to implement custom methods.
+	/// </summary>
+	/// <param name="pParser">Instance calling the callback.</param>
+	/// <param name="sMethodName">Name of the function being invoked.</param>
+	/// <param name="dParameters">Array of parameters passed to the method.</param>
+	/// <param name="iParamCount">Count of the parameters being passed to the method.</param>
+	/// <param name="pOutResult">Pointer for pushing resulting value back to the engine.</param>
+	/// <returns></returns>
+	typedef bool (*TMethodCallback)(CMathParser* pParser, const char* sMethodName, double* dParameters, int iParamCount, double* pOutResult);
+
+	/// <summary>
+	/// Implements a function added by RegisterFunction().
+	/// </summary>
+	/// <param name="pParser">Instance calling the function.</param>
+	/// <param name="dParameters">Array of parameters passed to the function.</param>
+	/// <param name="iParamCount">Count of the parameters, always within the declared range.</param>
+	/// <param name="pOutResult">Pointer for pushing resulting value back to the engine.</param>
+	/// <param name="pUserData">Value passed to RegisterFunction().</param>
+	/// <returns>False to fail the evaluation with ResultFunctionFailed.</returns>
+	typedef bool (*TFunctionProc)(CMathParser* pParser, double* dParameters, int iParamCount, double* pOutResult, void* pUserData);
+
+	enum FunctionFlags {
+		FunctionPure = 1          //The result only depends on the parameters and the function can be called from any thread.
+	};
+
+	enum MathResult {
+		ResultFoundNegative = -1,
+		ResultOk = 0,
+		ResultInfiniteOrNotANumber,
+		ResultMissingOperator,
+		ResultInvalidOperator,
+		ResultInvalidToken,
+		ResultIntegerunderflow,
+		ResultIntegerOverflow,
+		ResultIntegerTextConversionFailed,
+		ResultDoubleTextConversionFailed,
+		ResultRightValueFailed,
+		ResultParenthesesMismatch,
+		ResultMemoryAllocationError,
+		ResultUndefiendVariable,
+		ResultFunctionFailed,
+		ResultCircularReference,
+		ResultFileError,
+		ResultNestingTooDeep
+	};
+
+	typedef struct _tag_Error_Information {
+		char* Text;
+		MathResult Error;
+		int Position;         //Offset into the expression where the error was found, -1 if not known.
+	} MATHERRORINFO, *LPMATHERRORINFO;
+
+	MathResult Calculate(const char *sExpression, int iExpressionSz, double *dResult);
+	MathResult Calculate(const char *sExpression, double *dResult);
+	MathResult Calculate(const char *sExpression, int iExpressionSz, int *iResult);
+	MathResult Calculate(const char *sExpression, int *iResult);
+	MathResult Calculate(const char *sExpression, int iExpressionSz, unsigned int *iResult);
+	MathResult Calculate(const char *sExpression, unsigned int *iResult);
+	MathResult Calculate(const char *sExpression, int iExpressionSz, long long *iResult);
+	MathResult Calculate(const char *sExpression, long long *iResult);
+	MathResult Calculate(const char *sExpression, int iExpressionSz, unsigned long long *iResult);
+	MathResult Calculate(const char *sExpression, unsigned long long *iResult);
+
+	MathResult Compile(const char *sExpression, int iExpressionSz, CMathExpression **pOutExpression);
+	MathResult Compile(const char *sExpression, CMathExpression **pOutExpression);
+	MathResult Evaluate(CMathExpression *pExpression, double *dResult);
+	MathResult Evaluate(CMathExpression *pExpression, const double *pSlots, double *dResult);
+	MathResult EvaluateBatch(CMathExpression *pExpression, const double *const *pColumns, size_t iRows, double *pResults);
+
+	MathResult RegisterFunction(const char *sName, int iMinArgs, int iMaxArgs, int iFlags, TFunctionProc pProc, void *pUserData);
+	MathResult SetVariable(const char *sName, double dValue);
+	MathResult BindVariable(const char *sName, double *pValue);
+	double *VariablePointer(const char *sName);
+	size_t HeapAllocations(void);
+
+	int SmartRound(double dValue, char *sOut, int iMaxOutSz);
+
+	bool IsMathChar(const char cChar);
+	bool IsValidChar(const char cChar);
+	bool IsValidVariableChar(const char cChar);
+	bool IsIntegerExclusive(const char *sOperator);
+	int MatchParentheses(const char *sExpression, const int iExpressionSz);
+	int DoubleToChar(double dVal, char *sOut, int iMaxOutSz);
+	static int ModPow(long long base, long long exponent, int modulus);
+
+	CMathParser(short iPrecision);
+	CMathParser(void);
+	~CMathParser(void);
+
+	short Precision(short iPrecision);
+	short Precision(void);
+
+	TMethodCallback GetMethodCallback(void);
+	TMethodCallback SetMethodCallback(TMethodCallback procPtr);
+
+	TVariableSetCallback GetVariableSetCallback(void);
+	TVariableSetCallback SetVariableSetCallback(TVariableSetCallback procPtr);
+
+	TDebugTextCallback GetDebugCallback(void);
+	TDebugTextCallback SetDebugCallback(TDebugTextCallback procPtr);
+
+	CMathCache *GetCache(void);
+	CMathCache *SetCache(CMathCache *pCache);
+
+	bool DebugMode(bool bDebugMode);
+	bool DebugMode(void);
+	bool JITMode(bool bJITMode);
+	bool JITMode(void);
+	bool IncrementalMode(bool bIncrementalMode);
+	bool IncrementalMode(void);
+	bool TokenizerMode(bool bTokenizerMode);
+	bool TokenizerMode(void);
+	bool BinaryMode(bool bBinaryMode);
+	bool BinaryMode(void);
+	bool VectorMathMode(bool bVectorMathMode);
+	bool VectorMathMode(void);
+	int ThreadCount(int iThreadCount);
+	int ThreadCount(void);
+	size_t ChunkSize(size_t iChunkSize);
+	size_t ChunkSize(void);
+	bool ThreadSafeCallbacks(bool bThreadSafeCallbacks);
+	bool ThreadSafeCallbacks(void);
+	MATHERRORINFO *LastError(void);
+
+private:
+	typedef struct _tag_Math_Function {
+		char *Name;
+		int MinArgs;
+		int MaxArgs;          //-1 for no limit.
+		int Flags;            //FunctionFlags.
+		TFunctionProc Proc;
+		void *UserData;
+	} MATHFUNCTION, *LPMATHFUNCTION;
+
+	bool cbDebugMode;
+	bool cbJITMode;
+	bool cbIncrementalMode;
+	bool cbTokenizerMode;
+	bool cbBinaryMode;
+	bool cbVectorMathMode;
+	bool cbThreadSafeCallbacks;
+	bool cbParallel; //EvaluateBatch() is running on the thread pool.
+	int ciThreadCount;
+	size_t ciChunkSize;
+	CMathThreadPool *pThreadPool;
+	CMathCache *pCache;
+	unsigned int ciCacheIdentity; //Distinguishes the cached compiled forms of this parser from those of other parsers.
+	CMathLexer *pLexer; //Token buffer reused by CalculateTokenStream().
+	CMathVariables *pVariableStore; //Variables set by SetVariable() and BindVariable(), NULL until the first one.
+	short ciPrecision;
+	CMathContext *pContext; //Scratch memory and error state of the parser's own calls.
+	TVariableSetCallback pVariableSetProc;
+	TMethodCallback pMethodProc;
+	TDebugTextCallback pDebugProc;
+	MATHFUNCTION *Functions;
+	int iFunctionCount;
+	int iFunctionsAllocated;
+
+	MathResult PerformDoubleOperation(MATHINSTANCE *pInst, double dVal1, MathOperator Operator, double dVal2);
+	MathResult PerformBooleanOperation(MATHINSTANCE *pInst, int iVal, MathOperator Operator);
+	MathResult PerformIntOperation(MATHINSTANCE *pInst, int iVal1, MathOperator Operator, int iVal2);
+	MathResult PerformInt64Operation(MATHINSTANCE *pInst, long long iVal1, MathOperator Operator, long long iVal2, long long *piResult);
+	MathOperator GetOperator(const char *sOperator);
+	bool IsIntegerExclusive(MathOperator Operator);
+
+	bool CalculateCached(const char *sExpression, int iExpressionSz, double *dResult, MathResult *pErrorCode);
+	bool EvaluateTextForm(MATHINSTANCE *pInst, const CMathExpression *pExpression, int iNode, MATHOPERAND *pResult, bool *pbNegative);
+	bool ReadTextValue(double dValue, MATHOPERAND *pResult, bool *pbNegative);
+	bool CalculateBinary(const char *sExpression, int iExpressionSz, double *dResult, MathResult *pErrorCode);
+	MathResult RoundToPrecision(double *pdValue);
+	MathResult CalculateSimpleExpression(MATHINSTANCE *pInst, MATHEXPRESSION *pSubExp);
+	MathResult CalculateComplexExpression(MATHINSTANCE *pInst);
+	bool CalculateTokenStream(MATHINSTANCE *pInst);
+	bool EvaluateTokenGroup(MATHINSTANCE *pInst, int *piToken, double *pdResult);
+	bool EvaluateTokenOperation(MATHINSTANCE *pInst, int *piToken, int iMinPrecedence, MATHOPERAND *pResult);
+	bool EvaluateTokenOperand(MATHINSTANCE *pInst, int *piToken, MATHOPERAND *pResult);
+	bool ReadTokenGroup(MATHINSTANCE *pInst, double dGroup, MATHOPERAND *pResult, bool *pbNegative);
+	bool ApplyTokenSign(const char *sSign, bool bNegative, MATHOPERAND *pResult);
+	bool ApplyTokenOperator(MATHINSTANCE *pInst, MathOperator Operator, MATHOPERAND *pLeft, const MATHOPERAND *pRight);
+	MathResult CalculateInteger(const char *sExpression, int iExpressionSz, bool bUnsigned, bool b64Bit, long long *piResult);
+	MathResult CalculateIntegerTokenStream(MATHINSTANCE *pInst);
+	bool EvaluateIntegerGroup(MATHINSTANCE *pInst, int *piToken, long long *piResult);
+	bool EvaluateIntegerOperation(MATHINSTANCE *pInst, int *piToken, int iMinPrecedence, MATHINTEGEROPERAND *pResult);
+	bool EvaluateIntegerOperand(MATHINSTANCE *pInst, int *piToken, MATHINTEGEROPERAND *pResult);
+	bool ApplyIntegerOperator(MATHINSTANCE *pInst, MathOperator Operator, MATHINTEGEROPERAND *pLeft, const MATHINTEGEROPERAND *pRight);
+	bool ReadInteger(MATHINSTANCE *pInst, const char *sText, MATHINTEGEROPERAND *pResult);
+	bool CheckIntegerRange(MATHINSTANCE *pInst, const MATHINTEGEROPERAND *pValue);
+	bool CheckIntegerToken(int iToken, int iExpectedType);
+	long long IntegerBitwiseNot(MATHINSTANCE *pInst, long long iValue);
+
+	MathResult GetLeftNumber(MATHEXPRESSION *pExp, int iStartPos, char *sOutVal, int iMaxSz, int *iOutSz, int *iBegin);
+	MathResult GetRightNumber(MATHEXPRESSION *pExp, int iStartPos, char *sOutVal, int iMaxSz, int *iOutSz, int *iEnd);
+	MathResult GetSubExpression(MATHINSTANCE *pInst, int *iBegin, int *iEnd);
+	MathResult ParseOperator(MATHINSTANCE *pInst, MATHEXPRESSION *pExp, const char *sOp, int iOpPos, int iOpSz);
+	MathResult ExecuteNativeMethod(MathMethod Method, const char* sMethodName, double* dParameters, int iParamCount, double* pOutResult);
+	double CallNativeMethod(MathMethod Method, const double* dParameters, int iParamCount);
+	MathResult CheckNativeParameters(CMathContext *pContext, MathMethod Method, const double* dParameters);
+	MathResult ExecuteFunction(int iFunction, double* dParameters, int iParamCount, double* pOutResult);
+	MathResult ParseMethodParameters(const char* sSource, int iSourceSz, int* piRPos, double** pOutParameters, int* piOutParamCount);
+	MathResult Evaluate(CMathContext *pContext, const CMathExpression *pExpression, double *dResult);
+	MathResult Evaluate(CMathContext *pContext, const CMathExpression *pExpression, const double *pSlots, double *dResult);
+	MathResult EvaluateBatch(CMathContext *pContext, const CMathExpression *pExpression, const double *const *pColumns, size_t iRows, double *pResults);
+	MathResult Execute(CMathContext *pContext, const CMathExpression *pExpression, const double *pVariables, double *pResult);
+	MathResult ExecuteInstructions(CMathContext *pContext, const CMathExpression *pExpression, int iFirstInstruction, int iInstructionCount, int iMaxStackDepth, int iTempCount, const double *pVariables, double *pResult);
+	MathResult EvaluateIncremental(CMathContext *pContext, const CMathExpression *pExpression, const double *pSlots, double *dResult);
+	MathResult EvaluateParallel(CMathExpression *pExpression, const double *const *pColumns, size_t iRows, double *pResults);
+	static bool EvaluateChunk(void *pContext, int iWorker, size_t iFirstRow, size_t iRows);
+	MathResult ExecuteRows(CMathContext *pContext, const CMathExpression *pExpression, const double *const *pColumns, size_t iFirstRow, size_t iRows, double *pStack, double *pResults);
+	bool InvokeMethodCallback(CMathContext *pContext, const char *sMethodName, double *dParameters, int iParamCount, double *pOutResult);
+	bool InvokeFunction(CMathContext *pContext, TFunctionProc pProc, void *pUserData, bool bPure, double *dParameters, int iParamCount, double *pOutResult);
+	MathResult ExecuteBlock(CMathContext *pContext, const CMathExpression *pExpression, const double *const *pColumns, size_t iFirstRow, int iRows, double *pStack, double *pResults);
+	MathResult EvaluateNode(const CMathExpression *pExpression, int iNode, const double *pVariables, double *pResult);
+
+	int GetFreestandingNotOperation(MATHEXPRESSION *pExp);
+	int GetFirstOrderOperation(MATHEXPRESSION *pExp);
+	int GetSecondOrderOperation(MATHEXPRESSION *pExp, int iStartPos);
+
+	MathResult ReplaceValue(MATHEXPRESSION *pExp, int iBegin, int iEnd, const char *sWith, int iWithSz);
+	MathResult AllocateExpression(MATHEXPRESSION *pExp, const char *sSource, int iSourceSz, bool bInteger);
+	MathResult FormatValue(double dValue, bool bInteger, char *sOut, int iMaxOutSz, int *piOutSz);
+
+	int InStr(const char *sSearchFor, const char *sInBuf, const int iBufSz, const int iStartPos);
+	bool ReverseString(char *sBuf, int iBufSz);
+	bool IsWhiteSpace(const char cChar);
+	bool IsValidName(const char *sName);
+	bool GetVariableValue(const char *sName, double *pOutValue);
+	bool IsNativeMethod(const char* sName);
+	MathMethod GetNativeMethod(const char* sName);
+	bool IsValidParamCount(MathMethod Method, int iParamCount);
+	int GetFunction(const char* sName);
+	bool IsNumeric(const char cIn);
+	bool IsNumeric(const char *sText, int iLength);
+	bool IsNumeric(const char *sText);
+	int TrailingChars(const char *sVal, int iStartPos, const char cChar);
+
+	MathResult SetError(MathResult ErrorCode, const char *sFormat, ...);
+	MathResult SetErrorAt(MathResult ErrorCode, int iPosition, const char *sFormat, ...);
+	MathResult SetError(CMathContext *pContext, MathResult ErrorCode, const char *sFormat, ...);
+	void ReportError(CMathContext *pContext, MathResult ErrorCode, int iPosition, const char *sFormat, va_list ArgList);
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
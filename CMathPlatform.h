@@ -0,0 +1,257 @@
+#ifndef _CMathPlatform_H
+#define _CMathPlatform_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Headers needed by the parser sources. The parser is written against the Visual C++ runtime, on other platforms
+///	(GCC and Clang on Linux) the few Microsoft specific functions it calls are implemented on top of the standard
+///	C library with the same parameters and return values.
+/// </summary>
+
+#ifdef _WIN32
+
+#include <Windows.H>
+#include <StdIO.H>
+#include <StdLib.H>
+#include <StdArg.H>
+#include <String.H>
+#include <Math.H>
+#include <Float.H>
+#include <Limits.H>
+
+#else
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <errno.h>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define _strcmpi strcasecmp
+#define sprintf_s snprintf
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline int _finite(double dValue)
+{
+	return isfinite(dValue) ? 1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline int _isnan(double dValue)
+{
+	return isnan(dValue) ? 1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline int strcpy_s(char *sDest, size_t iDestSz, const char *sSource)
+{
+	size_t iLength = strlen(sSource);
+	if (iLength >= iDestSz)
+	{
+		if (iDestSz > 0)
+		{
+			sDest[0] = '\0';
+		}
+		return ERANGE;
+	}
+
+	memcpy(sDest, sSource, iLength + 1);
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline int memcpy_s(void *pDest, size_t iDestSz, const void *pSource, size_t iCount)
+{
+	if (iCount > iDestSz)
+	{
+		return ERANGE;
+	}
+
+	memmove(pDest, pSource, iCount);
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline int _itoa_s(int iValue, char *sOut, size_t iOutSz, int iRadix)
+{
+	if (iRadix != 10)
+	{
+		return EINVAL;
+	}
+
+	int iLength = snprintf(sOut, iOutSz, "%d", iValue);
+	return (iLength < 0 || (size_t)iLength >= iOutSz) ? ERANGE : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Writes the digits of the value rounded to iDigits decimal places, without the sign and the decimal point, and
+///	returns where the decimal point goes. Leading zeros are dropped, a value which rounds to zero gives no digits.
+/// </summary>
+inline int _fcvt_s(char *sOut, size_t iOutSz, double dValue, int iDigits, int *piDecimal, int *piSign)
+{
+	char sText[512];
+	int iLength = snprintf(sText, sizeof(sText), "%.*f", iDigits, fabs(dValue));
+	if (iLength < 0 || iLength >= (int)sizeof(sText) || (size_t)iLength >= iOutSz)
+	{
+		return ERANGE;
+	}
+
+	const char *sPoint = strchr(sText, '.');
+	int iRPos = 0;
+
+	*piSign = signbit(dValue) ? 1 : 0;
+	*piDecimal = sPoint ? (int)(sPoint - sText) : iLength;
+
+	while (sText[iRPos] == '0' || sText[iRPos] == '.')
+	{
+		iRPos++;
+	}
+
+	if (sText[iRPos] == '\0')
+	{
+		if (dValue != 0 && iDigits > 0)
+		{
+			*piDecimal = -iDigits;
+			iRPos = iLength;
+		}
+		else {
+			iRPos = 0; //Zero itself keeps all of its digits.
+		}
+	}
+	else {
+		*piDecimal -= (sPoint && sPoint < sText + iRPos) ? iRPos - 1 : iRPos;
+	}
+
+	int iWPos = 0;
+	for (; iRPos < iLength; iRPos++)
+	{
+		if (sText[iRPos] != '.')
+		{
+			sOut[iWPos++] = sText[iRPos];
+		}
+	}
+	sOut[iWPos] = '\0';
+
+	return 0;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Checked 64 bit integer arithmetic: each function stores the result and returns true if it overflowed, in which
+///	case the stored value must not be used. GCC and Clang provide builtins which test the overflow flag of the
+///	processor and store the wrapped result, other compilers (Visual C++) check the operands beforehand and store
+///	nothing.
+/// </summary>
+inline bool CheckedAdd(long long iVal1, long long iVal2, long long *piResult)
+{
+#if defined(__GNUC__)
+	return __builtin_add_overflow(iVal1, iVal2, piResult);
+#else
+	if ((iVal2 > 0 && iVal1 > LLONG_MAX - iVal2) || (iVal2 < 0 && iVal1 < LLONG_MIN - iVal2))
+	{
+		return true;
+	}
+	*piResult = iVal1 + iVal2;
+	return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool CheckedAdd(unsigned long long iVal1, unsigned long long iVal2, unsigned long long *piResult)
+{
+#if defined(__GNUC__)
+	return __builtin_add_overflow(iVal1, iVal2, piResult);
+#else
+	if (iVal1 > ULLONG_MAX - iVal2)
+	{
+		return true;
+	}
+	*piResult = iVal1 + iVal2;
+	return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool CheckedSubtract(long long iVal1, long long iVal2, long long *piResult)
+{
+#if defined(__GNUC__)
+	return __builtin_sub_overflow(iVal1, iVal2, piResult);
+#else
+	if ((iVal2 < 0 && iVal1 > LLONG_MAX + iVal2) || (iVal2 > 0 && iVal1 < LLONG_MIN + iVal2))
+	{
+		return true;
+	}
+	*piResult = iVal1 - iVal2;
+	return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool CheckedSubtract(unsigned long long iVal1, unsigned long long iVal2, unsigned long long *piResult)
+{
+#if defined(__GNUC__)
+	return __builtin_sub_overflow(iVal1, iVal2, piResult);
+#else
+	if (iVal1 < iVal2)
+	{
+		return true;
+	}
+	*piResult = iVal1 - iVal2;
+	return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool CheckedMultiply(long long iVal1, long long iVal2, long long *piResult)
+{
+#if defined(__GNUC__)
+	return __builtin_mul_overflow(iVal1, iVal2, piResult);
+#else
+	if (iVal1 > 0 ? (iVal2 > 0 ? iVal1 > LLONG_MAX / iVal2 : iVal2 < LLONG_MIN / iVal1)
+		: (iVal2 > 0 ? iVal1 < LLONG_MIN / iVal2 : (iVal1 != 0 && iVal2 < LLONG_MAX / iVal1)))
+	{
+		return true;
+	}
+	*piResult = iVal1 * iVal2;
+	return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline bool CheckedMultiply(unsigned long long iVal1, unsigned long long iVal2, unsigned long long *piResult)
+{
+#if defined(__GNUC__)
+	return __builtin_mul_overflow(iVal1, iVal2, piResult);
+#else
+	if (iVal1 != 0 && iVal2 > ULLONG_MAX / iVal1)
+	{
+		return true;
+	}
+	*piResult = iVal1 * iVal2;
+	return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
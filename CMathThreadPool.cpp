@@ -0,0 +1,323 @@
+#ifndef _CMathThreadPool_CPP
+#define _CMathThreadPool_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include "CMathThreadPool.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define MATHTHREADPOOL_NO_FAILURE ((size_t)-1)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Starts the worker threads.
+/// </summary>
+/// <param name="iThreads">Total number of workers, including the thread which calls Run().</param>
+CMathThreadPool::CMathThreadPool(int iThreads)
+{
+	this->iThreadCount = (iThreads < 1) ? 1 : iThreads;
+	this->iGeneration = 0;
+	this->iBusyWorkers = 0;
+	this->bShutdown = false;
+	this->pTaskProc = NULL;
+	this->pContext = NULL;
+	this->iFailedItem = MATHTHREADPOOL_NO_FAILURE;
+	this->iStolenCount = 0;
+
+	this->Workers = new MATHWORKER[this->iThreadCount];
+	for (int iWorker = 0; iWorker < this->iThreadCount; iWorker++)
+	{
+		this->Workers[iWorker].Tasks = NULL;
+		this->Workers[iWorker].iHead = 0;
+		this->Workers[iWorker].iTail = 0;
+		this->Workers[iWorker].iAllocated = 0;
+	}
+
+	this->Threads = new std::thread[this->iThreadCount - 1];
+	for (int iWorker = 1; iWorker < this->iThreadCount; iWorker++)
+	{
+		this->Threads[iWorker - 1] = std::thread(&CMathThreadPool::WorkerThread, this, iWorker);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathThreadPool::~CMathThreadPool(void)
+{
+	{
+		std::lock_guard<std::mutex> Guard(this->StateLock);
+		this->bShutdown = true;
+	}
+	this->WorkReady.notify_all();
+
+	for (int iWorker = 1; iWorker < this->iThreadCount; iWorker++)
+	{
+		this->Threads[iWorker - 1].join();
+	}
+
+	for (int iWorker = 0; iWorker < this->iThreadCount; iWorker++)
+	{
+		free(this->Workers[iWorker].Tasks);
+	}
+
+	delete[] this->Threads;
+	delete[] this->Workers;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of hardware threads (cores, including hyper-threads) of the machine.
+/// </summary>
+int CMathThreadPool::HardwareThreads(void)
+{
+	int iThreads = (int)std::thread::hardware_concurrency();
+	return (iThreads < 1) ? 1 : iThreads;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int CMathThreadPool::ThreadCount(void)
+{
+	return this->iThreadCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Splits the items 0 to iCount - 1 into chunks and runs pTaskProc for each chunk on the workers, returning once
+///	all chunks have been processed. Each worker starts with a contiguous share of the chunks.
+/// </summary>
+/// <param name="iCount">Number of items.</param>
+/// <param name="iChunkSz">Number of items passed to each call of pTaskProc.</param>
+/// <param name="pTaskProc"></param>
+/// <param name="pContext">Passed to pTaskProc.</param>
+/// <returns>False if any chunk failed. Chunks which start after a failed chunk may have been skipped, but all
+///	chunks before the first failed chunk (see FailedItem()) have been processed.</returns>
+bool CMathThreadPool::Run(size_t iCount, size_t iChunkSz, TTaskProc pTaskProc, void *pContext)
+{
+	if (iChunkSz == 0)
+	{
+		iChunkSz = 1;
+	}
+
+	size_t iChunks = (iCount + iChunkSz - 1) / iChunkSz;
+
+	this->pTaskProc = pTaskProc;
+	this->pContext = pContext;
+	this->iFailedItem = MATHTHREADPOOL_NO_FAILURE;
+	this->iStolenCount = 0;
+
+	bool bQueued = true;
+
+	for (int iWorker = 0; iWorker < this->iThreadCount; iWorker++)
+	{
+		MATHWORKER *pWorker = &this->Workers[iWorker];
+		size_t iBegin = (iChunks * iWorker) / this->iThreadCount;
+		size_t iEnd = (iChunks * (iWorker + 1)) / this->iThreadCount;
+
+		std::lock_guard<std::mutex> Guard(pWorker->Lock);
+
+		pWorker->iHead = 0;
+		pWorker->iTail = 0;
+
+		if (!bQueued)
+		{
+			continue;
+		}
+
+		if ((size_t)pWorker->iAllocated < iEnd - iBegin)
+		{
+			MATHTASK *pTasks = (MATHTASK *)realloc(pWorker->Tasks, sizeof(MATHTASK) * (iEnd - iBegin));
+			if (!pTasks)
+			{
+				bQueued = false;
+				continue;
+			}
+			pWorker->Tasks = pTasks;
+			pWorker->iAllocated = (int)(iEnd - iBegin);
+		}
+
+		for (size_t iChunk = iBegin; iChunk < iEnd; iChunk++)
+		{
+			MATHTASK *pTask = &pWorker->Tasks[pWorker->iTail++];
+			pTask->First = iChunk * iChunkSz;
+			pTask->Count = (iCount - pTask->First < iChunkSz) ? iCount - pTask->First : iChunkSz;
+		}
+	}
+
+	if (!bQueued)
+	{
+		//Out of memory for the deques, run the chunks on this thread instead.
+		for (int iWorker = 0; iWorker < this->iThreadCount; iWorker++)
+		{
+			this->Workers[iWorker].iTail = 0;
+		}
+
+		for (size_t iFirst = 0; iFirst < iCount; iFirst += iChunkSz)
+		{
+			if (!pTaskProc(pContext, 0, iFirst, (iCount - iFirst < iChunkSz) ? iCount - iFirst : iChunkSz))
+			{
+				this->iFailedItem = iFirst;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> Guard(this->StateLock);
+		this->iBusyWorkers = this->iThreadCount - 1;
+		this->iGeneration++;
+	}
+	this->WorkReady.notify_all();
+
+	this->RunWorker(0);
+
+	{
+		std::unique_lock<std::mutex> Guard(this->StateLock);
+		this->WorkDone.wait(Guard, [this] { return this->iBusyWorkers == 0; });
+	}
+
+	return (this->iFailedItem == MATHTHREADPOOL_NO_FAILURE);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the first item of the first chunk which failed during the last Run().
+/// </summary>
+size_t CMathThreadPool::FailedItem(void)
+{
+	return this->iFailedItem;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of chunks which were stolen from another worker's deque during the last Run().
+/// </summary>
+int CMathThreadPool::StolenCount(void)
+{
+	return this->iStolenCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// General purpose locks for task procedures which need to serialize part of their work.
+/// </summary>
+/// <param name="iLock">0 to CMATHTHREADPOOL_LOCKS - 1.</param>
+void CMathThreadPool::Lock(int iLock)
+{
+	this->UserLocks[iLock].lock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathThreadPool::Unlock(int iLock)
+{
+	this->UserLocks[iLock].unlock();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathThreadPool::WorkerThread(int iWorker)
+{
+	long long iSeenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> Guard(this->StateLock);
+			this->WorkReady.wait(Guard, [&] { return this->bShutdown || this->iGeneration != iSeenGeneration; });
+			if (this->bShutdown)
+			{
+				return;
+			}
+			iSeenGeneration = this->iGeneration;
+		}
+
+		this->RunWorker(iWorker);
+
+		{
+			std::lock_guard<std::mutex> Guard(this->StateLock);
+			if (--this->iBusyWorkers == 0)
+			{
+				this->WorkDone.notify_all();
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Runs chunks from the worker's own deque, then from the other deques, until there are none left.
+/// </summary>
+void CMathThreadPool::RunWorker(int iWorker)
+{
+	MATHTASK Task;
+
+	while (this->TakeTask(iWorker, &Task) || this->StealTask(iWorker, &Task))
+	{
+		if (Task.First > this->iFailedItem)
+		{
+			continue; //An earlier chunk failed, the caller will not use the result.
+		}
+
+		if (!this->pTaskProc(this->pContext, iWorker, Task.First, Task.Count))
+		{
+			size_t iFailedItem = this->iFailedItem;
+			while (Task.First < iFailedItem && !this->iFailedItem.compare_exchange_weak(iFailedItem, Task.First))
+			{
+			}
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Takes the next chunk from the front of the worker's own deque, which keeps it walking forward through memory.
+/// </summary>
+bool CMathThreadPool::TakeTask(int iWorker, MATHTASK *pOutTask)
+{
+	MATHWORKER *pWorker = &this->Workers[iWorker];
+	std::lock_guard<std::mutex> Guard(pWorker->Lock);
+
+	if (pWorker->iHead < pWorker->iTail)
+	{
+		*pOutTask = pWorker->Tasks[pWorker->iHead++];
+		return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Steals the last chunk of another worker's deque, the one its owner would have reached last.
+/// </summary>
+bool CMathThreadPool::StealTask(int iWorker, MATHTASK *pOutTask)
+{
+	for (int iOffset = 1; iOffset < this->iThreadCount; iOffset++)
+	{
+		MATHWORKER *pVictim = &this->Workers[(iWorker + iOffset) % this->iThreadCount];
+		std::lock_guard<std::mutex> Guard(pVictim->Lock);
+
+		if (pVictim->iHead < pVictim->iTail)
+		{
+			*pOutTask = pVictim->Tasks[--pVictim->iTail];
+			this->iStolenCount++;
+			return true;
+		}
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
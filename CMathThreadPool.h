@@ -0,0 +1,86 @@
+#ifndef _CMathThreadPool_H
+#define _CMathThreadPool_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define CMATHTHREADPOOL_LOCKS 2 //Number of locks available through Lock() and Unlock().
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// A fixed set of worker threads which split a range of items (rows) into chunks. Each worker owns a deque of
+///	chunks: it takes work from the front of its own deque and, once that is empty, steals from the back of the
+///	other workers' deques, so a worker which finishes early picks up the slack of slower ones. The thread calling
+///	Run() takes part as worker 0.
+/// </summary>
+class CMathThreadPool {
+public:
+	/// <summary>
+	/// Processes one chunk of items.
+	/// </summary>
+	/// <param name="pContext">Value passed to Run().</param>
+	/// <param name="iWorker">Index of the worker running the chunk (0 to ThreadCount() - 1), for per worker scratch memory.</param>
+	/// <param name="iFirst">Index of the first item of the chunk.</param>
+	/// <param name="iCount">Number of items in the chunk.</param>
+	/// <returns>False to stop processing chunks which start after this one.</returns>
+	typedef bool (*TTaskProc)(void *pContext, int iWorker, size_t iFirst, size_t iCount);
+
+	CMathThreadPool(int iThreads);
+	~CMathThreadPool(void);
+
+	static int HardwareThreads(void);
+
+	int ThreadCount(void);
+	bool Run(size_t iCount, size_t iChunkSz, TTaskProc pTaskProc, void *pContext);
+	size_t FailedItem(void);
+	int StolenCount(void);
+
+	void Lock(int iLock);
+	void Unlock(int iLock);
+
+private:
+	typedef struct _tag_Math_Task {
+		size_t First;
+		size_t Count;
+	} MATHTASK, *LPMATHTASK;
+
+	typedef struct _tag_Math_Worker {
+		std::mutex Lock;
+		MATHTASK *Tasks;
+		int iHead;       //Next task taken by the owner.
+		int iTail;       //One past the next task taken by a thief.
+		int iAllocated;
+	} MATHWORKER, *LPMATHWORKER;
+
+	MATHWORKER *Workers;
+	std::thread *Threads;
+	int iThreadCount;
+
+	std::mutex StateLock;
+	std::condition_variable WorkReady;
+	std::condition_variable WorkDone;
+	long long iGeneration;
+	int iBusyWorkers;
+	bool bShutdown;
+
+	std::mutex UserLocks[CMATHTHREADPOOL_LOCKS];
+
+	TTaskProc pTaskProc;
+	void *pContext;
+	std::atomic<size_t> iFailedItem;
+	std::atomic<int> iStolenCount;
+
+	void WorkerThread(int iWorker);
+	void RunWorker(int iWorker);
+	bool TakeTask(int iWorker, MATHTASK *pOutTask);
+	bool StealTask(int iWorker, MATHTASK *pOutTask);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,224 @@
+#ifndef _CMathVariables_CPP
+#define _CMathVariables_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include "CMathVariables.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define MATHVARIABLES_INITIAL_SLOTS 32
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathVariables::CMathVariables(void)
+{
+	this->Slots = NULL;
+	this->iSlotCount = 0;
+	this->iCount = 0;
+
+	this->Pages = NULL;
+	this->iPageCount = 0;
+	this->iPagesAllocated = 0;
+	this->iPageUsed = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathVariables::~CMathVariables(void)
+{
+	for (int i = 0; i < this->iSlotCount; i++)
+	{
+		free(this->Slots[i].Name);
+	}
+	for (int i = 0; i < this->iPageCount; i++)
+	{
+		free(this->Pages[i]);
+	}
+
+	free(this->Slots);
+	free(this->Pages);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the number of variables defined.
+/// </summary>
+/// <returns></returns>
+int CMathVariables::Count(void)
+{
+	return this->iCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Case insensitive FNV-1a hash of a name.
+/// </summary>
+unsigned int CMathVariables::Hash(const char *sName)
+{
+	unsigned int iHash = 2166136261U;
+
+	for (int i = 0; sName[i]; i++)
+	{
+		char cChar = sName[i];
+		if (cChar >= 'a' && cChar <= 'z')
+		{
+			cChar -= ('a' - 'A');
+		}
+		iHash = (iHash ^ (unsigned char)cChar) * 16777619U;
+	}
+
+	return iHash;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the slot holding the name, or the empty slot where it should be stored.
+/// </summary>
+int CMathVariables::FindSlot(const char *sName, unsigned int iHash)
+{
+	int iMask = this->iSlotCount - 1;
+	int iSlot = (int)(iHash & (unsigned int)iMask);
+
+	while (this->Slots[iSlot].Name)
+	{
+		if (this->Slots[iSlot].Hash == iHash && _strcmpi(this->Slots[iSlot].Name, sName) == 0)
+		{
+			return iSlot;
+		}
+
+		iSlot = (iSlot + 1) & iMask;
+	}
+
+	return iSlot;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Finds a variable by name (case insensitive).
+/// </summary>
+/// <param name="sName"></param>
+/// <returns>The value of the variable, NULL if it is not defined.</returns>
+CMathVariables::MATHVALUE *CMathVariables::Find(const char *sName)
+{
+	if (this->iCount == 0)
+	{
+		return NULL;
+	}
+
+	return this->Slots[this->FindSlot(sName, this->Hash(sName))].Value;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Finds a variable by name, adding it (with a value of zero) if it is not defined yet. The name is not validated.
+/// </summary>
+/// <param name="sName"></param>
+/// <returns>The value of the variable, NULL if memory could not be allocated.</returns>
+CMathVariables::MATHVALUE *CMathVariables::Define(const char *sName)
+{
+	//Keep the table at most half full so that probe sequences stay short.
+	if ((this->iCount + 1) * 2 > this->iSlotCount && !this->Grow())
+	{
+		return NULL;
+	}
+
+	unsigned int iHash = this->Hash(sName);
+	int iSlot = this->FindSlot(sName, iHash);
+	MATHVARIABLE *pVariable = &this->Slots[iSlot];
+
+	if (pVariable->Name)
+	{
+		return pVariable->Value;
+	}
+
+	size_t iNameSz = strlen(sName);
+	char *sCopy = (char *)calloc(sizeof(char), iNameSz + 1);
+	MATHVALUE *pValue = this->AllocateValue();
+	if (!sCopy || !pValue)
+	{
+		free(sCopy);
+		return NULL;
+	}
+	memcpy(sCopy, sName, iNameSz);
+
+	pValue->Value = 0;
+	pValue->Pointer = &pValue->Value;
+
+	pVariable->Name = sCopy;
+	pVariable->Hash = iHash;
+	pVariable->Value = pValue;
+	this->iCount++;
+
+	return pValue;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CMathVariables::Grow(void)
+{
+	int iSlotCount = (this->iSlotCount == 0) ? MATHVARIABLES_INITIAL_SLOTS : this->iSlotCount * 2;
+	MATHVARIABLE *pSlots = (MATHVARIABLE *)calloc(sizeof(MATHVARIABLE), iSlotCount);
+	if (!pSlots)
+	{
+		return false;
+	}
+
+	MATHVARIABLE *pOldSlots = this->Slots;
+	int iOldSlotCount = this->iSlotCount;
+
+	this->Slots = pSlots;
+	this->iSlotCount = iSlotCount;
+
+	for (int i = 0; i < iOldSlotCount; i++)
+	{
+		if (pOldSlots[i].Name)
+		{
+			this->Slots[this->FindSlot(pOldSlots[i].Name, pOldSlots[i].Hash)] = pOldSlots[i];
+		}
+	}
+
+	free(pOldSlots);
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMathVariables::MATHVALUE *CMathVariables::AllocateValue(void)
+{
+	if (this->iPageCount == 0 || this->iPageUsed >= CMATHVARIABLES_PAGE_SIZE)
+	{
+		if (this->iPageCount >= this->iPagesAllocated)
+		{
+			int iAllocate = (this->iPagesAllocated == 0) ? 4 : this->iPagesAllocated * 2;
+			MATHVALUE **pPages = (MATHVALUE **)realloc(this->Pages, sizeof(MATHVALUE *) * iAllocate);
+			if (!pPages)
+			{
+				return NULL;
+			}
+			this->Pages = pPages;
+			this->iPagesAllocated = iAllocate;
+		}
+
+		MATHVALUE *pPage = (MATHVALUE *)calloc(sizeof(MATHVALUE), CMATHVARIABLES_PAGE_SIZE);
+		if (!pPage)
+		{
+			return NULL;
+		}
+
+		this->Pages[this->iPageCount++] = pPage;
+		this->iPageUsed = 0;
+	}
+
+	return &this->Pages[this->iPageCount - 1][this->iPageUsed++];
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,52 @@
+#ifndef _CMathVariables_H
+#define _CMathVariables_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define CMATHVARIABLES_PAGE_SIZE 64 //Values allocated at a time, pages are never moved so value pointers stay valid.
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// The variables defined on a parser with CMathParser::SetVariable() and CMathParser::BindVariable(): an open
+///	addressing hash table of interned, case insensitive names. Each variable owns a value which never moves, so
+///	compiled expressions (and the caller) can keep a pointer to it and read or update it with a single load or
+///	store. A variable can also be bound to a double owned by the caller, in which case it is read from there.
+/// </summary>
+class CMathVariables {
+public:
+	typedef struct _tag_Math_Value {
+		double *Pointer;      //&Value, or the double the variable is bound to.
+		double Value;
+	} MATHVALUE, *LPMATHVALUE;
+
+	CMathVariables(void);
+	~CMathVariables(void);
+
+	MATHVALUE *Find(const char *sName);
+	MATHVALUE *Define(const char *sName);
+	int Count(void);
+
+private:
+	typedef struct _tag_Math_Variable {
+		char *Name;           //NULL for an empty slot.
+		unsigned int Hash;
+		MATHVALUE *Value;
+	} MATHVARIABLE, *LPMATHVARIABLE;
+
+	MATHVARIABLE *Slots;
+	int iSlotCount;       //Always a power of two.
+	int iCount;
+
+	MATHVALUE **Pages;
+	int iPageCount;
+	int iPagesAllocated;
+	int iPageUsed;        //Values handed out from the last page.
+
+	static unsigned int Hash(const char *sName);
+	int FindSlot(const char *sName, unsigned int iHash);
+	bool Grow(void);
+	MATHVALUE *AllocateValue(void);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,1375 @@
+#ifndef _CMathVector_CPP
+#define _CMathVector_CPP
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathPlatform.h"
+
+#include <atomic>
+
+#include "CMathVector.h"
+
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CMATHVECTOR_AVX2
+#else
+#include <cpuid.h>
+#define CMATHVECTOR_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define VEC_MAGIC         6755399441055744.0      //1.5 * 2^52: adding it rounds to an integer held in the low mantissa bits.
+#define VEC_TWO52         4503599627370496.0      //2^52
+#define VEC_TWO54         18014398509481984.0     //2^54
+#define VEC_DBL_MIN       2.2250738585072014e-308 //Smallest normal double.
+#define VEC_SQRT2         1.4142135623730951
+#define VEC_LOG2E         1.4426950408889634
+#define VEC_INV_LN10      0.43429448190325176
+#define VEC_LN2_HI        6.93147180369123816490e-01
+#define VEC_LN2_LO        1.90821492927058770002e-10
+#define VEC_TWO_OVER_PI   6.36619772367581382433e-01
+#define VEC_PIO2_1        1.57079632673412561417e+00
+#define VEC_PIO2_2        6.07710050630396597660e-11
+#define VEC_PIO2_3        2.02226624871116645580e-21
+#define VEC_PIO2_3T       8.47842766036889956997e-32
+#define VEC_TRIG_LIMIT    524288.0                //2^19, q * VEC_PIO2_x stays exact below this.
+
+//1/k! for the Taylor series of e^r.
+#define EXP_C2            0.5
+#define EXP_C3            0.16666666666666666
+#define EXP_C4            0.041666666666666664
+#define EXP_C5            0.008333333333333333
+#define EXP_C6            0.001388888888888889
+#define EXP_C7            0.0001984126984126984
+#define EXP_C8            2.48015873015873e-05
+#define EXP_C9            2.7557319223985893e-06
+#define EXP_C10           2.755731922398589e-07
+#define EXP_C11           2.505210838544172e-08
+#define EXP_C12           2.08767569878681e-09
+#define EXP_C13           1.6059043836821613e-10
+
+//Polynomial coefficients from fdlibm (e_log.c, k_sin.c and k_cos.c).
+#define LOG_LG1           6.666666666666735130e-01
+#define LOG_LG2           3.999999999940941908e-01
+#define LOG_LG3           2.857142874366239149e-01
+#define LOG_LG4           2.222219843214978396e-01
+#define LOG_LG5           1.818357216161805012e-01
+#define LOG_LG6           1.531383769920937332e-01
+#define LOG_LG7           1.479819860511658591e-01
+
+#define SIN_S1           -1.66666666666666324348e-01
+#define SIN_S2            8.33333333332248946124e-03
+#define SIN_S3           -1.98412698298579493134e-04
+#define SIN_S4            2.75573137070700676789e-06
+#define SIN_S5           -2.50507602534068634195e-08
+#define SIN_S6            1.58969099521155010221e-10
+
+#define COS_C1            4.16666666666666019037e-02
+#define COS_C2           -1.38888888888741095749e-03
+#define COS_C3            2.48015872894767294178e-05
+#define COS_C4           -2.75573143513906633035e-07
+#define COS_C5            2.08757232129817482790e-09
+#define COS_C6           -1.13596475577881948265e-11
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Atomic since the first evaluations of several threads (see CMathContext) may detect the level at the same time.
+static std::atomic<int> giVectorLevel(-1);
+static std::atomic<int> giDetectedVectorLevel(-1);
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Determines the best instruction set supported by both the processor and the operating system.
+/// </summary>
+/// <returns>One of the VectorLevel values.</returns>
+int CMathVector::DetectLevel(void)
+{
+	if (giDetectedVectorLevel >= 0)
+	{
+		return giDetectedVectorLevel;
+	}
+
+	int iLevel = LevelScalar;
+
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	iLevel = LevelSSE2; //Part of the x86-64 baseline.
+
+#ifdef _MSC_VER
+	int iInfo[4];
+
+	__cpuid(iInfo, 0);
+	if (iInfo[0] >= 7)
+	{
+		__cpuid(iInfo, 1);
+		bool bOSXSave = (iInfo[2] & (1 << 27)) != 0;
+		bool bAVX = (iInfo[2] & (1 << 28)) != 0;
+
+		__cpuidex(iInfo, 7, 0);
+		bool bAVX2 = (iInfo[1] & (1 << 5)) != 0;
+
+		//The operating system must also save the upper halves of the YMM registers.
+		if (bOSXSave && bAVX && bAVX2 && (_xgetbv(0) & 6) == 6)
+		{
+			iLevel = LevelAVX2;
+		}
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		iLevel = LevelAVX2;
+	}
+#endif
+#endif
+
+	giDetectedVectorLevel = iLevel;
+
+	return iLevel;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Returns the instruction set in use.
+/// </summary>
+/// <returns>One of the VectorLevel values.</returns>
+int CMathVector::Level(void)
+{
+	if (giVectorLevel < 0)
+	{
+		giVectorLevel = DetectLevel();
+	}
+	return giVectorLevel;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Selects a lower instruction set than the one detected (ex: to compare the results of each). Requests for an
+///	instruction set which is not supported are limited to the detected one.
+/// </summary>
+/// <param name="iLevel">One of the VectorLevel values.</param>
+/// <returns>The previous setting.</returns>
+int CMathVector::Level(int iLevel)
+{
+	int iOldLevel = Level();
+	int iDetected = DetectLevel();
+
+	giVectorLevel = (iLevel < LevelScalar) ? LevelScalar : (iLevel > iDetected ? iDetected : iLevel);
+
+	return iOldLevel;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//SSE2 (2 doubles per instruction).
+
+static inline __m128d Sse2Set(double dValue) { return _mm_set1_pd(dValue); }
+static inline __m128d Sse2Load(const double *pIn) { return _mm_loadu_pd(pIn); }
+static inline void Sse2Store(double *pOut, __m128d v) { _mm_storeu_pd(pOut, v); }
+static inline __m128d Sse2Add(__m128d a, __m128d b) { return _mm_add_pd(a, b); }
+static inline __m128d Sse2Sub(__m128d a, __m128d b) { return _mm_sub_pd(a, b); }
+static inline __m128d Sse2Mul(__m128d a, __m128d b) { return _mm_mul_pd(a, b); }
+static inline __m128d Sse2Div(__m128d a, __m128d b) { return _mm_div_pd(a, b); }
+static inline __m128d Sse2Min(__m128d a, __m128d b) { return _mm_min_pd(a, b); }
+static inline __m128d Sse2Max(__m128d a, __m128d b) { return _mm_max_pd(a, b); }
+static inline __m128d Sse2Sqrt(__m128d a) { return _mm_sqrt_pd(a); }
+static inline __m128d Sse2And(__m128d a, __m128d b) { return _mm_and_pd(a, b); }
+static inline __m128d Sse2Or(__m128d a, __m128d b) { return _mm_or_pd(a, b); }
+static inline __m128d Sse2Xor(__m128d a, __m128d b) { return _mm_xor_pd(a, b); }
+static inline __m128d Sse2CmpLt(__m128d a, __m128d b) { return _mm_cmplt_pd(a, b); }
+static inline __m128d Sse2CmpLe(__m128d a, __m128d b) { return _mm_cmple_pd(a, b); }
+static inline __m128d Sse2CmpGt(__m128d a, __m128d b) { return _mm_cmpgt_pd(a, b); }
+static inline __m128d Sse2CmpEq(__m128d a, __m128d b) { return _mm_cmpeq_pd(a, b); }
+static inline __m128d Sse2CmpUnord(__m128d a, __m128d b) { return _mm_cmpunord_pd(a, b); }
+static inline __m128d Sse2Blend(__m128d a, __m128d b, __m128d mask) { return _mm_or_pd(_mm_andnot_pd(mask, a), _mm_and_pd(mask, b)); }
+static inline int Sse2MoveMask(__m128d a) { return _mm_movemask_pd(a); }
+static inline __m128i Sse2SetI(long long iValue) { return _mm_set1_epi64x(iValue); }
+static inline __m128i Sse2AddI(__m128i a, __m128i b) { return _mm_add_epi64(a, b); }
+static inline __m128i Sse2SubI(__m128i a, __m128i b) { return _mm_sub_epi64(a, b); }
+static inline __m128i Sse2AndI(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+static inline __m128i Sse2OrI(__m128i a, __m128i b) { return _mm_or_si128(a, b); }
+static inline __m128i Sse2ShiftLeft52(__m128i a) { return _mm_slli_epi64(a, 52); }
+static inline __m128i Sse2ShiftRight52(__m128i a) { return _mm_srli_epi64(a, 52); }
+static inline __m128i Sse2Bits(__m128d a) { return _mm_castpd_si128(a); }
+static inline __m128d Sse2FromBits(__m128i a) { return _mm_castsi128_pd(a); }
+
+//SSE2 has no 64 bit compare. The values compared here fit in the low 32 bits and the high halves are always equal,
+//	so compare 32 bit lanes and copy the result of the low half over the high half.
+static inline __m128d Sse2EqualI(__m128i a, __m128i b)
+{
+	return _mm_castsi128_pd(_mm_shuffle_epi32(_mm_cmpeq_epi32(a, b), _MM_SHUFFLE(2, 2, 0, 0)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline __m128d Sse2Abs(__m128d x)
+{
+	return Sse2And(x, Sse2FromBits(Sse2SetI(0x7FFFFFFFFFFFFFFFLL)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Rounds to an integer in the given direction (-1 for floor, 1 for ceil) without the SSE4.1 round instruction.
+/// </summary>
+static inline __m128d Sse2Round(__m128d x, double dDirection)
+{
+	__m128d vSign = Sse2FromBits(Sse2SetI((long long)0x8000000000000000ULL));
+	__m128d vAbs = Sse2Abs(x);
+
+	//Adding 2^52 leaves no room for a fraction, so this rounds |x| to the nearest integer.
+	__m128d vRounded = Sse2Sub(Sse2Add(vAbs, Sse2Set(VEC_TWO52)), Sse2Set(VEC_TWO52));
+	vRounded = Sse2Or(vRounded, Sse2And(x, vSign));
+
+	//Step back by one where rounding went the wrong way.
+	__m128d vWrongWay = (dDirection < 0) ? Sse2CmpGt(vRounded, x) : Sse2CmpLt(vRounded, x);
+	vRounded = Sse2Add(vRounded, Sse2And(vWrongWay, Sse2Set(dDirection)));
+
+	//Keep the sign of zero results (ex: ceil(-0.5) is -0).
+	vRounded = Sse2Or(vRounded, Sse2And(x, vSign));
+
+	//Values of 2^52 and above (and infinities and NaN) are already integers.
+	return Sse2Blend(x, vRounded, Sse2CmpLt(vAbs, Sse2Set(VEC_TWO52)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline __m128d Sse2Exp(__m128d x)
+{
+	__m128d vMagic = Sse2Set(VEC_MAGIC);
+	__m128d vNaN = Sse2CmpUnord(x, x);
+
+	//Beyond these limits the result is infinity or zero.
+	__m128d vX = Sse2Max(Sse2Min(x, Sse2Set(710.0)), Sse2Set(-746.0));
+
+	//x = n * ln(2) + r, |r| <= ln(2) / 2.
+	__m128d vT = Sse2Add(Sse2Mul(vX, Sse2Set(VEC_LOG2E)), vMagic);
+	__m128d vN = Sse2Sub(vT, vMagic);
+	__m128d vR = Sse2Sub(Sse2Sub(vX, Sse2Mul(vN, Sse2Set(VEC_LN2_HI))), Sse2Mul(vN, Sse2Set(VEC_LN2_LO)));
+
+	//Taylor series of e^r, the first omitted term is below 2^-57.
+	__m128d vP = Sse2Set(EXP_C13);
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C12));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C11));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C10));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C9));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C8));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C7));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C6));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C5));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C4));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C3));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(EXP_C2));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(1.0));
+	vP = Sse2Add(Sse2Mul(vP, vR), Sse2Set(1.0));
+
+	//Scale by 2^n in two steps so that neither factor leaves the normal range (n can be as large as 1024 or as
+	//	small as -1076). Subtracting the magic number from the bits of vT leaves n as a 64 bit integer.
+	__m128d vT1 = Sse2Add(Sse2Mul(vN, Sse2Set(0.5)), vMagic);
+	__m128d vT2 = Sse2Add(Sse2Sub(vN, Sse2Sub(vT1, vMagic)), vMagic);
+	__m128i vBias = Sse2SetI(1023);
+	__m128d vScale1 = Sse2FromBits(Sse2ShiftLeft52(Sse2AddI(Sse2SubI(Sse2Bits(vT1), Sse2Bits(vMagic)), vBias)));
+	__m128d vScale2 = Sse2FromBits(Sse2ShiftLeft52(Sse2AddI(Sse2SubI(Sse2Bits(vT2), Sse2Bits(vMagic)), vBias)));
+
+	__m128d vResult = Sse2Mul(Sse2Mul(vP, vScale1), vScale2);
+
+	return Sse2Blend(vResult, Sse2Add(x, x), vNaN);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline __m128d Sse2Log(__m128d x)
+{
+	__m128d vOne = Sse2Set(1.0);
+
+	//Bring subnormals into the normal range.
+	__m128d vSubnormal = Sse2CmpLt(x, Sse2Set(VEC_DBL_MIN));
+	__m128d vX = Sse2Blend(x, Sse2Mul(x, Sse2Set(VEC_TWO54)), vSubnormal);
+	__m128d vE = Sse2And(vSubnormal, Sse2Set(-54.0));
+
+	//x = m * 2^e, sqrt(2)/2 <= m < sqrt(2).
+	__m128i vBits = Sse2Bits(vX);
+	__m128i vExponent = Sse2AndI(Sse2ShiftRight52(vBits), Sse2SetI(0x7FF));
+	vE = Sse2Add(vE, Sse2Sub(Sse2Sub(Sse2FromBits(Sse2OrI(vExponent, Sse2Bits(Sse2Set(VEC_TWO52)))), Sse2Set(VEC_TWO52)), Sse2Set(1023.0)));
+
+	__m128d vM = Sse2FromBits(Sse2OrI(Sse2AndI(vBits, Sse2SetI(0x000FFFFFFFFFFFFFLL)), Sse2SetI(0x3FF0000000000000LL)));
+	__m128d vLarge = Sse2CmpGt(vM, Sse2Set(VEC_SQRT2));
+	vM = Sse2Blend(vM, Sse2Mul(vM, Sse2Set(0.5)), vLarge);
+	vE = Sse2Add(vE, Sse2And(vLarge, vOne));
+
+	//log(1 + f) = f - hfsq + s * (hfsq + R), s = f / (2 + f).
+	__m128d vF = Sse2Sub(vM, vOne);
+	__m128d vS = Sse2Div(vF, Sse2Add(Sse2Set(2.0), vF));
+	__m128d vZ = Sse2Mul(vS, vS);
+	__m128d vW = Sse2Mul(vZ, vZ);
+	__m128d vT1 = Sse2Mul(vW, Sse2Add(Sse2Set(LOG_LG2), Sse2Mul(vW, Sse2Add(Sse2Set(LOG_LG4), Sse2Mul(vW, Sse2Set(LOG_LG6))))));
+	__m128d vT2 = Sse2Mul(vZ, Sse2Add(Sse2Set(LOG_LG1), Sse2Mul(vW, Sse2Add(Sse2Set(LOG_LG3), Sse2Mul(vW, Sse2Add(Sse2Set(LOG_LG5), Sse2Mul(vW, Sse2Set(LOG_LG7))))))));
+	__m128d vR = Sse2Add(vT2, vT1);
+	__m128d vHfsq = Sse2Mul(Sse2Mul(Sse2Set(0.5), vF), vF);
+
+	__m128d vResult = Sse2Sub(Sse2Mul(vE, Sse2Set(VEC_LN2_HI)),
+		Sse2Sub(Sse2Sub(vHfsq, Sse2Add(Sse2Mul(vS, Sse2Add(vHfsq, vR)), Sse2Mul(vE, Sse2Set(VEC_LN2_LO)))), vF));
+
+	//log(NaN) = NaN, log(inf) = inf, log(0) = -inf, log(x < 0) = NaN.
+	__m128d vPassThrough = Sse2Or(Sse2CmpUnord(x, x), Sse2CmpEq(x, Sse2Set(HUGE_VAL)));
+	vResult = Sse2Blend(vResult, Sse2Add(x, x), vPassThrough);
+	vResult = Sse2Blend(vResult, Sse2Set(-HUGE_VAL), Sse2CmpEq(x, Sse2Set(0.0)));
+	vResult = Sse2Blend(vResult, Sse2FromBits(Sse2SetI(0x7FF8000000000000LL)), Sse2CmpLt(x, Sse2Set(0.0)));
+
+	return vResult;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Computes sin(x) (iQuadrantOffset 0) or cos(x) (iQuadrantOffset 1, since cos(x) = sin(x + PI/2)). Only valid
+///	for |x| <= VEC_TRIG_LIMIT.
+/// </summary>
+static inline __m128d Sse2SinCos(__m128d x, int iQuadrantOffset)
+{
+	__m128d vMagic = Sse2Set(VEC_MAGIC);
+
+	//x = q * PI/2 + r, |r| <= PI/4. Each part of PI/2 has 33 significant bits so q * part is exact.
+	__m128d vT = Sse2Add(Sse2Mul(x, Sse2Set(VEC_TWO_OVER_PI)), vMagic);
+	__m128d vQ = Sse2Sub(vT, vMagic);
+	__m128d vR = Sse2Sub(x, Sse2Mul(vQ, Sse2Set(VEC_PIO2_1)));
+	vR = Sse2Sub(vR, Sse2Mul(vQ, Sse2Set(VEC_PIO2_2)));
+	vR = Sse2Sub(vR, Sse2Mul(vQ, Sse2Set(VEC_PIO2_3)));
+	vR = Sse2Sub(vR, Sse2Mul(vQ, Sse2Set(VEC_PIO2_3T)));
+
+	__m128d vZ = Sse2Mul(vR, vR);
+
+	__m128d vSinPoly = Sse2Add(Sse2Set(SIN_S2), Sse2Mul(vZ, Sse2Add(Sse2Set(SIN_S3), Sse2Mul(vZ, Sse2Add(Sse2Set(SIN_S4), Sse2Mul(vZ, Sse2Add(Sse2Set(SIN_S5), Sse2Mul(vZ, Sse2Set(SIN_S6)))))))));
+	__m128d vSin = Sse2Add(vR, Sse2Mul(Sse2Mul(vZ, vR), Sse2Add(Sse2Set(SIN_S1), Sse2Mul(vZ, vSinPoly))));
+
+	__m128d vCosPoly = Sse2Mul(vZ, Sse2Add(Sse2Set(COS_C1), Sse2Mul(vZ, Sse2Add(Sse2Set(COS_C2), Sse2Mul(vZ, Sse2Add(Sse2Set(COS_C3), Sse2Mul(vZ, Sse2Add(Sse2Set(COS_C4), Sse2Mul(vZ, Sse2Add(Sse2Set(COS_C5), Sse2Mul(vZ, Sse2Set(COS_C6))))))))))));
+	__m128d vHalfZ = Sse2Mul(Sse2Set(0.5), vZ);
+	__m128d vW = Sse2Sub(Sse2Set(1.0), vHalfZ);
+	__m128d vCos = Sse2Add(vW, Sse2Add(Sse2Sub(Sse2Sub(Sse2Set(1.0), vW), vHalfZ), Sse2Mul(vZ, vCosPoly)));
+
+	//Quadrant 0: sin(r), 1: cos(r), 2: -sin(r), 3: -cos(r).
+	__m128i vQuadrant = Sse2AddI(Sse2SubI(Sse2Bits(vT), Sse2Bits(vMagic)), Sse2SetI(iQuadrantOffset));
+	__m128d vSwap = Sse2EqualI(Sse2AndI(vQuadrant, Sse2SetI(1)), Sse2SetI(1));
+	__m128d vNegate = Sse2EqualI(Sse2AndI(vQuadrant, Sse2SetI(2)), Sse2SetI(2));
+
+	__m128d vResult = Sse2Blend(vSin, vCos, vSwap);
+	vResult = Sse2Xor(vResult, Sse2And(vNegate, Sse2FromBits(Sse2SetI((long long)0x8000000000000000ULL))));
+
+	//sin(-0) = -0.
+	if (iQuadrantOffset == 0)
+	{
+		vResult = Sse2Blend(vResult, x, Sse2CmpEq(x, Sse2Set(0.0)));
+	}
+
+	return vResult;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Sse2SqrtArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 2 <= iCount; i += 2)
+	{
+		__m128d v = Sse2Load(pIn + i);
+		Sse2Store(pOut + i, Sse2Sqrt(v));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[2] = { 1.0, 1.0 };
+		double dOut[2];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m128d v = Sse2Load(dIn);
+		Sse2Store(dOut, Sse2Sqrt(v));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Sse2AbsArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 2 <= iCount; i += 2)
+	{
+		__m128d v = Sse2Load(pIn + i);
+		Sse2Store(pOut + i, Sse2Abs(v));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[2] = { 1.0, 1.0 };
+		double dOut[2];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m128d v = Sse2Load(dIn);
+		Sse2Store(dOut, Sse2Abs(v));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Sse2FloorArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 2 <= iCount; i += 2)
+	{
+		__m128d v = Sse2Load(pIn + i);
+		Sse2Store(pOut + i, Sse2Round(v, -1.0));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[2] = { 1.0, 1.0 };
+		double dOut[2];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m128d v = Sse2Load(dIn);
+		Sse2Store(dOut, Sse2Round(v, -1.0));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Sse2CeilArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 2 <= iCount; i += 2)
+	{
+		__m128d v = Sse2Load(pIn + i);
+		Sse2Store(pOut + i, Sse2Round(v, 1.0));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[2] = { 1.0, 1.0 };
+		double dOut[2];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m128d v = Sse2Load(dIn);
+		Sse2Store(dOut, Sse2Round(v, 1.0));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Sse2ExpArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 2 <= iCount; i += 2)
+	{
+		__m128d v = Sse2Load(pIn + i);
+		Sse2Store(pOut + i, Sse2Exp(v));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[2] = { 1.0, 1.0 };
+		double dOut[2];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m128d v = Sse2Load(dIn);
+		Sse2Store(dOut, Sse2Exp(v));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Sse2LogArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 2 <= iCount; i += 2)
+	{
+		__m128d v = Sse2Load(pIn + i);
+		Sse2Store(pOut + i, Sse2Log(v));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[2] = { 1.0, 1.0 };
+		double dOut[2];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m128d v = Sse2Load(dIn);
+		Sse2Store(dOut, Sse2Log(v));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Sse2Log10Array(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 2 <= iCount; i += 2)
+	{
+		__m128d v = Sse2Load(pIn + i);
+		Sse2Store(pOut + i, Sse2Mul(Sse2Log(v), Sse2Set(VEC_INV_LN10)));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[2] = { 1.0, 1.0 };
+		double dOut[2];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m128d v = Sse2Load(dIn);
+		Sse2Store(dOut, Sse2Mul(Sse2Log(v), Sse2Set(VEC_INV_LN10)));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Sse2SinCosArray(const double *pIn, double *pOut, int iCount, int iQuadrantOffset)
+{
+	double dIn[2];
+	double dOut[2];
+
+	for (int i = 0; i < iCount; i += 2)
+	{
+		int iLanes = (iCount - i < 2) ? iCount - i : 2;
+
+		for (int iLane = 0; iLane < 2; iLane++)
+		{
+			dIn[iLane] = (iLane < iLanes) ? pIn[i + iLane] : 0.0;
+		}
+
+		__m128d v = Sse2Load(dIn);
+
+		if (Sse2MoveMask(Sse2CmpLe(Sse2Abs(v), Sse2Set(VEC_TRIG_LIMIT))) == 0x3)
+		{
+			Sse2Store(dOut, Sse2SinCos(v, iQuadrantOffset));
+		}
+		else {
+			//Large arguments (and infinities and NaN) need the full range reduction of the C runtime.
+			for (int iLane = 0; iLane < iLanes; iLane++)
+			{
+				dOut[iLane] = iQuadrantOffset ? cos(dIn[iLane]) : sin(dIn[iLane]);
+			}
+		}
+
+		memcpy(pOut + i, dOut, sizeof(double) * iLanes);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void Sse2PowArray(const double *pX, const double *pY, double *pOut, int iCount)
+{
+	double dX[2];
+	double dY[2];
+	double dOut[2];
+
+	for (int i = 0; i < iCount; i += 2)
+	{
+		int iLanes = (iCount - i < 2) ? iCount - i : 2;
+
+		for (int iLane = 0; iLane < 2; iLane++)
+		{
+			dX[iLane] = (iLane < iLanes) ? pX[i + iLane] : 1.0;
+			dY[iLane] = (iLane < iLanes) ? pY[i + iLane] : 1.0;
+		}
+
+		__m128d vX = Sse2Load(dX);
+		__m128d vY = Sse2Load(dY);
+		__m128d vL = Sse2Mul(vY, Sse2Log(vX));
+
+		Sse2Store(dOut, Sse2Exp(vL));
+
+		//x^y = e^(y * ln(x)) only holds for positive x, the remaining cases are left to the C runtime.
+		__m128d vValid = Sse2And(Sse2CmpGt(vX, Sse2Set(0.0)), Sse2CmpLt(vX, Sse2Set(HUGE_VAL)));
+		vValid = Sse2And(vValid, Sse2CmpLt(Sse2Abs(vY), Sse2Set(HUGE_VAL)));
+		vValid = Sse2And(vValid, Sse2CmpLt(Sse2Abs(vL), Sse2Set(700.0)));
+
+		int iValid = Sse2MoveMask(vValid);
+		if (iValid != 0x3)
+		{
+			for (int iLane = 0; iLane < iLanes; iLane++)
+			{
+				if (!(iValid & (1 << iLane)))
+				{
+					dOut[iLane] = pow(dX[iLane], dY[iLane]);
+				}
+			}
+		}
+
+		memcpy(pOut + i, dOut, sizeof(double) * iLanes);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//AVX2 (4 doubles per instruction), the same algorithms as the SSE2 kernels above.
+
+static inline CMATHVECTOR_AVX2 __m256d Avx2Set(double dValue) { return _mm256_set1_pd(dValue); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Load(const double *pIn) { return _mm256_loadu_pd(pIn); }
+static inline CMATHVECTOR_AVX2 void Avx2Store(double *pOut, __m256d v) { _mm256_storeu_pd(pOut, v); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Sub(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Mul(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Div(__m256d a, __m256d b) { return _mm256_div_pd(a, b); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Min(__m256d a, __m256d b) { return _mm256_min_pd(a, b); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Max(__m256d a, __m256d b) { return _mm256_max_pd(a, b); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Sqrt(__m256d a) { return _mm256_sqrt_pd(a); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2And(__m256d a, __m256d b) { return _mm256_and_pd(a, b); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Or(__m256d a, __m256d b) { return _mm256_or_pd(a, b); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Xor(__m256d a, __m256d b) { return _mm256_xor_pd(a, b); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2CmpLt(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2CmpLe(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2CmpGt(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2CmpEq(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2CmpUnord(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_UNORD_Q); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2Blend(__m256d a, __m256d b, __m256d mask) { return _mm256_blendv_pd(a, b, mask); }
+static inline CMATHVECTOR_AVX2 int Avx2MoveMask(__m256d a) { return _mm256_movemask_pd(a); }
+static inline CMATHVECTOR_AVX2 __m256i Avx2SetI(long long iValue) { return _mm256_set1_epi64x(iValue); }
+static inline CMATHVECTOR_AVX2 __m256i Avx2AddI(__m256i a, __m256i b) { return _mm256_add_epi64(a, b); }
+static inline CMATHVECTOR_AVX2 __m256i Avx2SubI(__m256i a, __m256i b) { return _mm256_sub_epi64(a, b); }
+static inline CMATHVECTOR_AVX2 __m256i Avx2AndI(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+static inline CMATHVECTOR_AVX2 __m256i Avx2OrI(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+static inline CMATHVECTOR_AVX2 __m256i Avx2ShiftLeft52(__m256i a) { return _mm256_slli_epi64(a, 52); }
+static inline CMATHVECTOR_AVX2 __m256i Avx2ShiftRight52(__m256i a) { return _mm256_srli_epi64(a, 52); }
+static inline CMATHVECTOR_AVX2 __m256i Avx2Bits(__m256d a) { return _mm256_castpd_si256(a); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2FromBits(__m256i a) { return _mm256_castsi256_pd(a); }
+static inline CMATHVECTOR_AVX2 __m256d Avx2EqualI(__m256i a, __m256i b) { return _mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b)); }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline CMATHVECTOR_AVX2 __m256d Avx2Abs(__m256d x)
+{
+	return Avx2And(x, Avx2FromBits(Avx2SetI(0x7FFFFFFFFFFFFFFFLL)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Rounds to an integer in the given direction (-1 for floor, 1 for ceil) without the SSE4.1 round instruction.
+/// </summary>
+static inline CMATHVECTOR_AVX2 __m256d Avx2Round(__m256d x, double dDirection)
+{
+	__m256d vSign = Avx2FromBits(Avx2SetI((long long)0x8000000000000000ULL));
+	__m256d vAbs = Avx2Abs(x);
+
+	//Adding 2^52 leaves no room for a fraction, so this rounds |x| to the nearest integer.
+	__m256d vRounded = Avx2Sub(Avx2Add(vAbs, Avx2Set(VEC_TWO52)), Avx2Set(VEC_TWO52));
+	vRounded = Avx2Or(vRounded, Avx2And(x, vSign));
+
+	//Step back by one where rounding went the wrong way.
+	__m256d vWrongWay = (dDirection < 0) ? Avx2CmpGt(vRounded, x) : Avx2CmpLt(vRounded, x);
+	vRounded = Avx2Add(vRounded, Avx2And(vWrongWay, Avx2Set(dDirection)));
+
+	//Keep the sign of zero results (ex: ceil(-0.5) is -0).
+	vRounded = Avx2Or(vRounded, Avx2And(x, vSign));
+
+	//Values of 2^52 and above (and infinities and NaN) are already integers.
+	return Avx2Blend(x, vRounded, Avx2CmpLt(vAbs, Avx2Set(VEC_TWO52)));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline CMATHVECTOR_AVX2 __m256d Avx2Exp(__m256d x)
+{
+	__m256d vMagic = Avx2Set(VEC_MAGIC);
+	__m256d vNaN = Avx2CmpUnord(x, x);
+
+	//Beyond these limits the result is infinity or zero.
+	__m256d vX = Avx2Max(Avx2Min(x, Avx2Set(710.0)), Avx2Set(-746.0));
+
+	//x = n * ln(2) + r, |r| <= ln(2) / 2.
+	__m256d vT = Avx2Add(Avx2Mul(vX, Avx2Set(VEC_LOG2E)), vMagic);
+	__m256d vN = Avx2Sub(vT, vMagic);
+	__m256d vR = Avx2Sub(Avx2Sub(vX, Avx2Mul(vN, Avx2Set(VEC_LN2_HI))), Avx2Mul(vN, Avx2Set(VEC_LN2_LO)));
+
+	//Taylor series of e^r, the first omitted term is below 2^-57.
+	__m256d vP = Avx2Set(EXP_C13);
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C12));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C11));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C10));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C9));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C8));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C7));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C6));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C5));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C4));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C3));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(EXP_C2));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(1.0));
+	vP = Avx2Add(Avx2Mul(vP, vR), Avx2Set(1.0));
+
+	//Scale by 2^n in two steps so that neither factor leaves the normal range (n can be as large as 1024 or as
+	//	small as -1076). Subtracting the magic number from the bits of vT leaves n as a 64 bit integer.
+	__m256d vT1 = Avx2Add(Avx2Mul(vN, Avx2Set(0.5)), vMagic);
+	__m256d vT2 = Avx2Add(Avx2Sub(vN, Avx2Sub(vT1, vMagic)), vMagic);
+	__m256i vBias = Avx2SetI(1023);
+	__m256d vScale1 = Avx2FromBits(Avx2ShiftLeft52(Avx2AddI(Avx2SubI(Avx2Bits(vT1), Avx2Bits(vMagic)), vBias)));
+	__m256d vScale2 = Avx2FromBits(Avx2ShiftLeft52(Avx2AddI(Avx2SubI(Avx2Bits(vT2), Avx2Bits(vMagic)), vBias)));
+
+	__m256d vResult = Avx2Mul(Avx2Mul(vP, vScale1), vScale2);
+
+	return Avx2Blend(vResult, Avx2Add(x, x), vNaN);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline CMATHVECTOR_AVX2 __m256d Avx2Log(__m256d x)
+{
+	__m256d vOne = Avx2Set(1.0);
+
+	//Bring subnormals into the normal range.
+	__m256d vSubnormal = Avx2CmpLt(x, Avx2Set(VEC_DBL_MIN));
+	__m256d vX = Avx2Blend(x, Avx2Mul(x, Avx2Set(VEC_TWO54)), vSubnormal);
+	__m256d vE = Avx2And(vSubnormal, Avx2Set(-54.0));
+
+	//x = m * 2^e, sqrt(2)/2 <= m < sqrt(2).
+	__m256i vBits = Avx2Bits(vX);
+	__m256i vExponent = Avx2AndI(Avx2ShiftRight52(vBits), Avx2SetI(0x7FF));
+	vE = Avx2Add(vE, Avx2Sub(Avx2Sub(Avx2FromBits(Avx2OrI(vExponent, Avx2Bits(Avx2Set(VEC_TWO52)))), Avx2Set(VEC_TWO52)), Avx2Set(1023.0)));
+
+	__m256d vM = Avx2FromBits(Avx2OrI(Avx2AndI(vBits, Avx2SetI(0x000FFFFFFFFFFFFFLL)), Avx2SetI(0x3FF0000000000000LL)));
+	__m256d vLarge = Avx2CmpGt(vM, Avx2Set(VEC_SQRT2));
+	vM = Avx2Blend(vM, Avx2Mul(vM, Avx2Set(0.5)), vLarge);
+	vE = Avx2Add(vE, Avx2And(vLarge, vOne));
+
+	//log(1 + f) = f - hfsq + s * (hfsq + R), s = f / (2 + f).
+	__m256d vF = Avx2Sub(vM, vOne);
+	__m256d vS = Avx2Div(vF, Avx2Add(Avx2Set(2.0), vF));
+	__m256d vZ = Avx2Mul(vS, vS);
+	__m256d vW = Avx2Mul(vZ, vZ);
+	__m256d vT1 = Avx2Mul(vW, Avx2Add(Avx2Set(LOG_LG2), Avx2Mul(vW, Avx2Add(Avx2Set(LOG_LG4), Avx2Mul(vW, Avx2Set(LOG_LG6))))));
+	__m256d vT2 = Avx2Mul(vZ, Avx2Add(Avx2Set(LOG_LG1), Avx2Mul(vW, Avx2Add(Avx2Set(LOG_LG3), Avx2Mul(vW, Avx2Add(Avx2Set(LOG_LG5), Avx2Mul(vW, Avx2Set(LOG_LG7))))))));
+	__m256d vR = Avx2Add(vT2, vT1);
+	__m256d vHfsq = Avx2Mul(Avx2Mul(Avx2Set(0.5), vF), vF);
+
+	__m256d vResult = Avx2Sub(Avx2Mul(vE, Avx2Set(VEC_LN2_HI)),
+		Avx2Sub(Avx2Sub(vHfsq, Avx2Add(Avx2Mul(vS, Avx2Add(vHfsq, vR)), Avx2Mul(vE, Avx2Set(VEC_LN2_LO)))), vF));
+
+	//log(NaN) = NaN, log(inf) = inf, log(0) = -inf, log(x < 0) = NaN.
+	__m256d vPassThrough = Avx2Or(Avx2CmpUnord(x, x), Avx2CmpEq(x, Avx2Set(HUGE_VAL)));
+	vResult = Avx2Blend(vResult, Avx2Add(x, x), vPassThrough);
+	vResult = Avx2Blend(vResult, Avx2Set(-HUGE_VAL), Avx2CmpEq(x, Avx2Set(0.0)));
+	vResult = Avx2Blend(vResult, Avx2FromBits(Avx2SetI(0x7FF8000000000000LL)), Avx2CmpLt(x, Avx2Set(0.0)));
+
+	return vResult;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Computes sin(x) (iQuadrantOffset 0) or cos(x) (iQuadrantOffset 1, since cos(x) = sin(x + PI/2)). Only valid
+///	for |x| <= VEC_TRIG_LIMIT.
+/// </summary>
+static inline CMATHVECTOR_AVX2 __m256d Avx2SinCos(__m256d x, int iQuadrantOffset)
+{
+	__m256d vMagic = Avx2Set(VEC_MAGIC);
+
+	//x = q * PI/2 + r, |r| <= PI/4. Each part of PI/2 has 33 significant bits so q * part is exact.
+	__m256d vT = Avx2Add(Avx2Mul(x, Avx2Set(VEC_TWO_OVER_PI)), vMagic);
+	__m256d vQ = Avx2Sub(vT, vMagic);
+	__m256d vR = Avx2Sub(x, Avx2Mul(vQ, Avx2Set(VEC_PIO2_1)));
+	vR = Avx2Sub(vR, Avx2Mul(vQ, Avx2Set(VEC_PIO2_2)));
+	vR = Avx2Sub(vR, Avx2Mul(vQ, Avx2Set(VEC_PIO2_3)));
+	vR = Avx2Sub(vR, Avx2Mul(vQ, Avx2Set(VEC_PIO2_3T)));
+
+	__m256d vZ = Avx2Mul(vR, vR);
+
+	__m256d vSinPoly = Avx2Add(Avx2Set(SIN_S2), Avx2Mul(vZ, Avx2Add(Avx2Set(SIN_S3), Avx2Mul(vZ, Avx2Add(Avx2Set(SIN_S4), Avx2Mul(vZ, Avx2Add(Avx2Set(SIN_S5), Avx2Mul(vZ, Avx2Set(SIN_S6)))))))));
+	__m256d vSin = Avx2Add(vR, Avx2Mul(Avx2Mul(vZ, vR), Avx2Add(Avx2Set(SIN_S1), Avx2Mul(vZ, vSinPoly))));
+
+	__m256d vCosPoly = Avx2Mul(vZ, Avx2Add(Avx2Set(COS_C1), Avx2Mul(vZ, Avx2Add(Avx2Set(COS_C2), Avx2Mul(vZ, Avx2Add(Avx2Set(COS_C3), Avx2Mul(vZ, Avx2Add(Avx2Set(COS_C4), Avx2Mul(vZ, Avx2Add(Avx2Set(COS_C5), Avx2Mul(vZ, Avx2Set(COS_C6))))))))))));
+	__m256d vHalfZ = Avx2Mul(Avx2Set(0.5), vZ);
+	__m256d vW = Avx2Sub(Avx2Set(1.0), vHalfZ);
+	__m256d vCos = Avx2Add(vW, Avx2Add(Avx2Sub(Avx2Sub(Avx2Set(1.0), vW), vHalfZ), Avx2Mul(vZ, vCosPoly)));
+
+	//Quadrant 0: sin(r), 1: cos(r), 2: -sin(r), 3: -cos(r).
+	__m256i vQuadrant = Avx2AddI(Avx2SubI(Avx2Bits(vT), Avx2Bits(vMagic)), Avx2SetI(iQuadrantOffset));
+	__m256d vSwap = Avx2EqualI(Avx2AndI(vQuadrant, Avx2SetI(1)), Avx2SetI(1));
+	__m256d vNegate = Avx2EqualI(Avx2AndI(vQuadrant, Avx2SetI(2)), Avx2SetI(2));
+
+	__m256d vResult = Avx2Blend(vSin, vCos, vSwap);
+	vResult = Avx2Xor(vResult, Avx2And(vNegate, Avx2FromBits(Avx2SetI((long long)0x8000000000000000ULL))));
+
+	//sin(-0) = -0.
+	if (iQuadrantOffset == 0)
+	{
+		vResult = Avx2Blend(vResult, x, Avx2CmpEq(x, Avx2Set(0.0)));
+	}
+
+	return vResult;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static CMATHVECTOR_AVX2 void Avx2SqrtArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 4 <= iCount; i += 4)
+	{
+		__m256d v = Avx2Load(pIn + i);
+		Avx2Store(pOut + i, Avx2Sqrt(v));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[4] = { 1.0, 1.0, 1.0, 1.0 };
+		double dOut[4];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m256d v = Avx2Load(dIn);
+		Avx2Store(dOut, Avx2Sqrt(v));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static CMATHVECTOR_AVX2 void Avx2AbsArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 4 <= iCount; i += 4)
+	{
+		__m256d v = Avx2Load(pIn + i);
+		Avx2Store(pOut + i, Avx2Abs(v));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[4] = { 1.0, 1.0, 1.0, 1.0 };
+		double dOut[4];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m256d v = Avx2Load(dIn);
+		Avx2Store(dOut, Avx2Abs(v));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static CMATHVECTOR_AVX2 void Avx2FloorArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 4 <= iCount; i += 4)
+	{
+		__m256d v = Avx2Load(pIn + i);
+		Avx2Store(pOut + i, Avx2Round(v, -1.0));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[4] = { 1.0, 1.0, 1.0, 1.0 };
+		double dOut[4];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m256d v = Avx2Load(dIn);
+		Avx2Store(dOut, Avx2Round(v, -1.0));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static CMATHVECTOR_AVX2 void Avx2CeilArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 4 <= iCount; i += 4)
+	{
+		__m256d v = Avx2Load(pIn + i);
+		Avx2Store(pOut + i, Avx2Round(v, 1.0));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[4] = { 1.0, 1.0, 1.0, 1.0 };
+		double dOut[4];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m256d v = Avx2Load(dIn);
+		Avx2Store(dOut, Avx2Round(v, 1.0));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static CMATHVECTOR_AVX2 void Avx2ExpArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 4 <= iCount; i += 4)
+	{
+		__m256d v = Avx2Load(pIn + i);
+		Avx2Store(pOut + i, Avx2Exp(v));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[4] = { 1.0, 1.0, 1.0, 1.0 };
+		double dOut[4];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m256d v = Avx2Load(dIn);
+		Avx2Store(dOut, Avx2Exp(v));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static CMATHVECTOR_AVX2 void Avx2LogArray(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 4 <= iCount; i += 4)
+	{
+		__m256d v = Avx2Load(pIn + i);
+		Avx2Store(pOut + i, Avx2Log(v));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[4] = { 1.0, 1.0, 1.0, 1.0 };
+		double dOut[4];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m256d v = Avx2Load(dIn);
+		Avx2Store(dOut, Avx2Log(v));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static CMATHVECTOR_AVX2 void Avx2Log10Array(const double *pIn, double *pOut, int iCount)
+{
+	int i = 0;
+
+	for (; i + 4 <= iCount; i += 4)
+	{
+		__m256d v = Avx2Load(pIn + i);
+		Avx2Store(pOut + i, Avx2Mul(Avx2Log(v), Avx2Set(VEC_INV_LN10)));
+	}
+
+	if (i < iCount)
+	{
+		double dIn[4] = { 1.0, 1.0, 1.0, 1.0 };
+		double dOut[4];
+
+		memcpy(dIn, pIn + i, sizeof(double) * (iCount - i));
+		__m256d v = Avx2Load(dIn);
+		Avx2Store(dOut, Avx2Mul(Avx2Log(v), Avx2Set(VEC_INV_LN10)));
+		memcpy(pOut + i, dOut, sizeof(double) * (iCount - i));
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static CMATHVECTOR_AVX2 void Avx2SinCosArray(const double *pIn, double *pOut, int iCount, int iQuadrantOffset)
+{
+	double dIn[4];
+	double dOut[4];
+
+	for (int i = 0; i < iCount; i += 4)
+	{
+		int iLanes = (iCount - i < 4) ? iCount - i : 4;
+
+		for (int iLane = 0; iLane < 4; iLane++)
+		{
+			dIn[iLane] = (iLane < iLanes) ? pIn[i + iLane] : 0.0;
+		}
+
+		__m256d v = Avx2Load(dIn);
+
+		if (Avx2MoveMask(Avx2CmpLe(Avx2Abs(v), Avx2Set(VEC_TRIG_LIMIT))) == 0xF)
+		{
+			Avx2Store(dOut, Avx2SinCos(v, iQuadrantOffset));
+		}
+		else {
+			//Large arguments (and infinities and NaN) need the full range reduction of the C runtime.
+			for (int iLane = 0; iLane < iLanes; iLane++)
+			{
+				dOut[iLane] = iQuadrantOffset ? cos(dIn[iLane]) : sin(dIn[iLane]);
+			}
+		}
+
+		memcpy(pOut + i, dOut, sizeof(double) * iLanes);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static CMATHVECTOR_AVX2 void Avx2PowArray(const double *pX, const double *pY, double *pOut, int iCount)
+{
+	double dX[4];
+	double dY[4];
+	double dOut[4];
+
+	for (int i = 0; i < iCount; i += 4)
+	{
+		int iLanes = (iCount - i < 4) ? iCount - i : 4;
+
+		for (int iLane = 0; iLane < 4; iLane++)
+		{
+			dX[iLane] = (iLane < iLanes) ? pX[i + iLane] : 1.0;
+			dY[iLane] = (iLane < iLanes) ? pY[i + iLane] : 1.0;
+		}
+
+		__m256d vX = Avx2Load(dX);
+		__m256d vY = Avx2Load(dY);
+		__m256d vL = Avx2Mul(vY, Avx2Log(vX));
+
+		Avx2Store(dOut, Avx2Exp(vL));
+
+		//x^y = e^(y * ln(x)) only holds for positive x, the remaining cases are left to the C runtime.
+		__m256d vValid = Avx2And(Avx2CmpGt(vX, Avx2Set(0.0)), Avx2CmpLt(vX, Avx2Set(HUGE_VAL)));
+		vValid = Avx2And(vValid, Avx2CmpLt(Avx2Abs(vY), Avx2Set(HUGE_VAL)));
+		vValid = Avx2And(vValid, Avx2CmpLt(Avx2Abs(vL), Avx2Set(700.0)));
+
+		int iValid = Avx2MoveMask(vValid);
+		if (iValid != 0xF)
+		{
+			for (int iLane = 0; iLane < iLanes; iLane++)
+			{
+				if (!(iValid & (1 << iLane)))
+				{
+					dOut[iLane] = pow(dX[iLane], dY[iLane]);
+				}
+			}
+		}
+
+		memcpy(pOut + i, dOut, sizeof(double) * iLanes);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Sqrt(const double *pIn, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2SqrtArray(pIn, pOut, iCount);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2SqrtArray(pIn, pOut, iCount);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = sqrt(pIn[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Abs(const double *pIn, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2AbsArray(pIn, pOut, iCount);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2AbsArray(pIn, pOut, iCount);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = fabs(pIn[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Floor(const double *pIn, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2FloorArray(pIn, pOut, iCount);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2FloorArray(pIn, pOut, iCount);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = floor(pIn[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Ceil(const double *pIn, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2CeilArray(pIn, pOut, iCount);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2CeilArray(pIn, pOut, iCount);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = ceil(pIn[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Exp(const double *pIn, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2ExpArray(pIn, pOut, iCount);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2ExpArray(pIn, pOut, iCount);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = exp(pIn[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Log(const double *pIn, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2LogArray(pIn, pOut, iCount);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2LogArray(pIn, pOut, iCount);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = log(pIn[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Log10(const double *pIn, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2Log10Array(pIn, pOut, iCount);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2Log10Array(pIn, pOut, iCount);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = log10(pIn[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Sin(const double *pIn, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2SinCosArray(pIn, pOut, iCount, 0);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2SinCosArray(pIn, pOut, iCount, 0);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = sin(pIn[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Cos(const double *pIn, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2SinCosArray(pIn, pOut, iCount, 1);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2SinCosArray(pIn, pOut, iCount, 1);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = cos(pIn[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CMathVector::Pow(const double *pX, const double *pY, double *pOut, int iCount)
+{
+#ifdef CMATHPARSER_SIMD_SUPPORTED
+	if (Level() == LevelAVX2)
+	{
+		Avx2PowArray(pX, pY, pOut, iCount);
+		return;
+	}
+	else if (Level() == LevelSSE2)
+	{
+		Sse2PowArray(pX, pY, pOut, iCount);
+		return;
+	}
+#endif
+
+	for (int i = 0; i < iCount; i++)
+	{
+		pOut[i] = pow(pX[i], pY[i]);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Lets us know whether the array implementation of a native method gives exactly the same results as the C runtime.
+/// </summary>
+/// <param name="Method"></param>
+/// <returns></returns>
+bool CMathVector::IsExact(CMathParser::MathMethod Method)
+{
+	switch (Method)
+	{
+	case CMathParser::MethodSqrt:
+	case CMathParser::MethodAbs:
+	case CMathParser::MethodFloor:
+	case CMathParser::MethodCeil:
+		return true;
+	default:
+		return false;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Runs the array implementation of a native method, if there is one.
+/// </summary>
+/// <param name="Method"></param>
+/// <param name="iArgCount"></param>
+/// <param name="pArgs">One array of iCount values for each parameter.</param>
+/// <param name="pOut">Receives iCount results, may be the same array as the first parameter.</param>
+/// <param name="iCount"></param>
+/// <param name="bApproximate">Allow kernels which are not exact (see the accuracy notes in CMathVector.h).</param>
+/// <returns>False if the method has no array implementation (or it is not allowed), in which case nothing is done.</returns>
+bool CMathVector::Execute(CMathParser::MathMethod Method, int iArgCount, const double *const *pArgs, double *pOut, int iCount, bool bApproximate)
+{
+	if (iArgCount == 1 && IsExact(Method))
+	{
+		switch (Method)
+		{
+		case CMathParser::MethodSqrt: Sqrt(pArgs[0], pOut, iCount); break;
+		case CMathParser::MethodAbs: Abs(pArgs[0], pOut, iCount); break;
+		case CMathParser::MethodFloor: Floor(pArgs[0], pOut, iCount); break;
+		case CMathParser::MethodCeil: Ceil(pArgs[0], pOut, iCount); break;
+		default: return false;
+		}
+		return true;
+	}
+	else if (!bApproximate)
+	{
+		return false;
+	}
+	else if (iArgCount == 1)
+	{
+		switch (Method)
+		{
+		case CMathParser::MethodExp: Exp(pArgs[0], pOut, iCount); break;
+		case CMathParser::MethodLog: Log(pArgs[0], pOut, iCount); break;
+		case CMathParser::MethodLog10: Log10(pArgs[0], pOut, iCount); break;
+		case CMathParser::MethodSin: Sin(pArgs[0], pOut, iCount); break;
+		case CMathParser::MethodCos: Cos(pArgs[0], pOut, iCount); break;
+		default: return false;
+		}
+		return true;
+	}
+	else if (iArgCount == 2 && Method == CMathParser::MethodPow)
+	{
+		Pow(pArgs[0], pArgs[1], pOut, iCount);
+		return true;
+	}
+
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
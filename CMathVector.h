@@ -0,0 +1,61 @@
+#ifndef _CMathVector_H
+#define _CMathVector_H
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "CMathParser.h"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CMATHPARSER_SIMD_SUPPORTED
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// <summary>
+/// Array implementations of the native methods which are used by CMathParser::EvaluateBatch(). The best
+///	instruction set is selected at runtime (AVX2 processes 4 doubles per instruction, SSE2 processes 2), with a
+///	scalar fallback which simply calls the C runtime. The SSE2 and AVX2 kernels perform the same operations and
+///	produce identical results.
+///
+/// Accuracy compared to the C runtime (ulp = unit in the last place of the exact result):
+///	Sqrt, Abs, Floor, Ceil: exact.
+///	Exp:   1 ulp. Results which underflow to subnormals may lose up to 1 ulp of the subnormal.
+///	Log:   1 ulp.
+///	Log10: 3 ulp.
+///	Sin, Cos: 1 ulp for |x| <= PI/4, otherwise an absolute error of at most 2^-53 * (1 + |x| / 2^20). Lanes with
+///		|x| > 2^19 (and infinities) are computed by the C runtime.
+///	Pow:   (2 + 2 * |y * ln(x)|) ulp for x > 0, since the result is computed as exp(y * log(x)). Lanes with x <= 0,
+///		non finite parameters or results which overflow or underflow are computed by the C runtime.
+/// The approximate kernels (Exp, Log, Log10, Sin, Cos and Pow) are only used when CMathParser::VectorMathMode()
+///	is enabled.
+/// </summary>
+class CMathVector {
+public:
+	enum VectorLevel {
+		LevelScalar,
+		LevelSSE2,
+		LevelAVX2
+	};
+
+	static int DetectLevel(void);
+	static int Level(void);
+	static int Level(int iLevel);
+
+	static bool IsExact(CMathParser::MathMethod Method);
+	static bool Execute(CMathParser::MathMethod Method, int iArgCount, const double *const *pArgs, double *pOut, int iCount, bool bApproximate);
+
+	static void Sqrt(const double *pIn, double *pOut, int iCount);
+	static void Abs(const double *pIn, double *pOut, int iCount);
+	static void Floor(const double *pIn, double *pOut, int iCount);
+	static void Ceil(const double *pIn, double *pOut, int iCount);
+	static void Exp(const double *pIn, double *pOut, int iCount);
+	static void Log(const double *pIn, double *pOut, int iCount);
+	static void Log10(const double *pIn, double *pOut, int iCount);
+	static void Sin(const double *pIn, double *pOut, int iCount);
+	static void Cos(const double *pIn, double *pOut, int iCount);
+	static void Pow(const double *pX, const double *pY, double *pOut, int iCount);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif